@@ -274,6 +274,10 @@ else:
     except (ImportError, AttributeError):
         MAX_JOBS = 1
 
+# the number of threads a single encoder or decoder may use
+# for formats able to process independent frames in parallel
+CODEC_THREADS = max(config.getint_default("System", "codec_threads", 1), 1)
+
 
 class Messenger(object):
     """this class is for displaying formatted output in a consistent way"""
@@ -2591,11 +2595,13 @@ class ThreadedPCMReader(PCMReader):
             """transfers everything from pcmreader to queue
             until stop_event is set or the data is exhausted"""
 
+            # queued FrameLists may pile up faster than they're read
+            # so store them as compactly as possible
             try:
                 framelist = pcmreader.read(4096)
                 while ((len(framelist) > 0) and
                        (not stop_event.is_set())):
-                    queue.put((False, framelist))
+                    queue.put((False, framelist.compact()))
                     framelist = pcmreader.read(4096)
             except (IOError, ValueError) as err:
                 queue.put((True, err))
@@ -2930,46 +2936,26 @@ def PCMConverter(pcmreader,
         from audiotools.text import ERR_CHANNEL_COUNT_MASK_MISMATCH
         raise ValueError(ERR_CHANNEL_COUNT_MASK_MISMATCH)
 
-    if pcmreader.channels > channels:
-        if (channels == 1) and (channel_mask in (0, 0x4)):
-            if pcmreader.channels > 2:
-                # reduce channel count through downmixing
-                # followed by averaging
-                from audiotools.pcmconverter import (Averager, Downmixer)
-                pcmreader = Averager(Downmixer(pcmreader))
-            else:
-                # pcmreader.channels == 2
-                # so reduce channel count through averaging
-                from audiotools.pcmconverter import Averager
-                pcmreader = Averager(pcmreader)
-        elif (channels == 2) and (channel_mask in (0, 0x3)):
-            # reduce channel count through downmixing
-            from audiotools.pcmconverter import Downmixer
-            pcmreader = Downmixer(pcmreader)
-        else:
-            # unusual channel count/mask combination
-            pcmreader = RemaskedPCMReader(pcmreader,
-                                          channels,
-                                          channel_mask)
-    elif pcmreader.channels < channels:
-        # increase channel count by duplicating first channel
-        # (this is usually just going from mono to stereo
-        #  since there's no way to summon surround channels
-        #  out of thin air)
-        pcmreader = ReorderedPCMReader(pcmreader,
-                                       list(range(pcmreader.channels)) +
-                                       [0] * (channels - pcmreader.channels),
-                                       channel_mask)
-
-    if pcmreader.sample_rate != sample_rate:
-        # convert sample rate through resampling
-        from audiotools.pcmconverter import Resampler
-        pcmreader = Resampler(pcmreader, sample_rate)
-
-    if pcmreader.bits_per_sample != bits_per_sample:
-        # use bitshifts/dithering to adjust bits-per-sample
-        from audiotools.pcmconverter import BPSConverter
-        pcmreader = BPSConverter(pcmreader, bits_per_sample)
+    if ((pcmreader.channels > channels) and
+        not (((channels == 1) and (channel_mask in (0, 0x4))) or
+             ((channels == 2) and (channel_mask in (0, 0x3))))):
+        # unusual channel count/mask combination
+        pcmreader = RemaskedPCMReader(pcmreader,
+                                      channels,
+                                      channel_mask)
+
+    if ((pcmreader.channels != channels) or
+        (pcmreader.sample_rate != sample_rate) or
+        (pcmreader.bits_per_sample != bits_per_sample)):
+        # downmix, average or duplicate channels,
+        # resample and adjust bits-per-sample in a single pass
+        # which stays in floating point until the final dither
+        from audiotools.pcmconverter import Converter
+        pcmreader = Converter(pcmreader,
+                              sample_rate,
+                              channels,
+                              channel_mask,
+                              bits_per_sample)
 
     return pcmreader
 
@@ -3068,68 +3054,233 @@ def resampled_frame_count(initial_frame_count,
                                             rounding=ROUND_DOWN))
 
 
-def calculate_replay_gain(tracks, progress=None):
+def __track_replay_gain__(track, sample_rate, total_frames, progress,
+                          current_frames=0, loudness=False):
+    """returns (title_gain, title_peak, album_histogram, album_peak,
+    loudness) for a single AudioFile analyzed at the given sample rate
+
+    the album histogram and peak may be merged with other tracks'
+    to calculate the album gain
+
+    if loudness is True, the same pass also meters the track's
+    EBU R128 (integrated_loudness, loudness_range, true_peak)
+    with integrated loudness of None if the track is too short or quiet,
+    otherwise loudness is None"""
+
+    from audiotools.replaygain import ReplayGain, R128
+    from audiotools.pcmconverter import PCMTee
+
+    rg = ReplayGain(sample_rate)
+    pcm = track.to_pcm()
+    analyzers = [rg.callback]
+
+    if loudness:
+        meter = R128(sample_rate, pcm.channels, pcm.channel_mask)
+        analyzers.append(meter.callback)
+
+    # each analyzer runs on its own thread from a single decode
+    PCMTee(PCMReaderProgress(PCMConverter(pcm,
+                                          sample_rate,
+                                          pcm.channels,
+                                          pcm.channel_mask,
+                                          pcm.bits_per_sample),
+                             total_frames,
+                             progress,
+                             current_frames),
+           analyzers).run()
+
+    try:
+        title_gain = rg.title_gain()
+    except ValueError:
+        title_gain = 0.0
+    title_peak = rg.title_peak()
+    rg.next_title()
+
+    if loudness:
+        try:
+            integrated_loudness = meter.integrated_loudness()
+        except ValueError:
+            integrated_loudness = None
+        try:
+            loudness_range = meter.loudness_range()
+        except ValueError:
+            loudness_range = 0.0
+        loudness = (integrated_loudness, loudness_range, meter.true_peak())
+    else:
+        loudness = None
+
+    return (title_gain, title_peak, rg.album_histogram(), rg.album_peak(),
+            loudness)
+
+
+def __parallel_replay_gain__(tracks, track_rates, track_frames,
+                             progress, jobs, loudness=False):
+    """analyzes each track in its own child process,
+    running up to "jobs" of them at once,
+    and returns a list of __track_replay_gain__ results in track order"""
+
+    from multiprocessing import Process, Array, Pipe
+    from multiprocessing.connection import wait
+
+    # PCM frames analyzed so far by each track's job
+    frames_done = Array("L", len(tracks))
+
+    def execute_job(index, result_pipe):
+        def job_progress(fraction):
+            frames_done[index] = int(fraction * track_frames[index])
+
+        try:
+            result_pipe.send((False,
+                              __track_replay_gain__(tracks[index],
+                                                    track_rates[index],
+                                                    track_frames[index],
+                                                    job_progress,
+                                                    loudness=loudness)))
+        except Exception as exception:
+            result_pipe.send((True, exception))
+
+        result_pipe.close()
+
+    total_frames = max(sum(track_frames), 1)
+    results = [None] * len(tracks)
+    queued = list(range(len(tracks)))
+    running = {}
+
+    try:
+        while (len(queued) > 0) or (len(running) > 0):
+            while (len(queued) > 0) and (len(running) < jobs):
+                index = queued.pop(0)
+                (parent_conn, child_conn) = Pipe(False)
+                process = Process(target=execute_job,
+                                  args=(index, child_conn))
+                process.start()
+                child_conn.close()
+                running[parent_conn] = (index, process)
+
+            for conn in wait(list(running.keys()), 0.25):
+                (index, process) = running.pop(conn)
+                try:
+                    (exception, result) = conn.recv()
+                except EOFError:
+                    (exception, result) = (
+                        True, ValueError("ReplayGain calculation failed"))
+                conn.close()
+                process.join()
+                if exception:
+                    raise result
+                results[index] = result
+                frames_done[index] = track_frames[index]
+
+            if progress is not None:
+                progress(Fraction(sum(frames_done), total_frames))
+    finally:
+        for (conn, (index, process)) in running.items():
+            process.terminate()
+            process.join()
+            conn.close()
+
+    return results
+
+
+def calculate_replay_gain(tracks, progress=None, jobs=None, loudness=False):
     """yields (track, track_gain, track_peak, album_gain, album_peak)
     for each AudioFile in the list of tracks
 
+    if loudness is True, each tuple gains a sixth item of
+    (integrated_loudness, loudness_range, true_peak)
+    from an EBU R128 meter run in the same decoding pass,
+    with integrated loudness in LUFS (or None if it can't be gated),
+    loudness range in LU and a linear true peak
+
+    up to "jobs" tracks are analyzed at once in child processes,
+    which defaults to MAX_JOBS,
+    and their loudness histograms are merged for the album gain
+
     raises ValueError if a problem occurs during calculation"""
 
     if len(tracks) == 0:
         return
 
     from bisect import bisect
+    from audiotools.replaygain import ReplayGain
 
     SUPPORTED_RATES = [8000,  11025,  12000,  16000,  18900,  22050, 24000,
                        32000, 37800,  44100,  48000,  56000,  64000, 88200,
                        96000, 112000, 128000, 144000, 176400, 192000]
 
-    target_rate = ([SUPPORTED_RATES[0]] + SUPPORTED_RATES)[
-        bisect(SUPPORTED_RATES, most_numerous([track.sample_rate()
-                                               for track in tracks]))]
+    # tracks are analyzed at their own sample rates
+    # and only those at rates without ReplayGain filters are resampled
+    def analysis_rate(sample_rate):
+        if sample_rate in SUPPORTED_RATES:
+            return sample_rate
+        else:
+            return ([SUPPORTED_RATES[0]] + SUPPORTED_RATES)[
+                bisect(SUPPORTED_RATES, sample_rate)]
+
+    track_rates = [analysis_rate(track.sample_rate()) for track in tracks]
 
     track_frames = [resampled_frame_count(track.total_frames(),
                                           track.sample_rate(),
-                                          target_rate)
-                    for track in tracks]
-    current_frames = 0
-    total_frames = sum(track_frames)
-
-    rg = ReplayGainCalculator(target_rate)
-
-    for (track, track_frames) in zip(tracks, track_frames):
-        pcm = track.to_pcm()
-
-        # perform calculation by decoding through ReplayGain
-        with rg.to_pcm(
-            PCMReaderProgress(
-                PCMConverter(pcm,
-                             target_rate,
-                             pcm.channels,
-                             pcm.channel_mask,
-                             pcm.bits_per_sample),
-                total_frames,
-                progress,
-                current_frames)) as pcmreader:
-            transfer_data(pcmreader.read, lambda f: None)
-            current_frames += track_frames
-
-    # yield a set of accumulated track and album gains
-    for (track, (track_gain, track_peak,
-                 album_gain, album_peak)) in zip(tracks, rg):
-        yield (track, track_gain, track_peak, album_gain, album_peak)
-
-
-def add_replay_gain(tracks, progress=None):
+                                          rate)
+                    for (track, rate) in zip(tracks, track_rates)]
+
+    if jobs is None:
+        jobs = MAX_JOBS
+
+    if (jobs > 1) and (len(tracks) > 1):
+        results = __parallel_replay_gain__(tracks,
+                                           track_rates,
+                                           track_frames,
+                                           progress,
+                                           jobs,
+                                           loudness)
+    else:
+        results = []
+        current_frames = 0
+        total_frames = sum(track_frames)
+        for (track, rate, frames) in zip(tracks, track_rates, track_frames):
+            results.append(__track_replay_gain__(track,
+                                                 rate,
+                                                 total_frames,
+                                                 progress,
+                                                 current_frames,
+                                                 loudness))
+            current_frames += frames
+
+    # album gain comes from every track's histogram combined,
+    # which doesn't depend on the rates they were analyzed at
+    album = ReplayGain(track_rates[0])
+    for (title_gain, title_peak, histogram, peak, meter) in results:
+        album.merge(histogram, peak)
+    try:
+        album_gain = album.album_gain()
+    except ValueError:
+        album_gain = 0.0
+    album_peak = album.album_peak()
+
+    for (track, (track_gain, track_peak, histogram, peak, meter)) in zip(
+            tracks, results):
+        if loudness:
+            yield (track, track_gain, track_peak, album_gain, album_peak,
+                   meter)
+        else:
+            yield (track, track_gain, track_peak, album_gain, album_peak)
+
+
+def add_replay_gain(tracks, progress=None, jobs=None):
     """given an iterable set of AudioFile objects
     and optional progress function
     calculates the ReplayGain for them and adds it
-    via their set_replay_gain method"""
+    via their set_replay_gain method
+
+    up to "jobs" tracks are analyzed at once,
+    which defaults to MAX_JOBS as in calculate_replay_gain"""
 
     for (track,
          track_gain,
          track_peak,
          album_gain,
-         album_peak) in calculate_replay_gain(tracks, progress):
+         album_peak) in calculate_replay_gain(tracks, progress, jobs):
         track.set_replay_gain(ReplayGain(track_gain=track_gain,
                                          track_peak=track_peak,
                                          album_gain=album_gain,
@@ -5370,6 +5521,311 @@ def accuraterip_sheet_lookup(sheet, total_pcm_frames, sample_rate,
                           accuraterip_port)
 
 
+class __CDDATrackReader__(PCMReader):
+    """a PCMReader of CD audio sent to an encoding job
+    by rip_cddareader, as raw bytes through a multiprocessing Queue"""
+
+    def __init__(self, pcm_queue, frames_done, index):
+        PCMReader.__init__(self,
+                           sample_rate=44100,
+                           channels=2,
+                           channel_mask=0x3,
+                           bits_per_sample=16)
+        self.__queue__ = pcm_queue
+        self.__frames_done__ = frames_done
+        self.__index__ = index
+        self.__finished__ = False
+
+    def read(self, pcm_frames):
+        if self.__finished__:
+            return pcm.empty_framelist(2, 16)
+
+        data = self.__queue__.get()
+        if data is None:
+            # end of track
+            self.__finished__ = True
+            return pcm.empty_framelist(2, 16)
+        else:
+            framelist = pcm.FrameList(data, 2, 16, False, True)
+            self.__frames_done__[self.__index__] += framelist.frames
+            return framelist
+
+    def close(self):
+        self.__finished__ = True
+
+
+def rip_cddareader(cddareader, track_offsets, track_lengths, tracks,
+                   read_offset=0, progress=None, jobs=None):
+    """reads a CDDAReader front to back in a single pass,
+    splitting the stream at the track boundaries and encoding
+    each track in its own child process while the rest is read
+
+    track_offsets and track_lengths are dicts of
+    {track_number:pcm_frames, ...} as from the CDDAReader
+    and tracks is a list of
+    (track_number, output_class, output_filename, output_quality)
+    tuples for the tracks to be ripped, in ascending order
+
+    read_offset is the drive's read offset in PCM frames
+
+    progress(Fraction) is called as tracks are encoded
+    and up to "jobs" tracks are encoded at once,
+    which defaults to MAX_JOBS
+
+    returns a list of
+    (AudioFile, rip_log, checksums_v1, checksum_v2, ReplayGain)
+    tuples in track order, where the AccurateRip checksums
+    are calculated over each track's +/- 2940 PCM frame window
+    in the same pass as the rest of the data
+
+    tracks whose windows meet are read as one run,
+    and the reader seeks past any gap between runs
+
+    since the reader logs whole sectors, each rip_log
+    covers every sector holding part of its track,
+    so a sector shared by adjacent tracks is in both logs
+
+    each track buffers at most a few FRAMELIST_SIZE reads ahead
+    of its encoder, or of a free job if none has started yet,
+    so reading pauses while encoders catch up
+    rather than holding the rest of the disc in memory
+
+    raises IOError if a problem occurs reading the disc
+    or EncodingError if a problem occurs encoding a track,
+    whose filename attribute is that track's output_filename"""
+
+    from multiprocessing import Process, Array, Pipe, Queue
+    from multiprocessing.connection import wait
+    try:
+        from queue import Full
+    except ImportError:
+        from Queue import Full
+    from audiotools.accuraterip import Checksum
+    from audiotools.replaygain import ReplayGain as Analyzer
+
+    if len(tracks) == 0:
+        return []
+
+    PREVIOUS_TRACK_FRAMES = NEXT_TRACK_FRAMES = 5880 // 2
+    SECTOR_FRAMES = 44100 // 75
+
+    # reads of up to FRAMELIST_SIZE PCM frames each
+    # that a single track may have waiting for its encoder
+    TRACK_BACKLOG = 8
+
+    if jobs is None:
+        jobs = MAX_JOBS
+    jobs = max(jobs, 1)
+
+    # each track's audio and AccurateRip window in the stream
+    # (which is shifted by the drive's read offset)
+    starts = [track_offsets[number] + read_offset
+              for (number, c, f, q) in tracks]
+    ends = [start + track_lengths[number]
+            for (start, (number, c, f, q)) in zip(starts, tracks)]
+
+    # the sectors holding each track's audio
+    # whose log entries belong to that track
+    log_starts = [(start // SECTOR_FRAMES) * SECTOR_FRAMES
+                  for start in starts]
+    log_ends = [-(-end // SECTOR_FRAMES) * SECTOR_FRAMES for end in ends]
+
+    # runs of tracks whose windows meet are read straight through
+    runs = [[0]]
+    for index in range(1, len(tracks)):
+        if ((starts[index] - PREVIOUS_TRACK_FRAMES) >
+                (ends[index - 1] + NEXT_TRACK_FRAMES)):
+            runs.append([index])
+        else:
+            runs[-1].append(index)
+
+    checksums = [Checksum(total_pcm_frames=track_lengths[number],
+                          sample_rate=44100,
+                          is_first=(number == min(track_offsets.keys())),
+                          is_last=(number == max(track_offsets.keys())),
+                          pcm_frame_range=(PREVIOUS_TRACK_FRAMES + 1 +
+                                           NEXT_TRACK_FRAMES),
+                          accurateripv2_offset=PREVIOUS_TRACK_FRAMES)
+                 for (number, c, f, q) in tracks]
+    first_logs = [None] * len(tracks)
+    rip_logs = [None] * len(tracks)
+
+    # PCM frames encoded so far by each track's job
+    frames_done = Array("L", len(tracks))
+    total_frames = max(sum(e - s for (s, e) in zip(starts, ends)), 1)
+
+    def execute_job(index, pcm_queue, result_pipe):
+        (number, output_class, output_filename, output_quality) = \
+            tracks[index]
+
+        # ReplayGain is calculated alongside the encoder
+        # and its histogram merged afterward for the album gain
+        try:
+            replay_gain = Analyzer(44100)
+            reader = ReplayGainCalculatorReader(
+                replay_gain,
+                __CDDATrackReader__(pcm_queue, frames_done, index))
+            output_class.from_pcm(str(output_filename),
+                                  reader,
+                                  output_quality,
+                                  total_pcm_frames=track_lengths[number])
+            result_pipe.send((False,
+                              (reader.title_gain(),
+                               reader.title_peak(),
+                               replay_gain.album_histogram(),
+                               replay_gain.album_peak())))
+        except Exception as exception:
+            result_pipe.send((True, exception))
+
+        result_pipe.close()
+
+    queues = [Queue(TRACK_BACKLOG) for t in tracks]
+    results = [None] * len(tracks)
+    queued = []
+    running = {}
+
+    def collect_jobs(timeout):
+        for conn in wait(list(running.keys()), timeout):
+            (index, process) = running.pop(conn)
+            try:
+                (exception, result) = conn.recv()
+            except EOFError:
+                (exception, result) = (
+                    True, EncodingError(u"encoding job failed"))
+            conn.close()
+            process.join()
+            if exception:
+                if isinstance(result, EncodingError):
+                    result.filename = tracks[index][2]
+                raise result
+            results[index] = result
+
+        # tracks waiting for a free job are buffered in their queues
+        while (len(queued) > 0) and (len(running) < jobs):
+            index = queued.pop(0)
+            (parent_conn, child_conn) = Pipe(False)
+            process = Process(target=execute_job,
+                              args=(index, queues[index], child_conn))
+            process.start()
+            child_conn.close()
+            running[parent_conn] = (index, process)
+
+        if progress is not None:
+            progress(Fraction(sum(frames_done), total_frames))
+
+    def send(index, data):
+        # a full queue waits on its encoder,
+        # or on an earlier track's job finishing so its own can start
+        while True:
+            try:
+                queues[index].put(data, True, 0.25)
+                return
+            except Full:
+                collect_jobs(0)
+
+    try:
+        for run in runs:
+            run_start = starts[run[0]] - PREVIOUS_TRACK_FRAMES
+            run_end = ends[run[-1]] + NEXT_TRACK_FRAMES
+
+            # reads are split at every boundary
+            # so each one falls inside or outside any given window
+            # and reads meet the log boundaries at sector boundaries
+            boundaries = set([run_end])
+            for index in run:
+                boundaries.update([starts[index] - PREVIOUS_TRACK_FRAMES,
+                                   starts[index],
+                                   ends[index],
+                                   ends[index] + NEXT_TRACK_FRAMES,
+                                   log_starts[index],
+                                   log_ends[index]])
+
+            # the stream is silent before the disc's start and past its end
+            seeked_offset = cddareader.seek(max(run_start, 0))
+            stream = PCMReaderWindow(cddareader,
+                                     run_start - seeked_offset,
+                                     run_end - run_start,
+                                     forward_close=False)
+            position = run_start
+            pending = pcm.empty_framelist(2, 16)
+
+            for boundary in sorted(boundaries):
+                while position < boundary:
+                    # the reader returns whole sectors,
+                    # so anything past the boundary
+                    # is held for the next read
+                    if pending.frames == 0:
+                        pending = stream.read(min(boundary - position,
+                                                  FRAMELIST_SIZE))
+                        if pending.frames == 0:
+                            raise IOError("I/O error reading stream")
+                    (framelist, pending) = pending.split(boundary - position)
+                    data = None
+
+                    for index in run:
+                        (start, end) = (starts[index], ends[index])
+                        if ((start - PREVIOUS_TRACK_FRAMES) <= position <
+                                (end + NEXT_TRACK_FRAMES)):
+                            checksums[index].update(framelist)
+
+                        if start <= position < end:
+                            if position == start:
+                                queued.append(index)
+                            if data is None:
+                                data = framelist.to_bytes(False, True)
+                            send(index, data)
+
+                    position += framelist.frames
+                    collect_jobs(0)
+
+                # the log only grows, so each track's log
+                # is the difference across its sectors
+                for index in run:
+                    if position == log_starts[index]:
+                        first_logs[index] = cddareader.log()
+                    if position == log_ends[index]:
+                        last_log = cddareader.log()
+                        rip_logs[index] = dict(
+                            (key, last_log[key] - first_logs[index][key])
+                            for key in last_log)
+                    if position == ends[index]:
+                        send(index, None)
+
+        while len(running) > 0:
+            collect_jobs(0.25)
+    finally:
+        for (conn, (index, process)) in running.items():
+            process.terminate()
+            process.join()
+            conn.close()
+        for pcm_queue in queues:
+            pcm_queue.cancel_join_thread()
+            pcm_queue.close()
+
+    album = Analyzer(44100)
+    for (title_gain, title_peak, histogram, peak) in results:
+        album.merge(histogram, peak)
+    try:
+        album_gain = album.album_gain()
+    except ValueError:
+        album_gain = 0.0
+    album_peak = album.album_peak()
+
+    return [(output_class(str(output_filename)),
+             rip_log,
+             checksum.checksums_v1(),
+             checksum.checksum_v2(),
+             ReplayGain(track_gain=title_gain,
+                        track_peak=title_peak,
+                        album_gain=album_gain,
+                        album_peak=album_peak))
+            for ((number, output_class, output_filename, output_quality),
+                 rip_log,
+                 checksum,
+                 (title_gain, title_peak, histogram, peak)) in
+            zip(tracks, rip_logs, checksums, results)]
+
+
 def output_progress(u, current, total):
     """given a unicode string and current/total integers,
     returns a u'[<current>/<total>]  <string>'  unicode string
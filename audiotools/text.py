@@ -239,6 +239,7 @@ LAB_OUTPUT_TYPE_DESCRIPTION = u"name"
 LAB_OUTPUT_QUALITY_DESCRIPTION = u"description"
 LAB_SUPPORTED_FIELDS = u"Supported fields are:"
 LAB_CD2TRACK_PROGRESS = u"track {track_number:02d} -> {filename}"
+LAB_CD2TRACK_RIPPING = u"extracting {:d} tracks"
 LAB_CD2TRACK_LOG = u"Rip log : "
 LAB_CD2TRACK_APPLY = u"extract tracks"
 LAB_CDDA2TRACK_WROTE_CUESHEET = u"wrote cuesheet \"{}\""
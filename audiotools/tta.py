@@ -135,7 +135,7 @@ class TrueAudio(ApeTaggedAudio, ApeGainedAudio, AudioFile):
         return a PCMReaderError with an appropriate error message"""
 
         from audiotools.decoders import TTADecoder
-        from audiotools import PCMReaderError
+        from audiotools import (PCMReaderError, CODEC_THREADS)
         from audiotools.id3 import skip_id3v2_comment
 
         try:
@@ -148,7 +148,7 @@ class TrueAudio(ApeTaggedAudio, ApeGainedAudio, AudioFile):
                                   bits_per_sample=self.bits_per_sample())
         try:
             skip_id3v2_comment(tta)
-            return TTADecoder(tta)
+            return TTADecoder(tta, threads=CODEC_THREADS)
         except (IOError, ValueError) as msg:
             # This isn't likely unless the TTA file is modified
             # between when TrueAudio is instantiated
@@ -196,7 +196,8 @@ class TrueAudio(ApeTaggedAudio, ApeGainedAudio, AudioFile):
         from audiotools import (BufferedPCMReader,
                                 CounterPCMReader,
                                 transfer_data,
-                                EncodingError)
+                                EncodingError,
+                                CODEC_THREADS)
         # from audiotools.py_encoders import encode_tta
         from audiotools.encoders import encode_tta
         from audiotools.bitstream import BitstreamWriter
@@ -219,7 +220,8 @@ class TrueAudio(ApeTaggedAudio, ApeGainedAudio, AudioFile):
                 file=file,
                 pcmreader=pcmreader,
                 total_pcm_frames=(total_pcm_frames if
-                                  total_pcm_frames is not None else 0))
+                                  total_pcm_frames is not None else 0),
+                threads=CODEC_THREADS)
 
             return cls(filename)
         except (IOError, ValueError) as err:
@@ -176,6 +176,11 @@ class VorbisAudio(AudioFile):
 
         return self.__sample_rate__
 
+    def seekable(self):
+        """returns True if the file is seekable"""
+
+        return True
+
     @classmethod
     def supports_to_pcm(cls):
         """returns True if all necessary components are available
@@ -518,6 +518,7 @@ class audiotools_cdio(Extension):
             sources.extend(["src/cdiomodule.c",
                             "src/framelist.c",
                             "src/pcm_conv.c"])
+            libraries.add("pthread")
 
             self.__library_manifest__.append(("libcdio",
                                               "CDDA data extraction",
@@ -569,6 +570,7 @@ class audiotools_dvdaudio(Extension):
             sources.extend(["src/dvdamodule.c",
                             "src/framelist.c",
                             "src/pcm_conv.c"])
+            libraries.add("pthread")
 
             self.__library_manifest__.append(("libdvd-audio",
                                               "DVD-Audio data extraction",
@@ -615,6 +617,8 @@ class audiotools_pcmconverter(Extension):
                                     "src/framelist.c",
                                     "src/pcmreader.c",
                                     "src/pcm_conv.c",
+                                    "src/polyphase.c",
+                                    "src/dither.c",
                                     "src/bitstream.c",
                                     "src/buffer.c",
                                     "src/func_io.c",
@@ -623,6 +627,7 @@ class audiotools_pcmconverter(Extension):
                                     "src/samplerate/src_sinc.c",
                                     "src/samplerate/src_zoh.c",
                                     "src/samplerate/src_linear.c"],
+                           libraries=["pthread"],
                            define_macros=[("HAS_PYTHON", None)])
 
 
@@ -631,6 +636,7 @@ class audiotools_replaygain(Extension):
         Extension.__init__(self,
                            "audiotools.replaygain",
                            sources=["src/replaygain.c",
+                                    "src/dither.c",
                                     "src/framelist.c",
                                     "src/pcmreader.c",
                                     "src/bitstream.c",
@@ -657,6 +663,7 @@ class audiotools_decoders(Extension):
                    "src/ogg_crc.c",
                    "src/common/flac_crc.c",
                    "src/common/tta_crc.c",
+                   "src/common/tta_filter.c",
                    "src/common/m4a_atoms.c",
                    "src/common/md5.c",
                    "src/mpc/mpc_crc32.c",
@@ -673,7 +680,7 @@ class audiotools_decoders(Extension):
                    "src/decoders/mpc.c",
                    "src/decoders/sine.c",
                    "src/decoders.c"]
-        libraries = set()
+        libraries = set(["pthread"])
         extra_link_args = []
         extra_compile_args = []
 
@@ -791,11 +798,12 @@ class audiotools_encoders(Extension):
                    "src/encoders/flac.c",
                    "src/common/flac_crc.c",
                    "src/common/tta_crc.c",
+                   "src/common/tta_filter.c",
                    "src/encoders/alac.c",
                    "src/common/m4a_atoms.c",
                    "src/encoders/tta.c",
                    "src/encoders.c"]
-        libraries = set()
+        libraries = set(["pthread"])
         extra_link_args = []
         extra_compile_args = []
 
@@ -972,7 +980,9 @@ class audiotools_output(Extension):
                     extra_link_args.extend(
                         system_libraries.extra_link_args("alsa"))
                 sources.append("src/output/alsa.c")
+                sources.append("src/output/ringbuffer.c")
                 sources.append("src/framelist.c")
+                libraries.add("pthread")
                 defines.append(("ALSA", "1"))
                 self.__library_manifest__.append(("libasound2",
                                                   "ALSA output",
@@ -991,9 +1001,12 @@ class audiotools_output(Extension):
                 extra_link_args.extend(
                     system_libraries.extra_link_args("libpulse"))
             sources.append("src/output/pulseaudio.c")
-            # only include pcmconv once
+            # only include the shared output queue and pcmconv once
+            if "src/output/ringbuffer.c" not in sources:
+                sources.append("src/output/ringbuffer.c")
             if "src/framelist.c" not in sources:
                 sources.append("src/framelist.c")
+            libraries.add("pthread")
             defines.append(("PULSEAUDIO", "1"))
             self.__library_manifest__.append(("libpulse",
                                               "PulseAudio output",
@@ -1,6 +1,9 @@
 #include "accuraterip.h"
 #include "pcm.h"
 #include "mod_defs.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -26,11 +29,20 @@
 
   http://jonls.dk/2009/10/calculating-accuraterip-checksums/
 
-  The math is the same, but I find it clearer to store the initial
-  and trailing values used to adjust the values sum in a seperate memory
-  space rather than stuff them in the checksums area temporarily.
+  The math is the same, but rather than stepping from one offset's
+  checksum to the next with every initial and trailing value,
+  the running sums are saved at every index a window may start or end
+  so each offset's checksum is a difference of those sums.
+  Everything in between is summed a whole block at a time.
  **********************************************************************/
 
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+#ifndef MAX
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#endif
+
 static PyMethodDef accuraterip_methods[] = {
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
@@ -83,9 +95,8 @@ Checksum_init(accuraterip_Checksum *self, PyObject *args, PyObject *kwds)
     int pcm_frame_range = 1;
     int accurateripv2_offset = 0;
 
-    self->accuraterip_v1.checksums = NULL;
-    self->accuraterip_v1.initial_values = NULL;
-    self->accuraterip_v1.final_values = NULL;
+    self->accuraterip_v1.leading = NULL;
+    self->accuraterip_v1.trailing = NULL;
     self->framelist_class = NULL;
 
     if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|iiiii", kwlist,
@@ -133,23 +144,29 @@ Checksum_init(accuraterip_Checksum *self, PyObject *args, PyObject *kwds)
     if (accurateripv2_offset < 0) {
         PyErr_SetString(PyExc_ValueError, "accurateripv2_offset must be >= 0");
         return -1;
+    } else if (accurateripv2_offset >= pcm_frame_range) {
+        PyErr_SetString(PyExc_ValueError,
+                        "accurateripv2_offset must be < pcm_frame_range");
+        return -1;
     }
 
     self->pcm_frame_range = pcm_frame_range;
     self->processed_frames = 0;
 
-    /*initialize AccurateRip V1 values*/
-    self->accuraterip_v1.index = 1;
-    self->accuraterip_v1.checksums = calloc(pcm_frame_range, sizeof(uint32_t));
-    self->accuraterip_v1.initial_values = init_queue(pcm_frame_range - 1);
-    self->accuraterip_v1.final_values = init_queue(pcm_frame_range - 1);
-    self->accuraterip_v1.values_sum = 0;
+    /*initialize AccurateRip V1 values
 
+      the sums at index 0 are all 0, so zeroed windows
+      already hold them should one start or end there*/
+    self->accuraterip_v1.index = 1;
+    self->accuraterip_v1.sums.values = 0;
+    self->accuraterip_v1.sums.products = 0;
+    self->accuraterip_v1.leading = calloc(pcm_frame_range,
+                                          sizeof(struct prefix_sums));
+    self->accuraterip_v1.trailing = calloc(pcm_frame_range,
+                                           sizeof(struct prefix_sums));
 
     /*initialize AccurateRip V2 values*/
-    self->accuraterip_v2.index = 1;
     self->accuraterip_v2.checksum = 0;
-    self->accuraterip_v2.current_offset = accurateripv2_offset;
     self->accuraterip_v2.initial_offset = accurateripv2_offset;
 
     /*keep a copy of the FrameList class so we can check for it*/
@@ -161,15 +178,17 @@ Checksum_init(accuraterip_Checksum *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    self->callback.update = checksum_update;
+    self->callback.data = self;
+
     return 0;
 }
 
 void
 Checksum_dealloc(accuraterip_Checksum *self)
 {
-    free(self->accuraterip_v1.checksums);
-    free_queue(self->accuraterip_v1.initial_values);
-    free_queue(self->accuraterip_v1.final_values);
+    free(self->accuraterip_v1.leading);
+    free(self->accuraterip_v1.trailing);
 
     Py_XDECREF(self->framelist_class);
 
@@ -188,12 +207,79 @@ value(int l, int r)
     return (unsigned_(r) << 16) | unsigned_(l);
 }
 
+/*returns 0 if the FrameList is CD-formatted
+  and fits in the checksum's window, 1 if not*/
+static int
+checksum_invalid(const accuraterip_Checksum* self,
+                 const pcm_FrameList *framelist)
+{
+    return ((framelist->channels != 2) ||
+            (framelist->bits_per_sample != 16) ||
+            ((self->processed_frames + framelist->frames) >
+             (self->total_pcm_frames + self->pcm_frame_range - 1)));
+}
+
+/*updates checksums from a FrameList without touching any Python state,
+  returning 0 on success or 1 if the FrameList is invalid*/
+static int
+checksum_update(void *data, const pcm_FrameList *framelist)
+{
+    accuraterip_Checksum* self = data;
+    const unsigned channels = 2;
+    unsigned frame = 0;
+
+    if (checksum_invalid(self, framelist)) {
+        return 1;
+    }
+
+    while (frame < framelist->frames) {
+        const unsigned to_process = MIN(framelist->frames - frame,
+                                        ACCURATERIP_CHUNK_SIZE);
+        const unsigned index = self->accuraterip_v1.index;
+        unsigned i;
+
+        if (framelist->storage_bits == 16) {
+            const int16_t *samples16 =
+                framelist->samples16 + (frame * channels);
+            for (i = 0; i < to_process; i++) {
+                self->values[i] = value(samples16[i * channels],
+                                        samples16[i * channels + 1]);
+            }
+        } else {
+            for (i = 0; i < to_process; i++) {
+                self->values[i] =
+                    value(FrameList_sample(framelist,
+                                           (frame + i) * channels),
+                          FrameList_sample(framelist,
+                                           (frame + i) * channels + 1));
+            }
+        }
+
+        update_checksum_v2(&(self->accuraterip_v2),
+                           self->start_offset,
+                           self->end_offset,
+                           index,
+                           self->values,
+                           to_process);
+        update_sums_v1(&(self->accuraterip_v1),
+                       self->start_offset,
+                       self->end_offset,
+                       self->pcm_frame_range,
+                       self->values,
+                       to_process);
+
+        frame += to_process;
+    }
+
+    self->processed_frames += framelist->frames;
+
+    return 0;
+}
+
 static PyObject*
 Checksum_update(accuraterip_Checksum* self, PyObject *args)
 {
     pcm_FrameList *framelist;
-    const unsigned channels = 2;
-    unsigned i;
 
     if (!PyArg_ParseTuple(args, "O!", self->framelist_class, &framelist))
         return NULL;
@@ -211,104 +297,228 @@ Checksum_update(accuraterip_Checksum* self, PyObject *args)
     }
 
     /*ensure we're not given too many samples*/
-    if ((self->processed_frames + framelist->frames) >
-        (self->total_pcm_frames + self->pcm_frame_range - 1)) {
+    if (checksum_invalid(self, framelist)) {
         PyErr_SetString(PyExc_ValueError, "too many samples for checksum");
         return NULL;
     }
 
     /*update checksum values*/
-    for (i = 0; i < framelist->frames; i++) {
-        const unsigned v = value(framelist->samples[i * channels],
-                                 framelist->samples[i * channels + 1]);
-        update_frame_v1(&(self->accuraterip_v1),
-                        self->total_pcm_frames,
-                        self->start_offset,
-                        self->end_offset,
-                        v);
-        update_frame_v2(&(self->accuraterip_v2),
-                        self->total_pcm_frames,
-                        self->start_offset,
-                        self->end_offset,
-                        v);
-    }
-
-    self->processed_frames += framelist->frames;
+    Py_BEGIN_ALLOW_THREADS
+    checksum_update(self, framelist);
+    Py_END_ALLOW_THREADS
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
 static void
-update_frame_v1(struct accuraterip_v1 *v1,
-                unsigned total_pcm_frames,
-                unsigned start_offset,
-                unsigned end_offset,
-                unsigned value)
+callback_capsule_destructor(PyObject *capsule)
 {
-    /*calculate initial checksum*/
-    if ((v1->index >= start_offset) && (v1->index <= end_offset)) {
-        v1->checksums[0] += (value * v1->index);
-        v1->values_sum += value;
-    }
+    Py_XDECREF((PyObject*)PyCapsule_GetContext(capsule));
+}
 
-    /*store the first (pcm_frame_range - 1) values in initial_values*/
-    if ((v1->index >= start_offset) && (!queue_full(v1->initial_values))) {
-        queue_push(v1->initial_values, value);
+static PyObject*
+Checksum_callback(accuraterip_Checksum* self, void *closure)
+{
+    /*the capsule keeps this checksum alive
+      as long as a PCMTee might call it*/
+    PyObject *capsule = PyCapsule_New(&(self->callback),
+                                      PCMTEE_CALLBACK,
+                                      callback_capsule_destructor);
+    if (capsule) {
+        Py_INCREF((PyObject*)self);
+        PyCapsule_SetContext(capsule, self);
     }
+    return capsule;
+}
 
-    /*store the trailing (pcm_frame_range - 1) values in final_values*/
-    if ((v1->index > end_offset) && (!queue_full(v1->final_values))) {
-        queue_push(v1->final_values, value);
+/*adds "count" values, the first of which is at "index", to "sums"*/
+static void
+add_sums(struct prefix_sums *sums,
+         unsigned index,
+         const uint32_t values[],
+         unsigned count)
+{
+    uint32_t values_sum = sums->values;
+    uint32_t products_sum = sums->products;
+    unsigned i = 0;
+
+#if defined(__SSE2__)
+    if (count >= 4) {
+        const __m128i step = _mm_set1_epi32(4);
+        __m128i indexes = _mm_setr_epi32(index, index + 1,
+                                         index + 2, index + 3);
+        __m128i values_lanes = _mm_setzero_si128();
+        __m128i products_lanes = _mm_setzero_si128();
+        uint32_t lanes[4];
+
+        for (; (i + 4) <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+
+            values_lanes = _mm_add_epi32(values_lanes, v);
+
+            /*only the low 32 bits of each product are kept,
+              which land in lanes 0 and 2 of each 64-bit multiply*/
+            products_lanes = _mm_add_epi32(
+                products_lanes,
+                _mm_mul_epu32(v, indexes));
+            products_lanes = _mm_add_epi32(
+                products_lanes,
+                _mm_mul_epu32(_mm_srli_epi64(v, 32),
+                              _mm_srli_epi64(indexes, 32)));
+
+            indexes = _mm_add_epi32(indexes, step);
+        }
+
+        _mm_storeu_si128((__m128i*)lanes, values_lanes);
+        values_sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i*)lanes, products_lanes);
+        products_sum += lanes[0] + lanes[2];
     }
+#endif
 
-    /*calculate incremental checksums*/
-    if (v1->index > total_pcm_frames) {
-        const uint32_t initial_value = queue_pop(v1->initial_values);
+    for (; i < count; i++) {
+        values_sum += values[i];
+        products_sum += values[i] * (index + i);
+    }
 
-        const uint32_t final_value = queue_pop(v1->final_values);
+    sums->values = values_sum;
+    sums->products = products_sum;
+}
 
-        const uint32_t initial_value_product =
-            (uint32_t)(start_offset - 1) * initial_value;
+static void
+update_sums_v1(struct accuraterip_v1 *v1,
+               unsigned start_offset,
+               unsigned end_offset,
+               unsigned pcm_frame_range,
+               const uint32_t values[],
+               unsigned count)
+{
+    /*indexes whose sums are saved for each window*/
+    const unsigned leading_index = start_offset - 1;
+    const unsigned trailing_index = end_offset;
+
+    while (count) {
+        const unsigned index = v1->index;
+        const unsigned leading = index - leading_index;
+        const unsigned trailing = index - trailing_index;
+
+        if ((leading < pcm_frame_range) || (trailing < pcm_frame_range)) {
+            /*save sums one value at a time within either window*/
+            add_sums(&(v1->sums), index, values, 1);
+            if (leading < pcm_frame_range) {
+                v1->leading[leading] = v1->sums;
+            }
+            if (trailing < pcm_frame_range) {
+                v1->trailing[trailing] = v1->sums;
+            }
+            values += 1;
+            count -= 1;
+            v1->index += 1;
+        } else {
+            /*otherwise sum everything up to the next window at once*/
+            unsigned to_process = count;
+            if (index < leading_index) {
+                to_process = MIN(to_process, leading_index - index);
+            }
+            if (index < trailing_index) {
+                to_process = MIN(to_process, trailing_index - index);
+            }
+            add_sums(&(v1->sums), index, values, to_process);
+            values += to_process;
+            count -= to_process;
+            v1->index += to_process;
+        }
+    }
+}
 
-        const uint32_t final_value_product =
-            (uint32_t)end_offset * final_value;
+/*returns the sum of the high 32 bits of each value
+  times its index, the first of which is "index"*/
+static uint32_t
+sum_high_products(unsigned index, const uint32_t values[], unsigned count)
+{
+    uint32_t sum = 0;
+    unsigned i = 0;
+
+#if defined(__SSE2__)
+    if (count >= 4) {
+        const __m128i step = _mm_set1_epi32(4);
+        __m128i indexes = _mm_setr_epi32(index, index + 1,
+                                         index + 2, index + 3);
+        __m128i sum_lanes = _mm_setzero_si128();
+        uint32_t lanes[4];
+
+        for (; (i + 4) <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+
+            /*the high 32 bits of each 64-bit product
+              shift down into lanes 0 and 2*/
+            sum_lanes = _mm_add_epi32(
+                sum_lanes,
+                _mm_srli_epi64(_mm_mul_epu32(v, indexes), 32));
+            sum_lanes = _mm_add_epi32(
+                sum_lanes,
+                _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(v, 32),
+                                             _mm_srli_epi64(indexes, 32)),
+                               32));
+
+            indexes = _mm_add_epi32(indexes, step);
+        }
 
-        v1->checksums[v1->index - total_pcm_frames] =
-            v1->checksums[v1->index - total_pcm_frames - 1] +
-            final_value_product -
-            v1->values_sum -
-            initial_value_product;
+        _mm_storeu_si128((__m128i*)lanes, sum_lanes);
+        sum += lanes[0] + lanes[2];
+    }
+#endif
 
-        v1->values_sum -= initial_value;
-        v1->values_sum += final_value;
+    for (; i < count; i++) {
+        const uint64_t v_i = (uint64_t)values[i] * (uint64_t)(index + i);
+        sum += (uint32_t)(v_i >> 32);
     }
 
-    v1->index++;
+    return sum;
 }
 
 static void
-update_frame_v2(struct accuraterip_v2 *v2,
-                unsigned total_pcm_frames,
-                unsigned start_offset,
-                unsigned end_offset,
-                unsigned value)
+update_checksum_v2(struct accuraterip_v2 *v2,
+                   unsigned start_offset,
+                   unsigned end_offset,
+                   unsigned index,
+                   const uint32_t values[],
+                   unsigned count)
 {
-    if (!v2->current_offset) {
-        if ((v2->index >= start_offset) && (v2->index <= end_offset)) {
-            const uint64_t v_i = ((uint64_t)value * (uint64_t)(v2->index));
-            v2->checksum += (uint32_t)(v_i >> 32);
-        }
-        v2->index++;
+    /*the V2 window starts "initial_offset" frames in,
+      so only values between its own start and end offsets count*/
+    const unsigned offset = v2->initial_offset;
+    const unsigned first = MAX(index, start_offset + offset);
+    const unsigned last = MIN(index + count, end_offset + offset + 1);
+
+    if (first < last) {
+        v2->checksum += sum_high_products(first - offset,
+                                          values + (first - index),
+                                          last - first);
+    }
+}
+
+static uint32_t
+checksum_v1(const accuraterip_Checksum* self, unsigned offset)
+{
+    const struct accuraterip_v1 *v1 = &(self->accuraterip_v1);
+
+    if (self->end_offset >= self->start_offset) {
+        const struct prefix_sums *leading = &(v1->leading[offset]);
+        const struct prefix_sums *trailing = &(v1->trailing[offset]);
+
+        return (trailing->products - leading->products) -
+               (offset * (trailing->values - leading->values));
     } else {
-        v2->current_offset--;
+        /*no values between start and end offset*/
+        return 0;
     }
 }
 
 static PyObject*
 Checksum_checksums_v1(accuraterip_Checksum* self, PyObject *args)
 {
-    const struct accuraterip_v1 *v1 = &(self->accuraterip_v1);
     unsigned i;
 
     if (self->processed_frames <
@@ -322,7 +532,7 @@ Checksum_checksums_v1(accuraterip_Checksum* self, PyObject *args)
         return NULL;
 
     for (i = 0; i < self->pcm_frame_range; i++) {
-        PyObject *number = PyLong_FromUnsignedLong(v1->checksums[i]);
+        PyObject *number = PyLong_FromUnsignedLong(checksum_v1(self, i));
         int result;
         if (number == NULL) {
             Py_DECREF(checksums_obj);
@@ -342,7 +552,6 @@ Checksum_checksums_v1(accuraterip_Checksum* self, PyObject *args)
 static PyObject*
 Checksum_checksum_v2(accuraterip_Checksum* self, PyObject *args)
 {
-    const struct accuraterip_v1 *v1 = &(self->accuraterip_v1);
     const struct accuraterip_v2 *v2 = &(self->accuraterip_v2);
 
     if (self->processed_frames <
@@ -351,28 +560,8 @@ Checksum_checksum_v2(accuraterip_Checksum* self, PyObject *args)
         return NULL;
     } else {
         const uint32_t checksum_v2 =
-            v2->checksum + v1->checksums[v2->initial_offset];
+            v2->checksum + checksum_v1(self, v2->initial_offset);
 
         return PyLong_FromUnsignedLong(checksum_v2);
     }
 }
-
-static struct queue*
-init_queue(unsigned total_size)
-{
-    struct queue *queue = malloc(sizeof(struct queue));
-    queue->values = malloc(total_size * sizeof(uint32_t));
-    queue->total_size = total_size;
-    queue->head_index = 0;
-    queue->tail_index = 0;
-    return queue;
-}
-
-static void
-free_queue(struct queue *queue)
-{
-    if (queue != NULL) {
-        free(queue->values);
-        free(queue);
-    }
-}
@@ -1,6 +1,7 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <stdint.h>
+#include "pcmtee.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -21,32 +22,33 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
-struct queue {
-    uint32_t *values;
-    unsigned total_size;
-    unsigned head_index;
-    unsigned tail_index;
+#define ACCURATERIP_CHUNK_SIZE 4096
+
+/*running sums of every value up to some index*/
+struct prefix_sums {
+    uint32_t values;    /*the sum of the values*/
+    uint32_t products;  /*the sum of each value times its index*/
 };
 
 struct accuraterip_v1 {
     unsigned index;
 
-    uint32_t *checksums;  /*array of AccurateRip V1 checksums*/
+    struct prefix_sums sums;  /*running sums of all values so far*/
+
+    /*the running sums just before each window's start offset
+      and at each window's end offset
 
-    /*saved values necessary for calculating incremental
-      AccurateRip V1 checksums*/
-    struct queue *initial_values;
-    struct queue *final_values;
-    uint32_t values_sum;
+      since a window shifted by "r" frames has the checksum
+      (trailing products - leading products) -
+      r * (trailing values - leading values)
+      these are all that's needed to calculate every window's checksum*/
+    struct prefix_sums *leading;
+    struct prefix_sums *trailing;
 };
 
 struct accuraterip_v2 {
-    unsigned index;
-
     uint32_t checksum;        /*the AccurateRip V2 checksum*/
 
-    unsigned current_offset;  /*offset of the checksum in window*/
-
     unsigned initial_offset;  /*initially specified window offset*/
 };
 
@@ -67,6 +69,12 @@ typedef struct {
     struct accuraterip_v2 accuraterip_v2;
 
     PyObject* framelist_class;
+
+    /*values of the FrameList being checksummed*/
+    uint32_t values[ACCURATERIP_CHUNK_SIZE];
+
+    /*for feeding the checksum directly from a PCMTee*/
+    struct pcmtee_callback callback;
 } accuraterip_Checksum;
 
 static PyObject*
@@ -78,46 +86,35 @@ Checksum_init(accuraterip_Checksum *self, PyObject *args, PyObject *kwds);
 void
 Checksum_dealloc(accuraterip_Checksum *self);
 
+static int
+checksum_update(void *data, const pcm_FrameList *framelist);
+
 static PyObject*
 Checksum_update(accuraterip_Checksum* self, PyObject *args);
 
-static void
-update_frame_v1(struct accuraterip_v1 *v1,
-                unsigned total_pcm_frames,
-                unsigned start_offset,
-                unsigned end_offset,
-                unsigned value);
+static PyObject*
+Checksum_callback(accuraterip_Checksum* self, void *closure);
 
 static void
-update_frame_v2(struct accuraterip_v2 *v2,
-                unsigned total_pcm_frames,
-                unsigned start_offset,
-                unsigned end_offset,
-                unsigned value);
-
-static struct queue*
-init_queue(unsigned total_size);
+update_sums_v1(struct accuraterip_v1 *v1,
+               unsigned start_offset,
+               unsigned end_offset,
+               unsigned pcm_frame_range,
+               const uint32_t values[],
+               unsigned count);
 
 static void
-free_queue(struct queue *queue);
-
-static inline int
-queue_full(const struct queue *queue)
-{
-    return (queue->tail_index == queue->total_size);
-}
-
-static inline void
-queue_push(struct queue *queue, uint32_t value)
-{
-    queue->values[queue->tail_index++] = value;
-}
-
-static inline uint32_t
-queue_pop(struct queue *queue)
-{
-    return queue->values[queue->head_index++];
-}
+update_checksum_v2(struct accuraterip_v2 *v2,
+                   unsigned start_offset,
+                   unsigned end_offset,
+                   unsigned index,
+                   const uint32_t values[],
+                   unsigned count);
+
+/*returns the AccurateRip V1 checksum of the window
+  shifted by "offset" PCM frames*/
+static uint32_t
+checksum_v1(const accuraterip_Checksum* self, unsigned offset);
 
 static PyObject*
 Checksum_checksums_v1(accuraterip_Checksum* self, PyObject *args);
@@ -135,6 +132,12 @@ static PyMethodDef Checksum_methods[] = {
     {NULL}
 };
 
+static PyGetSetDef Checksum_getseters[] = {
+    {"callback", (getter)Checksum_callback,
+     NULL, "PCMTee callback capsule", NULL},
+    {NULL}
+};
+
 static PyTypeObject accuraterip_ChecksumType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     "_accuraterip.Checksum",   /*tp_name*/
@@ -165,7 +168,7 @@ static PyTypeObject accuraterip_ChecksumType = {
     0,                         /* tp_iternext */
     Checksum_methods,          /* tp_methods */
     0,                         /* tp_members */
-    0,                         /* tp_getset */
+    Checksum_getseters,        /* tp_getset */
     0,                         /* tp_base */
     0,                         /* tp_dict */
     0,                         /* tp_descr_get */
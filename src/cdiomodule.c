@@ -1,5 +1,10 @@
 #include "cdiomodule.h"
 #include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <cdio/cd_types.h>
 #include <cdio/audio.h>
 #include <cdio/track.h>
@@ -75,6 +80,7 @@ CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
 
     self->is_cd_image = 0;
     self->is_logging = 0;
+    self->close = NULL;
     self->dealloc = NULL;
     self->closed = 0;
     self->audiotools_pcm = NULL;
@@ -125,9 +131,14 @@ CDDAReader_init(cdio_CDDAReader *self, PyObject *args, PyObject *kwds)
 static int
 CDDAReader_init_image(cdio_CDDAReader *self, const char *device)
 {
+    char *bin_file = NULL;
+    char *cue_file = NULL;
+
     self->_.image.image = NULL;
     self->_.image.current_sector = 0;
     self->_.image.final_sector = 0;
+    self->_.image.mapped = NULL;
+    self->_.image.mapped_size = 0;
     self->first_track_num  = CDDAReader_first_track_num_image;
     self->last_track_num = CDDAReader_last_track_num_image;
     self->track_lsn = CDDAReader_track_lsn_image;
@@ -137,12 +148,15 @@ CDDAReader_init_image(cdio_CDDAReader *self, const char *device)
     self->read = CDDAReader_read_image;
     self->seek = CDDAReader_seek_image;
     self->set_speed = CDDAReader_set_speed_image;
+    self->close = CDDAReader_close_image;
     self->dealloc = CDDAReader_dealloc_image;
 
     /*open CD image based on what type it is*/
-    if (cdio_is_cuefile(device)) {
+    if ((bin_file = cdio_is_cuefile(device)) != NULL) {
         self->_.image.image = cdio_open_cue(device);
-    } else if (cdio_is_tocfile(device)) {
+    } else if ((cue_file = cdio_is_binfile(device)) != NULL) {
+        free(cue_file);
+        bin_file = strdup(device);
         self->_.image.image = cdio_open_bincue(device);
     } else if (cdio_is_tocfile(device)) {
         self->_.image.image = cdio_open_cdrdao(device);
@@ -150,21 +164,114 @@ CDDAReader_init_image(cdio_CDDAReader *self, const char *device)
         self->_.image.image = cdio_open_nrg(device);
     }
     if (self->_.image.image == NULL) {
+        free(bin_file);
         PyErr_SetString(PyExc_IOError, "unable to open CD image");
         return -1;
     }
     self->_.image.final_sector = (lsn_t)self->last_sector(self);
+
+    /*BIN/CUE images are mapped and converted
+      straight from memory when possible*/
+    if (bin_file != NULL) {
+        if (cdio_get_driver_id(self->_.image.image) == DRIVER_BINCUE) {
+            CDDAReader_map_image(self, bin_file);
+        }
+        free(bin_file);
+    }
+
     return 0;
 }
 
+static void
+CDDAReader_map_image(cdio_CDDAReader *self, const char *bin_file)
+{
+    const int first_track_num = self->first_track_num(self);
+    const int last_track_num = self->last_track_num(self);
+    const size_t image_size =
+        ((size_t)self->_.image.final_sector + 1) * CDIO_CD_FRAMESIZE_RAW;
+    struct stat buf;
+    void *mapped;
+    int fd;
+    int i;
+
+    if (self->_.image.final_sector < 0) {
+        return;
+    }
+    if ((fd = open(bin_file, O_RDONLY)) == -1) {
+        return;
+    }
+    if (fstat(fd, &buf) || (buf.st_size < (off_t)image_size)) {
+        close(fd);
+        return;
+    }
+    mapped = mmap(NULL, (size_t)buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(mapped, (size_t)buf.st_size, MADV_SEQUENTIAL);
+#endif
+
+    /*BIN/CUE sector N is at byte N * 2352 of a single BIN file,
+      but cue sheets with several files or PREGAP entries
+      break that, so check the start and end of every track
+      against what libcdio reads before trusting the mapping*/
+    for (i = first_track_num; i <= last_track_num; i++) {
+        const lsn_t sectors[2] = {self->track_lsn(self, i),
+                                  self->track_last_lsn(self, i)};
+        unsigned j;
+
+        for (j = 0; j < 2; j++) {
+            uint8_t sector[CDIO_CD_FRAMESIZE_RAW];
+
+            if ((sectors[j] < 0) ||
+                (sectors[j] > self->_.image.final_sector) ||
+                (cdio_read_audio_sector(self->_.image.image,
+                                        sector,
+                                        sectors[j]) != DRIVER_OP_SUCCESS) ||
+                memcmp(sector,
+                       (const uint8_t*)mapped +
+                       ((size_t)sectors[j] * CDIO_CD_FRAMESIZE_RAW),
+                       CDIO_CD_FRAMESIZE_RAW)) {
+                munmap(mapped, (size_t)buf.st_size);
+                return;
+            }
+        }
+    }
+
+    self->_.image.mapped = mapped;
+    self->_.image.mapped_size = (size_t)buf.st_size;
+}
+
 static int
 CDDAReader_init_device(cdio_CDDAReader *self, const char *device)
 {
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+
     self->_.drive.drive = NULL;
     self->_.drive.paranoia = NULL;
     self->_.drive.current_sector = 0;
     self->_.drive.final_sector = 0;
 
+    read_ahead->started = 0;
+    pthread_mutex_init(&(read_ahead->mutex), NULL);
+    pthread_cond_init(&(read_ahead->filled), NULL);
+    pthread_cond_init(&(read_ahead->drained), NULL);
+    read_ahead->sectors = NULL;
+    read_ahead->logs = NULL;
+    read_ahead->head = 0;
+    read_ahead->count = 0;
+    read_ahead->next_sector = 0;
+    read_ahead->generation = 0;
+    read_ahead->seek_requested = 0;
+    read_ahead->speed_requested = 0;
+    read_ahead->speed = 0;
+    read_ahead->stop = 0;
+    read_ahead->error = 0;
+    self->close = CDDAReader_close_device;
+    self->dealloc = CDDAReader_dealloc_device;
+
     if ((self->_.drive.drive = cdio_cddap_identify(device, 0, NULL)) == NULL) {
         PyErr_SetString(PyExc_IOError, "error opening CD-ROM");
         return -1;
@@ -186,7 +293,6 @@ CDDAReader_init_device(cdio_CDDAReader *self, const char *device)
     self->read = CDDAReader_read_device;
     self->seek = CDDAReader_seek_device;
     self->set_speed = CDDAReader_set_speed_device;
-    self->dealloc = CDDAReader_dealloc_device;
 
     self->_.drive.final_sector = self->last_sector(self);
 
@@ -212,6 +318,9 @@ CDDAReader_dealloc(cdio_CDDAReader *self)
 static void
 CDDAReader_dealloc_image(cdio_CDDAReader *self)
 {
+    if (self->_.image.mapped != NULL) {
+        munmap((void*)self->_.image.mapped, self->_.image.mapped_size);
+    }
     if (self->_.image.image != NULL) {
         cdio_destroy(self->_.image.image);
     }
@@ -220,6 +329,15 @@ CDDAReader_dealloc_image(cdio_CDDAReader *self)
 static void
 CDDAReader_dealloc_device(cdio_CDDAReader *self)
 {
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+
+    CDDAReader_close_device(self);
+    free(read_ahead->sectors);
+    free(read_ahead->logs);
+    pthread_mutex_destroy(&(read_ahead->mutex));
+    pthread_cond_destroy(&(read_ahead->filled));
+    pthread_cond_destroy(&(read_ahead->drained));
+
     if (self->_.drive.paranoia) {
         cdio_paranoia_free(self->_.drive.paranoia);
     }
@@ -446,7 +564,6 @@ CDDAReader_read(cdio_CDDAReader* self, PyObject *args)
     unsigned sectors_to_read;
     pcm_FrameList *framelist;
     int sectors_read;
-    PyThreadState *thread_state = NULL;
 
     if (!PyArg_ParseTuple(args, "i", &pcm_frames)) {
         return NULL;
@@ -462,25 +579,20 @@ CDDAReader_read(cdio_CDDAReader* self, PyObject *args)
         sectors_to_read = 1;
     }
 
-    framelist = new_FrameList(self->audiotools_pcm,
-                              2,
-                              16,
-                              sectors_to_read * (44100 / 75));
-
-    /*if logging is in progress, only let a single thread
-      into this function at once so that the global callback
-      can be set and used atomically
-
-      since the callback function doesn't take any state
-      we're forced to stick it in a global variable*/
-    if (!self->is_logging) {
-        thread_state = PyEval_SaveThread();
-    }
-    sectors_read = self->read(self, sectors_to_read, framelist->samples);
-    if (!self->is_logging) {
-        PyEval_RestoreThread(thread_state);
+    /*CD audio is 16-bit to begin with,
+      so it's stored that way rather than widened*/
+    framelist = new_compact_FrameList(self->audiotools_pcm,
+                                      2,
+                                      16,
+                                      sectors_to_read * (44100 / 75));
+    if (framelist == NULL) {
+        return NULL;
     }
 
+    Py_BEGIN_ALLOW_THREADS
+    sectors_read = self->read(self, sectors_to_read, framelist->samples16);
+    Py_END_ALLOW_THREADS
+
     if (sectors_read >= 0) {
         /*reduce length of framelist if fewer samples are read*/
         framelist->frames = sectors_read * (44100 / 75);
@@ -495,66 +607,203 @@ CDDAReader_read(cdio_CDDAReader* self, PyObject *args)
 static int
 CDDAReader_read_image(cdio_CDDAReader *self,
                       unsigned sectors_to_read,
-                      int *samples)
+                      int16_t *samples)
 {
     const unsigned samples_per_sector = (44100 / 75) * 2;
-    const unsigned initial_sectors_to_read = sectors_to_read;
-
-    while (sectors_to_read &&
-           (self->_.image.current_sector <= self->_.image.final_sector)) {
-        uint8_t sector[CDIO_CD_FRAMESIZE_RAW];
-        const int result = cdio_read_audio_sector(
-            self->_.image.image,
-            sector,
-            self->_.image.current_sector);
-
-        if (result == DRIVER_OP_SUCCESS) {
-            pcm_to_int_converter(16, 0, 1)(samples_per_sector, sector, samples);
-            samples += samples_per_sector;
-            self->_.image.current_sector++;
-            sectors_to_read--;
-        } else {
+    const lsn_t current_sector = self->_.image.current_sector;
+    unsigned sectors;
+
+    if (current_sector > self->_.image.final_sector) {
+        return 0;
+    }
+    sectors = MIN(sectors_to_read,
+                  (unsigned)(self->_.image.final_sector - current_sector + 1));
+
+    if (self->_.image.mapped != NULL) {
+        /*convert every sector straight from the mapped image*/
+        pcm_to_int16_converter(16, 0, 1)(
+            sectors * samples_per_sector,
+            self->_.image.mapped +
+            ((size_t)current_sector * CDIO_CD_FRAMESIZE_RAW),
+            samples);
+    } else {
+        /*read every sector into the FrameList at once
+          and convert them in place,
+          since each sample's 2 bytes become its own int16_t*/
+        if (cdio_read_audio_sectors(self->_.image.image,
+                                    samples,
+                                    current_sector,
+                                    sectors) != DRIVER_OP_SUCCESS) {
             return -1;
         }
+        pcm_to_int16_converter(16, 0, 1)(
+            sectors * samples_per_sector,
+            (const unsigned char*)samples,
+            samples);
     }
 
-    return initial_sectors_to_read - sectors_to_read;
+    self->_.image.current_sector += sectors;
+
+    return sectors;
 }
 
 static int
 CDDAReader_read_device(cdio_CDDAReader *self,
                        unsigned sectors_to_read,
-                       int *samples)
+                       int16_t *samples)
 {
-    const unsigned initial_sectors_to_read = sectors_to_read;
-
-    if (self->is_logging) {
-        log_state = &(self->log);
+    const unsigned samples_per_sector = (44100 / 75) * 2;
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+    unsigned sectors_read = 0;
+
+    pthread_mutex_lock(&(read_ahead->mutex));
+
+    /*the drive starts reading ahead once the first sector is wanted*/
+    if (!read_ahead->started) {
+        if (read_ahead->sectors == NULL) {
+            read_ahead->sectors = malloc(READ_AHEAD_SECTORS *
+                                         CDIO_CD_FRAMESIZE_RAW);
+            read_ahead->logs = malloc(READ_AHEAD_SECTORS *
+                                      sizeof(struct cdio_log));
+        }
+        if ((read_ahead->sectors == NULL) ||
+            (read_ahead->logs == NULL) ||
+            pthread_create(&(read_ahead->thread),
+                           NULL,
+                           cddareader_read_ahead,
+                           self)) {
+            pthread_mutex_unlock(&(read_ahead->mutex));
+            return -1;
+        }
+        read_ahead->started = 1;
     }
 
-    while (sectors_to_read &&
+    while (sectors_read < sectors_to_read &&
            (self->_.drive.current_sector <= self->_.drive.final_sector)) {
-        int16_t *raw_sector =
-            cdio_paranoia_read_limited(
-                self->_.drive.paranoia,
-                self->is_logging ? cddareader_callback : NULL,
-                10);
+        unsigned to_take;
         unsigned i;
 
-        for (i = 0; i < ((44100 / 75) * 2); i++) {
-            *samples = raw_sector[i];
-            samples += 1;
+        while ((read_ahead->count == 0) && !read_ahead->error) {
+            pthread_cond_wait(&(read_ahead->filled), &(read_ahead->mutex));
+        }
+        if (read_ahead->count == 0) {
+            pthread_mutex_unlock(&(read_ahead->mutex));
+            return -1;
         }
 
-        self->_.drive.current_sector++;
-        sectors_to_read--;
+        /*the thread only appends to the ring,
+          so the sectors already in it can be copied unlocked*/
+        to_take = MIN(read_ahead->count, sectors_to_read - sectors_read);
+        pthread_mutex_unlock(&(read_ahead->mutex));
+        for (i = 0; i < to_take; i++) {
+            memcpy(samples,
+                   read_ahead->sectors +
+                   (((read_ahead->head + i) % READ_AHEAD_SECTORS) *
+                    samples_per_sector),
+                   CDIO_CD_FRAMESIZE_RAW);
+            samples += samples_per_sector;
+        }
+        pthread_mutex_lock(&(read_ahead->mutex));
+
+        if (self->is_logging) {
+            for (i = 0; i < to_take; i++) {
+                cddareader_add_log(
+                    &(self->log),
+                    &(read_ahead->logs[(read_ahead->head + i) %
+                                       READ_AHEAD_SECTORS]));
+            }
+        }
+        read_ahead->head = (read_ahead->head + to_take) % READ_AHEAD_SECTORS;
+        read_ahead->count -= to_take;
+        self->_.drive.current_sector += to_take;
+        sectors_read += to_take;
+        pthread_cond_signal(&(read_ahead->drained));
     }
 
-    if (self->is_logging) {
-        log_state = NULL;
+    pthread_mutex_unlock(&(read_ahead->mutex));
+
+    return sectors_read;
+}
+
+static void*
+cddareader_read_ahead(void *arg)
+{
+    cdio_CDDAReader *self = arg;
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+    const unsigned samples_per_sector = (44100 / 75) * 2;
+    struct cdio_log log;
+
+    /*paranoia's callbacks from this thread land in its own log
+      which is stored alongside every sector read*/
+    cddareader_reset_log(&log);
+    log_state = &log;
+
+    pthread_mutex_lock(&(read_ahead->mutex));
+    while (!read_ahead->stop) {
+        unsigned generation;
+        int16_t *raw_sector;
+
+        if (read_ahead->speed_requested) {
+            const int speed = read_ahead->speed;
+            read_ahead->speed_requested = 0;
+            pthread_mutex_unlock(&(read_ahead->mutex));
+            cdio_cddap_speed_set(self->_.drive.drive, speed);
+            pthread_mutex_lock(&(read_ahead->mutex));
+            continue;
+        }
+
+        if (read_ahead->seek_requested) {
+            const lsn_t sector = read_ahead->next_sector;
+            read_ahead->seek_requested = 0;
+            pthread_mutex_unlock(&(read_ahead->mutex));
+            cdio_paranoia_seek(self->_.drive.paranoia,
+                               (int32_t)sector,
+                               (int)SEEK_SET);
+            pthread_mutex_lock(&(read_ahead->mutex));
+            continue;
+        }
+
+        if ((read_ahead->count == READ_AHEAD_SECTORS) ||
+            (read_ahead->next_sector > self->_.drive.final_sector) ||
+            read_ahead->error) {
+            /*nothing to do until the caller takes sectors or seeks*/
+            pthread_cond_wait(&(read_ahead->drained), &(read_ahead->mutex));
+            continue;
+        }
+
+        generation = read_ahead->generation;
+        pthread_mutex_unlock(&(read_ahead->mutex));
+
+        raw_sector = cdio_paranoia_read_limited(
+            self->_.drive.paranoia,
+            self->is_logging ? cddareader_callback : NULL,
+            10);
+
+        pthread_mutex_lock(&(read_ahead->mutex));
+
+        if (generation != read_ahead->generation) {
+            /*the caller seeked while this sector was being read*/
+            cddareader_reset_log(&log);
+            continue;
+        } else if (raw_sector == NULL) {
+            read_ahead->error = 1;
+        } else {
+            const unsigned slot =
+                (read_ahead->head + read_ahead->count) % READ_AHEAD_SECTORS;
+            memcpy(read_ahead->sectors + (slot * samples_per_sector),
+                   raw_sector,
+                   CDIO_CD_FRAMESIZE_RAW);
+            read_ahead->logs[slot] = log;
+            cddareader_reset_log(&log);
+            read_ahead->count++;
+            read_ahead->next_sector++;
+        }
+        pthread_cond_signal(&(read_ahead->filled));
     }
+    pthread_mutex_unlock(&(read_ahead->mutex));
 
-    return initial_sectors_to_read - sectors_to_read;
+    log_state = NULL;
+    return NULL;
 }
 
 static PyObject*
@@ -596,23 +845,70 @@ static unsigned
 CDDAReader_seek_device(cdio_CDDAReader *self, unsigned sector)
 {
     const unsigned desired_sector = MIN(sector, self->_.drive.final_sector - 1u);
-    /*not sure what this returns, but it isn't the sector seeked to*/
-    cdio_paranoia_seek(self->_.drive.paranoia,
-                       (int32_t)desired_sector,
-                       (int)SEEK_SET);
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+
+    pthread_mutex_lock(&(read_ahead->mutex));
+    if (read_ahead->started) {
+        /*discard whatever's been read ahead
+          and have the thread seek before reading again*/
+        read_ahead->generation++;
+        read_ahead->head = 0;
+        read_ahead->count = 0;
+        read_ahead->error = 0;
+        read_ahead->seek_requested = 1;
+        pthread_cond_signal(&(read_ahead->drained));
+    } else {
+        /*not sure what this returns, but it isn't the sector seeked to*/
+        cdio_paranoia_seek(self->_.drive.paranoia,
+                           (int32_t)desired_sector,
+                           (int)SEEK_SET);
+    }
+    read_ahead->next_sector = desired_sector;
     self->_.drive.current_sector = desired_sector;
+    pthread_mutex_unlock(&(read_ahead->mutex));
+
     return self->_.drive.current_sector;
 }
 
 static PyObject*
 CDDAReader_close(cdio_CDDAReader* self, PyObject *args)
 {
+    if (!self->closed && self->close) {
+        Py_BEGIN_ALLOW_THREADS
+        self->close(self);
+        Py_END_ALLOW_THREADS
+    }
     self->closed = 1;
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
+static void
+CDDAReader_close_image(cdio_CDDAReader *self)
+{
+    /*nothing to stop*/
+}
+
+static void
+CDDAReader_close_device(cdio_CDDAReader *self)
+{
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+
+    pthread_mutex_lock(&(read_ahead->mutex));
+    if (read_ahead->started) {
+        read_ahead->stop = 1;
+        pthread_cond_signal(&(read_ahead->drained));
+        pthread_mutex_unlock(&(read_ahead->mutex));
+        pthread_join(read_ahead->thread, NULL);
+        pthread_mutex_lock(&(read_ahead->mutex));
+        read_ahead->started = 0;
+        read_ahead->stop = 0;
+        read_ahead->count = 0;
+    }
+    pthread_mutex_unlock(&(read_ahead->mutex));
+}
+
 static PyObject*
 CDDAReader_set_speed(cdio_CDDAReader *self, PyObject *args)
 {
@@ -636,7 +932,17 @@ CDDAReader_set_speed_image(cdio_CDDAReader *self, int new_speed)
 static void
 CDDAReader_set_speed_device(cdio_CDDAReader *self, int new_speed)
 {
-    cdio_cddap_speed_set(self->_.drive.drive, new_speed);
+    struct cdio_read_ahead *read_ahead = &(self->_.drive.read_ahead);
+
+    pthread_mutex_lock(&(read_ahead->mutex));
+    if (read_ahead->started) {
+        read_ahead->speed = new_speed;
+        read_ahead->speed_requested = 1;
+        pthread_cond_signal(&(read_ahead->drained));
+    } else {
+        cdio_cddap_speed_set(self->_.drive.drive, new_speed);
+    }
+    pthread_mutex_unlock(&(read_ahead->mutex));
 }
 
 static void
@@ -707,6 +1013,24 @@ cddareader_reset_log(struct cdio_log *log)
     log->readerr = 0;
 }
 
+static void
+cddareader_add_log(struct cdio_log *total, const struct cdio_log *log)
+{
+    total->read += log->read;
+    total->verify += log->verify;
+    total->fixup_edge += log->fixup_edge;
+    total->fixup_atom += log->fixup_atom;
+    total->scratch += log->scratch;
+    total->repair += log->repair;
+    total->skip += log->skip;
+    total->drift += log->drift;
+    total->backoff += log->backoff;
+    total->overlap += log->overlap;
+    total->fixup_dropped += log->fixup_dropped;
+    total->fixup_duped += log->fixup_duped;
+    total->readerr += log->readerr;
+}
+
 static int
 cddareader_set_log_item(PyObject *dict, const char *key, int value)
 {
@@ -727,8 +1051,20 @@ cddareader_set_log_item(PyObject *dict, const char *key, int value)
 static PyObject*
 CDDAReader_log(cdio_CDDAReader *self, PyObject *args)
 {
-    const struct cdio_log *log = &(self->log);
-    PyObject *log_obj = PyDict_New();
+    struct cdio_log log_copy;
+    const struct cdio_log *log = &log_copy;
+    PyObject *log_obj;
+
+    /*a drive's read-ahead thread adds to the log as it goes*/
+    if (self->is_cd_image) {
+        log_copy = self->log;
+    } else {
+        pthread_mutex_lock(&(self->_.drive.read_ahead.mutex));
+        log_copy = self->log;
+        pthread_mutex_unlock(&(self->_.drive.read_ahead.mutex));
+    }
+
+    log_obj = PyDict_New();
     if (log_obj) {
         if (cddareader_set_log_item(log_obj, "read", log->read))
             goto error;
@@ -770,7 +1106,13 @@ error:
 static PyObject*
 CDDAReader_reset_log(cdio_CDDAReader *self, PyObject *args)
 {
-    cddareader_reset_log(&(self->log));
+    if (self->is_cd_image) {
+        cddareader_reset_log(&(self->log));
+    } else {
+        pthread_mutex_lock(&(self->_.drive.read_ahead.mutex));
+        cddareader_reset_log(&(self->log));
+        pthread_mutex_unlock(&(self->_.drive.read_ahead.mutex));
+    }
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -1,5 +1,6 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <pthread.h>
 #ifdef PARANOIA_LT_0_90
 #include <cdio/cdda.h>
 #include <cdio/paranoia.h>
@@ -50,9 +51,45 @@ struct cdio_log {
     int readerr;
 };
 
-/*global pointer to the current cdio_log state
-  to be used by the cddareader_callback*/
-struct cdio_log *log_state = NULL;
+/*pointer to the cdio_log state of the thread reading from paranoia
+  to be used by the cddareader_callback
+
+  since the callback function doesn't take any state
+  each drive's read-ahead thread points this at its own log*/
+static __thread struct cdio_log *log_state = NULL;
+
+/*the number of sectors a drive may read ahead of the caller*/
+#define READ_AHEAD_SECTORS 300
+
+/*a drive's read-ahead thread and the verified sectors it has read
+
+  only this thread calls paranoia or the drive once it's started,
+  so seeks and speed changes are left as requests for it to carry out*/
+struct cdio_read_ahead {
+    pthread_t thread;
+    int started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;    /*signaled when a sector is read*/
+    pthread_cond_t drained;   /*signaled when a sector is taken
+                                or a request is made*/
+
+    /*a ring of sectors following the caller's current sector
+      along with what paranoia logged while reading each one,
+      which is added to the reader's log once the sector is taken*/
+    int16_t *sectors;
+    struct cdio_log *logs;
+    unsigned head;
+    unsigned count;
+
+    lsn_t next_sector;        /*the next sector for the thread to read*/
+    unsigned generation;      /*incremented by each seek*/
+    int seek_requested;
+    int speed_requested;
+    int speed;
+    int stop;
+    int error;
+};
 
 static void
 cddareader_callback(long int i, paranoia_cb_mode_t mode);
@@ -68,12 +105,18 @@ typedef struct cdio_CDDAReader_s {
             CdIo_t *image;
             lsn_t current_sector;
             lsn_t final_sector;
+
+            /*a BIN file's raw sectors mapped into memory,
+              or NULL if sectors are read through libcdio*/
+            const uint8_t *mapped;
+            size_t mapped_size;
         } image;
         struct {
             cdrom_drive_t *drive;
             cdrom_paranoia_t *paranoia;
             lsn_t current_sector;
             lsn_t final_sector;
+            struct cdio_read_ahead read_ahead;
         } drive;
     } _;
     int (*first_track_num)(struct cdio_CDDAReader_s *self);
@@ -84,9 +127,10 @@ typedef struct cdio_CDDAReader_s {
     int (*last_sector)(struct cdio_CDDAReader_s *self);
     int (*read)(struct cdio_CDDAReader_s *self,
                 unsigned to_read,
-                int *samples);
+                int16_t *samples);
     unsigned (*seek)(struct cdio_CDDAReader_s *self, unsigned sector);
     void (*set_speed)(struct cdio_CDDAReader_s *self, int new_speed);
+    void (*close)(struct cdio_CDDAReader_s *self);
     void (*dealloc)(struct cdio_CDDAReader_s *self);
 
     int closed;
@@ -105,6 +149,12 @@ CDDAReader_init_image(cdio_CDDAReader *self, const char *device);
 static int
 CDDAReader_init_device(cdio_CDDAReader *self, const char *device);
 
+/*maps the BIN file of an opened BIN/CUE image into memory
+  if its sectors match those libcdio reads,
+  otherwise leaves the image to be read through libcdio*/
+static void
+CDDAReader_map_image(cdio_CDDAReader *self, const char *bin_file);
+
 static void
 CDDAReader_dealloc(cdio_CDDAReader *self);
 
@@ -205,12 +255,12 @@ CDDAReader_read(cdio_CDDAReader* self, PyObject *args);
 static int
 CDDAReader_read_image(cdio_CDDAReader *self,
                       unsigned sectors_to_read,
-                      int *samples);
+                      int16_t *samples);
 
 static int
 CDDAReader_read_device(cdio_CDDAReader *self,
                        unsigned sectors_to_read,
-                       int *samples);
+                       int16_t *samples);
 
 static PyObject*
 CDDAReader_seek(cdio_CDDAReader* self, PyObject *args);
@@ -224,6 +274,17 @@ CDDAReader_seek_device(cdio_CDDAReader *self, unsigned sector);
 static PyObject*
 CDDAReader_close(cdio_CDDAReader* self, PyObject *args);
 
+static void
+CDDAReader_close_image(cdio_CDDAReader *self);
+
+/*stops the drive's read-ahead thread, if any*/
+static void
+CDDAReader_close_device(cdio_CDDAReader *self);
+
+/*reads sectors from paranoia into the ring until stopped*/
+static void*
+cddareader_read_ahead(void *arg);
+
 static PyObject*
 CDDAReader_set_speed(cdio_CDDAReader *self, PyObject *args);
 
@@ -245,6 +306,10 @@ CDDAReader_reset_log(cdio_CDDAReader *self, PyObject *args);
 static void
 cddareader_reset_log(struct cdio_log *log);
 
+/*adds the counts in "log" to "total"*/
+static void
+cddareader_add_log(struct cdio_log *total, const struct cdio_log *log);
+
 static PyMethodDef CDDAReader_methods[] = {
     {"read", (PyCFunction)CDDAReader_read,
      METH_VARARGS, "read(pcm_frames) -> Framelist"},
@@ -0,0 +1,693 @@
+#include "tta_filter.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#include "../simd.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*******************************
+ * private function signatures *
+ *******************************/
+
+/*runs the filter over a single sample, one tap at a time*/
+static inline int
+filter_sample(tta_filter_direction_t direction,
+              struct tta_filter_params *params,
+              int input);
+
+#if defined(__SSE2__)
+/*runs the filter over "pcm_frames" samples of a single channel
+  spaced "stride" apart, with all 8 taps held in vector registers*/
+static void
+filter_channel_sse2(tta_filter_direction_t direction,
+                    struct tta_filter_params *params,
+                    unsigned pcm_frames,
+                    unsigned stride,
+                    int samples[]);
+
+/*runs the filter over "lanes" adjacent channels at once
+  (where "lanes" is 1 to 4) with one channel per vector lane*/
+static void
+filter_lanes_sse2(tta_filter_direction_t direction,
+                  unsigned channels,
+                  unsigned lanes,
+                  struct tta_filter_params params[],
+                  unsigned pcm_frames,
+                  int samples[]);
+#endif
+
+#if defined(SIMD_X86)
+/*works like filter_lanes_sse2, but for up to 8 lanes*/
+SIMD_TARGET("avx2") static void
+filter_lanes_avx2(tta_filter_direction_t direction,
+                  unsigned channels,
+                  unsigned lanes,
+                  struct tta_filter_params params[],
+                  unsigned pcm_frames,
+                  int samples[]);
+#endif
+
+/***********************************
+ * public function implementations *
+ ***********************************/
+
+void
+tta_init_filter_params(unsigned bits_per_sample,
+                       struct tta_filter_params *params)
+{
+    switch (bits_per_sample) {
+    case 8:
+        params->shift = 10;
+        break;
+    case 16:
+        params->shift = 9;
+        break;
+    case 24:
+        params->shift = 10;
+        break;
+    }
+    params->previous_residual = 0;
+    params->round = 1 << (params->shift - 1);
+    memset(params->qm, 0, sizeof(params->qm));
+    memset(params->dx, 0, sizeof(params->dx));
+    memset(params->dl, 0, sizeof(params->dl));
+}
+
+void
+tta_run_filter(tta_filter_direction_t direction,
+               unsigned channels,
+               struct tta_filter_params params[],
+               unsigned pcm_frames,
+               int samples[])
+{
+#if defined(__SSE2__)
+#if defined(__SSE4_1__)
+    /*with a native 32-bit multiply,
+      filtering channels in lanes wins from 2 channels up*/
+    const unsigned minimum_lanes = 2;
+#else
+    /*but emulated multiplies make mostly-empty lanes a loss*/
+    const unsigned minimum_lanes = 3;
+#endif
+#if defined(SIMD_X86)
+    const int has_avx2 = simd_supports("avx2");
+#endif
+    unsigned c;
+
+    if (channels < minimum_lanes) {
+        /*vectorize across each channel's taps instead*/
+        for (c = 0; c < channels; c++) {
+            filter_channel_sse2(direction,
+                                &params[c],
+                                pcm_frames,
+                                channels,
+                                samples + c);
+        }
+        return;
+    }
+
+    for (c = 0; c < channels;) {
+        const unsigned remaining = channels - c;
+#if defined(SIMD_X86)
+        if (has_avx2 && (remaining > 4)) {
+            const unsigned lanes = remaining < 8 ? remaining : 8;
+            filter_lanes_avx2(direction,
+                              channels,
+                              lanes,
+                              params + c,
+                              pcm_frames,
+                              samples + c);
+            c += lanes;
+            continue;
+        }
+#endif
+        {
+            const unsigned lanes = remaining < 4 ? remaining : 4;
+            filter_lanes_sse2(direction,
+                              channels,
+                              lanes,
+                              params + c,
+                              pcm_frames,
+                              samples + c);
+            c += lanes;
+        }
+    }
+#else
+    tta_run_filter_scalar(direction, channels, params, pcm_frames, samples);
+#endif
+}
+
+void
+tta_run_filter_scalar(tta_filter_direction_t direction,
+                      unsigned channels,
+                      struct tta_filter_params params[],
+                      unsigned pcm_frames,
+                      int samples[])
+{
+    for (; pcm_frames; pcm_frames--) {
+        unsigned c;
+        for (c = 0; c < channels; c++) {
+            samples[c] = filter_sample(direction, &params[c], samples[c]);
+        }
+        samples += channels;
+    }
+}
+
+int
+tta_filter_kernel_available(tta_filter_kernel_t kernel)
+{
+    switch (kernel) {
+    case TTA_KERNEL_SCALAR:
+        return 1;
+#if defined(__SSE2__)
+    case TTA_KERNEL_SSE2:
+    case TTA_KERNEL_SSE2_LANES:
+        return 1;
+#endif
+#if defined(SIMD_X86)
+    case TTA_KERNEL_AVX2_LANES:
+        return simd_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+void
+tta_run_filter_kernel(tta_filter_kernel_t kernel,
+                      tta_filter_direction_t direction,
+                      unsigned channels,
+                      struct tta_filter_params params[],
+                      unsigned pcm_frames,
+                      int samples[])
+{
+    unsigned c;
+    unsigned lanes;
+
+    switch (kernel) {
+#if defined(__SSE2__)
+    case TTA_KERNEL_SSE2:
+        for (c = 0; c < channels; c++) {
+            filter_channel_sse2(direction,
+                                &params[c],
+                                pcm_frames,
+                                channels,
+                                samples + c);
+        }
+        break;
+    case TTA_KERNEL_SSE2_LANES:
+        for (c = 0; c < channels; c += lanes) {
+            lanes = channels - c < 4 ? channels - c : 4;
+            filter_lanes_sse2(direction,
+                              channels,
+                              lanes,
+                              params + c,
+                              pcm_frames,
+                              samples + c);
+        }
+        break;
+#endif
+#if defined(SIMD_X86)
+    case TTA_KERNEL_AVX2_LANES:
+        for (c = 0; c < channels; c += lanes) {
+            lanes = channels - c < 8 ? channels - c : 8;
+            filter_lanes_avx2(direction,
+                              channels,
+                              lanes,
+                              params + c,
+                              pcm_frames,
+                              samples + c);
+        }
+        break;
+#endif
+    default:
+        tta_run_filter_scalar(direction,
+                              channels,
+                              params,
+                              pcm_frames,
+                              samples);
+        break;
+    }
+}
+
+/************************************
+ * private function implementations *
+ ************************************/
+
+static inline int
+sign(int x) {
+    if (x > 0) {
+        return 1;
+    } else if (x < 0) {
+        return -1;
+    } else {
+        return 0;
+    }
+}
+
+static inline int
+filter_sample(tta_filter_direction_t direction,
+              struct tta_filter_params *params,
+              int input)
+{
+    const int previous_sign = sign(params->previous_residual);
+    int32_t sum = params->round;
+    int output;
+    int value;
+
+    sum += params->dl[0] * (params->qm[0] += previous_sign * params->dx[0]);
+    sum += params->dl[1] * (params->qm[1] += previous_sign * params->dx[1]);
+    sum += params->dl[2] * (params->qm[2] += previous_sign * params->dx[2]);
+    sum += params->dl[3] * (params->qm[3] += previous_sign * params->dx[3]);
+    sum += params->dl[4] * (params->qm[4] += previous_sign * params->dx[4]);
+    sum += params->dl[5] * (params->qm[5] += previous_sign * params->dx[5]);
+    sum += params->dl[6] * (params->qm[6] += previous_sign * params->dx[6]);
+    sum += params->dl[7] * (params->qm[7] += previous_sign * params->dx[7]);
+
+    if (direction == TTA_FILTER_ENCODE) {
+        /*input is predicted sample, output is residual*/
+        output = input - (sum >> params->shift);
+        params->previous_residual = output;
+        value = input;
+    } else {
+        /*input is residual, output is predicted sample*/
+        output = input + (sum >> params->shift);
+        params->previous_residual = input;
+        value = output;
+    }
+
+    params->dx[0] = params->dx[1];
+    params->dx[1] = params->dx[2];
+    params->dx[2] = params->dx[3];
+    params->dx[3] = params->dx[4];
+    params->dx[4] = params->dl[4] >= 0 ? 1 : -1;
+    params->dx[5] = params->dl[5] >= 0 ? 2 : -2;
+    params->dx[6] = params->dl[6] >= 0 ? 2 : -2;
+    params->dx[7] = params->dl[7] >= 0 ? 4 : -4;
+    params->dl[0] = params->dl[1];
+    params->dl[1] = params->dl[2];
+    params->dl[2] = params->dl[3];
+    params->dl[3] = params->dl[4];
+    params->dl[4] =
+        -(params->dl[5]) + (-(params->dl[6]) + (value - params->dl[7]));
+    params->dl[5] = -(params->dl[6]) + (value - params->dl[7]);
+    params->dl[6] = value - params->dl[7];
+    params->dl[7] = value;
+
+    return output;
+}
+
+#if defined(__SSE2__)
+
+/*returns x multiplied by the sign of s, per 32-bit lane*/
+static inline __m128i
+sign_sse2(__m128i x, __m128i s)
+{
+#if defined(__SSSE3__)
+    return _mm_sign_epi32(x, s);
+#else
+    const __m128i negative = _mm_srai_epi32(s, 31);
+    const __m128i zero = _mm_cmpeq_epi32(s, _mm_setzero_si128());
+    const __m128i masked = _mm_andnot_si128(zero, x);
+    return _mm_sub_epi32(_mm_xor_si128(masked, negative), negative);
+#endif
+}
+
+/*returns the low 32 bits of a * b, per 32-bit lane*/
+static inline __m128i
+mullo_sse2(__m128i a, __m128i b)
+{
+#if defined(__SSE4_1__)
+    return _mm_mullo_epi32(a, b);
+#else
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32),
+                                      _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+/*returns "step" where x >= 0 and -"step" where x < 0, per 32-bit lane*/
+static inline __m128i
+step_sse2(__m128i x, __m128i step)
+{
+    const __m128i negative = _mm_srai_epi32(x, 31);
+    return _mm_sub_epi32(_mm_xor_si128(step, negative), negative);
+}
+
+static void
+filter_channel_sse2(tta_filter_direction_t direction,
+                    struct tta_filter_params *params,
+                    unsigned pcm_frames,
+                    unsigned stride,
+                    int samples[])
+{
+    const __m128i steps = _mm_setr_epi32(1, 2, 2, 4);
+    const __m128i shift = _mm_cvtsi32_si128((int)params->shift);
+    const int round = params->round;
+    int previous_residual = params->previous_residual;
+
+    /*taps 0-3 in the low vectors, taps 4-7 in the high vectors*/
+    __m128i qm_lo = _mm_loadu_si128((const __m128i*)params->qm);
+    __m128i qm_hi = _mm_loadu_si128((const __m128i*)(params->qm + 4));
+    __m128i dx_lo = _mm_loadu_si128((const __m128i*)params->dx);
+    __m128i dx_hi = _mm_loadu_si128((const __m128i*)(params->dx + 4));
+    __m128i dl_lo = _mm_loadu_si128((const __m128i*)params->dl);
+    __m128i dl_hi = _mm_loadu_si128((const __m128i*)(params->dl + 4));
+
+    for (; pcm_frames; pcm_frames--) {
+        const __m128i previous = _mm_set1_epi32(previous_residual);
+        const int input = *samples;
+        __m128i sum;
+        __m128i suffix;
+        int output;
+        int value;
+
+        qm_lo = _mm_add_epi32(qm_lo, sign_sse2(dx_lo, previous));
+        qm_hi = _mm_add_epi32(qm_hi, sign_sse2(dx_hi, previous));
+
+        /*wrapping addition is associative,
+          so the horizontal sum matches the scalar sum's order*/
+        sum = _mm_add_epi32(mullo_sse2(dl_lo, qm_lo),
+                            mullo_sse2(dl_hi, qm_hi));
+        sum = _mm_add_epi32(sum,
+                            _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum,
+                            _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_sra_epi32(_mm_add_epi32(sum, _mm_set1_epi32(round)), shift);
+
+        if (direction == TTA_FILTER_ENCODE) {
+            output = input - _mm_cvtsi128_si32(sum);
+            previous_residual = output;
+            value = input;
+        } else {
+            output = input + _mm_cvtsi128_si32(sum);
+            previous_residual = input;
+            value = output;
+        }
+
+        /*dl[4] = value - dl[5] - dl[6] - dl[7]
+          dl[5] = value - dl[6] - dl[7]
+          dl[6] = value - dl[7]
+          dl[7] = value
+          which is value minus the suffix sums of the old high taps*/
+        suffix = _mm_srli_si128(dl_hi, 4);
+        suffix = _mm_add_epi32(suffix, _mm_srli_si128(suffix, 4));
+        suffix = _mm_add_epi32(suffix, _mm_srli_si128(suffix, 8));
+
+        /*shift taps 1-4 down to 0-3*/
+        dx_lo = _mm_or_si128(_mm_srli_si128(dx_lo, 4),
+                             _mm_slli_si128(dx_hi, 12));
+        dl_lo = _mm_or_si128(_mm_srli_si128(dl_lo, 4),
+                             _mm_slli_si128(dl_hi, 12));
+
+        dx_hi = step_sse2(dl_hi, steps);
+        dl_hi = _mm_sub_epi32(_mm_set1_epi32(value), suffix);
+
+        *samples = output;
+        samples += stride;
+    }
+
+    params->previous_residual = previous_residual;
+    _mm_storeu_si128((__m128i*)params->qm, qm_lo);
+    _mm_storeu_si128((__m128i*)(params->qm + 4), qm_hi);
+    _mm_storeu_si128((__m128i*)params->dx, dx_lo);
+    _mm_storeu_si128((__m128i*)(params->dx + 4), dx_hi);
+    _mm_storeu_si128((__m128i*)params->dl, dl_lo);
+    _mm_storeu_si128((__m128i*)(params->dl + 4), dl_hi);
+}
+
+static void
+filter_lanes_sse2(tta_filter_direction_t direction,
+                  unsigned channels,
+                  unsigned lanes,
+                  struct tta_filter_params params[],
+                  unsigned pcm_frames,
+                  int samples[])
+{
+    const __m128i round = _mm_set1_epi32(params[0].round);
+    const __m128i shift = _mm_cvtsi32_si128((int)params[0].shift);
+    const __m128i steps[4] = {_mm_set1_epi32(1),
+                              _mm_set1_epi32(2),
+                              _mm_set1_epi32(2),
+                              _mm_set1_epi32(4)};
+    __m128i qm[8];
+    __m128i dx[8];
+    __m128i dl[8];
+    __m128i previous;
+    int lane_buffer[4] = {0, 0, 0, 0};
+    unsigned i;
+    unsigned k;
+
+    /*transpose each channel's taps into one lane per channel*/
+    for (k = 0; k < 8; k++) {
+        int qm_lanes[4] = {0, 0, 0, 0};
+        int dx_lanes[4] = {0, 0, 0, 0};
+        int dl_lanes[4] = {0, 0, 0, 0};
+        for (i = 0; i < lanes; i++) {
+            qm_lanes[i] = params[i].qm[k];
+            dx_lanes[i] = params[i].dx[k];
+            dl_lanes[i] = params[i].dl[k];
+        }
+        qm[k] = _mm_loadu_si128((const __m128i*)qm_lanes);
+        dx[k] = _mm_loadu_si128((const __m128i*)dx_lanes);
+        dl[k] = _mm_loadu_si128((const __m128i*)dl_lanes);
+    }
+    for (i = 0; i < lanes; i++) {
+        lane_buffer[i] = params[i].previous_residual;
+    }
+    previous = _mm_loadu_si128((const __m128i*)lane_buffer);
+
+    for (; pcm_frames; pcm_frames--) {
+        __m128i input;
+        __m128i output;
+        __m128i value;
+        __m128i sum = round;
+        __m128i dl6;
+        __m128i dl5;
+
+        if (lanes == 4) {
+            input = _mm_loadu_si128((const __m128i*)samples);
+        } else {
+            memcpy(lane_buffer, samples, lanes * sizeof(int));
+            input = _mm_loadu_si128((const __m128i*)lane_buffer);
+        }
+
+        for (k = 0; k < 8; k++) {
+            qm[k] = _mm_add_epi32(qm[k], sign_sse2(dx[k], previous));
+            sum = _mm_add_epi32(sum, mullo_sse2(dl[k], qm[k]));
+        }
+        sum = _mm_sra_epi32(sum, shift);
+
+        if (direction == TTA_FILTER_ENCODE) {
+            output = _mm_sub_epi32(input, sum);
+            previous = output;
+            value = input;
+        } else {
+            output = _mm_add_epi32(input, sum);
+            previous = input;
+            value = output;
+        }
+
+        for (k = 0; k < 4; k++) {
+            dx[k] = dx[k + 1];
+        }
+        for (k = 4; k < 8; k++) {
+            dx[k] = step_sse2(dl[k], steps[k - 4]);
+        }
+        for (k = 0; k < 4; k++) {
+            dl[k] = dl[k + 1];
+        }
+        dl6 = _mm_sub_epi32(value, dl[7]);
+        dl5 = _mm_sub_epi32(dl6, dl[6]);
+        dl[4] = _mm_sub_epi32(dl5, dl[5]);
+        dl[5] = dl5;
+        dl[6] = dl6;
+        dl[7] = value;
+
+        if (lanes == 4) {
+            _mm_storeu_si128((__m128i*)samples, output);
+        } else {
+            _mm_storeu_si128((__m128i*)lane_buffer, output);
+            memcpy(samples, lane_buffer, lanes * sizeof(int));
+        }
+        samples += channels;
+    }
+
+    /*transpose lanes back to each channel's taps*/
+    for (k = 0; k < 8; k++) {
+        int qm_lanes[4];
+        int dx_lanes[4];
+        int dl_lanes[4];
+        _mm_storeu_si128((__m128i*)qm_lanes, qm[k]);
+        _mm_storeu_si128((__m128i*)dx_lanes, dx[k]);
+        _mm_storeu_si128((__m128i*)dl_lanes, dl[k]);
+        for (i = 0; i < lanes; i++) {
+            params[i].qm[k] = qm_lanes[i];
+            params[i].dx[k] = dx_lanes[i];
+            params[i].dl[k] = dl_lanes[i];
+        }
+    }
+    _mm_storeu_si128((__m128i*)lane_buffer, previous);
+    for (i = 0; i < lanes; i++) {
+        params[i].previous_residual = lane_buffer[i];
+    }
+}
+
+#endif
+
+#if defined(SIMD_X86)
+
+SIMD_TARGET("avx2") static inline __m256i
+step_avx2(__m256i x, __m256i step)
+{
+    const __m256i negative = _mm256_srai_epi32(x, 31);
+    return _mm256_sub_epi32(_mm256_xor_si256(step, negative), negative);
+}
+
+SIMD_TARGET("avx2") static void
+filter_lanes_avx2(tta_filter_direction_t direction,
+                  unsigned channels,
+                  unsigned lanes,
+                  struct tta_filter_params params[],
+                  unsigned pcm_frames,
+                  int samples[])
+{
+    const __m256i round = _mm256_set1_epi32(params[0].round);
+    const __m128i shift = _mm_cvtsi32_si128((int)params[0].shift);
+    const __m256i steps[4] = {_mm256_set1_epi32(1),
+                              _mm256_set1_epi32(2),
+                              _mm256_set1_epi32(2),
+                              _mm256_set1_epi32(4)};
+    __m256i qm[8];
+    __m256i dx[8];
+    __m256i dl[8];
+    __m256i previous;
+    int lane_buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    unsigned i;
+    unsigned k;
+
+    /*transpose each channel's taps into one lane per channel*/
+    for (k = 0; k < 8; k++) {
+        int qm_lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        int dx_lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        int dl_lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (i = 0; i < lanes; i++) {
+            qm_lanes[i] = params[i].qm[k];
+            dx_lanes[i] = params[i].dx[k];
+            dl_lanes[i] = params[i].dl[k];
+        }
+        qm[k] = _mm256_loadu_si256((const __m256i*)qm_lanes);
+        dx[k] = _mm256_loadu_si256((const __m256i*)dx_lanes);
+        dl[k] = _mm256_loadu_si256((const __m256i*)dl_lanes);
+    }
+    for (i = 0; i < lanes; i++) {
+        lane_buffer[i] = params[i].previous_residual;
+    }
+    previous = _mm256_loadu_si256((const __m256i*)lane_buffer);
+
+    for (; pcm_frames; pcm_frames--) {
+        __m256i input;
+        __m256i output;
+        __m256i value;
+        __m256i sum = round;
+        __m256i dl6;
+        __m256i dl5;
+
+        if (lanes == 8) {
+            input = _mm256_loadu_si256((const __m256i*)samples);
+        } else {
+            memcpy(lane_buffer, samples, lanes * sizeof(int));
+            input = _mm256_loadu_si256((const __m256i*)lane_buffer);
+        }
+
+        for (k = 0; k < 8; k++) {
+            qm[k] = _mm256_add_epi32(qm[k], _mm256_sign_epi32(dx[k], previous));
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(dl[k], qm[k]));
+        }
+        sum = _mm256_sra_epi32(sum, shift);
+
+        if (direction == TTA_FILTER_ENCODE) {
+            output = _mm256_sub_epi32(input, sum);
+            previous = output;
+            value = input;
+        } else {
+            output = _mm256_add_epi32(input, sum);
+            previous = input;
+            value = output;
+        }
+
+        for (k = 0; k < 4; k++) {
+            dx[k] = dx[k + 1];
+        }
+        for (k = 4; k < 8; k++) {
+            dx[k] = step_avx2(dl[k], steps[k - 4]);
+        }
+        for (k = 0; k < 4; k++) {
+            dl[k] = dl[k + 1];
+        }
+        dl6 = _mm256_sub_epi32(value, dl[7]);
+        dl5 = _mm256_sub_epi32(dl6, dl[6]);
+        dl[4] = _mm256_sub_epi32(dl5, dl[5]);
+        dl[5] = dl5;
+        dl[6] = dl6;
+        dl[7] = value;
+
+        if (lanes == 8) {
+            _mm256_storeu_si256((__m256i*)samples, output);
+        } else {
+            _mm256_storeu_si256((__m256i*)lane_buffer, output);
+            memcpy(samples, lane_buffer, lanes * sizeof(int));
+        }
+        samples += channels;
+    }
+
+    /*transpose lanes back to each channel's taps*/
+    for (k = 0; k < 8; k++) {
+        int qm_lanes[8];
+        int dx_lanes[8];
+        int dl_lanes[8];
+        _mm256_storeu_si256((__m256i*)qm_lanes, qm[k]);
+        _mm256_storeu_si256((__m256i*)dx_lanes, dx[k]);
+        _mm256_storeu_si256((__m256i*)dl_lanes, dl[k]);
+        for (i = 0; i < lanes; i++) {
+            params[i].qm[k] = qm_lanes[i];
+            params[i].dx[k] = dx_lanes[i];
+            params[i].dl[k] = dl_lanes[i];
+        }
+    }
+    _mm256_storeu_si256((__m256i*)lane_buffer, previous);
+    for (i = 0; i < lanes; i++) {
+        params[i].previous_residual = lane_buffer[i];
+    }
+}
+
+#endif
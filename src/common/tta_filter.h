@@ -0,0 +1,98 @@
+#ifndef TTA_FILTER_H
+#define TTA_FILTER_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*TTA's adaptive hybrid filter, shared by the encoder and decoder
+
+  the encoder runs it over predicted samples to generate residuals
+  and the decoder runs it over residuals to regenerate predicted samples
+  with both updating their taps identically*/
+
+typedef enum {
+    TTA_FILTER_ENCODE,
+    TTA_FILTER_DECODE
+} tta_filter_direction_t;
+
+struct tta_filter_params {
+    unsigned shift;
+    int previous_residual;
+    int round;
+    int qm[8];
+    int dx[8];
+    int dl[8];
+};
+
+void
+tta_init_filter_params(unsigned bits_per_sample,
+                       struct tta_filter_params *params);
+
+/*given a block of interleaved samples and one set of
+  filter parameters per channel, runs the hybrid filter
+  over all "pcm_frames" in the given direction,
+  replacing each sample in place and updating the parameters
+
+  encoding transforms predicted samples to residuals
+  while decoding transforms residuals to predicted samples
+
+  multichannel blocks filter all channels at once,
+  one channel per vector lane, when SIMD is available*/
+void
+tta_run_filter(tta_filter_direction_t direction,
+               unsigned channels,
+               struct tta_filter_params params[],
+               unsigned pcm_frames,
+               int samples[]);
+
+/*works like tta_run_filter but always uses the portable
+  one-sample-at-a-time implementation, which the
+  vectorized versions must match exactly*/
+void
+tta_run_filter_scalar(tta_filter_direction_t direction,
+                      unsigned channels,
+                      struct tta_filter_params params[],
+                      unsigned pcm_frames,
+                      int samples[]);
+
+/*each of the filter's implementations,
+  which tta_run_filter chooses between by block shape and CPU*/
+typedef enum {
+    TTA_KERNEL_SCALAR,
+    TTA_KERNEL_SSE2,          /*one channel at a time, taps in a vector*/
+    TTA_KERNEL_SSE2_LANES,    /*up to 4 channels at a time*/
+    TTA_KERNEL_AVX2_LANES     /*up to 8 channels at a time*/
+} tta_filter_kernel_t;
+
+/*returns nonzero if the kernel is built in and the CPU can run it*/
+int
+tta_filter_kernel_available(tta_filter_kernel_t kernel);
+
+/*works like tta_run_filter but always uses the given kernel,
+  falling back to the scalar one if it isn't available,
+  so that each can be checked against the scalar kernel*/
+void
+tta_run_filter_kernel(tta_filter_kernel_t kernel,
+                      tta_filter_direction_t direction,
+                      unsigned channels,
+                      struct tta_filter_params params[],
+                      unsigned pcm_frames,
+                      int samples[]);
+
+#endif
@@ -27,6 +27,21 @@ typedef int Py_ssize_t;
 #define IS_PY3K
 #endif
 
+PyObject*
+decoders_tta_filter_kernels(PyObject *dummy, PyObject *args);
+
+PyObject*
+decoders_tta_filter(PyObject *dummy, PyObject *args);
+
 PyMethodDef module_methods[] = {
+    {"tta_filter_kernels", (PyCFunction)decoders_tta_filter_kernels,
+     METH_NOARGS,
+     "tta_filter_kernels() -> [kernel name, ...] this CPU can run"},
+    {"tta_filter", (PyCFunction)decoders_tta_filter,
+     METH_VARARGS,
+     "tta_filter(kernel, decode, bits_per_sample, channels, samples, [taps])"
+     " -> (samples, taps)\n"
+     "runs TTA's hybrid filter over samples with the given kernel, "
+     "where taps holds previous_residual, qm[8], dx[8], dl[8] per channel"},
     {NULL}
 };
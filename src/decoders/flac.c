@@ -99,6 +99,9 @@ read_frame_header(BitstreamReader *r,
 static status_t
 read_utf8(BitstreamReader *r, unsigned *utf8);
 
+/*decodes a frame's subframes to "samples" in planar order,
+  with channel "c" occupying the "block_size" entries
+  starting at samples[c * block_size]*/
 typedef status_t (*decode_f)(BitstreamReader *r,
                              const struct frame_header *frame_header,
                              int samples[]);
@@ -172,22 +175,21 @@ read_residual_block(BitstreamReader *r,
 static status_t
 read_crc16(BitstreamReader *r);
 
+/*each decorrelates a pair of decoded subframes in place
+  into left and right channels*/
 static void
 decorrelate_left_difference(unsigned block_size,
-                            const int left[],
-                            const int difference[],
-                            int samples[]);
+                            int left[],
+                            int difference[]);
 static void
 decorrelate_difference_right(unsigned block_size,
-                             const int difference[],
-                             const int right[],
-                             int samples[]);
+                             int difference[],
+                             int right[]);
 
 static void
 decorrelate_average_difference(unsigned block_size,
-                               const int average[],
-                               const int difference[],
-                               int samples[]);
+                               int average[],
+                               int difference[]);
 
 static status_t
 skip_subframe(BitstreamReader *r,
@@ -220,9 +222,11 @@ skip_residual_block(BitstreamReader *r,
                     unsigned block_size,
                     unsigned predictor_order);
 
+/*updates the running MD5 sum with planar samples
+  in the interleaved little-endian order FLAC's checksum uses*/
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
-              const int pcm_data[],
+              const int planar_data[],
               unsigned channels,
               unsigned bits_per_sample,
               unsigned pcm_frames);
@@ -543,10 +547,11 @@ FlacDecoder_read(decoders_FlacDecoder* self, PyObject *args)
         return NULL;
     } else {
         /*setup framelist to be output once populated*/
-        pcm_FrameList *framelist = new_FrameList(self->audiotools_pcm,
-                                                 frame_header.channel_count,
-                                                 frame_header.bits_per_sample,
-                                                 frame_header.block_size);
+        pcm_FrameList *framelist =
+            new_planar_FrameList(self->audiotools_pcm,
+                                 frame_header.channel_count,
+                                 frame_header.bits_per_sample,
+                                 frame_header.block_size);
 
         /*decode subframes based on channel assignment*/
         decode_f decode = get_decoder(frame_header.channel_assignment);
@@ -1072,18 +1077,12 @@ decode_independent(BitstreamReader *r,
     unsigned c;
     status_t status;
     for (c = 0; c < frame_header->channel_count; c++) {
-        int channel_data[frame_header->block_size];
         if ((status = read_subframe(r,
                                     frame_header->block_size,
                                     frame_header->bits_per_sample,
-                                    channel_data)) != OK) {
+                                    samples +
+                                    (c * frame_header->block_size))) != OK) {
             return status;
-        } else {
-            put_channel_data(samples,
-                             c,
-                             frame_header->channel_count,
-                             frame_header->block_size,
-                             channel_data);
         }
     }
 
@@ -1096,8 +1095,8 @@ decode_left_difference(BitstreamReader *r,
                        int samples[])
 {
     status_t status;
-    int left_data[frame_header->block_size];
-    int difference_data[frame_header->block_size];
+    int *left_data = samples;
+    int *difference_data = samples + frame_header->block_size;
 
     if ((status = read_subframe(r,
                                 frame_header->block_size,
@@ -1115,8 +1114,7 @@ decode_left_difference(BitstreamReader *r,
 
     decorrelate_left_difference(frame_header->block_size,
                                 left_data,
-                                difference_data,
-                                samples);
+                                difference_data);
 
     return OK;
 }
@@ -1127,8 +1125,8 @@ decode_difference_right(BitstreamReader *r,
                         int samples[])
 {
     status_t status;
-    int difference_data[frame_header->block_size];
-    int right_data[frame_header->block_size];
+    int *difference_data = samples;
+    int *right_data = samples + frame_header->block_size;
 
     if ((status = read_subframe(r,
                                 frame_header->block_size,
@@ -1146,8 +1144,7 @@ decode_difference_right(BitstreamReader *r,
 
     decorrelate_difference_right(frame_header->block_size,
                                  difference_data,
-                                 right_data,
-                                 samples);
+                                 right_data);
 
     return OK;
 }
@@ -1158,8 +1155,8 @@ decode_average_difference(BitstreamReader *r,
                           int samples[])
 {
     status_t status;
-    int average_data[frame_header->block_size];
-    int difference_data[frame_header->block_size];
+    int *average_data = samples;
+    int *difference_data = samples + frame_header->block_size;
 
     if ((status = read_subframe(r,
                                 frame_header->block_size,
@@ -1177,8 +1174,7 @@ decode_average_difference(BitstreamReader *r,
 
     decorrelate_average_difference(frame_header->block_size,
                                    average_data,
-                                   difference_data,
-                                   samples);
+                                   difference_data);
 
     return OK;
 }
@@ -1513,49 +1509,43 @@ read_crc16(BitstreamReader *r)
 
 static void
 decorrelate_left_difference(unsigned block_size,
-                            const int left[],
-                            const int difference[],
-                            int samples[])
+                            int left[],
+                            int difference[])
 {
     for (; block_size; block_size--) {
-        /*samples[0] = left[0];*/
-        /*samples[1] = left[0] - difference[0];*/
-        samples[1] = (samples[0] = left[0]) - difference[0];
+        /*left[0] stays as-is*/
+        /*right[0] = left[0] - difference[0];*/
+        difference[0] = left[0] - difference[0];
         left += 1;
         difference += 1;
-        samples += 2;
     }
 }
 
 static void
 decorrelate_difference_right(unsigned block_size,
-                             const int difference[],
-                             const int right[],
-                             int samples[])
+                             int difference[],
+                             int right[])
 {
     for (; block_size; block_size--) {
-        /*samples[0] = difference[0] + right[0];*/
-        /*samples[1] = right[0];*/
-        samples[0] = difference[0] + (samples[1] = right[0]);
+        /*left[0] = difference[0] + right[0];*/
+        /*right[0] stays as-is*/
+        difference[0] += right[0];
         difference += 1;
         right += 1;
-        samples += 2;
     }
 }
 
 static void
 decorrelate_average_difference(unsigned block_size,
-                               const int average[],
-                               const int difference[],
-                               int samples[])
+                               int average[],
+                               int difference[])
 {
     for (; block_size; block_size--) {
         const int sum = (average[0] * 2) + (abs(difference[0]) % 2);
-        samples[0] = (sum + difference[0]) >> 1;
-        samples[1] = (sum - difference[0]) >> 1;
+        average[0] = (sum + difference[0]) >> 1;
+        difference[0] = (sum - difference[0]) >> 1;
         average += 1;
         difference += 1;
-        samples += 2;
     }
 }
 
@@ -1704,22 +1694,42 @@ skip_residual_block(BitstreamReader *r,
 
 }
 
+#define MD5_CHUNK_FRAMES 1024
+
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
-              const int pcm_data[],
+              const int planar_data[],
               unsigned channels,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
+    const int_to_pcm_f converter =
+        int_to_pcm_converter(bits_per_sample, 0, 1);
+    int pcm_data[MD5_CHUNK_FRAMES * channels];
+    unsigned char buffer[MD5_CHUNK_FRAMES * channels * (bits_per_sample / 8)];
+    unsigned start;
+
+    /*interleave a chunk at a time to keep the buffers small*/
+    for (start = 0; start < pcm_frames; start += MD5_CHUNK_FRAMES) {
+        const unsigned chunk_frames = MIN(pcm_frames - start,
+                                          MD5_CHUNK_FRAMES);
+        const unsigned chunk_samples = chunk_frames * channels;
+        unsigned c;
+
+        for (c = 0; c < channels; c++) {
+            put_channel_data(pcm_data,
+                             c,
+                             channels,
+                             chunk_frames,
+                             planar_data + (c * pcm_frames) + start);
+        }
 
-    int_to_pcm_converter(bits_per_sample, 0, 1)(total_samples,
-                                                pcm_data,
-                                                buffer);
+        converter(chunk_samples, pcm_data, buffer);
 
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+        audiotools__MD5Update(md5sum,
+                              buffer,
+                              chunk_samples * (bits_per_sample / 8));
+    }
 }
 
 static int
@@ -1904,6 +1914,8 @@ main(int argc, char *argv[])
                                           frame_header.block_size;
 
             int samples[sample_count];
+            int interleaved[sample_count];
+            unsigned c;
 
             unsigned char pcm_samples[sample_count *
                                       (frame_header.bits_per_sample / 8)];
@@ -1930,7 +1942,14 @@ main(int argc, char *argv[])
             }
 
             /*output samples to stdout*/
-            converter(sample_count, samples, pcm_samples);
+            for (c = 0; c < frame_header.channel_count; c++) {
+                put_channel_data(interleaved,
+                                 c,
+                                 frame_header.channel_count,
+                                 frame_header.block_size,
+                                 samples + (c * frame_header.block_size));
+            }
+            converter(sample_count, interleaved, pcm_samples);
             fwrite(pcm_samples, sizeof(pcm_samples), 1, stdout);
 
             /*update MD5 sum*/
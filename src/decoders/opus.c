@@ -280,6 +280,57 @@ OpusDecoder_read(decoders_OpusDecoder* self, PyObject *args)
     }
 }
 
+static PyObject*
+OpusDecoder_seek(decoders_OpusDecoder* self, PyObject *args)
+{
+    long long seeked_offset;
+    ogg_int64_t total_pcm_frames;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "L", &seeked_offset))
+        return NULL;
+
+    if (seeked_offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek to negative value");
+        return NULL;
+    }
+
+    /*opusfile bisects the stream on page granule positions
+      and decodes forward from far enough back to account for
+      pre-skip and decoder convergence
+      so the next read() starts exactly at the requested PCM frame
+
+      it won't seek past the end, so clamp the offset to the stream*/
+    if ((total_pcm_frames = op_pcm_total(self->opus_file, -1)) < 0) {
+        PyErr_SetString(PyExc_ValueError, "stream is not seekable");
+        return NULL;
+    } else if (seeked_offset > total_pcm_frames) {
+        seeked_offset = total_pcm_frames;
+    }
+
+    switch (op_pcm_seek(self->opus_file, (ogg_int64_t)seeked_offset)) {
+    case 0:
+        return Py_BuildValue("L", seeked_offset);
+    case OP_EREAD:
+        PyErr_SetString(PyExc_IOError, "I/O error seeking in stream");
+        return NULL;
+    case OP_ENOSEEK:
+        PyErr_SetString(PyExc_ValueError, "stream is not seekable");
+        return NULL;
+    case OP_EBADLINK:
+    case OP_EBADTIMESTAMP:
+        PyErr_SetString(PyExc_ValueError, "invalid stream section");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_ValueError, "error seeking in stream");
+        return NULL;
+    }
+}
+
 static PyObject*
 OpusDecoder_close(decoders_OpusDecoder* self, PyObject *args)
 {
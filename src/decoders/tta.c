@@ -1,9 +1,11 @@
 #include "tta.h"
 #include "../common/tta_crc.h"
+#include "../common/tta_filter.h"
 #include "../framelist.h"
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -35,7 +37,8 @@ typedef enum {
     CRC_MISMATCH,
     FRAME_TOO_SMALL,
     INVALID_SIGNATURE,
-    INVALID_FORMAT
+    INVALID_FORMAT,
+    MEMORY_ERROR
 } status_t;
 
 struct residual_params {
@@ -45,20 +48,21 @@ struct residual_params {
     unsigned sum1;
 };
 
-struct filter_params {
-    unsigned shift;
-    int previous_residual;
-    int round;
-    int qm[8];
-    int dx[8];
-    int dl[8];
-};
-
 struct prediction_params {
     unsigned shift;
     int previous_sample;
 };
 
+/*a single TTA frame to be decoded on its own thread*/
+struct frame_job {
+    BitstreamReader *frame;  /*substream of the frame's raw bytes*/
+    unsigned channels;
+    unsigned bits_per_sample;
+    unsigned block_size;
+    int *samples;            /*block_size * channels output samples*/
+    status_t status;
+};
+
 /*******************************
  * private function signatures *
  *******************************/
@@ -101,6 +105,31 @@ read_tta_frame(BitstreamReader *frame,
                unsigned block_size,
                int samples[]);
 
+#ifndef STANDALONE
+/*pthread entry point which decodes a struct frame_job
+  and closes its frame substream*/
+static void*
+decode_frame_job(struct frame_job *job);
+
+/*reads and decodes up to self->threads TTA frames in parallel
+  and places the results in self->decoded
+
+  returns OK on success, or some error value*/
+static status_t
+decode_frames_parallel(decoders_TTADecoder *self);
+
+/*deallocates any decoded FrameLists not yet returned by read()*/
+static void
+clear_decoded(decoders_TTADecoder *self);
+
+/*decodes the next TTA frame and returns the PCM frames
+  after the first "skip" frames as a new FrameList*/
+static status_t
+decode_frame_remainder(decoders_TTADecoder *self,
+                       unsigned skip,
+                       pcm_FrameList **remainder);
+#endif
+
 static void
 init_residual_params(struct residual_params *params);
 
@@ -109,15 +138,6 @@ init_residual_params(struct residual_params *params);
 static int
 read_residual(struct residual_params *params, BitstreamReader *frame);
 
-static void
-init_filter_params(unsigned bits_per_sample,
-                   struct filter_params *params);
-
-/*given a residual and filter parameters,
-  updates the parameters and returns a predicted sample*/
-static int
-run_filter(struct filter_params *params, int residual);
-
 static void
 init_prediction_params(unsigned bits_per_sample,
                        struct prediction_params *params);
@@ -167,19 +187,31 @@ TTADecoder_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
 int
 TTADecoder_init(decoders_TTADecoder *self, PyObject *args, PyObject *kwds) {
     PyObject *file;
+    int threads = 1;
     status_t status;
+    static char *kwlist[] = {"file", "threads", NULL};
 
     self->seektable = NULL;
     self->bitstream = NULL;
     self->audiotools_pcm = NULL;
     self->frames_start = NULL;
+    self->decoded = NULL;
+    self->decoded_count = 0;
+    self->decoded_index = 0;
+    self->remainder = NULL;
 
-    if (!PyArg_ParseTuple(args, "O", &file)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", kwlist,
+                                     &file, &threads)) {
+        return -1;
+    } else if (threads < 1) {
+        PyErr_SetString(PyExc_ValueError, "threads must be >= 1");
         return -1;
     } else {
         Py_INCREF(file);
     }
 
+    self->threads = (unsigned)threads;
+
     self->bitstream = br_open_external(file,
                                        BS_LITTLE_ENDIAN,
                                        4096,
@@ -214,6 +246,16 @@ TTADecoder_init(decoders_TTADecoder *self, PyObject *args, PyObject *kwds) {
     /*mark beginning of frames for seeking*/
     self->frames_start = self->bitstream->getpos(self->bitstream);
 
+    /*allocate space for FrameLists decoded in parallel*/
+    if (self->threads > 1) {
+        if ((self->decoded =
+             malloc(sizeof(pcm_FrameList*) * self->threads)) == NULL) {
+            PyErr_SetString(PyExc_MemoryError,
+                            "unable to allocate parallel frames");
+            return -1;
+        }
+    }
+
     /*mark file as not closed*/
     self->closed = 0;
 
@@ -224,6 +266,10 @@ void
 TTADecoder_dealloc(decoders_TTADecoder *self) {
     free(self->seektable);
 
+    clear_decoded(self);
+    free(self->decoded);
+    Py_XDECREF((PyObject*)self->remainder);
+
     if (self->bitstream) {
         self->bitstream->free(self->bitstream);
     }
@@ -274,10 +320,27 @@ TTADecoder_read(decoders_TTADecoder* self, PyObject *args)
     if (self->closed) {
         PyErr_SetString(PyExc_ValueError, "cannot read closed stream");
         return NULL;
+    } else if (self->remainder) {
+        /*return rest of the frame seeked into*/
+        pcm_FrameList *remainder = self->remainder;
+        self->remainder = NULL;
+        return (PyObject*)remainder;
+    } else if (self->decoded_index < self->decoded_count) {
+        /*return next FrameList already decoded in parallel*/
+        return (PyObject*)self->decoded[self->decoded_index++];
     } else if (self->current_tta_frame == self->header.total_tta_frames) {
         return empty_FrameList(self->audiotools_pcm,
                                self->header.channels,
                                self->header.bits_per_sample);
+    } else if (self->threads > 1) {
+        status_t status;
+
+        if ((status = decode_frames_parallel(self)) == OK) {
+            return (PyObject*)self->decoded[self->decoded_index++];
+        } else {
+            PyErr_SetString(tta_exception(status), tta_strerror(status));
+            return NULL;
+        }
     } else {
         const unsigned block_size =
             tta_block_size(self->current_tta_frame, &self->header);
@@ -321,47 +384,58 @@ TTADecoder_seek(decoders_TTADecoder *self, PyObject *args)
         return NULL;
     }
 
+    /*discard any frames decoded ahead of the old position*/
+    clear_decoded(self);
+    Py_CLEAR(self->remainder);
+
+    if (seeked_offset > self->header.total_pcm_frames) {
+        seeked_offset = self->header.total_pcm_frames;
+    }
+
     if (!setjmp(*br_try(self->bitstream))) {
-        unsigned current_pcm_frame = 0;
+        /*the TTA frame containing the requested PCM frame*/
+        const unsigned target_tta_frame =
+            (unsigned)(seeked_offset / self->header.default_block_size);
+        const unsigned skip =
+            (unsigned)(seeked_offset % self->header.default_block_size);
+        status_t status;
 
         /*rewind to start of TTA blocks*/
         self->bitstream->setpos(self->bitstream, self->frames_start);
 
-        /*skip frames until we reach the requested one
-          or run out of frames entirely
-          and adjust both current TTA frame and
-          remaining number of PCM frames according to new position*/
-        self->current_tta_frame = 0;
-
-        while (seeked_offset > self->header.default_block_size) {
-            if (self->current_tta_frame < self->header.total_tta_frames) {
-                const unsigned frame_size =
-                    self->seektable[self->current_tta_frame];
-
-                self->bitstream->seek(self->bitstream,
-                                      (long)frame_size,
-                                      BS_SEEK_CUR);
-
-                current_pcm_frame += self->header.default_block_size;
-                self->current_tta_frame++;
-                seeked_offset -= self->header.default_block_size;
-            } else {
-                /*no additional frames to seek to*/
-                break;
-            }
+        /*skip whole frames until we reach the one
+          containing the requested PCM frame*/
+        for (self->current_tta_frame = 0;
+             (self->current_tta_frame < target_tta_frame) &&
+             (self->current_tta_frame < self->header.total_tta_frames);
+             self->current_tta_frame++) {
+            self->bitstream->seek(self->bitstream,
+                                  (long)self->seektable[self->current_tta_frame],
+                                  BS_SEEK_CUR);
         }
 
         br_etry(self->bitstream);
 
+        /*if the offset falls within a frame,
+          decode it and hold onto its remaining PCM frames
+          so the next read() starts exactly at the requested one*/
+        if (skip &&
+            (self->current_tta_frame < self->header.total_tta_frames)) {
+            if ((status = decode_frame_remainder(self,
+                                                 skip,
+                                                 &self->remainder)) != OK) {
+                PyErr_SetString(tta_exception(status), tta_strerror(status));
+                return NULL;
+            }
+        }
+
         /*return PCM offset actually seeked to*/
-        return Py_BuildValue("I", current_pcm_frame);
+        return Py_BuildValue("L", seeked_offset);
     } else {
         br_etry(self->bitstream);
         PyErr_SetString(PyExc_IOError, "I/O error seeking in stream");
         return NULL;
     }
-
-    return Py_None;
 }
 
 PyObject*
@@ -393,12 +467,399 @@ TTADecoder_exit(decoders_TTADecoder* self, PyObject *args)
     return Py_None;
 }
 
+static status_t
+decode_frames_parallel(decoders_TTADecoder *self)
+{
+    const unsigned remaining =
+        self->header.total_tta_frames - self->current_tta_frame;
+    const unsigned count =
+        remaining < self->threads ? remaining : self->threads;
+    struct frame_job jobs[count];
+    pthread_t workers[count];
+    int started[count];
+    status_t status = OK;
+    unsigned i;
+
+    /*split the next "count" frames into substreams
+      while holding the GIL, since the file may be a Python object*/
+    for (i = 0; i < count; i++) {
+        const unsigned tta_frame = self->current_tta_frame + i;
+
+        jobs[i].frame = NULL;
+        started[i] = 0;
+        if (!setjmp(*br_try(self->bitstream))) {
+            jobs[i].frame =
+                self->bitstream->substream(self->bitstream,
+                                           self->seektable[tta_frame]);
+            br_etry(self->bitstream);
+        } else {
+            br_etry(self->bitstream);
+            status = IO_ERROR;
+            break;
+        }
+
+        jobs[i].channels = self->header.channels;
+        jobs[i].bits_per_sample = self->header.bits_per_sample;
+        jobs[i].block_size = tta_block_size(tta_frame, &self->header);
+        self->decoded[i] = new_FrameList(self->audiotools_pcm,
+                                         self->header.channels,
+                                         self->header.bits_per_sample,
+                                         jobs[i].block_size);
+        jobs[i].samples = self->decoded[i]->samples;
+        jobs[i].status = OK;
+    }
+
+    if (status != OK) {
+        /*cleanup any substreams and FrameLists already allocated*/
+        unsigned j;
+        for (j = 0; j < i; j++) {
+            jobs[j].frame->close(jobs[j].frame);
+            Py_DECREF((PyObject*)self->decoded[j]);
+        }
+        return status;
+    }
+
+    /*decode all frames with the GIL released*/
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 1; i < count; i++) {
+        started[i] = !pthread_create(&workers[i],
+                                     NULL,
+                                     (void *(*)(void*))decode_frame_job,
+                                     &jobs[i]);
+        if (!started[i]) {
+            /*fall back to decoding on this thread*/
+            decode_frame_job(&jobs[i]);
+        }
+    }
+    decode_frame_job(&jobs[0]);
+    for (i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(workers[i], NULL);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    for (i = 0; i < count; i++) {
+        if (jobs[i].status != OK) {
+            status = jobs[i].status;
+            break;
+        }
+    }
+
+    if (status == OK) {
+        self->current_tta_frame += count;
+        self->decoded_count = count;
+        self->decoded_index = 0;
+    } else {
+        for (i = 0; i < count; i++) {
+            Py_DECREF((PyObject*)self->decoded[i]);
+        }
+    }
+
+    return status;
+}
+
+static status_t
+decode_frame_remainder(decoders_TTADecoder *self,
+                       unsigned skip,
+                       pcm_FrameList **remainder)
+{
+    const unsigned channels = self->header.channels;
+    const unsigned block_size =
+        tta_block_size(self->current_tta_frame, &self->header);
+    int *samples = malloc(sizeof(int) * channels * block_size);
+    status_t status;
+
+    if (samples == NULL) {
+        return MEMORY_ERROR;
+    }
+
+    if ((status = read_tta_frame(self->bitstream,
+                                 channels,
+                                 self->header.bits_per_sample,
+                                 block_size,
+                                 samples)) == OK) {
+        if ((*remainder = new_FrameList(self->audiotools_pcm,
+                                        channels,
+                                        self->header.bits_per_sample,
+                                        block_size - skip)) == NULL) {
+            free(samples);
+            return MEMORY_ERROR;
+        }
+        memcpy((*remainder)->samples,
+               samples + (skip * channels),
+               sizeof(int) * channels * (block_size - skip));
+        self->current_tta_frame += 1;
+    }
+
+    free(samples);
+    return status;
+}
+
+static void
+clear_decoded(decoders_TTADecoder *self)
+{
+    for (; self->decoded_index < self->decoded_count; self->decoded_index++) {
+        Py_DECREF((PyObject*)self->decoded[self->decoded_index]);
+    }
+    self->decoded_count = self->decoded_index = 0;
+}
+
+static const char *tta_filter_kernel_names[] =
+    {"scalar", "sse2", "sse2_lanes", "avx2_lanes", NULL};
+
+#define TTA_FILTER_TAPS 25
+
+PyObject*
+decoders_tta_filter_kernels(PyObject *dummy, PyObject *args)
+{
+    PyObject *kernels = PyList_New(0);
+    int i;
+
+    if (kernels == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; tta_filter_kernel_names[i] != NULL; i++) {
+        if (tta_filter_kernel_available((tta_filter_kernel_t)i)) {
+#if PY_MAJOR_VERSION >= 3
+            PyObject *name = PyUnicode_FromString(tta_filter_kernel_names[i]);
+#else
+            PyObject *name = PyString_FromString(tta_filter_kernel_names[i]);
+#endif
+            if ((name == NULL) || (PyList_Append(kernels, name) == -1)) {
+                Py_XDECREF(name);
+                Py_DECREF(kernels);
+                return NULL;
+            }
+            Py_DECREF(name);
+        }
+    }
+
+    return kernels;
+}
+
+/*populates params from a list of
+  previous_residual, qm[8], dx[8], dl[8] integers
+  returns 0 on success, -1 with an exception set on error*/
+static int
+taps_from_list(PyObject *list, struct tta_filter_params *params)
+{
+    int *taps[TTA_FILTER_TAPS];
+    Py_ssize_t i;
+
+    taps[0] = &(params->previous_residual);
+    for (i = 0; i < 8; i++) {
+        taps[1 + i] = &(params->qm[i]);
+        taps[9 + i] = &(params->dx[i]);
+        taps[17 + i] = &(params->dl[i]);
+    }
+
+    if (PySequence_Size(list) != TTA_FILTER_TAPS) {
+        PyErr_SetString(PyExc_ValueError,
+                        "each channel's taps must contain 25 integers");
+        return -1;
+    }
+
+    for (i = 0; i < TTA_FILTER_TAPS; i++) {
+        PyObject *tap = PySequence_GetItem(list, i);
+        long value;
+        if (tap == NULL) {
+            return -1;
+        }
+        value = PyLong_AsLong(tap);
+        Py_DECREF(tap);
+        if ((value == -1) && PyErr_Occurred()) {
+            return -1;
+        }
+        *taps[i] = (int)value;
+    }
+
+    return 0;
+}
+
+static PyObject*
+taps_to_list(const struct tta_filter_params *params)
+{
+    PyObject *list = PyList_New(TTA_FILTER_TAPS);
+    unsigned i;
+
+    if (list == NULL) {
+        return NULL;
+    }
+
+    PyList_SET_ITEM(list, 0, PyLong_FromLong(params->previous_residual));
+    for (i = 0; i < 8; i++) {
+        PyList_SET_ITEM(list, 1 + i, PyLong_FromLong(params->qm[i]));
+        PyList_SET_ITEM(list, 9 + i, PyLong_FromLong(params->dx[i]));
+        PyList_SET_ITEM(list, 17 + i, PyLong_FromLong(params->dl[i]));
+    }
+
+    return list;
+}
+
+PyObject*
+decoders_tta_filter(PyObject *dummy, PyObject *args)
+{
+    char *kernel_name;
+    int kernel;
+    int decode;
+    int bits_per_sample;
+    int channels;
+    PyObject *samples_obj;
+    PyObject *taps_obj = NULL;
+    Py_ssize_t samples_length;
+    unsigned pcm_frames;
+    int *samples = NULL;
+    struct tta_filter_params *params = NULL;
+    PyObject *samples_list = NULL;
+    PyObject *taps_list = NULL;
+    PyObject *result = NULL;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTuple(args, "siiiO|O",
+                          &kernel_name,
+                          &decode,
+                          &bits_per_sample,
+                          &channels,
+                          &samples_obj,
+                          &taps_obj))
+        return NULL;
+
+    for (kernel = 0; tta_filter_kernel_names[kernel] != NULL; kernel++) {
+        if (!strcmp(kernel_name, tta_filter_kernel_names[kernel])) {
+            break;
+        }
+    }
+    if ((tta_filter_kernel_names[kernel] == NULL) ||
+        !tta_filter_kernel_available((tta_filter_kernel_t)kernel)) {
+        PyErr_SetString(PyExc_ValueError, "unavailable filter kernel");
+        return NULL;
+    }
+
+    if ((bits_per_sample != 8) &&
+        (bits_per_sample != 16) &&
+        (bits_per_sample != 24)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "unsupported number of bits per sample");
+        return NULL;
+    }
+
+    if (channels <= 0) {
+        PyErr_SetString(PyExc_ValueError, "channels must be > 0");
+        return NULL;
+    }
+
+    if ((samples_length = PySequence_Size(samples_obj)) == -1) {
+        return NULL;
+    }
+    if (samples_length % channels) {
+        PyErr_SetString(PyExc_ValueError,
+            "number of samples must be divisible by number of channels");
+        return NULL;
+    }
+    pcm_frames = (unsigned)(samples_length / channels);
+
+    samples = malloc(sizeof(int) * (samples_length ? samples_length : 1));
+    params = malloc(sizeof(struct tta_filter_params) * channels);
+    if ((samples == NULL) || (params == NULL)) {
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        goto done;
+    }
+
+    for (i = 0; i < samples_length; i++) {
+        PyObject *sample = PySequence_GetItem(samples_obj, i);
+        long value;
+        if (sample == NULL) {
+            goto done;
+        }
+        value = PyLong_AsLong(sample);
+        Py_DECREF(sample);
+        if ((value == -1) && PyErr_Occurred()) {
+            goto done;
+        }
+        samples[i] = (int)value;
+    }
+
+    for (i = 0; i < channels; i++) {
+        tta_init_filter_params(bits_per_sample, &params[i]);
+    }
+
+    if (taps_obj != NULL) {
+        if (PySequence_Size(taps_obj) != channels) {
+            PyErr_SetString(PyExc_ValueError,
+                            "taps must be given for each channel");
+            goto done;
+        }
+        for (i = 0; i < channels; i++) {
+            PyObject *channel_taps = PySequence_GetItem(taps_obj, i);
+            int status;
+            if (channel_taps == NULL) {
+                goto done;
+            }
+            status = taps_from_list(channel_taps, &params[i]);
+            Py_DECREF(channel_taps);
+            if (status) {
+                goto done;
+            }
+        }
+    }
+
+    tta_run_filter_kernel((tta_filter_kernel_t)kernel,
+                          decode ? TTA_FILTER_DECODE : TTA_FILTER_ENCODE,
+                          channels,
+                          params,
+                          pcm_frames,
+                          samples);
+
+    if ((samples_list = PyList_New(samples_length)) == NULL) {
+        goto done;
+    }
+    for (i = 0; i < samples_length; i++) {
+        PyList_SET_ITEM(samples_list, i, PyLong_FromLong(samples[i]));
+    }
+
+    if ((taps_list = PyList_New(channels)) == NULL) {
+        goto done;
+    }
+    for (i = 0; i < channels; i++) {
+        PyObject *channel_taps = taps_to_list(&params[i]);
+        if (channel_taps == NULL) {
+            goto done;
+        }
+        PyList_SET_ITEM(taps_list, i, channel_taps);
+    }
+
+    result = Py_BuildValue("(OO)", samples_list, taps_list);
+
+done:
+    Py_XDECREF(samples_list);
+    Py_XDECREF(taps_list);
+    free(samples);
+    free(params);
+    return result;
+}
+
 #endif
 
 /************************************
  * private function implementations *
  ************************************/
 
+#ifndef STANDALONE
+static void*
+decode_frame_job(struct frame_job *job)
+{
+    job->status = read_tta_frame(job->frame,
+                                 job->channels,
+                                 job->bits_per_sample,
+                                 job->block_size,
+                                 job->samples);
+    job->frame->close(job->frame);
+    return NULL;
+}
+#endif
+
 static void
 checksum_init(BitstreamReader *frame, checksum_t *checksum)
 {
@@ -516,44 +977,28 @@ read_tta_frame(BitstreamReader *frame,
 {
     checksum_t checksum;
     struct residual_params residual_params[channels];
-    struct filter_params filter_params[channels];
+    struct tta_filter_params filter_params[channels];
     struct prediction_params prediction_params[channels];
+    unsigned i;
     unsigned c;
 
     /*initialize per-channel parameters*/
     for (c = 0; c < channels; c++) {
         init_residual_params(&residual_params[c]);
-        init_filter_params(bits_per_sample, &filter_params[c]);
+        tta_init_filter_params(bits_per_sample, &filter_params[c]);
         init_prediction_params(bits_per_sample, &prediction_params[c]);
     }
 
     checksum_init(frame, &checksum);
 
     if (!setjmp(*br_try(frame))) {
-        /*decode one PCM frame at a time*/
-        for (; block_size; block_size--) {
-            int predicted[channels];
-
+        /*decode the whole block's residuals,
+          one PCM frame at a time*/
+        for (i = 0; i < block_size; i++) {
             for (c = 0; c < channels; c++) {
-                /*run fixed prediction over filtered value*/
-                predicted[c] = run_prediction(
-                    &prediction_params[c],
-                    /*run hybrid filter over residual*/
-                    run_filter(
-                        &filter_params[c],
-                        /*decode a residual*/
-                        read_residual(
-                            &residual_params[c],
-                            frame)));
+                samples[(i * channels) + c] =
+                    read_residual(&residual_params[c], frame);
             }
-
-            /*decorrelate channels to samples*/
-            decorrelate_channels(channels,
-                                 predicted,
-                                 samples);
-
-            /*move on to next batch of samples*/
-            samples += channels;
         }
 
         frame->byte_align(frame);
@@ -565,6 +1010,28 @@ read_tta_frame(BitstreamReader *frame,
         return IO_ERROR;
     }
 
+    /*run hybrid filter over the whole block of residuals*/
+    tta_run_filter(TTA_FILTER_DECODE,
+                   channels,
+                   filter_params,
+                   block_size,
+                   samples);
+
+    for (i = 0; i < block_size; i++) {
+        int predicted[channels];
+
+        /*run fixed prediction over filtered values*/
+        for (c = 0; c < channels; c++) {
+            predicted[c] = run_prediction(&prediction_params[c], samples[c]);
+        }
+
+        /*decorrelate channels to samples*/
+        decorrelate_channels(channels, predicted, samples);
+
+        /*move on to next batch of samples*/
+        samples += channels;
+    }
+
     return checksum.is_valid ? OK : CRC_MISMATCH;
 }
 
@@ -615,101 +1082,6 @@ read_residual(struct residual_params *params, BitstreamReader *frame)
     return residual;
 }
 
-static void
-init_filter_params(unsigned bits_per_sample,
-                   struct filter_params *params)
-{
-    switch (bits_per_sample) {
-    case 8:
-        params->shift = 10;
-        break;
-    case 16:
-        params->shift = 9;
-        break;
-    case 24:
-        params->shift = 10;
-        break;
-    }
-    params->previous_residual = 0;
-    params->round = 1 << (params->shift - 1);
-    params->qm[0] =
-    params->qm[1] =
-    params->qm[2] =
-    params->qm[3] =
-    params->qm[4] =
-    params->qm[5] =
-    params->qm[6] =
-    params->qm[7] = 0;
-    params->dx[0] =
-    params->dx[1] =
-    params->dx[2] =
-    params->dx[3] =
-    params->dx[4] =
-    params->dx[5] =
-    params->dx[6] =
-    params->dx[7] = 0;
-    params->dl[0] =
-    params->dl[1] =
-    params->dl[2] =
-    params->dl[3] =
-    params->dl[4] =
-    params->dl[5] =
-    params->dl[6] =
-    params->dl[7] = 0;
-}
-
-static inline int
-sign(int x) {
-    if (x > 0) {
-        return 1;
-    } else if (x < 0) {
-        return -1;
-    } else {
-        return 0;
-    }
-}
-
-static int
-run_filter(struct filter_params *params, int residual)
-{
-    const int previous_sign = sign(params->previous_residual);
-    int32_t sum = params->round;
-    int filtered = residual;
-
-    params->previous_residual = residual;
-
-    sum += params->dl[0] * (params->qm[0] += previous_sign * params->dx[0]);
-    sum += params->dl[1] * (params->qm[1] += previous_sign * params->dx[1]);
-    sum += params->dl[2] * (params->qm[2] += previous_sign * params->dx[2]);
-    sum += params->dl[3] * (params->qm[3] += previous_sign * params->dx[3]);
-    sum += params->dl[4] * (params->qm[4] += previous_sign * params->dx[4]);
-    sum += params->dl[5] * (params->qm[5] += previous_sign * params->dx[5]);
-    sum += params->dl[6] * (params->qm[6] += previous_sign * params->dx[6]);
-    sum += params->dl[7] * (params->qm[7] += previous_sign * params->dx[7]);
-
-    filtered += (sum >> params->shift);
-
-    params->dx[0] = params->dx[1];
-    params->dx[1] = params->dx[2];
-    params->dx[2] = params->dx[3];
-    params->dx[3] = params->dx[4];
-    params->dx[4] = params->dl[4] >= 0 ? 1 : -1;
-    params->dx[5] = params->dl[5] >= 0 ? 2 : -2;
-    params->dx[6] = params->dl[6] >= 0 ? 2 : -2;
-    params->dx[7] = params->dl[7] >= 0 ? 4 : -4;
-    params->dl[0] = params->dl[1];
-    params->dl[1] = params->dl[2];
-    params->dl[2] = params->dl[3];
-    params->dl[3] = params->dl[4];
-    params->dl[4] =
-        -(params->dl[5]) + (-(params->dl[6]) + (filtered - params->dl[7]));
-    params->dl[5] = -(params->dl[6]) + (filtered - params->dl[7]);
-    params->dl[6] = filtered - params->dl[7];
-    params->dl[7] = filtered;
-
-    return filtered;
-}
-
 static void
 init_prediction_params(unsigned bits_per_sample,
                        struct prediction_params *params)
@@ -770,6 +1142,8 @@ tta_exception(status_t error)
     case IO_ERROR:
     case FRAME_TOO_SMALL:
         return PyExc_IOError;
+    case MEMORY_ERROR:
+        return PyExc_MemoryError;
     }
 }
 #endif
@@ -791,6 +1165,8 @@ tta_strerror(status_t error)
         return "invalid file signature";
     case INVALID_FORMAT:
         return "invalid file format";
+    case MEMORY_ERROR:
+        return "unable to allocate memory";
     }
 }
 
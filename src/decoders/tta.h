@@ -5,6 +5,7 @@
 
 #include <stdint.h>
 #include "../bitstream.h"
+#include "../pcm.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -51,6 +52,18 @@ typedef struct {
 
     /*position of start of frames*/
     br_pos_t* frames_start;
+
+    /*number of TTA frames to decode in parallel*/
+    unsigned threads;
+
+    /*FrameLists decoded in parallel but not yet returned by read()*/
+    pcm_FrameList** decoded;
+    unsigned decoded_count;
+    unsigned decoded_index;
+
+    /*the tail of the TTA frame seek() landed in the middle of,
+      returned by the next read() so it starts at the exact offset*/
+    pcm_FrameList* remainder;
 } decoders_TTADecoder;
 
 static PyObject*
@@ -57,6 +57,7 @@ VorbisDecoder_init(decoders_VorbisDecoder *self, PyObject *args, PyObject *kwds)
     self->channel_count = 0;
     self->rate = 0;
     self->closed = 0;
+    self->seeked_to_end = 0;
     self->audiotools_pcm = NULL;
 
     if (!PyArg_ParseTuple(args, "s", &filename))
@@ -187,7 +188,7 @@ VorbisDecoder_read(decoders_VorbisDecoder *self, PyObject *args) {
         int c;
 
         if (samples_read == 0) {
-            if (self->vorbisfile.os.e_o_s == 0) {
+            if ((self->vorbisfile.os.e_o_s == 0) && !self->seeked_to_end) {
                 /*EOF encountered without EOF being marked in stream*/
                 PyErr_SetString(PyExc_IOError,
                                 "I/O error reading from Ogg stream");
@@ -314,6 +315,58 @@ VorbisDecoder_read(decoders_VorbisDecoder *self, PyObject *args) {
     }
 }
 
+static PyObject*
+VorbisDecoder_seek(decoders_VorbisDecoder *self, PyObject *args) {
+    long long seeked_offset;
+    ogg_int64_t total_pcm_frames;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek closed stream");
+        return NULL;
+    }
+
+    if (!PyArg_ParseTuple(args, "L", &seeked_offset))
+        return NULL;
+
+    if (seeked_offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "cannot seek to negative value");
+        return NULL;
+    }
+
+    /*vorbisfile bisects the stream on page granule positions
+      and decodes the overlapping block preceding the target
+      so the next read() starts exactly at the requested PCM frame
+
+      it won't seek past the end, so clamp the offset to the stream*/
+    if ((total_pcm_frames = ov_pcm_total(&(self->vorbisfile), -1)) < 0) {
+        PyErr_SetString(PyExc_ValueError, "stream is not seekable");
+        return NULL;
+    } else if (seeked_offset > total_pcm_frames) {
+        seeked_offset = total_pcm_frames;
+    }
+
+    switch (ov_pcm_seek(&(self->vorbisfile), (ogg_int64_t)seeked_offset)) {
+    case 0:
+        self->seeked_to_end = (seeked_offset == total_pcm_frames);
+        return Py_BuildValue("L", seeked_offset);
+    case OV_EREAD:
+        PyErr_SetString(PyExc_IOError, "I/O error seeking in stream");
+        return NULL;
+    case OV_ENOSEEK:
+        PyErr_SetString(PyExc_ValueError, "stream is not seekable");
+        return NULL;
+    case OV_EBADLINK:
+        PyErr_SetString(PyExc_ValueError, "invalid stream section");
+        return NULL;
+    case OV_EFAULT:
+        PyErr_SetString(PyExc_ValueError, "internal logic fault");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_ValueError, "error seeking in stream");
+        return NULL;
+    }
+}
+
 static PyObject*
 VorbisDecoder_close(decoders_VorbisDecoder *self, PyObject *args) {
     self->closed = 1;
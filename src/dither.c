@@ -17,92 +17,498 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
-/*This is a set of reusable routines for opening a BitstreamReader
-  wrapped around the os.urandom function call
-  for generating individual bits of dither for an audio stream.*/
-
-/*this is quite similar to br_read_python
-  except that it pulls data from os.urandom()*/
-static unsigned
-read_os_random(void *user_data,
-               uint8_t* buffer,
-               unsigned buffer_size)
+#include <Python.h>
+#include <stdint.h>
+#include <math.h>
+#include "dither.h"
+#include "simd.h"
+
+/*the number of interleaved generators,
+  which is the widest vector of 32-bit lanes*/
+#define DITHER_LANES 8
+
+/*the amount of noise generated at once, in samples*/
+#define DITHER_BLOCK_SIZE 1024
+
+#define DITHER_MAX_ORDER 5
+
+struct dither {
+    /*each generator's four words of state, word-major
+      so one word of every generator is a single vector*/
+    uint32_t state[4][DITHER_LANES];
+
+    /*TPDF noise between -1 and 1 LSB, with "noise_used" consumed*/
+    float noise[DITHER_BLOCK_SIZE];
+    unsigned noise_used;
+
+    /*noise shaping filter applied to past quantization errors*/
+    unsigned order;
+    const double *coefficients;
+
+    dither_isa_t isa;             /*kernels chosen when opened*/
+
+    /*"order" past errors per channel, most recent first*/
+    unsigned channels;
+    unsigned channel;             /*the channel of the next sample*/
+    double errors[];
+};
+
+static const double SHAPING_FIRST_ORDER[] = {1.0};
+static const double SHAPING_SECOND_ORDER[] = {2.0, -1.0};
+/*from Lipshitz, Vanderkooy and Wannamaker's
+  "Minimally Audible Noise Shaping"*/
+static const double SHAPING_LIPSHITZ[] = {2.033, -2.165, 1.959,
+                                          -1.590, 0.6149};
+
+static inline uint32_t
+dither_rotl(uint32_t x, int k)
 {
-    PyObject *os_module = user_data;
-    /*call unrandom() function on os module*/
-    PyObject* read_result =
-        PyObject_CallMethod(os_module, "urandom", "I", buffer_size);
-    char *string;
-    Py_ssize_t string_size;
-    unsigned to_copy;
-
-    if (read_result == NULL) {
-        /*some exception occurred, so clear result and return no bytes
-          (which will likely turn into an I/O exception later)*/
-        PyErr_Clear();
-        return 0;
-    }
+    return (x << k) | (x >> (32 - k));
+}
 
-    /*get string data from returned object*/
-    if (PyBytes_AsStringAndSize(read_result,
-                                &string,
-                                &string_size) == -1) {
-        /*got something that wasn't a string from .read()
-          so clear exception and return no bytes*/
-        Py_DECREF(read_result);
-        PyErr_Clear();
-        return 0;
+/*the widest kernels new dither sources may use*/
+static dither_isa_t isa_limit = DITHER_AVX2;
+
+/*each generator kernel advances every generator's "state"
+  and fills "noise" with DITHER_BLOCK_SIZE values of TPDF noise
+  where each value is the difference of the
+  upper and lower halves of a 32-bit random number*/
+static void
+generate_scalar(uint32_t s[4][DITHER_LANES], float noise[])
+{
+    unsigned i;
+
+    for (i = 0; i < DITHER_BLOCK_SIZE; i++) {
+        const unsigned lane = i % DITHER_LANES;
+        const uint32_t r = dither_rotl(s[1][lane] * 5, 7) * 9;
+        const uint32_t t = s[1][lane] << 9;
+
+        s[2][lane] ^= s[0][lane];
+        s[3][lane] ^= s[1][lane];
+        s[1][lane] ^= s[2][lane];
+        s[0][lane] ^= s[3][lane];
+        s[2][lane] ^= t;
+        s[3][lane] = dither_rotl(s[3][lane], 11);
+
+        noise[i] = ((int)(r >> 16) - (int)(r & 0xFFFF)) * (1.0f / 65536);
     }
+}
+
+#if defined(SIMD_X86)
+SIMD_TARGET("sse2") static void
+generate_sse2(uint32_t s[4][DITHER_LANES], float noise[])
+{
+    unsigned half;
+
+    /*each half of the generators fills every other group of 4*/
+    for (half = 0; half < DITHER_LANES; half += 4) {
+        __m128i s0 = _mm_loadu_si128((__m128i*)(s[0] + half));
+        __m128i s1 = _mm_loadu_si128((__m128i*)(s[1] + half));
+        __m128i s2 = _mm_loadu_si128((__m128i*)(s[2] + half));
+        __m128i s3 = _mm_loadu_si128((__m128i*)(s[3] + half));
+        const __m128i low_half = _mm_set1_epi32(0xFFFF);
+        const __m128 scale = _mm_set1_ps(1.0f / 65536);
+        unsigned i;
+
+        for (i = half; i < DITHER_BLOCK_SIZE; i += DITHER_LANES) {
+            __m128i r = _mm_add_epi32(_mm_slli_epi32(s1, 2), s1);
+            __m128i t;
+            r = _mm_or_si128(_mm_slli_epi32(r, 7), _mm_srli_epi32(r, 25));
+            r = _mm_add_epi32(_mm_slli_epi32(r, 3), r);
 
-    /*write either "buffer_size" or "string_size" bytes to buffer
-      whichever is less*/
-    if (string_size >= buffer_size) {
-        /*truncate strings larger than expected*/
-        to_copy = buffer_size;
-    } else {
-        to_copy = (unsigned)string_size;
+            t = _mm_slli_epi32(s1, 9);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = _mm_or_si128(_mm_slli_epi32(s3, 11),
+                              _mm_srli_epi32(s3, 21));
+
+            _mm_storeu_ps(
+                noise + i,
+                _mm_mul_ps(
+                    _mm_cvtepi32_ps(
+                        _mm_sub_epi32(_mm_srli_epi32(r, 16),
+                                      _mm_and_si128(r, low_half))),
+                    scale));
+        }
+
+        _mm_storeu_si128((__m128i*)(s[0] + half), s0);
+        _mm_storeu_si128((__m128i*)(s[1] + half), s1);
+        _mm_storeu_si128((__m128i*)(s[2] + half), s2);
+        _mm_storeu_si128((__m128i*)(s[3] + half), s3);
     }
+}
+
+SIMD_TARGET("avx2") static void
+generate_avx2(uint32_t s[4][DITHER_LANES], float noise[])
+{
+    __m256i s0 = _mm256_loadu_si256((__m256i*)s[0]);
+    __m256i s1 = _mm256_loadu_si256((__m256i*)s[1]);
+    __m256i s2 = _mm256_loadu_si256((__m256i*)s[2]);
+    __m256i s3 = _mm256_loadu_si256((__m256i*)s[3]);
+    const __m256i low_half = _mm256_set1_epi32(0xFFFF);
+    const __m256 scale = _mm256_set1_ps(1.0f / 65536);
+    unsigned i;
+
+    for (i = 0; i < DITHER_BLOCK_SIZE; i += DITHER_LANES) {
+        /*result = rotl(s1 * 5, 7) * 9*/
+        __m256i r = _mm256_add_epi32(_mm256_slli_epi32(s1, 2), s1);
+        __m256i t;
+        r = _mm256_or_si256(_mm256_slli_epi32(r, 7),
+                            _mm256_srli_epi32(r, 25));
+        r = _mm256_add_epi32(_mm256_slli_epi32(r, 3), r);
 
-    memcpy(buffer, (uint8_t*)string, to_copy);
+        t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11),
+                             _mm256_srli_epi32(s3, 21));
 
-    /*perform cleanup and return bytes actually read*/
-    Py_DECREF(read_result);
+        _mm256_storeu_ps(
+            noise + i,
+            _mm256_mul_ps(
+                _mm256_cvtepi32_ps(
+                    _mm256_sub_epi32(_mm256_srli_epi32(r, 16),
+                                     _mm256_and_si256(r, low_half))),
+                scale));
+    }
 
-    return to_copy;
+    _mm256_storeu_si256((__m256i*)s[0], s0);
+    _mm256_storeu_si256((__m256i*)s[1], s1);
+    _mm256_storeu_si256((__m256i*)s[2], s2);
+    _mm256_storeu_si256((__m256i*)s[3], s3);
 }
 
-static int
-close_os_random(void *user_data)
+/*dithers, clamps and rounds pairs of samples without noise shaping
+  and returns the number handled, leaving any remainder
+  to the scalar loop*/
+SIMD_TARGET("sse2") static unsigned
+quantize_sse2(unsigned count,
+              const double input[],
+              const float noise[],
+              int minimum,
+              int maximum,
+              int output[])
 {
-    return 0;
+    const __m128d lower = _mm_set1_pd(minimum);
+    const __m128d upper = _mm_set1_pd(maximum);
+    unsigned i;
+
+    for (i = 0; (i + 2) <= count; i += 2) {
+        const __m128d dithered =
+            _mm_add_pd(_mm_loadu_pd(input + i),
+                       _mm_cvtps_pd(_mm_castsi128_ps(
+                           _mm_loadl_epi64((const __m128i*)(noise + i)))));
+        _mm_storel_epi64(
+            (__m128i*)(output + i),
+            _mm_cvtpd_epi32(
+                _mm_min_pd(_mm_max_pd(dithered, lower), upper)));
+    }
+    return i;
 }
+#endif
 
+/*refills the noise buffer with fresh TPDF noise*/
 static void
-free_os_random(void *user_data)
+dither_generate(struct dither *dither)
 {
-    PyObject *os_module = user_data;
-    Py_XDECREF(os_module);
+    switch (dither->isa) {
+#if defined(SIMD_X86)
+    case DITHER_AVX2:
+        generate_avx2(dither->state, dither->noise);
+        break;
+    case DITHER_SSE2:
+        generate_sse2(dither->state, dither->noise);
+        break;
+#endif
+    default:
+        generate_scalar(dither->state, dither->noise);
+        break;
+    }
+
+    dither->noise_used = 0;
 }
 
-/*returns a BitstreamReader for reading 1 bit white noise dither values
-  or NULL if an error occurs opening the os module*/
-static BitstreamReader*
-open_dither(void)
+dither_isa_t
+dither_supported_isa(void)
 {
-    PyObject* os_module;
-
-    if ((os_module = PyImport_ImportModule("os")) != NULL) {
-        return br_open_external(os_module,
-                                BS_BIG_ENDIAN,
-                                4096,
-                                read_os_random,
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                NULL, /*unseekable stream*/
-                                close_os_random,
-                                free_os_random);
-    } else {
+#if defined(SIMD_X86)
+    if (simd_supports("avx2")) {
+        return DITHER_AVX2;
+    } else if (simd_supports("sse2")) {
+        return DITHER_SSE2;
+    }
+#endif
+    return DITHER_SCALAR;
+}
+
+/*returns the kernels a new dither source should use*/
+static dither_isa_t
+dither_usable_isa(void)
+{
+    const dither_isa_t supported = dither_supported_isa();
+    return isa_limit < supported ? isa_limit : supported;
+}
+
+dither_isa_t
+dither_limit_isa(dither_isa_t isa)
+{
+    isa_limit = isa;
+    return dither_usable_isa();
+}
+
+struct dither*
+open_dither(unsigned channels, dither_shaping_t shaping)
+{
+    PyObject *os_module;
+    PyObject *seed;
+    char *seed_data;
+    Py_ssize_t seed_size;
+    struct dither *dither;
+    unsigned i;
+
+    if ((os_module = PyImport_ImportModule("os")) == NULL)
+        return NULL;
+    seed = PyObject_CallMethod(os_module, "urandom", "I",
+                               (unsigned)sizeof(dither->state));
+    Py_DECREF(os_module);
+    if (seed == NULL)
         return NULL;
+    if (PyBytes_AsStringAndSize(seed, &seed_data, &seed_size) == -1) {
+        Py_DECREF(seed);
+        return NULL;
+    }
+    if (seed_size < (Py_ssize_t)sizeof(dither->state)) {
+        PyErr_SetString(PyExc_ValueError, "insufficient random seed data");
+        Py_DECREF(seed);
+        return NULL;
+    }
+
+    if (!channels)
+        channels = 1;
+    dither = malloc(sizeof(struct dither) +
+                    sizeof(double) * channels * DITHER_MAX_ORDER);
+    memcpy(dither->state, seed_data, sizeof(dither->state));
+    Py_DECREF(seed);
+
+    /*xoshiro's state must not be all zeroes*/
+    for (i = 0; i < DITHER_LANES; i++) {
+        if (!(dither->state[0][i] | dither->state[1][i] |
+              dither->state[2][i] | dither->state[3][i])) {
+            dither->state[0][i] = i + 1;
+        }
+    }
+
+    switch (shaping) {
+    case DITHER_SHAPING_NONE:
+    default:
+        dither->order = 0;
+        dither->coefficients = NULL;
+        break;
+    case DITHER_SHAPING_FIRST_ORDER:
+        dither->order = 1;
+        dither->coefficients = SHAPING_FIRST_ORDER;
+        break;
+    case DITHER_SHAPING_SECOND_ORDER:
+        dither->order = 2;
+        dither->coefficients = SHAPING_SECOND_ORDER;
+        break;
+    case DITHER_SHAPING_LIPSHITZ:
+        dither->order = 5;
+        dither->coefficients = SHAPING_LIPSHITZ;
+        break;
+    }
+
+    dither->isa = dither_usable_isa();
+    dither->channels = channels;
+    dither->channel = 0;
+    for (i = 0; i < dither->channels * DITHER_MAX_ORDER; i++) {
+        dither->errors[i] = 0.0;
+    }
+
+    dither_generate(dither);
+
+    return dither;
+}
+
+void
+close_dither(struct dither *dither)
+{
+    free(dither);
+}
+
+/*rounds "total_samples" interleaved values which have already been
+  scaled to the output's integer range, adding TPDF dither
+  and feeding back shaped quantization error,
+  then clamps them between "minimum" and "maximum"*/
+static void
+dither_quantize(struct dither *dither,
+                unsigned total_samples,
+                const double input[],
+                int minimum,
+                int maximum,
+                int output[])
+{
+    while (total_samples) {
+        const float *noise;
+        unsigned count;
+
+        if (dither->noise_used == DITHER_BLOCK_SIZE) {
+            dither_generate(dither);
+        }
+        noise = dither->noise + dither->noise_used;
+        count = DITHER_BLOCK_SIZE - dither->noise_used;
+        if (count > total_samples) {
+            count = total_samples;
+        }
+        dither->noise_used += count;
+        total_samples -= count;
+
+        if (dither->order == 0) {
+            /*without feedback each sample stands alone*/
+#if defined(SIMD_X86)
+            if (dither->isa >= DITHER_SSE2) {
+                const unsigned quantized = quantize_sse2(count,
+                                                         input,
+                                                         noise,
+                                                         minimum,
+                                                         maximum,
+                                                         output);
+                input += quantized;
+                noise += quantized;
+                output += quantized;
+                count -= quantized;
+            }
+#endif
+            for (; count; count--) {
+                const double dithered = input[0] + noise[0];
+                output[0] = (int)lrint(dithered < minimum ? minimum :
+                                       dithered > maximum ? maximum :
+                                       dithered);
+                input += 1;
+                noise += 1;
+                output += 1;
+            }
+        } else {
+            /*feedback is inherently serial within each channel*/
+            const unsigned order = dither->order;
+            const double *coefficients = dither->coefficients;
+            unsigned channel = dither->channel;
+
+            for (; count; count--) {
+                double *errors =
+                    dither->errors + channel * DITHER_MAX_ORDER;
+                double shaped = input[0];
+                long rounded;
+                unsigned k;
+
+                for (k = 0; k < order; k++) {
+                    shaped -= coefficients[k] * errors[k];
+                }
+                rounded = lrint(shaped + noise[0]);
+
+                /*the error excludes clipping so
+                  overloads can't run away in the feedback loop*/
+                for (k = order - 1; k > 0; k--) {
+                    errors[k] = errors[k - 1];
+                }
+                errors[0] = rounded - shaped;
+
+                output[0] = (int)(rounded < minimum ? minimum :
+                                  rounded > maximum ? maximum :
+                                  rounded);
+                input += 1;
+                noise += 1;
+                output += 1;
+                if (++channel == dither->channels) {
+                    channel = 0;
+                }
+            }
+
+            dither->channel = channel;
+        }
+    }
+}
+
+void
+dither_shift(struct dither *dither,
+             unsigned total_samples,
+             unsigned shift,
+             unsigned bits_per_sample,
+             int samples[])
+{
+    const double scale = 1.0 / (1 << shift);
+    const int minimum = -(1 << (bits_per_sample - 1));
+    const int maximum = (1 << (bits_per_sample - 1)) - 1;
+    double scaled[DITHER_BLOCK_SIZE];
+
+    while (total_samples) {
+        const unsigned count = total_samples < DITHER_BLOCK_SIZE ?
+                               total_samples : DITHER_BLOCK_SIZE;
+        unsigned i;
+
+        for (i = 0; i < count; i++) {
+            scaled[i] = samples[i] * scale;
+        }
+        dither_quantize(dither, count, scaled, minimum, maximum, samples);
+        samples += count;
+        total_samples -= count;
+    }
+}
+
+void
+dither_scale(struct dither *dither,
+             unsigned total_samples,
+             double multiplier,
+             unsigned bits_per_sample,
+             int samples[])
+{
+    const int minimum = -(1 << (bits_per_sample - 1));
+    const int maximum = (1 << (bits_per_sample - 1)) - 1;
+    double scaled[DITHER_BLOCK_SIZE];
+
+    while (total_samples) {
+        const unsigned count = total_samples < DITHER_BLOCK_SIZE ?
+                               total_samples : DITHER_BLOCK_SIZE;
+        unsigned i;
+
+        for (i = 0; i < count; i++) {
+            scaled[i] = samples[i] * multiplier;
+        }
+        dither_quantize(dither, count, scaled, minimum, maximum, samples);
+        samples += count;
+        total_samples -= count;
+    }
+}
+
+void
+dither_float(struct dither *dither,
+             unsigned total_samples,
+             const float input[],
+             unsigned bits_per_sample,
+             int output[])
+{
+    const double scale = (double)(1 << (bits_per_sample - 1));
+    const int minimum = -(1 << (bits_per_sample - 1));
+    const int maximum = (1 << (bits_per_sample - 1)) - 1;
+    double scaled[DITHER_BLOCK_SIZE];
+
+    while (total_samples) {
+        const unsigned count = total_samples < DITHER_BLOCK_SIZE ?
+                               total_samples : DITHER_BLOCK_SIZE;
+        unsigned i;
+
+        for (i = 0; i < count; i++) {
+            scaled[i] = input[i] * scale;
+        }
+        dither_quantize(dither, count, scaled, minimum, maximum, output);
+        input += count;
+        output += count;
+        total_samples -= count;
     }
 }
@@ -0,0 +1,96 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*requantizes audio to fewer bits with triangular (TPDF) dither
+  and optional noise shaping
+
+  noise comes from several interleaved xoshiro128** generators
+  seeded once from os.urandom(), so generating it in bulk
+  never calls back into Python and vectorizes across the generators*/
+
+typedef enum {
+    DITHER_SHAPING_NONE,
+    DITHER_SHAPING_FIRST_ORDER,   /*error filtered by (1 - z^-1)*/
+    DITHER_SHAPING_SECOND_ORDER,  /*error filtered by (1 - z^-1)^2*/
+    DITHER_SHAPING_LIPSHITZ       /*5-tap E-weighted filter for 44.1kHz*/
+} dither_shaping_t;
+
+struct dither;
+
+/*the instruction sets the noise generator and quantizer
+  have kernels for, each of which implies those before it*/
+typedef enum {
+    DITHER_SCALAR,
+    DITHER_SSE2,
+    DITHER_AVX2
+} dither_isa_t;
+
+/*returns the widest instruction set whose kernels this CPU can run*/
+dither_isa_t
+dither_supported_isa(void);
+
+/*limits dither sources opened from now on to kernels for "isa"
+  and those before it, or to those the CPU supports if fewer,
+  and returns the instruction set they will use
+
+  this exists so that each set of kernels can be checked
+  against the scalar ones, which they must match exactly*/
+dither_isa_t
+dither_limit_isa(dither_isa_t isa);
+
+/*returns a new dither source for interleaved samples
+  with the given number of channels,
+  or NULL with an exception set if os.urandom() can't seed it*/
+struct dither*
+open_dither(unsigned channels, dither_shaping_t shaping);
+
+void
+close_dither(struct dither *dither);
+
+/*requantizes "total_samples" interleaved integer samples in place
+  to "shift" fewer bits, clamped to the reduced bits-per-sample*/
+void
+dither_shift(struct dither *dither,
+             unsigned total_samples,
+             unsigned shift,
+             unsigned bits_per_sample,
+             int samples[]);
+
+/*requantizes "total_samples" interleaved integer samples in place
+  after multiplying them by "multiplier"*/
+void
+dither_scale(struct dither *dither,
+             unsigned total_samples,
+             double multiplier,
+             unsigned bits_per_sample,
+             int samples[]);
+
+/*quantizes "total_samples" float samples between -1.0 and 1.0
+  to integers with the given bits-per-sample*/
+void
+dither_float(struct dither *dither,
+             unsigned total_samples,
+             const float input[],
+             unsigned bits_per_sample,
+             int output[]);
+
+#endif
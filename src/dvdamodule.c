@@ -1,6 +1,12 @@
 #include "dvdamodule.h"
 #include "mod_defs.h"
 #include "framelist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -93,6 +99,7 @@ DVDA_init(dvda_DVDA *self, PyObject *args, PyObject *kwds)
     char *device = NULL;
 
     self->dvda = NULL;
+    self->audio_ts = NULL;
 
     if (!PyArg_ParseTuple(args, "s|s", &audio_ts, &device))
         return -1;
@@ -102,6 +109,12 @@ DVDA_init(dvda_DVDA *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    /*title sets open their .AOB files from here*/
+    if ((self->audio_ts = strdup(audio_ts)) == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
     return 0;
 }
 
@@ -111,6 +124,7 @@ DVDA_dealloc(dvda_DVDA *self)
     if (self->dvda) {
         dvda_close(self->dvda);
     }
+    free(self->audio_ts);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -147,13 +161,40 @@ Titleset_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     return (PyObject *)self;
 }
 
+static int
+open_aob(const char *audio_ts, unsigned titleset, unsigned number)
+{
+    const size_t path_size = strlen(audio_ts) + 32;
+    char *path = malloc(path_size);
+    int fd;
+
+    if (path == NULL) {
+        return -1;
+    }
+
+    /*discs may use either upper or lower case file names*/
+    snprintf(path, path_size, "%s/ATS_%2.2u_%u.AOB",
+             audio_ts, titleset, number);
+    if ((fd = open(path, O_RDONLY)) == -1) {
+        snprintf(path, path_size, "%s/ats_%2.2u_%u.aob",
+                 audio_ts, titleset, number);
+        fd = open(path, O_RDONLY);
+    }
+
+    free(path);
+    return fd;
+}
+
 static int
 Titleset_init(dvda_Titleset *self, PyObject *args, PyObject *kwds)
 {
     dvda_DVDA* dvda;
     int titleset_number;
+    unsigned first_sector = 0;
+    unsigned i;
 
     self->titleset = NULL;
+    self->aob_count = 0;
 
     if (!PyArg_ParseTuple(args, "O!i",
                           &dvda_DVDAType,
@@ -172,18 +213,70 @@ Titleset_init(dvda_Titleset *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    /*the .AOB files are only used for prefetching,
+      so any that can't be opened are simply left out*/
+    for (i = 1; i <= MAX_AOB_FILES; i++) {
+        struct aob_file *aob = &(self->aobs[self->aob_count]);
+        struct stat aob_stat;
+
+        if ((aob->fd = open_aob(dvda->audio_ts,
+                                (unsigned)titleset_number,
+                                i)) == -1) {
+            break;
+        }
+        if (fstat(aob->fd, &aob_stat) == -1) {
+            close(aob->fd);
+            break;
+        }
+        aob->first_sector = first_sector;
+        aob->sectors = (unsigned)(aob_stat.st_size / AOB_SECTOR_SIZE);
+        first_sector += aob->sectors;
+        self->aob_count++;
+    }
+
     return 0;
 }
 
 static void
 Titleset_dealloc(dvda_Titleset *self)
 {
+    unsigned i;
+
     if (self->titleset) {
         dvda_close_titleset(self->titleset);
     }
+    for (i = 0; i < self->aob_count; i++) {
+        close(self->aobs[i].fd);
+    }
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+static void
+Titleset_prefetch(const dvda_Titleset *self,
+                  unsigned first_sector,
+                  unsigned sectors)
+{
+#ifdef POSIX_FADV_WILLNEED
+    const unsigned last_sector = first_sector + sectors;
+    unsigned i;
+
+    for (i = 0; i < self->aob_count; i++) {
+        const struct aob_file *aob = &(self->aobs[i]);
+        const unsigned start = MAX(first_sector, aob->first_sector);
+        const unsigned end = MIN(last_sector,
+                                 aob->first_sector + aob->sectors);
+
+        if (start < end) {
+            posix_fadvise(aob->fd,
+                          (off_t)(start - aob->first_sector) *
+                          AOB_SECTOR_SIZE,
+                          (off_t)(end - start) * AOB_SECTOR_SIZE,
+                          POSIX_FADV_WILLNEED);
+        }
+    }
+#endif
+}
+
 static PyObject*
 Titleset_title(dvda_Titleset *self, PyObject *args)
 {
@@ -230,6 +323,7 @@ Title_init(dvda_Title *self, PyObject *args, PyObject *kwds)
     int title_number;
 
     self->title = NULL;
+    self->titleset = NULL;
 
     if (!PyArg_ParseTuple(args, "O!i",
                           &dvda_TitlesetType,
@@ -248,6 +342,10 @@ Title_init(dvda_Title *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    /*the title set outlives its titles and their tracks' readers*/
+    Py_INCREF((PyObject*)titleset);
+    self->titleset = titleset;
+
     return 0;
 }
 
@@ -257,6 +355,7 @@ Title_dealloc(dvda_Title *self)
     if (self->title) {
         dvda_close_title(self->title);
     }
+    Py_XDECREF((PyObject*)self->titleset);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -312,6 +411,7 @@ Track_init(dvda_Track *self, PyObject *args, PyObject *kwds)
     int track_number;
 
     self->track = NULL;
+    self->title = NULL;
 
     if (!PyArg_ParseTuple(args, "O!i",
                           &dvda_TitleType,
@@ -330,6 +430,9 @@ Track_init(dvda_Track *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    Py_INCREF((PyObject*)title);
+    self->title = title;
+
     return 0;
 }
 
@@ -339,14 +442,21 @@ Track_dealloc(dvda_Track *self)
     if (self->track) {
         dvda_close_track(self->track);
     }
+    Py_XDECREF((PyObject*)self->title);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
 static PyObject*
-Track_reader(dvda_Track *self, PyObject *args)
+Track_reader(dvda_Track *self, PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"read_ahead", NULL};
+    int read_ahead = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &read_ahead))
+        return NULL;
+
     return PyObject_CallFunction(
-        (PyObject*)&dvda_TrackReaderType, "O", self);
+        (PyObject*)&dvda_TrackReaderType, "Oi", self, read_ahead);
 }
 
 static PyObject*
@@ -396,13 +506,18 @@ TrackReader_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 static int
 TrackReader_init(dvda_TrackReader *self, PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"track", "read_ahead", NULL};
     dvda_Track* track;
+    int read_ahead = 0;
 
     self->closed = 0;
     self->reader = NULL;
     self->audiotools_pcm = NULL;
+    self->track = NULL;
+    self->read_ahead_enabled = 0;
 
-    if (!PyArg_ParseTuple(args, "O!", &dvda_TrackType, &track))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|i", kwlist,
+                                     &dvda_TrackType, &track, &read_ahead))
         return -1;
 
     if ((self->reader = dvda_open_track_reader(track->track)) == NULL) {
@@ -414,16 +529,58 @@ TrackReader_init(dvda_TrackReader *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    Py_INCREF((PyObject*)track);
+    self->track = track;
+
+    self->first_sector = dvda_track_first_sector(track->track);
+    self->last_sector = dvda_track_last_sector(track->track);
+    self->next_prefetch = self->first_sector;
+    self->total_pcm_frames = ((uint64_t)dvda_track_pts_length(track->track) *
+                              dvda_sample_rate(self->reader)) / 90000;
+    self->pcm_frames_decoded = 0;
+
+    if (read_ahead) {
+        struct dvda_read_ahead *ring = &(self->read_ahead);
+
+        if ((ring->blocks = malloc(READ_AHEAD_BLOCKS *
+                                   READ_AHEAD_FRAMES *
+                                   dvda_channel_count(self->reader) *
+                                   sizeof(int))) == NULL) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        ring->started = 0;
+        ring->head = 0;
+        ring->count = 0;
+        ring->taken = 0;
+        ring->stop = 0;
+        ring->finished = 0;
+        pthread_mutex_init(&(ring->mutex), NULL);
+        pthread_cond_init(&(ring->filled), NULL);
+        pthread_cond_init(&(ring->drained), NULL);
+        self->read_ahead_enabled = 1;
+    }
+
     return 0;
 }
 
 static void
 TrackReader_dealloc(dvda_TrackReader *self)
 {
+    if (self->read_ahead_enabled) {
+        struct dvda_read_ahead *ring = &(self->read_ahead);
+
+        TrackReader_stop(self);
+        free(ring->blocks);
+        pthread_mutex_destroy(&(ring->mutex));
+        pthread_cond_destroy(&(ring->filled));
+        pthread_cond_destroy(&(ring->drained));
+    }
     if (self->reader) {
         dvda_close_track_reader(self->reader);
     }
     Py_XDECREF(self->audiotools_pcm);
+    Py_XDECREF((PyObject*)self->track);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -458,10 +615,19 @@ TrackReader_read(dvda_TrackReader *self, PyObject *args)
         return NULL;
     }
 
-    /*perform read to FrameList's buffer*/
-    received_pcm_frames = dvda_read(self->reader,
-                                    requested_pcm_frames,
-                                    framelist->samples);
+    /*perform read to FrameList's buffer,
+      either from the decoding thread or by decoding here*/
+    Py_BEGIN_ALLOW_THREADS
+    if (self->read_ahead_enabled) {
+        received_pcm_frames = TrackReader_take(self,
+                                               requested_pcm_frames,
+                                               framelist->samples);
+    } else {
+        received_pcm_frames = TrackReader_decode(self,
+                                                 requested_pcm_frames,
+                                                 framelist->samples);
+    }
+    Py_END_ALLOW_THREADS
 
     /*fill in remaining FrameList parameters*/
     framelist->frames = received_pcm_frames;
@@ -470,9 +636,169 @@ TrackReader_read(dvda_TrackReader *self, PyObject *args)
     return (PyObject*)framelist;
 }
 
+static unsigned
+TrackReader_decode(dvda_TrackReader *self,
+                   unsigned pcm_frames,
+                   int *samples)
+{
+    unsigned decoded;
+
+    /*MLP's bitrate varies, so the reader's sector is only estimated
+      from how much of the track has been decoded so far*/
+    if ((self->next_prefetch <= self->last_sector) &&
+        (self->total_pcm_frames > 0)) {
+        const uint64_t sectors = self->last_sector - self->first_sector + 1;
+        const unsigned position = self->first_sector + (unsigned)(
+            (MIN(self->pcm_frames_decoded, self->total_pcm_frames) *
+             sectors) / self->total_pcm_frames);
+
+        if (self->next_prefetch < position) {
+            self->next_prefetch = position;
+        }
+        if ((position + PREFETCH_SECTORS / 2) >= self->next_prefetch) {
+            const unsigned count =
+                MIN(PREFETCH_SECTORS,
+                    self->last_sector + 1 - self->next_prefetch);
+            Titleset_prefetch(self->track->title->titleset,
+                              self->next_prefetch,
+                              count);
+            self->next_prefetch += count;
+        }
+    }
+
+    decoded = dvda_read(self->reader, pcm_frames, samples);
+    self->pcm_frames_decoded += decoded;
+    return decoded;
+}
+
+static void*
+TrackReader_read_ahead(void *arg)
+{
+    dvda_TrackReader *self = arg;
+    struct dvda_read_ahead *ring = &(self->read_ahead);
+    const unsigned block_size =
+        READ_AHEAD_FRAMES * dvda_channel_count(self->reader);
+
+    pthread_mutex_lock(&(ring->mutex));
+    while (!ring->stop && !ring->finished) {
+        unsigned slot;
+        unsigned decoded;
+
+        if (ring->count == READ_AHEAD_BLOCKS) {
+            /*nothing to do until the caller takes a block*/
+            pthread_cond_wait(&(ring->drained), &(ring->mutex));
+            continue;
+        }
+
+        /*the caller never touches blocks past the filled ones,
+          so the next one can be decoded into without the lock*/
+        slot = (ring->head + ring->count) % READ_AHEAD_BLOCKS;
+        pthread_mutex_unlock(&(ring->mutex));
+
+        decoded = TrackReader_decode(self,
+                                     READ_AHEAD_FRAMES,
+                                     ring->blocks + (slot * block_size));
+
+        pthread_mutex_lock(&(ring->mutex));
+        if (decoded > 0) {
+            ring->frames[slot] = decoded;
+            ring->count++;
+        } else {
+            ring->finished = 1;
+        }
+        pthread_cond_signal(&(ring->filled));
+    }
+    pthread_mutex_unlock(&(ring->mutex));
+
+    return NULL;
+}
+
+static unsigned
+TrackReader_take(dvda_TrackReader *self,
+                 unsigned pcm_frames,
+                 int *samples)
+{
+    struct dvda_read_ahead *ring = &(self->read_ahead);
+    const unsigned channels = dvda_channel_count(self->reader);
+    unsigned taken = 0;
+
+    pthread_mutex_lock(&(ring->mutex));
+
+    /*the thread starts on the first read,
+      so readers only opened for their metadata never decode*/
+    if (!ring->started) {
+        if (pthread_create(&(ring->thread),
+                           NULL,
+                           TrackReader_read_ahead,
+                           self) == 0) {
+            ring->started = 1;
+        } else {
+            /*fall back to decoding on the caller's thread*/
+            pthread_mutex_unlock(&(ring->mutex));
+            return TrackReader_decode(self, pcm_frames, samples);
+        }
+    }
+
+    while (taken < pcm_frames) {
+        const int *block;
+        unsigned to_copy;
+
+        if (ring->count == 0) {
+            if (ring->finished) {
+                break;
+            } else {
+                pthread_cond_wait(&(ring->filled), &(ring->mutex));
+                continue;
+            }
+        }
+
+        block = ring->blocks + (ring->head * READ_AHEAD_FRAMES * channels);
+        to_copy = MIN(ring->frames[ring->head] - ring->taken,
+                      pcm_frames - taken);
+        memcpy(samples + (taken * channels),
+               block + (ring->taken * channels),
+               to_copy * channels * sizeof(int));
+        taken += to_copy;
+        ring->taken += to_copy;
+
+        if (ring->taken == ring->frames[ring->head]) {
+            ring->head = (ring->head + 1) % READ_AHEAD_BLOCKS;
+            ring->count--;
+            ring->taken = 0;
+            pthread_cond_signal(&(ring->drained));
+        }
+    }
+
+    pthread_mutex_unlock(&(ring->mutex));
+    return taken;
+}
+
+static void
+TrackReader_stop(dvda_TrackReader *self)
+{
+    struct dvda_read_ahead *ring = &(self->read_ahead);
+    int started;
+
+    pthread_mutex_lock(&(ring->mutex));
+    ring->stop = 1;
+    started = ring->started;
+    ring->started = 0;
+    pthread_cond_signal(&(ring->drained));
+    pthread_mutex_unlock(&(ring->mutex));
+
+    if (started) {
+        pthread_join(ring->thread, NULL);
+    }
+}
+
 static PyObject*
 TrackReader_close(dvda_TrackReader *self, PyObject *args)
 {
+    if (!self->closed && self->read_ahead_enabled) {
+        Py_BEGIN_ALLOW_THREADS
+        TrackReader_stop(self);
+        Py_END_ALLOW_THREADS
+    }
     self->closed = 1;
     Py_INCREF(Py_None);
     return Py_None;
@@ -488,9 +814,7 @@ TrackReader_enter(dvda_TrackReader* self, PyObject *args)
 static PyObject*
 TrackReader_exit(dvda_TrackReader* self, PyObject *args)
 {
-    self->closed = 1;
-    Py_INCREF(Py_None);
-    return Py_None;
+    return TrackReader_close(self, NULL);
 }
 
 static PyObject*
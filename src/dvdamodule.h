@@ -1,5 +1,7 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <dvd-audio.h>
 
 /********************************************************
@@ -33,6 +35,7 @@ typedef struct dvda_DVDA_s {
     PyObject_HEAD
 
     DVDA *dvda;
+    char *audio_ts;
 } dvda_DVDA;
 
 static PyObject*
@@ -107,10 +110,26 @@ static PyTypeObject dvda_DVDAType = {
  *       Titleset object       *
  *******************************/
 
+/*a title set's audio is split across up to 9 .AOB files*/
+#define MAX_AOB_FILES 9
+
+#define AOB_SECTOR_SIZE 2048
+
+struct aob_file {
+    int fd;
+    unsigned first_sector;   /*in the stream of .AOB files*/
+    unsigned sectors;
+};
+
 typedef struct dvda_Titleset_s {
     PyObject_HEAD
 
     DVDA_Titleset *titleset;
+
+    /*the title set's .AOB files, opened alongside the library's own
+      so upcoming sectors can be fetched while earlier ones are decoded*/
+    unsigned aob_count;
+    struct aob_file aobs[MAX_AOB_FILES];
 } dvda_Titleset;
 
 static PyObject*
@@ -125,6 +144,15 @@ Titleset_dealloc(dvda_Titleset *self);
 static PyObject*
 Titleset_title(dvda_Titleset *self, PyObject *args);
 
+/*hints that the given range of .AOB sectors will be read soon
+  so the kernel can start reading them in the background
+
+  may be called without the GIL*/
+static void
+Titleset_prefetch(const dvda_Titleset *self,
+                  unsigned first_sector,
+                  unsigned sectors);
+
 static PyMethodDef Titleset_methods[] = {
     {"title", (PyCFunction)Titleset_title,
      METH_VARARGS, "title(number) -> Title"},
@@ -194,6 +222,7 @@ typedef struct dvda_Title_s {
     PyObject_HEAD
 
     DVDA_Title *title;
+    dvda_Titleset *titleset;
 } dvda_Title;
 
 static PyObject*
@@ -282,6 +311,7 @@ typedef struct dvda_Track_s {
     PyObject_HEAD
 
     DVDA_Track *track;
+    dvda_Title *title;
 } dvda_Track;
 
 static PyObject*
@@ -294,11 +324,11 @@ static void
 Track_dealloc(dvda_Track *self);
 
 static PyObject*
-Track_reader(dvda_Track *self, PyObject *args);
+Track_reader(dvda_Track *self, PyObject *args, PyObject *kwds);
 
 static PyMethodDef Track_methods[] = {
     {"reader", (PyCFunction)Track_reader,
-     METH_NOARGS, "reader() -> TrackReader"},
+     METH_VARARGS | METH_KEYWORDS, "reader([read_ahead]) -> TrackReader"},
     {NULL}
 };
 
@@ -376,12 +406,55 @@ static PyTypeObject dvda_TrackType = {
  *     TrackReader object      *
  *******************************/
 
+/*PCM frames decoded into each block of the read-ahead ring*/
+#define READ_AHEAD_FRAMES 4096
+
+/*the number of blocks a reader may decode ahead of the caller*/
+#define READ_AHEAD_BLOCKS 16
+
+/*the number of .AOB sectors to prefetch at a time*/
+#define PREFETCH_SECTORS 2048
+
+/*a track reader's decoding thread and the blocks it has decoded
+
+  only this thread calls dvda_read once it's started*/
+struct dvda_read_ahead {
+    pthread_t thread;
+    int started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;    /*signaled when a block is decoded*/
+    pthread_cond_t drained;   /*signaled when a block is taken*/
+
+    /*a ring of decoded blocks following the caller's position*/
+    int *blocks;
+    unsigned frames[READ_AHEAD_BLOCKS];
+    unsigned head;
+    unsigned count;
+    unsigned taken;           /*PCM frames already taken from the head*/
+
+    int stop;
+    int finished;             /*set once dvda_read returns nothing*/
+};
+
 typedef struct dvda_TrackReader_s {
     PyObject_HEAD
 
     int closed;
     DVDA_Track_Reader *reader;
     PyObject *audiotools_pcm;
+    dvda_Track *track;
+
+    /*the reader's position is estimated from the PCM frames decoded
+      in order to prefetch the sectors it will need next*/
+    unsigned first_sector;
+    unsigned last_sector;
+    unsigned next_prefetch;
+    uint64_t total_pcm_frames;
+    uint64_t pcm_frames_decoded;
+
+    int read_ahead_enabled;
+    struct dvda_read_ahead read_ahead;
 } dvda_TrackReader;
 
 static PyObject*
@@ -396,6 +469,33 @@ TrackReader_dealloc(dvda_TrackReader *self);
 static PyObject*
 TrackReader_read(dvda_TrackReader *self, PyObject *args);
 
+/*decodes up to "pcm_frames" into "samples", prefetching as needed,
+  and returns the amount decoded
+
+  may be called without the GIL*/
+static unsigned
+TrackReader_decode(dvda_TrackReader *self,
+                   unsigned pcm_frames,
+                   int *samples);
+
+/*the body of a reader's decoding thread*/
+static void*
+TrackReader_read_ahead(void *arg);
+
+/*fills "samples" with up to "pcm_frames" from the read-ahead ring,
+  waiting for the thread as necessary,
+  and returns the amount taken
+
+  called without the GIL*/
+static unsigned
+TrackReader_take(dvda_TrackReader *self,
+                 unsigned pcm_frames,
+                 int *samples);
+
+/*stops the reader's decoding thread, if started*/
+static void
+TrackReader_stop(dvda_TrackReader *self);
+
 static PyObject*
 TrackReader_close(dvda_TrackReader *self, PyObject *args);
 
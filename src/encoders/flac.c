@@ -83,9 +83,11 @@ write_VORBIS_COMMENT(BitstreamWriter *output,
                      const char version[],
                      const struct PCMReader *pcmreader);
 
+/*updates the running MD5 sum with one array of samples per channel
+  in the interleaved little-endian order FLAC's checksum uses*/
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
-              const int pcm_data[],
+              int *const channel_data[],
               unsigned channels,
               unsigned bits_per_sample,
               unsigned pcm_frames);
@@ -100,7 +102,7 @@ static void
 encode_frame(const struct PCMReader *pcmreader,
              BitstreamWriter *output,
              const struct flac_encoding_options *options,
-             const int pcm_data[],
+             int *const channel_data[],
              unsigned pcm_frames,
              unsigned frame_number);
 
@@ -994,22 +996,42 @@ write_VORBIS_COMMENT(BitstreamWriter *output,
     comment->close(comment);
 }
 
+#define MD5_CHUNK_FRAMES 1024
+
 static void
 update_md5sum(audiotools__MD5Context *md5sum,
-              const int pcm_data[],
+              int *const channel_data[],
               unsigned channels,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    const unsigned total_samples = pcm_frames * channels;
-    const unsigned buffer_size = total_samples * (bits_per_sample / 8);
-    unsigned char buffer[buffer_size];
+    const int_to_pcm_f converter =
+        int_to_pcm_converter(bits_per_sample, 0, 1);
+    int pcm_data[MD5_CHUNK_FRAMES * channels];
+    unsigned char buffer[MD5_CHUNK_FRAMES * channels * (bits_per_sample / 8)];
+    unsigned start;
+
+    /*interleave a chunk at a time to keep the buffers small*/
+    for (start = 0; start < pcm_frames; start += MD5_CHUNK_FRAMES) {
+        const unsigned chunk_frames = MIN(pcm_frames - start,
+                                          MD5_CHUNK_FRAMES);
+        const unsigned chunk_samples = chunk_frames * channels;
+        unsigned c;
+        unsigned i;
+
+        for (c = 0; c < channels; c++) {
+            const int *channel = channel_data[c] + start;
+            for (i = 0; i < chunk_frames; i++) {
+                pcm_data[(i * channels) + c] = channel[i];
+            }
+        }
 
-    int_to_pcm_converter(bits_per_sample, 0, 1)(total_samples,
-                                                pcm_data,
-                                                buffer);
+        converter(chunk_samples, pcm_data, buffer);
 
-    audiotools__MD5Update(md5sum, buffer, buffer_size);
+        audiotools__MD5Update(md5sum,
+                              buffer,
+                              chunk_samples * (bits_per_sample / 8));
+    }
 }
 
 static struct flac_frame_size*
@@ -1020,16 +1042,26 @@ encode_frames(struct PCMReader *pcmreader,
 {
     struct flac_frame_size *frame_sizes = NULL;
     int pcm_data[options->block_size * pcmreader->channels];
+    int *channel_data[pcmreader->channels];
     unsigned pcm_frames_read;
     unsigned frame_number = 0;
+    unsigned c;
+
+    /*subframes are encoded a channel at a time,
+      so read samples planar rather than de-interleaving them*/
+    for (c = 0; c < pcmreader->channels; c++) {
+        channel_data[c] = pcm_data + (c * options->block_size);
+    }
 
     while ((pcm_frames_read =
-            pcmreader->read(pcmreader, options->block_size, pcm_data)) > 0) {
+            pcmreader->read_planar(pcmreader,
+                                   options->block_size,
+                                   channel_data)) > 0) {
         unsigned frame_size = 0;
 
         /*update running MD5 of stream*/
         update_md5sum(md5_context,
-                      pcm_data,
+                      channel_data,
                       pcmreader->channels,
                       pcmreader->bits_per_sample,
                       pcm_frames_read);
@@ -1039,7 +1071,7 @@ encode_frames(struct PCMReader *pcmreader,
         encode_frame(pcmreader,
                      output,
                      options,
-                     pcm_data,
+                     channel_data,
                      pcm_frames_read,
                      frame_number++);
         output->pop_callback(output, NULL);
@@ -1063,7 +1095,7 @@ static void
 encode_frame(const struct PCMReader *pcmreader,
              BitstreamWriter *output,
              const struct flac_encoding_options *options,
-             const int pcm_data[],
+             int *const channel_data[],
              unsigned pcm_frames,
              unsigned frame_number)
 {
@@ -1075,8 +1107,8 @@ encode_frame(const struct PCMReader *pcmreader,
     if ((pcmreader->channels == 2) &&
         (options->mid_side || options->adaptive_mid_side)) {
         /*attempt different assignments if stereo and mid-side requested*/
-        int left_channel[pcm_frames];
-        int right_channel[pcm_frames];
+        int *left_channel = channel_data[0];
+        int *right_channel = channel_data[1];
         int average_channel[pcm_frames];
         int difference_channel[pcm_frames];
 
@@ -1094,9 +1126,6 @@ encode_frame(const struct PCMReader *pcmreader,
         unsigned side_right;
         unsigned mid_side;
 
-        get_channel_data(pcm_data, 0, 2, pcm_frames, left_channel);
-        get_channel_data(pcm_data, 1, 2, pcm_frames, right_channel);
-
         correlate_channels(pcm_frames,
                            left_channel,
                            right_channel,
@@ -1206,15 +1235,10 @@ encode_frame(const struct PCMReader *pcmreader,
 
         /*write 1 subframe per channel*/
         for (c = 0; c < pcmreader->channels; c++) {
-            int channel_data[pcm_frames];
-
-            get_channel_data(pcm_data, c, pcmreader->channels,
-                             pcm_frames, channel_data);
-
             encode_subframe(output,
                             options,
                             pcm_frames,
-                            channel_data,
+                            channel_data[c],
                             pcmreader->bits_per_sample);
         }
     }
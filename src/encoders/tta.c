@@ -1,5 +1,7 @@
 #include "tta.h"
 #include "../common/tta_crc.h"
+#include "../common/tta_filter.h"
+#include <pthread.h>
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -25,15 +27,6 @@ struct prediction_params {
     int previous_sample;
 };
 
-struct filter_params {
-    unsigned shift;
-    int previous_residual;
-    int round;
-    int qm[8];
-    int dx[8];
-    int dl[8];
-};
-
 struct residual_params {
     int k0;
     int k1;
@@ -41,6 +34,15 @@ struct residual_params {
     int sum1;
 };
 
+/*a single TTA frame to be encoded on its own thread*/
+struct frame_job {
+    unsigned bits_per_sample;
+    unsigned channels;
+    unsigned block_size;
+    const int *samples;
+    BitstreamRecorder *output;
+};
+
 /*******************************
  * private function signatures *
  *******************************/
@@ -76,6 +78,18 @@ encode_frame(unsigned bits_per_sample,
              const int samples[],
              BitstreamWriter *output);
 
+/*pthread entry point which encodes a struct frame_job
+  to its recorder*/
+static void*
+encode_frame_job(struct frame_job *job);
+
+/*works like ttaenc_encode_tta_frames
+  but encodes up to "threads" TTA frames in parallel*/
+static struct tta_frame_size*
+encode_tta_frames_parallel(struct PCMReader *pcmreader,
+                           unsigned threads,
+                           BitstreamWriter *output);
+
 /*given a PCM frame's worth of samples and channel count,
   correlates the samples*/
 static void
@@ -92,15 +106,6 @@ init_prediction_params(unsigned bits_per_sample,
 static int
 run_prediction(struct prediction_params *params, int correlated);
 
-static void
-init_filter_params(unsigned bits_per_sample,
-                   struct filter_params *params);
-
-/*given a predicted sample and filter parameters,
-  updates the parameters and returns a residual*/
-static int
-run_filter(struct filter_params *params, int predicted);
-
 static void
 init_residual_params(struct residual_params *params);
 
@@ -125,15 +130,22 @@ reverse_frame_sizes(struct tta_frame_size **stack);
 
 struct tta_frame_size*
 ttaenc_encode_tta_frames(struct PCMReader *pcmreader,
+                         unsigned threads,
                          BitstreamWriter *output)
 {
     struct tta_frame_size *frame_sizes = NULL;
     const unsigned default_block_size = tta_block_size(pcmreader->sample_rate);
     unsigned block_size;
     unsigned frame_size = 0;
-    int *samples = malloc(default_block_size *
-                          pcmreader->channels *
-                          sizeof(int));
+    int *samples;
+
+    if (threads > 1) {
+        return encode_tta_frames_parallel(pcmreader, threads, output);
+    }
+
+    samples = malloc(default_block_size *
+                     pcmreader->channels *
+                     sizeof(int));
 
     output->add_callback(output, (bs_callback_f)byte_counter, &frame_size);
 
@@ -192,6 +204,109 @@ free_tta_frame_sizes(struct tta_frame_size *frame_sizes)
  * private function implementations *
  ************************************/
 
+static void*
+encode_frame_job(struct frame_job *job)
+{
+    encode_frame(job->bits_per_sample,
+                 job->channels,
+                 job->block_size,
+                 job->samples,
+                 (BitstreamWriter*)job->output);
+    return NULL;
+}
+
+static struct tta_frame_size*
+encode_tta_frames_parallel(struct PCMReader *pcmreader,
+                           unsigned threads,
+                           BitstreamWriter *output)
+{
+    struct tta_frame_size *frame_sizes = NULL;
+    const unsigned default_block_size = tta_block_size(pcmreader->sample_rate);
+    const unsigned block_samples = default_block_size * pcmreader->channels;
+    int *samples = malloc(block_samples * threads * sizeof(int));
+    struct frame_job jobs[threads];
+    pthread_t workers[threads];
+    int started[threads];
+    unsigned i;
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].bits_per_sample = pcmreader->bits_per_sample;
+        jobs[i].channels = pcmreader->channels;
+        jobs[i].samples = samples + (i * block_samples);
+        jobs[i].output = bw_open_bytes_recorder(BS_LITTLE_ENDIAN);
+    }
+
+    for (;;) {
+        unsigned count;
+
+        /*read up to one block per thread
+          on the calling thread, since the PCMReader may need the GIL*/
+        for (count = 0; count < threads; count++) {
+            if ((jobs[count].block_size =
+                 pcmreader->read(pcmreader,
+                                 default_block_size,
+                                 samples + (count * block_samples))) == 0) {
+                break;
+            }
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        /*encode all blocks to their own recorders*/
+#ifndef STANDALONE
+        Py_BEGIN_ALLOW_THREADS
+#endif
+        for (i = 1; i < count; i++) {
+            started[i] = !pthread_create(&workers[i],
+                                         NULL,
+                                         (void *(*)(void*))encode_frame_job,
+                                         &jobs[i]);
+            if (!started[i]) {
+                /*fall back to encoding on this thread*/
+                encode_frame_job(&jobs[i]);
+            }
+        }
+        encode_frame_job(&jobs[0]);
+        for (i = 1; i < count; i++) {
+            if (started[i]) {
+                pthread_join(workers[i], NULL);
+            }
+        }
+#ifndef STANDALONE
+        Py_END_ALLOW_THREADS
+#endif
+
+        /*then write encoded frames to output in order*/
+        for (i = 0; i < count; i++) {
+            jobs[i].output->copy(jobs[i].output, output);
+            frame_sizes = append_size(frame_sizes,
+                                      jobs[i].block_size,
+                                      jobs[i].output->bytes_written(
+                                          jobs[i].output));
+            jobs[i].output->reset(jobs[i].output);
+        }
+
+        if (count < threads) {
+            break;
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        jobs[i].output->close(jobs[i].output);
+    }
+    free(samples);
+
+    if (pcmreader->status == PCM_OK) {
+        reverse_frame_sizes(&frame_sizes);
+        return frame_sizes;
+    } else {
+        free_tta_frame_sizes(frame_sizes);
+        return NULL;
+    }
+}
+
 static void
 write_header(unsigned bits_per_sample,
              unsigned sample_rate,
@@ -233,50 +348,57 @@ encode_frame(unsigned bits_per_sample,
              BitstreamWriter *output)
 {
     struct prediction_params prediction_params[channels];
-    struct filter_params filter_params[channels];
+    struct tta_filter_params filter_params[channels];
     struct residual_params residual_params[channels];
+    int *residuals = malloc(block_size * channels * sizeof(int));
     uint32_t crc32 = 0xFFFFFFFF;
+    unsigned i;
     unsigned c;
 
     /*initialize per-channel parameters*/
     for (c = 0; c < channels; c++) {
         init_prediction_params(bits_per_sample, &prediction_params[c]);
-        init_filter_params(bits_per_sample, &filter_params[c]);
+        tta_init_filter_params(bits_per_sample, &filter_params[c]);
         init_residual_params(&residual_params[c]);
     }
 
-    /*setup CRC-32 calculation*/
-    output->add_callback(output, (bs_callback_f)tta_crc32, &crc32);
-
-    /*encode one PCM frame at a time*/
-    for (; block_size; block_size--) {
-        int correlated[channels];
+    /*correlate samples to channels
+      and run fixed prediction over correlated samples*/
+    for (i = 0; i < block_size; i++) {
+        int *predicted = residuals + (i * channels);
 
-        /*correlate samples to channels*/
-        correlate_channels(channels, samples, correlated);
+        correlate_channels(channels, samples + (i * channels), predicted);
 
         for (c = 0; c < channels; c++) {
-            /*encode a residual*/
-            write_residual(
-                &residual_params[c],
-                /*run hybrid filter over predicted value*/
-                run_filter(
-                    &filter_params[c],
-                    /*run fixed prediction over correlated sample*/
-                    run_prediction(
-                        &prediction_params[c],
-                        correlated[c])),
-                output);
+            predicted[c] = run_prediction(&prediction_params[c], predicted[c]);
         }
+    }
+
+    /*run hybrid filter over the whole block of predicted values*/
+    tta_run_filter(TTA_FILTER_ENCODE,
+                   channels,
+                   filter_params,
+                   block_size,
+                   residuals);
 
-        /*move on to next batch of samples*/
-        samples += channels;
+    /*setup CRC-32 calculation*/
+    output->add_callback(output, (bs_callback_f)tta_crc32, &crc32);
+
+    /*encode one PCM frame's worth of residuals at a time*/
+    for (i = 0; i < block_size; i++) {
+        for (c = 0; c < channels; c++) {
+            write_residual(&residual_params[c],
+                           residuals[(i * channels) + c],
+                           output);
+        }
     }
 
     /*write calculated CRC-32 at end of frame*/
     output->byte_align(output);
     output->pop_callback(output, NULL);
     output->write(output, 32, crc32 ^ 0xFFFFFFFF);
+
+    free(residuals);
 }
 
 static void
@@ -326,100 +448,6 @@ run_prediction(struct prediction_params *params, int correlated)
     return predicted;
 }
 
-static void
-init_filter_params(unsigned bits_per_sample,
-                   struct filter_params *params)
-{
-    switch (bits_per_sample) {
-    case 8:
-        params->shift = 10;
-        break;
-    case 16:
-        params->shift = 9;
-        break;
-    case 24:
-        params->shift = 10;
-        break;
-    }
-    params->previous_residual = 0;
-    params->round = 1 << (params->shift - 1);
-    params->qm[0] =
-    params->qm[1] =
-    params->qm[2] =
-    params->qm[3] =
-    params->qm[4] =
-    params->qm[5] =
-    params->qm[6] =
-    params->qm[7] = 0;
-    params->dx[0] =
-    params->dx[1] =
-    params->dx[2] =
-    params->dx[3] =
-    params->dx[4] =
-    params->dx[5] =
-    params->dx[6] =
-    params->dx[7] = 0;
-    params->dl[0] =
-    params->dl[1] =
-    params->dl[2] =
-    params->dl[3] =
-    params->dl[4] =
-    params->dl[5] =
-    params->dl[6] =
-    params->dl[7] = 0;
-}
-
-static inline int
-sign(int x) {
-    if (x > 0) {
-        return 1;
-    } else if (x < 0) {
-        return -1;
-    } else {
-        return 0;
-    }
-}
-
-static int
-run_filter(struct filter_params *params, int predicted)
-{
-    const int previous_sign = sign(params->previous_residual);
-    register int32_t sum = params->round;
-    int residual = predicted;
-
-    sum += params->dl[0] * (params->qm[0] += previous_sign * params->dx[0]);
-    sum += params->dl[1] * (params->qm[1] += previous_sign * params->dx[1]);
-    sum += params->dl[2] * (params->qm[2] += previous_sign * params->dx[2]);
-    sum += params->dl[3] * (params->qm[3] += previous_sign * params->dx[3]);
-    sum += params->dl[4] * (params->qm[4] += previous_sign * params->dx[4]);
-    sum += params->dl[5] * (params->qm[5] += previous_sign * params->dx[5]);
-    sum += params->dl[6] * (params->qm[6] += previous_sign * params->dx[6]);
-    sum += params->dl[7] * (params->qm[7] += previous_sign * params->dx[7]);
-
-    residual -= (sum >> params->shift);
-    params->previous_residual = residual;
-
-    params->dx[0] = params->dx[1];
-    params->dx[1] = params->dx[2];
-    params->dx[2] = params->dx[3];
-    params->dx[3] = params->dx[4];
-    params->dx[4] = params->dl[4] >= 0 ? 1 : -1;
-    params->dx[5] = params->dl[5] >= 0 ? 2 : -2;
-    params->dx[6] = params->dl[6] >= 0 ? 2 : -2;
-    params->dx[7] = params->dl[7] >= 0 ? 4 : -4;
-    params->dl[0] = params->dl[1];
-    params->dl[1] = params->dl[2];
-    params->dl[2] = params->dl[3];
-    params->dl[3] = params->dl[4];
-    params->dl[4] =
-        -(params->dl[5]) + (-(params->dl[6]) + (predicted - params->dl[7]));
-    params->dl[5] = -(params->dl[6]) + (predicted - params->dl[7]);
-    params->dl[6] = predicted - params->dl[7];
-    params->dl[7] = predicted;
-
-    return residual;
-}
-
 static void
 init_residual_params(struct residual_params *params)
 {
@@ -502,14 +530,27 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
     const long long maximum_pcm_frames = 0xFFFFFFFFll;
     BitstreamWriter *output;
     struct tta_frame_size *frame_sizes;
-    static char *kwlist[] = {"file", "pcmreader", "total_pcm_frames", NULL};
+    int threads = 1;
+    static char *kwlist[] = {"file",
+                             "pcmreader",
+                             "total_pcm_frames",
+                             "threads",
+                             NULL};
 
     if (!PyArg_ParseTupleAndKeywords(
-            args, keywds, "OO&|L", kwlist,
+            args, keywds, "OO&|Li", kwlist,
             &file_obj,
             py_obj_to_pcmreader,
             &pcmreader,
-            &total_pcm_frames)) {
+            &total_pcm_frames,
+            &threads)) {
+        return NULL;
+    }
+
+    /*sanity check thread count*/
+    if (threads < 1) {
+        pcmreader->del(pcmreader);
+        PyErr_SetString(PyExc_ValueError, "threads must be >= 1");
         return NULL;
     }
 
@@ -562,7 +603,9 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
 
         /*write frames*/
         if ((frame_sizes =
-             ttaenc_encode_tta_frames(pcmreader, output)) == NULL) {
+             ttaenc_encode_tta_frames(pcmreader,
+                                      (unsigned)threads,
+                                      output)) == NULL) {
             seektable_pos->del(seektable_pos);
             PyErr_SetString(PyExc_IOError, "read error during encoding");
             goto error;
@@ -597,7 +640,9 @@ encoders_encode_tta(PyObject *dummy, PyObject *args, PyObject *keywds)
         }
 
         /*write frames to temporary space*/
-        frame_sizes = ttaenc_encode_tta_frames(pcmreader, tempwriter);
+        frame_sizes = ttaenc_encode_tta_frames(pcmreader,
+                                               (unsigned)threads,
+                                               tempwriter);
         tempwriter->free(tempwriter);
         if (!frame_sizes) {
             PyErr_SetString(PyExc_IOError, "read error during encoding");
@@ -661,6 +706,7 @@ main(int argc, char* argv[]) {
     unsigned sample_rate = 44100;
     unsigned bits_per_sample = 16;
     unsigned total_pcm_frames = 0;
+    unsigned threads = 1;
 
     struct PCMReader *pcmreader;
     BitstreamWriter *output;
@@ -678,8 +724,9 @@ main(int argc, char* argv[]) {
         {"sample-rate",             required_argument, NULL, 'r'},
         {"bits-per-sample",         required_argument, NULL, 'b'},
         {"total-pcm-frames",        required_argument, NULL, 'T'},
+        {"threads",                 required_argument, NULL, 't'},
         {NULL,                      no_argument,       NULL, 0}};
-    const static char* short_opts = "-hc:r:b:T:";
+    const static char* short_opts = "-hc:r:b:T:t:";
 
     while ((c = getopt_long(argc,
                             argv,
@@ -720,6 +767,12 @@ main(int argc, char* argv[]) {
                 return 1;
             }
             break;
+        case 't':
+            if (((threads = strtoul(optarg, NULL, 10)) == 0) && errno) {
+                printf("invalid --threads \"%s\"\n", optarg);
+                return 1;
+            }
+            break;
         case 'h': /*fallthrough*/
         case ':':
         case '?':
@@ -728,6 +781,7 @@ main(int argc, char* argv[]) {
             printf("-r, --sample_rate=#       input sample rate in Hz\n");
             printf("-b, --bits-per-sample=#   bits per input sample\n");
             printf("-T, --total-pcm-frames=#  total PCM frames of input\n");
+            printf("-t, --threads=#           TTA frames to encode at once\n");
             return 0;
         default:
             break;
@@ -749,6 +803,7 @@ main(int argc, char* argv[]) {
            (bits_per_sample == 24));
     assert(sample_rate > 0);
     assert(total_pcm_frames > 0);
+    assert(threads > 0);
 
     block_size = tta_block_size(sample_rate);
     total_tta_frames = div_ceil(total_pcm_frames, block_size);
@@ -780,7 +835,7 @@ main(int argc, char* argv[]) {
     output->write(output, 32, 0);
 
     /*write TTA frames*/
-    frame_sizes = ttaenc_encode_tta_frames(pcmreader, output);
+    frame_sizes = ttaenc_encode_tta_frames(pcmreader, threads, output);
 
     /*write finalized seektable*/
     output->setpos(output, seektable_pos);
@@ -36,9 +36,13 @@ struct tta_frame_size {
   which must be deallocated when no longer needed
   using free_tta_frame_sizes()
 
+  if threads is greater than 1, up to that many TTA frames
+  are encoded in parallel before being written to output in order
+
   returns NULL if some error occurs reading from PCMReader*/
 struct tta_frame_size*
 ttaenc_encode_tta_frames(struct PCMReader *pcmreader,
+                         unsigned threads,
                          BitstreamWriter *output);
 
 /*given a list of TTA frame sizes, returns the total PCM frames*/
@@ -26,27 +26,77 @@ open_audiotools_pcm(void)
     return PyImport_ImportModule("audiotools.pcm");
 }
 
+/*calls audiotools.pcm's FrameList allocator,
+  which leaves the samples for the decoder to populate*/
+static pcm_FrameList*
+alloc_FrameList(PyObject* audiotools_pcm,
+                unsigned channels,
+                unsigned bits_per_sample,
+                unsigned pcm_frames,
+                int compact)
+{
+    PyObject *capsule;
+    pcm_framelist_alloc_f framelist_alloc;
+
+    if ((capsule = PyObject_GetAttrString(audiotools_pcm,
+                                          "_framelist_alloc")) == NULL) {
+        return NULL;
+    }
+    framelist_alloc =
+        (pcm_framelist_alloc_f)PyCapsule_GetPointer(capsule,
+                                                    PCM_FRAMELIST_ALLOC);
+    Py_DECREF(capsule);
+    if (framelist_alloc == NULL) {
+        return NULL;
+    }
+
+    return framelist_alloc(channels, bits_per_sample, pcm_frames, compact);
+}
+
 pcm_FrameList*
 new_FrameList(PyObject* audiotools_pcm,
               unsigned channels,
               unsigned bits_per_sample,
               unsigned pcm_frames)
 {
-    /*have audiotools.pcm make an empty FrameList for us*/
-    pcm_FrameList *framelist =
-        (pcm_FrameList*)empty_FrameList(audiotools_pcm,
-                                        channels,
-                                        bits_per_sample);
-
-    /*then resize it to hold the requested amount of data*/
-    framelist->frames = pcm_frames;
-    framelist->samples =
-        realloc(framelist->samples,
-                sizeof(int) * FrameList_samples_length(framelist));
+    /*have audiotools.pcm make a FrameList of the requested size for us
+      since its sample array must come from that module's allocator*/
+    return alloc_FrameList(audiotools_pcm,
+                           channels,
+                           bits_per_sample,
+                           pcm_frames,
+                           0);
+}
 
+pcm_FrameList*
+new_planar_FrameList(PyObject* audiotools_pcm,
+                     unsigned channels,
+                     unsigned bits_per_sample,
+                     unsigned pcm_frames)
+{
+    pcm_FrameList *framelist = new_FrameList(audiotools_pcm,
+                                             channels,
+                                             bits_per_sample,
+                                             pcm_frames);
+    if (framelist) {
+        framelist->planar = 1;
+    }
     return framelist;
 }
 
+pcm_FrameList*
+new_compact_FrameList(PyObject* audiotools_pcm,
+                      unsigned channels,
+                      unsigned bits_per_sample,
+                      unsigned pcm_frames)
+{
+    return alloc_FrameList(audiotools_pcm,
+                           channels,
+                           bits_per_sample,
+                           pcm_frames,
+                           1);
+}
+
 PyObject*
 empty_FrameList(PyObject* audiotools_pcm,
                 unsigned channels,
@@ -38,10 +38,14 @@ PyObject*
 open_audiotools_pcm(void);
 
 /*returns a new FrameList object with the given size
-  meant for population by an audio decoding routine
+  meant for population by an audio decoding routine,
+  so its samples are left uninitialized
 
   returns NULL if some error occurs getting new FrameList
 
+  its samples array belongs to audiotools.pcm
+  and must not be freed or resized
+
   it can be cast to PyObject* for returning*/
 pcm_FrameList*
 new_FrameList(PyObject* audiotools_pcm,
@@ -49,6 +53,28 @@ new_FrameList(PyObject* audiotools_pcm,
               unsigned bits_per_sample,
               unsigned pcm_frames);
 
+/*works like new_FrameList, but its samples array is planar
+  with channel "c" occupying the "pcm_frames" entries
+  starting at samples[c * pcm_frames]
+
+  this lets decoders write each channel in place
+  rather than interleaving them with put_channel_data*/
+pcm_FrameList*
+new_planar_FrameList(PyObject* audiotools_pcm,
+                     unsigned channels,
+                     unsigned bits_per_sample,
+                     unsigned pcm_frames);
+
+/*works like new_FrameList, but its samples are stored
+  as 16-bit integers in "samples16" rather than in "samples"
+
+  bits_per_sample must be 16 or less*/
+pcm_FrameList*
+new_compact_FrameList(PyObject* audiotools_pcm,
+                      unsigned channels,
+                      unsigned bits_per_sample,
+                      unsigned pcm_frames);
+
 /*returns an empty FrameList object with the given number of channels
   typically returned at the end of a stream*/
 PyObject*
@@ -20,14 +20,21 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
-static int
-play_8_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
 
-static int
-play_16_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
+static const void*
+convert_8_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
 
-static int
-play_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
+static const void*
+convert_16_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
+
+static const void*
+convert_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist);
+
+static PyObject*
+raise_write_error(int status);
 
 static
 PyObject* ALSAAudio_new(PyTypeObject *type,
@@ -51,6 +58,7 @@ ALSAAudio_init(output_ALSAAudio *self, PyObject *args, PyObject *kwds)
     int bits_per_sample = 16;
     int error;
     snd_pcm_format_t output_format = SND_PCM_FORMAT_S16_LE;
+    struct alsa_feeder *feeder = &(self->feeder);
 
     self->framelist_type = NULL;
     self->output = NULL;
@@ -58,6 +66,18 @@ ALSAAudio_init(output_ALSAAudio *self, PyObject *args, PyObject *kwds)
     self->mixer_elem = NULL;
     self->buffer_size = 0;
 
+    feeder->started = 0;
+    pthread_mutex_init(&(feeder->mutex), NULL);
+    pthread_cond_init(&(feeder->filled), NULL);
+    pthread_cond_init(&(feeder->drained), NULL);
+    feeder->queue.data = NULL;
+    feeder->period = NULL;
+    feeder->busy = 0;
+    feeder->paused = 0;
+    feeder->device_paused = 0;
+    feeder->stop = 0;
+    feeder->error = 0;
+
     /*get FrameList type for comparison during .play() operation*/
     if ((audiotools_pcm = open_audiotools_pcm()) != NULL) {
         self->framelist_type = PyObject_GetAttrString(audiotools_pcm,
@@ -100,19 +120,22 @@ ALSAAudio_init(output_ALSAAudio *self, PyObject *args, PyObject *kwds)
     case 8:
         self->bits_per_sample = bits_per_sample;
         self->buffer.int8 = NULL;
-        self->play = play_8_bps;
+        self->convert = convert_8_bps;
+        self->frame_size = channels * sizeof(int8_t);
         output_format = SND_PCM_FORMAT_S8;
         break;
     case 16:
         self->bits_per_sample = bits_per_sample;
         self->buffer.int16 = NULL;
-        self->play = play_16_bps;
+        self->convert = convert_16_bps;
+        self->frame_size = channels * sizeof(int16_t);
         output_format = SND_PCM_FORMAT_S16;
         break;
     case 24:
         self->bits_per_sample = bits_per_sample;
         self->buffer.int32 = NULL;
-        self->play = play_24_bps;
+        self->convert = convert_24_bps;
+        self->frame_size = channels * sizeof(int32_t);
         output_format = SND_PCM_FORMAT_S32;
         //output_format = SND_PCM_FORMAT_FLOAT;
         break;
@@ -141,6 +164,26 @@ ALSAAudio_init(output_ALSAAudio *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
+    if ((ringbuffer_init(&(feeder->queue),
+                         (unsigned)((uint64_t)sample_rate *
+                                    self->frame_size *
+                                    ALSA_QUEUE_MILLISECONDS / 1000)) != 0) ||
+        ((feeder->period = malloc(ALSA_PERIOD_FRAMES *
+                                  self->frame_size)) == NULL)) {
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate output queue");
+        return -1;
+    }
+
+    if (pthread_create(&(feeder->thread),
+                       NULL,
+                       ALSAAudio_feed,
+                       self) == 0) {
+        feeder->started = 1;
+    } else {
+        PyErr_SetString(PyExc_IOError, "unable to start ALSA output thread");
+        return -1;
+    }
+
     if ((error = snd_mixer_open(&self->mixer, 0)) < 0) {
         /*unable to open ALSA mixer*/
         self->mixer = NULL;
@@ -202,8 +245,18 @@ find_playback_mixer_element(snd_mixer_t *mixer, const char *name)
 void
 ALSAAudio_dealloc(output_ALSAAudio *self)
 {
+    struct alsa_feeder *feeder = &(self->feeder);
+
     Py_XDECREF(self->framelist_type);
 
+    /*the thread must be gone before the PCM it writes to*/
+    ALSAAudio_stop(self);
+    ringbuffer_free(&(feeder->queue));
+    free(feeder->period);
+    pthread_mutex_destroy(&(feeder->mutex));
+    pthread_cond_destroy(&(feeder->filled));
+    pthread_cond_destroy(&(feeder->drained));
+
     if (self->output != NULL)
         snd_pcm_close(self->output);
     if (self->mixer != NULL)
@@ -228,7 +281,9 @@ static
 PyObject* ALSAAudio_play(output_ALSAAudio *self, PyObject *args)
 {
     pcm_FrameList *framelist;
-    PyThreadState *state;
+    struct alsa_feeder *feeder = &(self->feeder);
+    const uint8_t *data;
+    unsigned remaining;
     int status;
 
     if (!PyArg_ParseTuple(args, "O!", self->framelist_type, &framelist))
@@ -246,45 +301,77 @@ PyObject* ALSAAudio_play(output_ALSAAudio *self, PyObject *args)
         return NULL;
     }
 
-    state = PyEval_SaveThread();
-
-    if ((status = self->play(self, framelist)) != 0) {
-        switch (status) {
-            case EBADFD:
-                PyEval_RestoreThread(state);
-                PyErr_SetString(PyExc_IOError,
-                                "PCM not in correct state");
-                return NULL;
-            case EPIPE:
-                PyEval_RestoreThread(state);
-                PyErr_SetString(PyExc_IOError,
-                                "buffer underrun occurred");
-                return NULL;
-            case ESTRPIPE:
-                PyEval_RestoreThread(state);
-                PyErr_SetString(PyExc_IOError,
-                                "suspend event occurred");
-                return NULL;
-            default:
-                PyEval_RestoreThread(state);
-                PyErr_SetString(PyExc_IOError,
-                                "unknown ALSA write error");
-                return NULL;
+    if (!feeder->started) {
+        PyErr_SetString(PyExc_ValueError, "cannot play closed stream");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    data = self->convert(self, framelist);
+    remaining = framelist->frames * self->frame_size;
+
+    /*the queue itself needs no lock,
+      the mutex only lets each side sleep until the other catches up*/
+    pthread_mutex_lock(&(feeder->mutex));
+    while ((remaining > 0) && !feeder->error) {
+        /*only whole frames are queued,
+          so the thread never writes a partial one*/
+        unsigned space = ringbuffer_space(&(feeder->queue));
+        space -= (space % self->frame_size);
+
+        if (space > 0) {
+            unsigned written;
+
+            pthread_mutex_unlock(&(feeder->mutex));
+            written = ringbuffer_write(&(feeder->queue),
+                                       data,
+                                       MIN(space, remaining));
+            data += written;
+            remaining -= written;
+            pthread_mutex_lock(&(feeder->mutex));
+            pthread_cond_signal(&(feeder->filled));
+        } else {
+            pthread_cond_wait(&(feeder->drained), &(feeder->mutex));
         }
+    }
+    status = feeder->error;
+    feeder->error = 0;
+    pthread_mutex_unlock(&(feeder->mutex));
+    Py_END_ALLOW_THREADS
+
+    if (status != 0) {
+        /*the device failed on some earlier queued frames*/
+        return raise_write_error(status);
     } else {
-        PyEval_RestoreThread(state);
         Py_INCREF(Py_None);
         return Py_None;
     }
 }
 
-static int
-play_8_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
+static PyObject*
+raise_write_error(int status)
+{
+    switch (status) {
+    case EBADFD:
+        PyErr_SetString(PyExc_IOError, "PCM not in correct state");
+        return NULL;
+    case EPIPE:
+        PyErr_SetString(PyExc_IOError, "buffer underrun occurred");
+        return NULL;
+    case ESTRPIPE:
+        PyErr_SetString(PyExc_IOError, "suspend event occurred");
+        return NULL;
+    default:
+        PyErr_SetString(PyExc_IOError, "unknown ALSA write error");
+        return NULL;
+    }
+}
+
+static const void*
+convert_8_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 {
     unsigned i;
     const unsigned samples_length = FrameList_samples_length(framelist);
-    snd_pcm_uframes_t to_write = framelist->frames;
-    snd_pcm_sframes_t frames_written;
 
     /*resize internal buffer if needed*/
     if (self->buffer_size < samples_length) {
@@ -295,37 +382,22 @@ play_8_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 
     /*transfer framelist data to buffer*/
     for (i = 0; i < samples_length; i++) {
-        self->buffer.int8[i] = framelist->samples[i];
+        self->buffer.int8[i] = FrameList_sample(framelist, i);
     }
 
-    /*output data to ALSA*/
-    while (to_write > 0) {
-        frames_written = snd_pcm_writei(self->output,
-                                        self->buffer.int8,
-                                        to_write);
-        if (frames_written < 0) {
-            /*try to recover a single time*/
-            frames_written = snd_pcm_recover(self->output,
-                                             frames_written,
-                                             1);
-        }
-        if (frames_written >= 0) {
-            to_write -= frames_written;
-        } else {
-            return -frames_written;
-        }
-    }
-
-    return 0;
+    return self->buffer.int8;
 }
 
-static int
-play_16_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
+static const void*
+convert_16_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 {
     const unsigned samples_length = FrameList_samples_length(framelist);
     unsigned i;
-    snd_pcm_uframes_t to_write = framelist->frames;
-    snd_pcm_sframes_t frames_written;
+
+    if (framelist->storage_bits == 16) {
+        /*compact FrameLists can be queued as-is*/
+        return framelist->samples16;
+    }
 
     /*resize internal buffer if needed*/
     if (self->buffer_size < samples_length) {
@@ -336,37 +408,17 @@ play_16_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 
     /*transfer framelist data to buffer*/
     for (i = 0; i < samples_length; i++) {
-        self->buffer.int16[i] = framelist->samples[i];
+        self->buffer.int16[i] = FrameList_sample(framelist, i);
     }
 
-    /*output data to ALSA*/
-    while (to_write > 0) {
-        frames_written = snd_pcm_writei(self->output,
-                                        self->buffer.int16,
-                                        to_write);
-        if (frames_written < 0) {
-            /*try to recover a single time*/
-            frames_written = snd_pcm_recover(self->output,
-                                             frames_written,
-                                             1);
-        }
-        if (frames_written >= 0) {
-            to_write -= frames_written;
-        } else {
-            return -frames_written;
-        }
-    }
-
-    return 0;
+    return self->buffer.int16;
 }
 
-static int
-play_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
+static const void*
+convert_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 {
     const unsigned samples_length = FrameList_samples_length(framelist);
     unsigned i;
-    snd_pcm_uframes_t to_write = framelist->frames;
-    snd_pcm_sframes_t frames_written;
 
     /*resize internal buffer if needed*/
     if (self->buffer_size < samples_length) {
@@ -377,14 +429,78 @@ play_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
 
     /*transfer framelist data to buffer*/
     for (i = 0; i < samples_length; i++) {
-        self->buffer.int32[i] = (framelist->samples[i] << 8);
+        self->buffer.int32[i] = (FrameList_sample(framelist, i) << 8);
     }
 
-    /*output data to ALSA*/
-    while (to_write > 0) {
-        frames_written = snd_pcm_writei(self->output,
-                                        self->buffer.int32,
-                                        to_write);
+    return self->buffer.int32;
+}
+
+static void*
+ALSAAudio_feed(void *arg)
+{
+    output_ALSAAudio *self = arg;
+    struct alsa_feeder *feeder = &(self->feeder);
+    const unsigned period_size = ALSA_PERIOD_FRAMES * self->frame_size;
+    struct sched_param param;
+
+    /*run ahead of the rest of the process when permitted to,
+      otherwise an ordinary thread still isn't stalled by Python*/
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    pthread_mutex_lock(&(feeder->mutex));
+    while (!feeder->stop) {
+        unsigned bytes;
+        int status;
+
+        if (feeder->paused != feeder->device_paused) {
+            /*only this thread touches the PCM once it's running*/
+            snd_pcm_pause(self->output, feeder->paused);
+            feeder->device_paused = feeder->paused;
+            continue;
+        } else if (feeder->paused ||
+                   (ringbuffer_used(&(feeder->queue)) == 0)) {
+            pthread_cond_wait(&(feeder->filled), &(feeder->mutex));
+            continue;
+        }
+
+        feeder->busy = 1;
+        pthread_mutex_unlock(&(feeder->mutex));
+
+        /*free the queue space before blocking on the device
+          so play() can refill it in the meantime*/
+        bytes = ringbuffer_read(&(feeder->queue), feeder->period, period_size);
+        pthread_mutex_lock(&(feeder->mutex));
+        pthread_cond_signal(&(feeder->drained));
+        pthread_mutex_unlock(&(feeder->mutex));
+
+        status = ALSAAudio_write(self,
+                                 feeder->period,
+                                 bytes / self->frame_size);
+
+        pthread_mutex_lock(&(feeder->mutex));
+        feeder->busy = 0;
+        if (status != 0) {
+            feeder->error = status;
+        }
+        pthread_cond_signal(&(feeder->drained));
+    }
+    pthread_mutex_unlock(&(feeder->mutex));
+
+    return NULL;
+}
+
+static int
+ALSAAudio_write(output_ALSAAudio *self,
+                const void *frames,
+                snd_pcm_uframes_t pcm_frames)
+{
+    const uint8_t *data = frames;
+
+    while (pcm_frames > 0) {
+        snd_pcm_sframes_t frames_written = snd_pcm_writei(self->output,
+                                                          data,
+                                                          pcm_frames);
         if (frames_written < 0) {
             /*try to recover a single time*/
             frames_written = snd_pcm_recover(self->output,
@@ -392,7 +508,8 @@ play_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
                                              1);
         }
         if (frames_written >= 0) {
-            to_write -= frames_written;
+            data += frames_written * self->frame_size;
+            pcm_frames -= frames_written;
         } else {
             return -frames_written;
         }
@@ -401,10 +518,55 @@ play_24_bps(output_ALSAAudio *self, pcm_FrameList *framelist)
     return 0;
 }
 
+static void
+ALSAAudio_wait_drained(output_ALSAAudio *self)
+{
+    struct alsa_feeder *feeder = &(self->feeder);
+
+    pthread_mutex_lock(&(feeder->mutex));
+
+    /*a paused stream would never drain*/
+    if (feeder->paused) {
+        feeder->paused = 0;
+        pthread_cond_signal(&(feeder->filled));
+    }
+
+    while (feeder->started &&
+           ((ringbuffer_used(&(feeder->queue)) > 0) || feeder->busy)) {
+        pthread_cond_wait(&(feeder->drained), &(feeder->mutex));
+    }
+
+    pthread_mutex_unlock(&(feeder->mutex));
+}
+
+static void
+ALSAAudio_stop(output_ALSAAudio *self)
+{
+    struct alsa_feeder *feeder = &(self->feeder);
+    int started;
+
+    pthread_mutex_lock(&(feeder->mutex));
+    feeder->stop = 1;
+    started = feeder->started;
+    feeder->started = 0;
+    pthread_cond_signal(&(feeder->filled));
+    pthread_mutex_unlock(&(feeder->mutex));
+
+    if (started) {
+        pthread_join(feeder->thread, NULL);
+    }
+}
+
 static PyObject*
 ALSAAudio_pause(output_ALSAAudio *self, PyObject *args)
 {
-    snd_pcm_pause(self->output, 1);
+    struct alsa_feeder *feeder = &(self->feeder);
+
+    /*the feeder thread pauses the PCM between writes*/
+    pthread_mutex_lock(&(feeder->mutex));
+    feeder->paused = 1;
+    pthread_cond_signal(&(feeder->filled));
+    pthread_mutex_unlock(&(feeder->mutex));
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -413,7 +575,12 @@ ALSAAudio_pause(output_ALSAAudio *self, PyObject *args)
 static PyObject*
 ALSAAudio_resume(output_ALSAAudio *self, PyObject *args)
 {
-    snd_pcm_pause(self->output, 0);
+    struct alsa_feeder *feeder = &(self->feeder);
+
+    pthread_mutex_lock(&(feeder->mutex));
+    feeder->paused = 0;
+    pthread_cond_signal(&(feeder->filled));
+    pthread_mutex_unlock(&(feeder->mutex));
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -422,7 +589,10 @@ ALSAAudio_resume(output_ALSAAudio *self, PyObject *args)
 static PyObject*
 ALSAAudio_flush(output_ALSAAudio *self, PyObject *args)
 {
-    /*FIXME*/
+    Py_BEGIN_ALLOW_THREADS
+    ALSAAudio_wait_drained(self);
+    Py_END_ALLOW_THREADS
+
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -495,7 +665,16 @@ ALSAAudio_set_volume(output_ALSAAudio *self, PyObject *args)
 static PyObject*
 ALSAAudio_close(output_ALSAAudio *self, PyObject *args)
 {
-    /*FIXME*/
+    /*anything still queued is dropped, as with the device's own buffer*/
+    Py_BEGIN_ALLOW_THREADS
+    ALSAAudio_stop(self);
+    Py_END_ALLOW_THREADS
+
+    if (self->output != NULL) {
+        snd_pcm_close(self->output);
+        self->output = NULL;
+    }
+
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -1,7 +1,9 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <alsa/asoundlib.h>
+#include <pthread.h>
 #include "../framelist.h"
+#include "ringbuffer.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -23,12 +25,40 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+/*how much converted audio play() may queue ahead of the device*/
+#define ALSA_QUEUE_MILLISECONDS 1000
+
+/*the most PCM frames the feeder thread hands to ALSA at once*/
+#define ALSA_PERIOD_FRAMES 1024
+
+/*a thread which drains queued PCM frames into the device
+  so that play() only blocks when the queue is full*/
+struct alsa_feeder {
+    pthread_t thread;
+    int started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;    /*signaled when frames are queued
+                                or the thread has something else to do*/
+    pthread_cond_t drained;   /*signaled when frames are written*/
+
+    struct ringbuffer queue;
+    uint8_t *period;          /*frames being written to the device*/
+    int busy;                 /*set while the period is being written*/
+
+    int paused;               /*set by pause(), cleared by resume()*/
+    int device_paused;        /*the state the thread last set the PCM to*/
+    int stop;
+    int error;                /*errno from the last failed write, or 0*/
+};
+
 typedef struct output_ALSAAudio_s {
     PyObject_HEAD
 
     unsigned sample_rate;
     unsigned channels;
     unsigned bits_per_sample;
+    unsigned frame_size;      /*bytes per PCM frame in the device format*/
 
     unsigned buffer_size;
     union {
@@ -38,7 +68,9 @@ typedef struct output_ALSAAudio_s {
         //float *float32;
     } buffer;
 
-    int (*play)(struct output_ALSAAudio_s *self, pcm_FrameList *framelist);
+    /*returns the FrameList's samples in the device's format*/
+    const void* (*convert)(struct output_ALSAAudio_s *self,
+                           pcm_FrameList *framelist);
 
     PyObject *framelist_type;
     snd_pcm_t *output;
@@ -46,6 +78,8 @@ typedef struct output_ALSAAudio_s {
     snd_mixer_elem_t *mixer_elem;
     long volume_min;
     long volume_max;
+
+    struct alsa_feeder feeder;
 } output_ALSAAudio;
 
 static PyObject*
@@ -138,3 +172,22 @@ PyTypeObject output_ALSAAudioType = {
 
 static snd_mixer_elem_t*
 find_playback_mixer_element(snd_mixer_t *mixer, const char *name);
+
+/*the feeder thread's body*/
+static void*
+ALSAAudio_feed(void *arg);
+
+/*writes "pcm_frames" frames to the device,
+  returning 0 on success or a positive errno value*/
+static int
+ALSAAudio_write(output_ALSAAudio *self,
+                const void *frames,
+                snd_pcm_uframes_t pcm_frames);
+
+/*blocks until every queued frame has been written to the device*/
+static void
+ALSAAudio_wait_drained(output_ALSAAudio *self);
+
+/*stops and joins the feeder thread, if running*/
+static void
+ALSAAudio_stop(output_ALSAAudio *self);
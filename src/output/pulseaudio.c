@@ -51,6 +51,7 @@ static void success_callback(pa_stream *stream,
 
 static PyObject* PulseAudio_play(output_PulseAudio *self, PyObject *args)
 {
+    struct pulseaudio_feeder *feeder = &(self->feeder);
     uint8_t *data;
 #ifdef PY_SSIZE_T_CLEAN
     Py_ssize_t data_len;
@@ -61,38 +62,49 @@ static PyObject* PulseAudio_play(output_PulseAudio *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s#", &data, &data_len))
         return NULL;
 
-    /*ensure output stream is still running*/
-    /*FIXME*/
+    if (data_len % self->frame_size) {
+        PyErr_SetString(PyExc_ValueError,
+                        "data must contain whole PCM frames");
+        return NULL;
+    }
+
+    if (!feeder->started) {
+        PyErr_SetString(PyExc_ValueError, "cannot play closed stream");
+        return NULL;
+    }
+
+    /*queue data for the feeder thread,
+      which pushes it into the stream as the server makes room
 
-    /*Use polling interface to push data into stream.
-      The callback is mostly useless
-      because it doesn't allow us to adjust the data length
-      like CoreAudio's does.*/
+      the queue itself needs no lock,
+      the mutex only lets each side sleep until the other catches up*/
     Py_BEGIN_ALLOW_THREADS
-    pa_threaded_mainloop_lock(self->mainloop);
+    pthread_mutex_lock(&(feeder->mutex));
 
     while (data_len > 0) {
-        size_t writeable_len;
-
-        while ((writeable_len = pa_stream_writable_size(self->stream)) == 0) {
-            pa_threaded_mainloop_wait(self->mainloop);
+        /*only whole frames are queued,
+          so the thread never writes a partial one*/
+        unsigned space = ringbuffer_space(&(feeder->queue));
+        space -= (space % self->frame_size);
+
+        if (space > 0) {
+            unsigned written;
+
+            pthread_mutex_unlock(&(feeder->mutex));
+            written = ringbuffer_write(&(feeder->queue),
+                                       data,
+                                       space < (size_t)data_len ?
+                                       space : (unsigned)data_len);
+            data += written;
+            data_len -= written;
+            pthread_mutex_lock(&(feeder->mutex));
+            pthread_cond_signal(&(feeder->filled));
+        } else {
+            pthread_cond_wait(&(feeder->drained), &(feeder->mutex));
         }
-
-        if (writeable_len > (size_t)data_len)
-            writeable_len = data_len;
-
-        pa_stream_write(self->stream,
-                        data,
-                        writeable_len,
-                        NULL,
-                        0,
-                        PA_SEEK_RELATIVE);
-
-        data += writeable_len;
-        data_len -= writeable_len;
     }
 
-    pa_threaded_mainloop_unlock(self->mainloop);
+    pthread_mutex_unlock(&(feeder->mutex));
     Py_END_ALLOW_THREADS
 
     Py_INCREF(Py_None);
@@ -164,7 +176,8 @@ static PyObject* PulseAudio_flush(output_PulseAudio *self, PyObject *args)
 
     pa_threaded_mainloop_lock(self->mainloop);
 
-    /*uncork output stream, if necessary*/
+    /*uncork output stream, if necessary,
+      so the queue can empty into it*/
     if (pa_stream_is_corked(self->stream)) {
         op = pa_stream_cork(
             self->stream,
@@ -179,6 +192,14 @@ static PyObject* PulseAudio_flush(output_PulseAudio *self, PyObject *args)
         pa_operation_unref(op);
     }
 
+    pa_threaded_mainloop_unlock(self->mainloop);
+
+    Py_BEGIN_ALLOW_THREADS
+    PulseAudio_wait_drained(self);
+    Py_END_ALLOW_THREADS
+
+    pa_threaded_mainloop_lock(self->mainloop);
+
     /*drain output stream*/
     op = pa_stream_drain(
         self->stream,
@@ -297,7 +318,11 @@ static PyObject* PulseAudio_set_volume(output_PulseAudio *self, PyObject *args)
 
 static PyObject* PulseAudio_close(output_PulseAudio *self, PyObject *args)
 {
-    /*FIXME*/
+    /*anything still queued is dropped*/
+    Py_BEGIN_ALLOW_THREADS
+    PulseAudio_stop(self);
+    Py_END_ALLOW_THREADS
+
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -320,12 +345,21 @@ int PulseAudio_init(output_PulseAudio *self, PyObject *args, PyObject *kwds)
     int bits_per_sample;
     char *stream_name;
     pa_sample_spec sample_spec;
+    struct pulseaudio_feeder *feeder = &(self->feeder);
 
     self->mainloop = NULL;
     self->mainloop_api = NULL;
     self->context = NULL;
     self->stream = NULL;
 
+    feeder->started = 0;
+    pthread_mutex_init(&(feeder->mutex), NULL);
+    pthread_cond_init(&(feeder->filled), NULL);
+    pthread_cond_init(&(feeder->drained), NULL);
+    feeder->queue.data = NULL;
+    feeder->busy = 0;
+    feeder->stop = 0;
+
     if (!PyArg_ParseTuple(args, "iiis",
                           &sample_rate,
                           &channels,
@@ -354,12 +388,15 @@ int PulseAudio_init(output_PulseAudio *self, PyObject *args, PyObject *kwds)
     switch (bits_per_sample) {
     case 8:
         sample_spec.format = PA_SAMPLE_U8;
+        self->frame_size = channels;
         break;
     case 16:
         sample_spec.format = PA_SAMPLE_S16LE;
+        self->frame_size = channels * 2;
         break;
     case 24:
         sample_spec.format = PA_SAMPLE_S24LE;
+        self->frame_size = channels * 3;
         break;
     default:
         PyErr_SetString(
@@ -477,6 +514,25 @@ int PulseAudio_init(output_PulseAudio *self, PyObject *args, PyObject *kwds)
         }
     } while (1);
 
+    if (ringbuffer_init(&(feeder->queue),
+                        (unsigned)((uint64_t)sample_rate *
+                                   self->frame_size *
+                                   PULSEAUDIO_QUEUE_MILLISECONDS / 1000))) {
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate output queue");
+        goto error;
+    }
+
+    if (pthread_create(&(feeder->thread),
+                       NULL,
+                       PulseAudio_feed,
+                       self) == 0) {
+        feeder->started = 1;
+    } else {
+        PyErr_SetString(
+            PyExc_ValueError, "unable to start PulseAudio output thread");
+        goto error;
+    }
+
     pa_threaded_mainloop_unlock(self->mainloop);
 
     return 0;
@@ -488,6 +544,15 @@ error:
 
 void PulseAudio_dealloc(output_PulseAudio *self)
 {
+    struct pulseaudio_feeder *feeder = &(self->feeder);
+
+    /*the thread must be gone before the stream it writes to*/
+    PulseAudio_stop(self);
+    ringbuffer_free(&(feeder->queue));
+    pthread_mutex_destroy(&(feeder->mutex));
+    pthread_cond_destroy(&(feeder->filled));
+    pthread_cond_destroy(&(feeder->drained));
+
     /*disconnect stream*/
     if (self->stream != NULL) {
         pa_stream_disconnect(self->stream);
@@ -510,6 +575,117 @@ void PulseAudio_dealloc(output_PulseAudio *self)
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+static void* PulseAudio_feed(void *arg)
+{
+    output_PulseAudio *self = arg;
+    struct pulseaudio_feeder *feeder = &(self->feeder);
+    struct sched_param param;
+
+    /*run ahead of the rest of the process when permitted to,
+      otherwise an ordinary thread still isn't stalled by Python*/
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    pthread_mutex_lock(&(feeder->mutex));
+    while (!feeder->stop) {
+        unsigned queued;
+        size_t writable_len;
+
+        if ((queued = ringbuffer_used(&(feeder->queue))) == 0) {
+            pthread_cond_wait(&(feeder->filled), &(feeder->mutex));
+            continue;
+        }
+
+        feeder->busy = 1;
+        pthread_mutex_unlock(&(feeder->mutex));
+
+        /*PulseAudio_stop() sets "stop" before signaling the mainloop,
+          so checking it under the mainloop's lock is enough*/
+        pa_threaded_mainloop_lock(self->mainloop);
+        while (((writable_len = pa_stream_writable_size(self->stream)) == 0) &&
+               !feeder->stop) {
+            pa_threaded_mainloop_wait(self->mainloop);
+        }
+
+        if (feeder->stop) {
+            /*nothing more to do*/
+        } else if (writable_len == (size_t)-1) {
+            /*the stream has failed, so the queue can never empty*/
+            ringbuffer_discard(&(feeder->queue));
+        } else {
+            void *buffer;
+            size_t buffer_len = queued < writable_len ? queued : writable_len;
+
+            /*copy frames from the queue directly into the server's buffer*/
+            if (pa_stream_begin_write(self->stream,
+                                      &buffer,
+                                      &buffer_len) == 0) {
+                if (buffer_len > queued)
+                    buffer_len = queued;
+                buffer_len -= (buffer_len % self->frame_size);
+
+                if (buffer_len > 0) {
+                    buffer_len = ringbuffer_read(&(feeder->queue),
+                                                 buffer,
+                                                 (unsigned)buffer_len);
+                    pa_stream_write(self->stream,
+                                    buffer,
+                                    buffer_len,
+                                    NULL,
+                                    0,
+                                    PA_SEEK_RELATIVE);
+                } else {
+                    pa_stream_cancel_write(self->stream);
+                }
+            } else {
+                ringbuffer_discard(&(feeder->queue));
+            }
+        }
+        pa_threaded_mainloop_unlock(self->mainloop);
+
+        pthread_mutex_lock(&(feeder->mutex));
+        feeder->busy = 0;
+        pthread_cond_signal(&(feeder->drained));
+    }
+    pthread_mutex_unlock(&(feeder->mutex));
+
+    return NULL;
+}
+
+static void PulseAudio_wait_drained(output_PulseAudio *self)
+{
+    struct pulseaudio_feeder *feeder = &(self->feeder);
+
+    pthread_mutex_lock(&(feeder->mutex));
+    while (feeder->started &&
+           ((ringbuffer_used(&(feeder->queue)) > 0) || feeder->busy)) {
+        pthread_cond_wait(&(feeder->drained), &(feeder->mutex));
+    }
+    pthread_mutex_unlock(&(feeder->mutex));
+}
+
+static void PulseAudio_stop(output_PulseAudio *self)
+{
+    struct pulseaudio_feeder *feeder = &(self->feeder);
+    int started;
+
+    pthread_mutex_lock(&(feeder->mutex));
+    feeder->stop = 1;
+    started = feeder->started;
+    feeder->started = 0;
+    pthread_cond_signal(&(feeder->filled));
+    pthread_mutex_unlock(&(feeder->mutex));
+
+    if (started) {
+        /*the thread may be waiting on the server for room*/
+        pa_threaded_mainloop_lock(self->mainloop);
+        pa_threaded_mainloop_signal(self->mainloop, 0);
+        pa_threaded_mainloop_unlock(self->mainloop);
+
+        pthread_join(feeder->thread, NULL);
+    }
+}
+
 
 static void context_state_callback(pa_context *context,
                                    pa_threaded_mainloop* mainloop)
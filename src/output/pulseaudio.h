@@ -1,6 +1,8 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <pulse/pulseaudio.h>
+#include <pthread.h>
+#include "ringbuffer.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -22,6 +24,25 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+/*how much audio play() may queue ahead of the server*/
+#define PULSEAUDIO_QUEUE_MILLISECONDS 1000
+
+/*a thread which writes queued PCM frames to the stream
+  as the server makes room for them,
+  so that play() only blocks when the queue is full*/
+struct pulseaudio_feeder {
+    pthread_t thread;
+    int started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;    /*signaled when frames are queued*/
+    pthread_cond_t drained;   /*signaled when frames are written*/
+
+    struct ringbuffer queue;
+    int busy;                 /*set while frames are being written*/
+    int stop;
+};
+
 typedef struct {
     PyObject_HEAD
 
@@ -29,6 +50,9 @@ typedef struct {
     pa_mainloop_api* mainloop_api;
     pa_context* context;
     pa_stream* stream;
+
+    unsigned frame_size;      /*bytes per PCM frame*/
+    struct pulseaudio_feeder feeder;
 } output_PulseAudio;
 
 static PyObject* PulseAudio_play(output_PulseAudio *self, PyObject *args);
@@ -45,6 +69,15 @@ static PyObject* PulseAudio_new(PyTypeObject *type,
 void PulseAudio_dealloc(output_PulseAudio *self);
 int PulseAudio_init(output_PulseAudio *self, PyObject *args, PyObject *kwds);
 
+/*the feeder thread's body*/
+static void* PulseAudio_feed(void *arg);
+
+/*blocks until every queued frame has been written to the stream*/
+static void PulseAudio_wait_drained(output_PulseAudio *self);
+
+/*stops and joins the feeder thread, if running*/
+static void PulseAudio_stop(output_PulseAudio *self);
+
 PyGetSetDef PulseAudio_getseters[] = {
     {NULL}
 };
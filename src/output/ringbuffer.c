@@ -0,0 +1,113 @@
+#include "ringbuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+
+/*each side reads the other side's position with acquire semantics
+  and publishes its own with release semantics,
+  so the bytes are always visible before the position that covers them*/
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+int
+ringbuffer_init(struct ringbuffer *ring, unsigned size)
+{
+    unsigned rounded = 1;
+
+    while (rounded < size) {
+        rounded <<= 1;
+    }
+
+    ring->data = malloc(rounded);
+    ring->size = rounded;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return ring->data != NULL ? 0 : -1;
+}
+
+void
+ringbuffer_free(struct ringbuffer *ring)
+{
+    free(ring->data);
+    ring->data = NULL;
+    ring->size = 0;
+}
+
+unsigned
+ringbuffer_used(const struct ringbuffer *ring)
+{
+    return LOAD_ACQUIRE(&(ring->head)) - LOAD_ACQUIRE(&(ring->tail));
+}
+
+unsigned
+ringbuffer_space(const struct ringbuffer *ring)
+{
+    return ring->size - ringbuffer_used(ring);
+}
+
+unsigned
+ringbuffer_write(struct ringbuffer *ring, const void *data, unsigned len)
+{
+    const unsigned head = LOAD_RELAXED(&(ring->head));
+    const unsigned tail = LOAD_ACQUIRE(&(ring->tail));
+    const unsigned offset = head & (ring->size - 1);
+    unsigned first;
+
+    len = MIN(len, ring->size - (head - tail));
+
+    /*the write may wrap around the end of the buffer*/
+    first = MIN(len, ring->size - offset);
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, (const uint8_t*)data + first, len - first);
+
+    STORE_RELEASE(&(ring->head), head + len);
+    return len;
+}
+
+unsigned
+ringbuffer_read(struct ringbuffer *ring, void *data, unsigned len)
+{
+    const unsigned tail = LOAD_RELAXED(&(ring->tail));
+    const unsigned head = LOAD_ACQUIRE(&(ring->head));
+    const unsigned offset = tail & (ring->size - 1);
+    unsigned first;
+
+    len = MIN(len, head - tail);
+
+    first = MIN(len, ring->size - offset);
+    memcpy(data, ring->data + offset, first);
+    memcpy((uint8_t*)data + first, ring->data, len - first);
+
+    STORE_RELEASE(&(ring->tail), tail + len);
+    return len;
+}
+
+void
+ringbuffer_discard(struct ringbuffer *ring)
+{
+    STORE_RELEASE(&(ring->tail), LOAD_ACQUIRE(&(ring->head)));
+}
@@ -0,0 +1,69 @@
+#ifndef OUTPUT_RINGBUFFER_H
+#define OUTPUT_RINGBUFFER_H
+
+#include <stdint.h>
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*a lock-free ring of bytes between exactly one producer thread
+  (which calls ringbuffer_write) and exactly one consumer thread
+  (which calls ringbuffer_read)
+
+  "head" and "tail" are free-running byte counts
+  which only their own side ever stores to,
+  so neither side needs a lock to find how much it may touch*/
+struct ringbuffer {
+    uint8_t *data;
+    unsigned size;      /*always a power of 2*/
+    unsigned head;      /*total bytes written, stored by the producer*/
+    unsigned tail;      /*total bytes read, stored by the consumer*/
+};
+
+/*allocates a ring of at least "size" bytes
+  returns 0 on success, -1 if unable to allocate the buffer*/
+int
+ringbuffer_init(struct ringbuffer *ring, unsigned size);
+
+void
+ringbuffer_free(struct ringbuffer *ring);
+
+/*returns the number of bytes available to the consumer*/
+unsigned
+ringbuffer_used(const struct ringbuffer *ring);
+
+/*returns the number of bytes available to the producer*/
+unsigned
+ringbuffer_space(const struct ringbuffer *ring);
+
+/*copies up to "len" bytes into the ring from the producer's thread
+  and returns the number of bytes actually written*/
+unsigned
+ringbuffer_write(struct ringbuffer *ring, const void *data, unsigned len);
+
+/*copies up to "len" bytes out of the ring from the consumer's thread
+  and returns the number of bytes actually read*/
+unsigned
+ringbuffer_read(struct ringbuffer *ring, void *data, unsigned len);
+
+/*discards everything in the ring from the consumer's thread*/
+void
+ringbuffer_discard(struct ringbuffer *ring);
+
+#endif
@@ -41,9 +41,75 @@
 #endif
 #endif
 
+/*Python 3 always supports the new-style buffer protocol*/
+#ifndef Py_TPFLAGS_HAVE_NEWBUFFER
+#define Py_TPFLAGS_HAVE_NEWBUFFER 0
+#endif
+
+/*Python 2's buffer procs start with the old-style buffer functions*/
+#if PY_MAJOR_VERSION >= 3
+#define BUFFER_PROCS(getbuffer, releasebuffer) \
+    {(getbufferproc)getbuffer, (releasebufferproc)releasebuffer}
+#else
+#define BUFFER_PROCS(getbuffer, releasebuffer) \
+    {0, 0, 0, 0, (getbufferproc)getbuffer, (releasebufferproc)releasebuffer}
+#endif
+
+/*fills in a read-only buffer view of a frames * channels array
+  of "itemsize" byte items which lives as long as "obj"*/
+static int
+fill_sample_buffer(PyObject *obj,
+                   Py_buffer *view,
+                   int flags,
+                   void *samples,
+                   unsigned frames,
+                   unsigned channels,
+                   Py_ssize_t itemsize,
+                   char *format);
+
+/*decoders generate a new FrameList for nearly every frame they read,
+  so sample arrays are recycled through pools of power-of-two sized
+  blocks rather than going back to malloc/free every time
+
+  pools cover from 64 bytes up to 4 megabytes,
+  which is 65536 PCM frames of 8 channels of doubles,
+  and larger arrays are allocated and freed directly
+
+  like everything else here, the pools are protected by the GIL*/
+#define SAMPLE_POOL_MIN_CLASS 6
+#define SAMPLE_POOL_MAX_CLASS 22
+
+/*the maximum number of bytes kept idle in a single pool,
+  though every pool keeps at least SAMPLE_POOL_MIN_BLOCKS*/
+#define SAMPLE_POOL_BYTES (1 << 19)
+#define SAMPLE_POOL_MIN_BLOCKS 2
+
+/*returns an uninitialized array of at least "size" bytes
+  suitable for a FrameList or FloatFrameList's "samples" field
+  or NULL if unable to allocate one*/
+static void*
+samples_alloc(size_t size);
+
+/*returns an array from samples_alloc to its pool, if any
+  a NULL array is ignored*/
+static void
+samples_free(void *samples);
+
+/*recently deallocated FrameList and FloatFrameList objects
+  are kept for reuse by FrameList_create and FloatFrameList_create*/
+#define FRAMELIST_FREELIST_SIZE 256
+
+static pcm_FrameList *framelist_freelist[FRAMELIST_FREELIST_SIZE];
+static unsigned framelist_freelist_size = 0;
+
+static pcm_FloatFrameList *floatframelist_freelist[FRAMELIST_FREELIST_SIZE];
+static unsigned floatframelist_freelist_size = 0;
+
 PyMethodDef module_methods[] = {
     {"empty_framelist", (PyCFunction)FrameList_empty,
-     METH_VARARGS, "empty_framelist(channels, bits_per_sample) -> FrameList"},
+     METH_VARARGS,
+     "empty_framelist(channels, bits_per_sample, frames=0, compact=False)"
+     " -> FrameList"},
     {"from_list", (PyCFunction)FrameList_from_list,
      METH_VARARGS,
      "from_list(int_list, channels, bits_per_sample, is_signed) -> FrameList"},
@@ -61,6 +127,13 @@ PyMethodDef module_methods[] = {
     {"from_float_channels", (PyCFunction)FloatFrameList_from_channels,
      METH_VARARGS,
      "from_float_channels(floatframelist_list) -> FloatFrameList"},
+    {"conversion_kernels", (PyCFunction)pcm_conversion_kernels,
+     METH_NOARGS,
+     "conversion_kernels() -> [kernel name, ...] this CPU can run"},
+    {"use_conversion_kernels", (PyCFunction)pcm_use_conversion_kernels,
+     METH_VARARGS,
+     "use_conversion_kernels(name) -- limits sample conversion "
+     "to the named kernels and those before them"},
     {NULL}
 };
 
@@ -75,6 +148,8 @@ PyGetSetDef FrameList_getseters[] = {
      0, "channel count", NULL},
     {"bits_per_sample", (getter)FrameList_bits_per_sample,
      0, "bits per sample", NULL},
+    {"storage_bits", (getter)FrameList_storage_bits,
+     0, "bits per stored sample, and per buffer item", NULL},
     {NULL}  /* Sentinel */
 };
 
@@ -92,6 +167,10 @@ PyMethodDef FrameList_methods[] = {
      METH_VARARGS,
      "F.split(i) -> (FrameList,FrameList) -- "
      "splits the FrameList at the given index"},
+    {"compact", (PyCFunction)FrameList_compact,
+     METH_NOARGS,
+     "F.compact() -> FrameList -- "
+     "returns FrameList using 16-bit storage if possible"},
     {"to_float", (PyCFunction)FrameList_to_float,
      METH_NOARGS,
      "F.to_float() -> FloatFrameList"},
@@ -113,6 +192,9 @@ PyMethodDef FrameList_methods[] = {
     {NULL}
 };
 
+static PyBufferProcs pcm_FrameListType_as_buffer =
+    BUFFER_PROCS(FrameList_getbuffer, FrameList_releasebuffer);
+
 static PySequenceMethods pcm_FrameListType_as_sequence = {
     (lenfunc)FrameList_len,          /* sq_length */
     (binaryfunc)FrameList_concat,    /* sq_concat */
@@ -145,8 +227,9 @@ PyTypeObject pcm_FrameListType = {
     0,                         /*tp_str*/
     0,                         /*tp_getattro*/
     0,                         /*tp_setattro*/
-    0,                         /*tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    &pcm_FrameListType_as_buffer, /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE |
+    Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
     "FrameList(string, channels, bits_per_sample, is_big_endian, is_signed)",
     /* tp_doc */
     0,                         /* tp_traverse */
@@ -172,8 +255,18 @@ PyTypeObject pcm_FrameListType = {
 void
 FrameList_dealloc(pcm_FrameList* self)
 {
-    free(self->samples);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    if (self->parent) {
+        Py_DECREF(self->parent);
+    } else {
+        samples_free(self->samples);
+        samples_free(self->samples16);
+    }
+    if ((Py_TYPE(self) == &pcm_FrameListType) &&
+        (framelist_freelist_size < FRAMELIST_FREELIST_SIZE)) {
+        framelist_freelist[framelist_freelist_size++] = self;
+    } else {
+        Py_TYPE(self)->tp_free((PyObject*)self);
+    }
 }
 
 PyObject*
@@ -217,11 +310,33 @@ FrameList_init(pcm_FrameList *self, PyObject *args, PyObject *kwds)
                         "number of samples must be divisible by "
                         "bits-per-sample and number of channels");
         return -1;
+    } else if (self->bits_per_sample <= 16) {
+        /*CD audio and the like is stored compactly
+          at half the size of its 32-bit equivalent*/
+        const unsigned samples_length =
+            data_size / (self->bits_per_sample / 8);
+        self->frames = samples_length / self->channels;
+        self->storage_bits = 16;
+        self->samples16 = samples_alloc(sizeof(int16_t) * samples_length);
+        if (self->samples16 == NULL) {
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return -1;
+        }
+        pcm_to_int16_converter(self->bits_per_sample,
+                               is_big_endian,
+                               is_signed)(samples_length,
+                                          data,
+                                          self->samples16);
     } else {
         const unsigned samples_length =
             data_size / (self->bits_per_sample / 8);
         self->frames = samples_length / self->channels;
-        self->samples = malloc(sizeof(int) * samples_length);
+        self->storage_bits = 32;
+        self->samples = samples_alloc(sizeof(int) * samples_length);
+        if (self->samples == NULL) {
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return -1;
+        }
         pcm_to_int_f converter = pcm_to_int_converter(self->bits_per_sample,
                                                       is_big_endian,
                                                       is_signed);
@@ -240,7 +355,85 @@ FrameList_init(pcm_FrameList *self, PyObject *args, PyObject *kwds)
 pcm_FrameList*
 FrameList_create(void)
 {
-    return (pcm_FrameList*)_PyObject_New(&pcm_FrameListType);
+    pcm_FrameList *framelist;
+
+    if (framelist_freelist_size) {
+        framelist = framelist_freelist[--framelist_freelist_size];
+        PyObject_Init((PyObject*)framelist, &pcm_FrameListType);
+    } else {
+        framelist = (pcm_FrameList*)_PyObject_New(&pcm_FrameListType);
+    }
+    framelist->storage_bits = 32;
+    framelist->samples16 = NULL;
+    framelist->parent = NULL;
+    framelist->planar = 0;
+    return framelist;
+}
+
+/*rearranges a planar FrameList's samples into interleaved order
+  in place, which does nothing if they already are
+
+  planar FrameLists are only produced by decoders for other C code,
+  so most operations from Python simply interleave them first
+
+  returns 0 on success, or -1 with a MemoryError set
+  if no interleaved array could be allocated*/
+static int
+FrameList_interleave(pcm_FrameList *self)
+{
+    if (self->planar) {
+        const unsigned samples_length = FrameList_samples_length(self);
+        int *interleaved = samples_alloc(sizeof(int) * samples_length);
+        unsigned c;
+        unsigned i;
+
+        if (interleaved == NULL) {
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return -1;
+        }
+        for (c = 0; c < self->channels; c++) {
+            const int *channel = self->samples + (c * self->frames);
+            for (i = 0; i < self->frames; i++) {
+                interleaved[(i * self->channels) + c] = channel[i];
+            }
+        }
+        samples_free(self->samples);
+        self->samples = interleaved;
+        self->planar = 0;
+    }
+    return 0;
+}
+
+pcm_FrameList*
+FrameList_view(pcm_FrameList *self, unsigned offset, unsigned frames)
+{
+    pcm_FrameList *view;
+    /*views of views share the original owner
+      rather than building a chain of parents*/
+    PyObject *parent = self->parent ? self->parent : (PyObject*)self;
+
+    if (FrameList_interleave(self)) {
+        return NULL;
+    }
+    view = FrameList_create();
+
+    view->frames = frames;
+    view->channels = self->channels;
+    view->bits_per_sample = self->bits_per_sample;
+    view->storage_bits = self->storage_bits;
+    if (frames) {
+        if (self->storage_bits == 16) {
+            view->samples = NULL;
+            view->samples16 = self->samples16 + (offset * self->channels);
+        } else {
+            view->samples = self->samples + (offset * self->channels);
+        }
+        view->parent = parent;
+        Py_INCREF(parent);
+    } else {
+        view->samples = NULL;
+    }
+    return view;
 }
 
 PyObject*
@@ -248,9 +441,12 @@ FrameList_empty(PyObject *dummy, PyObject *args)
 {
     int channels;
     int bits_per_sample;
+    int frames = 0;
+    int compact = 0;
     pcm_FrameList *framelist;
 
-    if (!PyArg_ParseTuple(args, "ii", &channels, &bits_per_sample)) {
+    if (!PyArg_ParseTuple(args, "ii|ii",
+                          &channels, &bits_per_sample, &frames, &compact)) {
         return NULL;
     }
 
@@ -267,15 +463,67 @@ FrameList_empty(PyObject *dummy, PyObject *args)
         return NULL;
     }
 
-    framelist = FrameList_create();
-    framelist->frames = 0;
-    framelist->channels = (unsigned)channels;
-    framelist->bits_per_sample = (unsigned)bits_per_sample;
-    framelist->samples = NULL;
+    if (frames < 0) {
+        PyErr_SetString(PyExc_ValueError, "frames must be >= 0");
+        return NULL;
+    }
+
+    if ((framelist = FrameList_alloc((unsigned)channels,
+                                     (unsigned)bits_per_sample,
+                                     (unsigned)frames,
+                                     compact)) == NULL) {
+        return NULL;
+    }
+
+    if (framelist->storage_bits == 16) {
+        memset(framelist->samples16,
+               0,
+               sizeof(int16_t) * FrameList_samples_length(framelist));
+    } else if (frames) {
+        memset(framelist->samples,
+               0,
+               sizeof(int) * FrameList_samples_length(framelist));
+    }
 
     return (PyObject*)framelist;
 }
 
+pcm_FrameList*
+FrameList_alloc(unsigned channels,
+                unsigned bits_per_sample,
+                unsigned frames,
+                int compact)
+{
+    pcm_FrameList *framelist = FrameList_create();
+    const unsigned samples_length = frames * channels;
+
+    framelist->frames = frames;
+    framelist->channels = channels;
+    framelist->bits_per_sample = bits_per_sample;
+    framelist->samples = NULL;
+
+    if (frames == 0) {
+        return framelist;
+    } else if (compact && (bits_per_sample <= 16)) {
+        /*for C readers whose samples are 16-bit to begin with*/
+        framelist->storage_bits = 16;
+        framelist->samples16 =
+            samples_alloc(sizeof(int16_t) * samples_length);
+        if (framelist->samples16 != NULL) {
+            return framelist;
+        }
+    } else {
+        framelist->samples = samples_alloc(sizeof(int) * samples_length);
+        if (framelist->samples != NULL) {
+            return framelist;
+        }
+    }
+
+    Py_DECREF((PyObject*)framelist);
+    PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+    return NULL;
+}
+
 int
 FrameList_CheckExact(PyObject *o)
 {
@@ -300,6 +548,12 @@ FrameList_bits_per_sample(pcm_FrameList *self, void* closure)
     return Py_BuildValue("i", self->bits_per_sample);
 }
 
+PyObject*
+FrameList_storage_bits(pcm_FrameList *self, void* closure)
+{
+    return Py_BuildValue("i", self->storage_bits);
+}
+
 Py_ssize_t
 FrameList_len(pcm_FrameList *o)
 {
@@ -309,25 +563,26 @@ FrameList_len(pcm_FrameList *o)
 PyObject
 *FrameList_richcompare(PyObject *a, PyObject *b, int op)
 {
+    int equals;
+
     switch (op) {
     case Py_EQ:
-        if (FrameList_CheckExact(a) && FrameList_CheckExact(b) &&
-            FrameList_equals((pcm_FrameList*)a, (pcm_FrameList*)b)) {
+    case Py_NE:
+        if (FrameList_CheckExact(a) && FrameList_CheckExact(b)) {
+            if ((equals = FrameList_equals((pcm_FrameList*)a,
+                                           (pcm_FrameList*)b)) == -1) {
+                return NULL;
+            }
+        } else {
+            equals = 0;
+        }
+        if (equals == (op == Py_EQ)) {
             Py_INCREF(Py_True);
             return Py_True;
         } else {
             Py_INCREF(Py_False);
             return Py_False;
         }
-    case Py_NE:
-        if (FrameList_CheckExact(a) && FrameList_CheckExact(b) &&
-            FrameList_equals((pcm_FrameList*)a, (pcm_FrameList*)b)) {
-            Py_INCREF(Py_False);
-            return Py_False;
-        } else {
-            Py_INCREF(Py_True);
-            return Py_True;
-        }
     default:
         PyErr_SetString(PyExc_TypeError, "unsupported comparison");
         return NULL;
@@ -337,19 +592,40 @@ PyObject
 int
 FrameList_equals(pcm_FrameList *a, pcm_FrameList *b)
 {
-    return ((a->frames == b->frames) &&
-            (a->channels == b->channels) &&
-            (a->bits_per_sample == b->bits_per_sample) &&
-            (memcmp(a->samples,
-                    b->samples,
-                    sizeof(int) * FrameList_samples_length(a)) == 0));
+    const unsigned samples_length = FrameList_samples_length(a);
+
+    if (FrameList_interleave(a) || FrameList_interleave(b)) {
+        return -1;
+    }
+
+    if ((a->frames != b->frames) ||
+        (a->channels != b->channels) ||
+        (a->bits_per_sample != b->bits_per_sample)) {
+        return 0;
+    } else if (a->storage_bits != b->storage_bits) {
+        unsigned i;
+        for (i = 0; i < samples_length; i++) {
+            if (FrameList_sample(a, i) != FrameList_sample(b, i)) {
+                return 0;
+            }
+        }
+        return 1;
+    } else if (a->storage_bits == 16) {
+        return memcmp(a->samples16,
+                      b->samples16,
+                      sizeof(int16_t) * samples_length) == 0;
+    } else {
+        return memcmp(a->samples,
+                      b->samples,
+                      sizeof(int) * samples_length) == 0;
+    }
 }
 
 PyObject*
 FrameList_GetItem(pcm_FrameList *o, Py_ssize_t i)
 {
     if ((i >= 0) && (i < FrameList_samples_length(o))) {
-        return Py_BuildValue("i", o->samples[i]);
+        return Py_BuildValue("i", FrameList_sample(o, (unsigned)i));
     } else {
         PyErr_SetString(PyExc_IndexError, "index out of range");
         return NULL;
@@ -373,10 +649,16 @@ FrameList_frame(pcm_FrameList *self, PyObject *args)
     frame->frames = 1;
     frame->channels = self->channels;
     frame->bits_per_sample = self->bits_per_sample;
-    frame->samples = malloc(sizeof(int) * self->channels);
-    memcpy(frame->samples,
-           self->samples + (frame_number * self->channels),
-           sizeof(int) * self->channels);
+    frame->samples = samples_alloc(sizeof(int) * self->channels);
+    if (frame->samples == NULL) {
+        Py_DECREF((PyObject*)frame);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
+    FrameList_get_samples(self,
+                          frame_number * self->channels,
+                          self->channels,
+                          frame->samples);
     return (PyObject*)frame;
 }
 
@@ -398,11 +680,41 @@ FrameList_channel(pcm_FrameList *self, PyObject *args)
     channel->frames = self->frames;
     channel->channels = 1;
     channel->bits_per_sample = self->bits_per_sample;
-    channel->samples = malloc(sizeof(int) * self->frames);
-
-    for (i = 0; i < self->frames; i++) {
-        channel->samples[i] = \
-            self->samples[channel_number + (i * self->channels)];
+    if (self->storage_bits == 16) {
+        channel->storage_bits = 16;
+        channel->samples = NULL;
+        channel->samples16 = samples_alloc(sizeof(int16_t) * self->frames);
+        if (channel->samples16 == NULL) {
+            Py_DECREF((PyObject*)channel);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        for (i = 0; i < self->frames; i++) {
+            channel->samples16[i] =
+                self->samples16[channel_number + (i * self->channels)];
+        }
+    } else if (self->planar) {
+        /*planar channels are already contiguous*/
+        channel->samples = samples_alloc(sizeof(int) * self->frames);
+        if (channel->samples == NULL) {
+            Py_DECREF((PyObject*)channel);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        memcpy(channel->samples,
+               self->samples + (channel_number * self->frames),
+               sizeof(int) * self->frames);
+    } else {
+        channel->samples = samples_alloc(sizeof(int) * self->frames);
+        if (channel->samples == NULL) {
+            Py_DECREF((PyObject*)channel);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        for (i = 0; i < self->frames; i++) {
+            channel->samples[i] = \
+                self->samples[channel_number + (i * self->channels)];
+        }
     }
 
     return (PyObject*)channel;
@@ -418,11 +730,20 @@ FrameList_to_bytes(pcm_FrameList *self, PyObject *args)
     const Py_ssize_t bytes_size =
         ((self->bits_per_sample / 8) * samples_length);
 
-    if (!PyArg_ParseTuple(args, "ii", &is_big_endian, &is_signed)) {
+    if (FrameList_interleave(self)) {
+        return NULL;
+    } else if (!PyArg_ParseTuple(args, "ii", &is_big_endian, &is_signed)) {
         return NULL;
     } else if ((bytes_obj =
                 PyBytes_FromStringAndSize(NULL, bytes_size)) == NULL) {
         return NULL;
+    } else if (self->storage_bits == 16) {
+        int16_to_pcm_converter(
+            self->bits_per_sample,
+            is_big_endian,
+            is_signed)(samples_length,
+                       self->samples16,
+                       (unsigned char *)PyBytes_AsString(bytes_obj));
     } else {
         int_to_pcm_converter(
             self->bits_per_sample,
@@ -453,40 +774,21 @@ FrameList_split(pcm_FrameList *self, PyObject *args)
     } else if ((unsigned)split_point >= self->frames) {
         head = self;
         Py_INCREF(head);
-        tail = FrameList_create();
-        tail->frames = 0;
-        tail->channels = self->channels;
-        tail->bits_per_sample = self->bits_per_sample;
-        tail->samples = NULL;
+        tail = FrameList_view(self, self->frames, 0);
     } else if (split_point == 0) {
-        head = FrameList_create();
-        head->frames = 0;
-        head->channels = self->channels;
-        head->bits_per_sample = self->bits_per_sample;
-        head->samples = NULL;
+        head = FrameList_view(self, 0, 0);
         tail = self;
         Py_INCREF(tail);
     } else {
-        const unsigned head_samples_length =
-            split_point * self->channels;
-        const unsigned tail_samples_length =
-            (self->frames - split_point) * self->channels;
-        head = FrameList_create();
-        head->frames = split_point;
-        head->samples = malloc(head_samples_length * sizeof(int));
-        memcpy(head->samples,
-               self->samples,
-               head_samples_length * sizeof(int));
-
-        tail = FrameList_create();
-        tail->frames = (self->frames - split_point);
-        tail->samples = malloc(tail_samples_length * sizeof(int));
-        memcpy(tail->samples,
-               self->samples + head_samples_length,
-               tail_samples_length * sizeof(int));
-
-        head->channels = tail->channels = self->channels;
-        head->bits_per_sample = tail->bits_per_sample = self->bits_per_sample;
+        /*both halves share self's samples rather than copying them*/
+        head = FrameList_view(self, 0, split_point);
+        tail = FrameList_view(self, split_point, self->frames - split_point);
+    }
+
+    if ((head == NULL) || (tail == NULL)) {
+        Py_XDECREF(head);
+        Py_XDECREF(tail);
+        return NULL;
     }
 
     tuple = Py_BuildValue("(O,O)", head, tail);
@@ -523,17 +825,65 @@ FrameList_concat(pcm_FrameList *a, PyObject *bb)
         return NULL;
     }
 
+    if (a->parent && (a->parent == b->parent)) {
+        /*rejoining adjacent views of the same FrameList,
+          such as the halves of a split, needs no copy*/
+        pcm_FrameList *parent = (pcm_FrameList*)a->parent;
+        const unsigned a_samples_length = FrameList_samples_length(a);
+
+        if ((a->storage_bits == 16) &&
+            ((a->samples16 + a_samples_length) == b->samples16)) {
+            return (PyObject*)FrameList_view(
+                parent,
+                (unsigned)(a->samples16 - parent->samples16) /
+                parent->channels,
+                a->frames + b->frames);
+        } else if ((a->storage_bits == 32) &&
+                   ((a->samples + a_samples_length) == b->samples)) {
+            return (PyObject*)FrameList_view(
+                parent,
+                (unsigned)(a->samples - parent->samples) / parent->channels,
+                a->frames + b->frames);
+        }
+    }
+
     concat = FrameList_create();
     concat->frames = a->frames + b->frames;
     concat->channels = a->channels;
     concat->bits_per_sample = a->bits_per_sample;
-    concat->samples = malloc(FrameList_samples_length(concat) * sizeof(int));
-    memcpy(concat->samples,
-           a->samples,
-           FrameList_samples_length(a) * sizeof(int));
-    memcpy(concat->samples + FrameList_samples_length(a),
-           b->samples,
-           FrameList_samples_length(b) * sizeof(int));
+    if ((a->storage_bits == 16) && (b->storage_bits == 16)) {
+        concat->storage_bits = 16;
+        concat->samples = NULL;
+        concat->samples16 =
+            samples_alloc(FrameList_samples_length(concat) * sizeof(int16_t));
+        if (concat->samples16 == NULL) {
+            Py_DECREF((PyObject*)concat);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        memcpy(concat->samples16,
+               a->samples16,
+               FrameList_samples_length(a) * sizeof(int16_t));
+        memcpy(concat->samples16 + FrameList_samples_length(a),
+               b->samples16,
+               FrameList_samples_length(b) * sizeof(int16_t));
+    } else {
+        concat->samples =
+            samples_alloc(FrameList_samples_length(concat) * sizeof(int));
+        if (concat->samples == NULL) {
+            Py_DECREF((PyObject*)concat);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        FrameList_get_samples(a,
+                              0,
+                              FrameList_samples_length(a),
+                              concat->samples);
+        FrameList_get_samples(b,
+                              0,
+                              FrameList_samples_length(b),
+                              concat->samples + FrameList_samples_length(a));
+    }
 
     return (PyObject*)concat;
 }
@@ -541,42 +891,175 @@ FrameList_concat(pcm_FrameList *a, PyObject *bb)
 PyObject*
 FrameList_repeat(pcm_FrameList *a, Py_ssize_t i)
 {
-    pcm_FrameList *repeat = FrameList_create();
+    pcm_FrameList *repeat;
     Py_ssize_t j;
     const unsigned a_samples_length = FrameList_samples_length(a);
 
+    if (FrameList_interleave(a)) {
+        return NULL;
+    }
+
+    repeat = FrameList_create();
     repeat->frames = (unsigned int)(a->frames * i);
     repeat->channels = a->channels;
     repeat->bits_per_sample = a->bits_per_sample;
-    repeat->samples = malloc(sizeof(int) * FrameList_samples_length(repeat));
+    if (a->storage_bits == 16) {
+        repeat->storage_bits = 16;
+        repeat->samples = NULL;
+        repeat->samples16 =
+            samples_alloc(sizeof(int16_t) * FrameList_samples_length(repeat));
+        if (repeat->samples16 == NULL) {
+            Py_DECREF((PyObject*)repeat);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
 
-    for (j = 0; j < i; j++) {
-        memcpy(repeat->samples + (j * a_samples_length),
-               a->samples,
-               a_samples_length * sizeof(int));
+        for (j = 0; j < i; j++) {
+            memcpy(repeat->samples16 + (j * a_samples_length),
+                   a->samples16,
+                   a_samples_length * sizeof(int16_t));
+        }
+    } else {
+        repeat->samples =
+            samples_alloc(sizeof(int) * FrameList_samples_length(repeat));
+        if (repeat->samples == NULL) {
+            Py_DECREF((PyObject*)repeat);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+
+        for (j = 0; j < i; j++) {
+            memcpy(repeat->samples + (j * a_samples_length),
+                   a->samples,
+                   a_samples_length * sizeof(int));
+        }
     }
 
     return (PyObject*)repeat;
 }
 
 
+PyObject*
+FrameList_compact(pcm_FrameList *self, PyObject *args)
+{
+    const unsigned samples_length = FrameList_samples_length(self);
+    pcm_FrameList *compact;
+    unsigned i;
+
+    if (FrameList_interleave(self)) {
+        return NULL;
+    }
+
+    if ((self->storage_bits == 16) || (self->bits_per_sample > 16)) {
+        Py_INCREF((PyObject*)self);
+        return (PyObject*)self;
+    }
+
+    /*FrameLists built from lists may hold out-of-range values
+      which must be preserved as-is*/
+    for (i = 0; i < samples_length; i++) {
+        if ((self->samples[i] < INT16_MIN) || (self->samples[i] > INT16_MAX)) {
+            Py_INCREF((PyObject*)self);
+            return (PyObject*)self;
+        }
+    }
+
+    compact = FrameList_create();
+    compact->frames = self->frames;
+    compact->channels = self->channels;
+    compact->bits_per_sample = self->bits_per_sample;
+    compact->storage_bits = 16;
+    compact->samples = NULL;
+    if (samples_length) {
+        compact->samples16 = samples_alloc(sizeof(int16_t) * samples_length);
+        if (compact->samples16 == NULL) {
+            Py_DECREF((PyObject*)compact);
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return NULL;
+        }
+        for (i = 0; i < samples_length; i++) {
+            compact->samples16[i] = (int16_t)self->samples[i];
+        }
+    }
+
+    return (PyObject*)compact;
+}
+
 PyObject*
 FrameList_to_float(pcm_FrameList *self, PyObject *args)
 {
-    pcm_FloatFrameList *framelist = FloatFrameList_create();
+    pcm_FloatFrameList *framelist;
+    const int_to_double_f converter =
+        int_to_double_converter(self->bits_per_sample);
+    const unsigned samples_length = FrameList_samples_length(self);
+
+    if (FrameList_interleave(self)) {
+        return NULL;
+    }
+
+    framelist = FloatFrameList_create();
     framelist->frames = self->frames;
     framelist->channels = self->channels;
-    framelist->samples = malloc(sizeof(double) *
+    framelist->samples = samples_alloc(sizeof(double) *
                                 FloatFrameList_samples_length(framelist));
+    if (framelist->samples == NULL) {
+        Py_DECREF((PyObject*)framelist);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
+
+    if (self->storage_bits == 16) {
+        /*widen compact samples a chunk at a time*/
+        int chunk[4096];
+        unsigned i;
 
-    int_to_double_converter(self->bits_per_sample)(
-        FloatFrameList_samples_length(framelist),
-        self->samples,
-        framelist->samples);
+        for (i = 0; i < samples_length; i += 4096) {
+            const unsigned to_convert = MIN(samples_length - i, 4096);
+            FrameList_get_samples(self, i, to_convert, chunk);
+            converter(to_convert, chunk, framelist->samples + i);
+        }
+    } else {
+        converter(samples_length, self->samples, framelist->samples);
+    }
 
     return (PyObject*)framelist;
 }
 
+int
+FrameList_getbuffer(pcm_FrameList *self, Py_buffer *view, int flags)
+{
+    if (FrameList_interleave(self)) {
+        view->obj = NULL;
+        return -1;
+    }
+
+    if (self->storage_bits == 16) {
+        return fill_sample_buffer((PyObject*)self,
+                                  view,
+                                  flags,
+                                  self->samples16,
+                                  self->frames,
+                                  self->channels,
+                                  sizeof(int16_t),
+                                  "h");
+    }
+
+    return fill_sample_buffer((PyObject*)self,
+                              view,
+                              flags,
+                              self->samples,
+                              self->frames,
+                              self->channels,
+                              sizeof(int),
+                              "i");
+}
+
+void
+FrameList_releasebuffer(pcm_FrameList *self, Py_buffer *view)
+{
+    PyMem_Free(view->internal);
+}
+
 PyObject*
 FrameList_frame_count(pcm_FrameList *self, PyObject *args)
 {
@@ -649,7 +1132,12 @@ FrameList_from_list(PyObject *dummy, PyObject *args)
     framelist = FrameList_create();
     framelist->channels = channels;
     framelist->bits_per_sample = bits_per_sample;
-    framelist->samples = malloc(sizeof(int) * list_len);
+    framelist->samples = samples_alloc(sizeof(int) * list_len);
+    if (framelist->samples == NULL) {
+        Py_DECREF((PyObject*)framelist);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
     framelist->frames = (unsigned int)list_len / framelist->channels;
     for (i = 0; i < list_len; i++) {
         PyObject *integer_obj;
@@ -714,11 +1202,18 @@ FrameList_from_frames(PyObject *dummy, PyObject *args)
     output_frame->channels = initial_frame->channels;
     output_frame->bits_per_sample = initial_frame->bits_per_sample;
     output_frame->samples =
-        malloc(sizeof(int) * FrameList_samples_length(output_frame));
+        samples_alloc(sizeof(int) * FrameList_samples_length(output_frame));
+    if (output_frame->samples == NULL) {
+        Py_DECREF((PyObject*)output_frame);
+        Py_DECREF(initial_frame_obj);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
-    memcpy(output_frame->samples,
-           initial_frame->samples,
-           sizeof(int) * FrameList_samples_length(initial_frame));
+    FrameList_get_samples(initial_frame,
+                          0,
+                          FrameList_samples_length(initial_frame),
+                          output_frame->samples);
 
     /*we're done with initial frame*/
     Py_DECREF((PyObject*)initial_frame);
@@ -769,9 +1264,11 @@ FrameList_from_frames(PyObject *dummy, PyObject *args)
             return NULL;
         }
 
-        memcpy(output_frame->samples + (i * output_frame->channels),
-               list_frame->samples,
-               sizeof(int) * FrameList_samples_length(list_frame));
+        FrameList_get_samples(list_frame,
+                              0,
+                              FrameList_samples_length(list_frame),
+                              output_frame->samples +
+                              (i * output_frame->channels));
 
         Py_DECREF(list_frame_obj);
     }
@@ -825,10 +1322,17 @@ FrameList_from_channels(PyObject *dummy, PyObject *args)
     output_frame->channels = (unsigned int)list_len;
     output_frame->bits_per_sample = initial_frame->bits_per_sample;
     output_frame->samples =
-        malloc(sizeof(int) * FrameList_samples_length(output_frame));
+        samples_alloc(sizeof(int) * FrameList_samples_length(output_frame));
+    if (output_frame->samples == NULL) {
+        Py_DECREF((PyObject*)output_frame);
+        Py_DECREF(initial_frame_obj);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     for (j = 0; j < FrameList_samples_length(initial_frame); j++) {
-        output_frame->samples[j * list_len] = initial_frame->samples[j];
+        output_frame->samples[j * list_len] =
+            FrameList_sample(initial_frame, j);
     }
 
     /*we're done with initial frame*/
@@ -881,7 +1385,8 @@ FrameList_from_channels(PyObject *dummy, PyObject *args)
 
 
         for (j = 0; j < FrameList_samples_length(list_frame); j++) {
-            output_frame->samples[(j * list_len) + i] = list_frame->samples[j];
+            output_frame->samples[(j * list_len) + i] =
+                FrameList_sample(list_frame, j);
         }
 
         Py_DECREF(list_frame_obj);
@@ -890,6 +1395,65 @@ FrameList_from_channels(PyObject *dummy, PyObject *args)
     return (PyObject*)output_frame;
 }
 
+/*names of each pcm_conv_isa_t, in order*/
+static const char *conversion_kernel_names[] =
+    {"scalar", "sse2", "ssse3", "avx", "avx2", NULL};
+
+PyObject*
+pcm_conversion_kernels(PyObject *dummy, PyObject *args)
+{
+    const pcm_conv_isa_t supported = pcm_conv_supported_isa();
+    PyObject *kernels = PyList_New(0);
+    int i;
+
+    if (kernels == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i <= (int)supported; i++) {
+#if PY_MAJOR_VERSION >= 3
+        PyObject *name = PyUnicode_FromString(conversion_kernel_names[i]);
+#else
+        PyObject *name = PyString_FromString(conversion_kernel_names[i]);
+#endif
+        if ((name == NULL) || (PyList_Append(kernels, name) == -1)) {
+            Py_XDECREF(name);
+            Py_DECREF(kernels);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+
+    return kernels;
+}
+
+PyObject*
+pcm_use_conversion_kernels(PyObject *dummy, PyObject *args)
+{
+    char *name;
+    int i;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    }
+
+    for (i = 0; conversion_kernel_names[i] != NULL; i++) {
+        if (!strcmp(name, conversion_kernel_names[i])) {
+            break;
+        }
+    }
+
+    if ((conversion_kernel_names[i] == NULL) ||
+        (i > (int)pcm_conv_supported_isa())) {
+        PyErr_SetString(PyExc_ValueError, "unavailable conversion kernels");
+        return NULL;
+    }
+
+    pcm_conv_limit_isa((pcm_conv_isa_t)i);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 int
 FrameList_converter(PyObject* obj, void** framelist)
 {
@@ -935,6 +1499,9 @@ PyMethodDef FloatFrameList_methods[] = {
     {NULL}
 };
 
+static PyBufferProcs pcm_FloatFrameListType_as_buffer =
+    BUFFER_PROCS(FloatFrameList_getbuffer, FloatFrameList_releasebuffer);
+
 static PySequenceMethods pcm_FloatFrameListType_as_sequence = {
     (lenfunc)FloatFrameList_len,          /* sq_length */
     (binaryfunc)FloatFrameList_concat,    /* sq_concat */
@@ -967,8 +1534,9 @@ PyTypeObject pcm_FloatFrameListType = {
     0,                         /*tp_str*/
     0,                         /*tp_getattro*/
     0,                         /*tp_setattro*/
-    0,                         /*tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    &pcm_FloatFrameListType_as_buffer, /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE |
+    Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
     "FloatFrameList(float_list, channels)",  /* tp_doc */
     0,                         /* tp_traverse */
     0,                         /* tp_clear */
@@ -992,8 +1560,17 @@ PyTypeObject pcm_FloatFrameListType = {
 void
 FloatFrameList_dealloc(pcm_FloatFrameList* self)
 {
-    free(self->samples);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    if (self->parent) {
+        Py_DECREF(self->parent);
+    } else {
+        samples_free(self->samples);
+    }
+    if ((Py_TYPE(self) == &pcm_FloatFrameListType) &&
+        (floatframelist_freelist_size < FRAMELIST_FREELIST_SIZE)) {
+        floatframelist_freelist[floatframelist_freelist_size++] = self;
+    } else {
+        Py_TYPE(self)->tp_free((PyObject*)self);
+    }
 }
 
 PyObject*
@@ -1031,7 +1608,12 @@ FloatFrameList_init(pcm_FloatFrameList *self, PyObject *args, PyObject *kwds)
         return -1;
     } else {
         self->frames = ((unsigned int)data_size / self->channels);
-        self->samples = malloc(sizeof(double) * (unsigned int)data_size);
+        self->samples =
+            samples_alloc(sizeof(double) * (unsigned int)data_size);
+        if (self->samples == NULL) {
+            PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+            return -1;
+        }
     }
 
     for (i = 0; i < data_size; i++) {
@@ -1054,7 +1636,37 @@ FloatFrameList_init(pcm_FloatFrameList *self, PyObject *args, PyObject *kwds)
 pcm_FloatFrameList*
 FloatFrameList_create(void)
 {
-    return (pcm_FloatFrameList*)_PyObject_New(&pcm_FloatFrameListType);
+    pcm_FloatFrameList *framelist;
+
+    if (floatframelist_freelist_size) {
+        framelist = floatframelist_freelist[--floatframelist_freelist_size];
+        PyObject_Init((PyObject*)framelist, &pcm_FloatFrameListType);
+    } else {
+        framelist =
+            (pcm_FloatFrameList*)_PyObject_New(&pcm_FloatFrameListType);
+    }
+    framelist->parent = NULL;
+    return framelist;
+}
+
+pcm_FloatFrameList*
+FloatFrameList_view(pcm_FloatFrameList *self,
+                    unsigned offset,
+                    unsigned frames)
+{
+    pcm_FloatFrameList *view = FloatFrameList_create();
+    PyObject *parent = self->parent ? self->parent : (PyObject*)self;
+
+    view->frames = frames;
+    view->channels = self->channels;
+    if (frames) {
+        view->samples = self->samples + (offset * self->channels);
+        view->parent = parent;
+        Py_INCREF(parent);
+    } else {
+        view->samples = NULL;
+    }
+    return view;
 }
 
 PyObject*
@@ -1172,7 +1784,12 @@ FloatFrameList_frame(pcm_FloatFrameList *self, PyObject *args)
     frame = FloatFrameList_create();
     frame->frames = 1;
     frame->channels = self->channels;
-    frame->samples = malloc(sizeof(double) * self->channels);
+    frame->samples = samples_alloc(sizeof(double) * self->channels);
+    if (frame->samples == NULL) {
+        Py_DECREF((PyObject*)frame);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
     memcpy(frame->samples,
            self->samples + (frame_number * self->channels),
            sizeof(double) * self->channels);
@@ -1198,7 +1815,12 @@ FloatFrameList_channel(pcm_FloatFrameList *self, PyObject *args)
     channel = FloatFrameList_create();
     channel->frames = self->frames;
     channel->channels = 1;
-    channel->samples = malloc(sizeof(double) * self->frames);
+    channel->samples = samples_alloc(sizeof(double) * self->frames);
+    if (channel->samples == NULL) {
+        Py_DECREF((PyObject*)channel);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     samples_length = FloatFrameList_samples_length(self);
     total_channels = self->channels;
@@ -1231,7 +1853,12 @@ FloatFrameList_to_int(pcm_FloatFrameList *self, PyObject *args)
     framelist->channels = self->channels;
     framelist->bits_per_sample = bits_per_sample;
     framelist->samples =
-        malloc(sizeof(int) * FrameList_samples_length(framelist));
+        samples_alloc(sizeof(int) * FrameList_samples_length(framelist));
+    if (framelist->samples == NULL) {
+        Py_DECREF((PyObject*)framelist);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     converter(FloatFrameList_samples_length(self),
               self->samples,
@@ -1258,37 +1885,16 @@ FloatFrameList_split(pcm_FloatFrameList *self, PyObject *args)
     } else if ((unsigned)split_point >= self->frames) {
         head = self;
         Py_INCREF(head);
-        tail = FloatFrameList_create();
-        tail->frames = 0;
-        tail->channels = self->channels;
-        tail->samples = NULL;
+        tail = FloatFrameList_view(self, self->frames, 0);
     } else if (split_point == 0) {
-        head = FloatFrameList_create();
-        head->frames = 0;
-        head->channels = self->channels;
-        head->samples = NULL;
+        head = FloatFrameList_view(self, 0, 0);
         tail = self;
         Py_INCREF(tail);
     } else {
-        const unsigned head_samples_length =
-            split_point * self->channels;
-        const unsigned tail_samples_length =
-            (self->frames - split_point) * self->channels;
-        head = FloatFrameList_create();
-        head->frames = split_point;
-        head->samples = malloc(head_samples_length * sizeof(double));
-        memcpy(head->samples,
-               self->samples,
-               head_samples_length * sizeof(double));
-
-        tail = FloatFrameList_create();
-        tail->frames = (self->frames - split_point);
-        tail->samples = malloc(tail_samples_length * sizeof(double));
-        memcpy(tail->samples,
-               self->samples + head_samples_length,
-               tail_samples_length * sizeof(double));
-
-        head->channels = tail->channels = self->channels;
+        head = FloatFrameList_view(self, 0, split_point);
+        tail = FloatFrameList_view(self,
+                                   split_point,
+                                   self->frames - split_point);
     }
 
     tuple = Py_BuildValue("(O,O)", head, tail);
@@ -1319,11 +1925,25 @@ FloatFrameList_concat(pcm_FloatFrameList *a, PyObject *bb)
         return NULL;
     }
 
+    if (a->parent && (a->parent == b->parent) &&
+        ((a->samples + FloatFrameList_samples_length(a)) == b->samples)) {
+        pcm_FloatFrameList *parent = (pcm_FloatFrameList*)a->parent;
+        return (PyObject*)FloatFrameList_view(
+            parent,
+            (unsigned)(a->samples - parent->samples) / parent->channels,
+            a->frames + b->frames);
+    }
+
     concat = FloatFrameList_create();
     concat->frames = a->frames + b->frames;
     concat->channels = a->channels;
     concat->samples =
-        malloc(FloatFrameList_samples_length(concat) * sizeof(double));
+        samples_alloc(FloatFrameList_samples_length(concat) * sizeof(double));
+    if (concat->samples == NULL) {
+        Py_DECREF((PyObject*)concat);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
     memcpy(concat->samples,
            a->samples,
            FloatFrameList_samples_length(a) * sizeof(double));
@@ -1345,7 +1965,12 @@ FloatFrameList_repeat(pcm_FloatFrameList *a, Py_ssize_t i)
     repeat->frames = (unsigned int)(a->frames * i);
     repeat->channels = a->channels;
     repeat->samples =
-        malloc(sizeof(double) * FloatFrameList_samples_length(repeat));
+        samples_alloc(sizeof(double) * FloatFrameList_samples_length(repeat));
+    if (repeat->samples == NULL) {
+        Py_DECREF((PyObject*)repeat);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     for (j = 0; j < i; j++) {
         memcpy(repeat->samples + (j * a_samples_length),
@@ -1400,7 +2025,14 @@ FloatFrameList_from_frames(PyObject *dummy, PyObject *args)
     output_frame->frames = (unsigned int)list_len;
     output_frame->channels = initial_frame->channels;
     output_frame->samples =
-        malloc(sizeof(double) * FloatFrameList_samples_length(output_frame));
+        samples_alloc(sizeof(double) *
+                      FloatFrameList_samples_length(output_frame));
+    if (output_frame->samples == NULL) {
+        Py_DECREF((PyObject*)output_frame);
+        Py_DECREF(initial_frame_obj);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     memcpy(output_frame->samples,
            initial_frame->samples,
@@ -1499,7 +2131,14 @@ FloatFrameList_from_channels(PyObject *dummy, PyObject *args)
     output_frame->frames = initial_frame->frames;
     output_frame->channels = (unsigned int)list_len;
     output_frame->samples =
-        malloc(sizeof(double) * FloatFrameList_samples_length(output_frame));
+        samples_alloc(sizeof(double) *
+                      FloatFrameList_samples_length(output_frame));
+    if (output_frame->samples == NULL) {
+        Py_DECREF((PyObject*)output_frame);
+        Py_DECREF(initial_frame_obj);
+        PyErr_SetString(PyExc_MemoryError, "unable to allocate samples");
+        return NULL;
+    }
 
     for (j = 0; j < FloatFrameList_samples_length(initial_frame); j++) {
         output_frame->samples[j * list_len] = initial_frame->samples[j];
@@ -1567,6 +2206,156 @@ FloatFrameList_converter(PyObject* obj, void** floatframelist)
     }
 }
 
+int
+FloatFrameList_getbuffer(pcm_FloatFrameList *self,
+                         Py_buffer *view,
+                         int flags)
+{
+    return fill_sample_buffer((PyObject*)self,
+                              view,
+                              flags,
+                              self->samples,
+                              self->frames,
+                              self->channels,
+                              sizeof(double),
+                              "d");
+}
+
+void
+FloatFrameList_releasebuffer(pcm_FloatFrameList *self, Py_buffer *view)
+{
+    PyMem_Free(view->internal);
+}
+
+static int
+fill_sample_buffer(PyObject *obj,
+                   Py_buffer *view,
+                   int flags,
+                   void *samples,
+                   unsigned frames,
+                   unsigned channels,
+                   Py_ssize_t itemsize,
+                   char *format)
+{
+    /*empty FrameLists have no samples array,
+      but consumers expect a valid pointer regardless*/
+    static double no_samples[1];
+    Py_ssize_t *dimensions;
+
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "FrameList is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+
+    /*shape and strides, released along with the view*/
+    if ((dimensions = PyMem_Malloc(sizeof(Py_ssize_t) * 4)) == NULL) {
+        PyErr_NoMemory();
+        view->obj = NULL;
+        return -1;
+    }
+    dimensions[0] = frames;
+    dimensions[1] = channels;
+    dimensions[2] = itemsize * channels;
+    dimensions[3] = itemsize;
+
+    view->buf = samples ? samples : no_samples;
+    view->obj = obj;
+    Py_INCREF(obj);
+    view->len = itemsize * frames * channels;
+    view->readonly = 1;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? format : NULL;
+    if (flags & PyBUF_ND) {
+        view->ndim = 2;
+        view->shape = dimensions;
+    } else {
+        /*consumers not asking for a shape get a flat block of bytes*/
+        view->ndim = 1;
+        view->shape = NULL;
+    }
+    view->strides =
+        ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? dimensions + 2 : NULL;
+    view->suboffsets = NULL;
+    view->internal = dimensions;
+
+    return 0;
+}
+
+/*each pooled array is preceded by a header
+  which links it into its pool while it's idle
+  and records which pool it returns to,
+  padded such that the array itself remains 16 byte aligned*/
+struct sample_block {
+    struct sample_block *next;
+    unsigned size_class;    /*log2 of the array's size in bytes,
+                              or 0 if the array isn't pooled*/
+};
+
+#define SAMPLE_BLOCK_HEADER 16
+
+static struct {
+    struct sample_block *blocks;
+    unsigned count;
+} sample_pools[SAMPLE_POOL_MAX_CLASS + 1];
+
+static void*
+samples_alloc(size_t size)
+{
+    unsigned size_class = SAMPLE_POOL_MIN_CLASS;
+    struct sample_block *block;
+
+    while ((size_class <= SAMPLE_POOL_MAX_CLASS) &&
+           (((size_t)1 << size_class) < size)) {
+        size_class++;
+    }
+
+    if (size_class > SAMPLE_POOL_MAX_CLASS) {
+        /*too large to pool*/
+        if ((block = malloc(SAMPLE_BLOCK_HEADER + size)) == NULL) {
+            return NULL;
+        }
+        block->size_class = 0;
+    } else if (sample_pools[size_class].blocks) {
+        block = sample_pools[size_class].blocks;
+        sample_pools[size_class].blocks = block->next;
+        sample_pools[size_class].count--;
+    } else {
+        if ((block = malloc(SAMPLE_BLOCK_HEADER +
+                            ((size_t)1 << size_class))) == NULL) {
+            return NULL;
+        }
+        block->size_class = size_class;
+    }
+
+    return (unsigned char*)block + SAMPLE_BLOCK_HEADER;
+}
+
+static void
+samples_free(void *samples)
+{
+    struct sample_block *block;
+    unsigned size_class;
+
+    if (samples == NULL) {
+        return;
+    }
+
+    block = (struct sample_block*)((unsigned char*)samples -
+                                   SAMPLE_BLOCK_HEADER);
+    size_class = block->size_class;
+
+    if (size_class &&
+        (sample_pools[size_class].count <
+         MAX(SAMPLE_POOL_MIN_BLOCKS, SAMPLE_POOL_BYTES >> size_class))) {
+        block->next = sample_pools[size_class].blocks;
+        sample_pools[size_class].blocks = block;
+        sample_pools[size_class].count++;
+    } else {
+        free(block);
+    }
+}
+
 MOD_INIT(pcm)
 {
     PyObject* m;
@@ -1591,6 +2380,11 @@ MOD_INIT(pcm)
     PyModule_AddObject(m, "FloatFrameList",
                        (PyObject *)&pcm_FloatFrameListType);
 
+    PyModule_AddObject(m, "_framelist_alloc",
+                       PyCapsule_New((void*)FrameList_alloc,
+                                     PCM_FRAMELIST_ALLOC,
+                                     NULL));
+
     return MOD_SUCCESS_VAL(m);
 }
 
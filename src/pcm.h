@@ -1,6 +1,7 @@
 #ifndef PCM_H
 #define PCM_H
 
+#include <string.h>
 #include "pcm_conv.h"
 
 /********************************************************
@@ -38,9 +39,33 @@ typedef struct {
                              aka the total number of columns in "samples*/
     unsigned int bits_per_sample; /*the maximum size of each sample, in bits*/
 
+    unsigned int storage_bits; /*32 if the samples are in "samples"
+                                 or 16 if they're in "samples16"
+                                 which is only possible for FrameLists
+                                 of 16 bits-per-sample or less*/
+
     int* samples;            /*the actual sample data itself,
                                stored raw as 32-bit signed integers
-                               whose total length is frames * channels*/
+                               whose total length is frames * channels,
+                               or NULL if stored in "samples16"*/
+
+    int16_t* samples16;      /*the same sample data stored compactly
+                               as 16-bit signed integers,
+                               or NULL if stored in "samples"*/
+
+    PyObject* parent;        /*if this FrameList is a view of another
+                               FrameList's samples, the FrameList
+                               which owns them, or NULL if this
+                               FrameList owns "samples" itself*/
+
+    unsigned int planar;     /*1 if "samples" is stored channel-major,
+                               with channel "c" occupying
+                               samples[c * frames] to
+                               samples[(c + 1) * frames - 1],
+                               or 0 if stored interleaved frame by frame
+
+                               planar FrameLists are never views
+                               and never use "samples16"*/
 } pcm_FrameList;
 
 /*returns total length of framelist's "samples" field*/
@@ -50,6 +75,67 @@ FrameList_samples_length(const pcm_FrameList *framelist)
     return framelist->frames * framelist->channels;
 }
 
+/*FrameLists returned by new_FrameList always store 32-bit samples,
+  but those from Python may store 16-bit samples instead
+  and those from planar decoders may store their channels planar,
+  so code reading them should use these accessors
+  or handle "samples", "samples16" and "planar" itself
+
+  sample indexes are always in interleaved order*/
+
+/*returns sample "i" of the FrameList regardless of its storage*/
+static inline int
+FrameList_sample(const pcm_FrameList *framelist, unsigned i)
+{
+    if (framelist->storage_bits == 16) {
+        return framelist->samples16[i];
+    } else if (framelist->planar) {
+        return framelist->samples[((i % framelist->channels) *
+                                   framelist->frames) +
+                                  (i / framelist->channels)];
+    } else {
+        return framelist->samples[i];
+    }
+}
+
+/*copies "count" samples starting from sample "start"
+  to "samples" as interleaved ints regardless of the FrameList's storage*/
+static inline void
+FrameList_get_samples(const pcm_FrameList *framelist,
+                      unsigned start,
+                      unsigned count,
+                      int samples[])
+{
+    if (framelist->storage_bits == 16) {
+        const int16_t *samples16 = framelist->samples16 + start;
+        for (; count; count--) {
+            *samples++ = *samples16++;
+        }
+    } else if (framelist->planar) {
+        for (; count; count--) {
+            *samples++ = FrameList_sample(framelist, start++);
+        }
+    } else if (count) {
+        memcpy(samples, framelist->samples + start, sizeof(int) * count);
+    }
+}
+
+/*besides its Python methods, audiotools.pcm exports
+  a PyCapsule of this name whose pointer is a pcm_framelist_alloc_f
+
+  it returns a new FrameList of "frames" PCM frames
+  whose samples are left uninitialized for the caller to populate,
+  stored as 16-bit integers in "samples16" if "compact" is nonzero
+  and "bits_per_sample" is 16 or less
+
+  returns NULL with MemoryError set if its samples can't be allocated*/
+#define PCM_FRAMELIST_ALLOC "audiotools.pcm._framelist_alloc"
+
+typedef pcm_FrameList* (*pcm_framelist_alloc_f)(unsigned channels,
+                                                unsigned bits_per_sample,
+                                                unsigned frames,
+                                                int compact);
+
 #ifdef PCM_MODULE
 void
 FrameList_dealloc(pcm_FrameList* self);
@@ -64,6 +150,27 @@ int FrameList_init(pcm_FrameList *self, PyObject *args, PyObject *kwds);
 pcm_FrameList*
 FrameList_create(void);
 
+/*returns a new FrameList of "frames" PCM frames
+  starting from PCM frame "offset" of "self"
+  which shares its samples rather than copying them
+
+  since FrameLists are immutable, the view and "self"
+  remain valid for as long as either is alive
+
+  returns NULL with a MemoryError set if a planar "self"
+  can't be interleaved first*/
+pcm_FrameList*
+FrameList_view(pcm_FrameList *self, unsigned offset, unsigned frames);
+
+/*the function exported as PCM_FRAMELIST_ALLOC*/
+pcm_FrameList*
+FrameList_alloc(unsigned channels,
+                unsigned bits_per_sample,
+                unsigned frames,
+                int compact);
+
+/*works like FrameList_alloc, but with its samples set to 0
+  since there's no reason to expose uninitialized data to Python*/
 PyObject*
 FrameList_empty(PyObject *dummy, PyObject *args);
 
@@ -79,12 +186,17 @@ FrameList_channels(pcm_FrameList *self, void* closure);
 PyObject*
 FrameList_bits_per_sample(pcm_FrameList *self, void* closure);
 
+PyObject*
+FrameList_storage_bits(pcm_FrameList *self, void* closure);
+
 Py_ssize_t
 FrameList_len(pcm_FrameList *o);
 
 PyObject*
 FrameList_richcompare(PyObject *a, PyObject *b, int op);
 
+/*returns 1 if the FrameLists are equal, 0 if not,
+  or -1 with a MemoryError set if either can't be interleaved*/
 int
 FrameList_equals(pcm_FrameList *a, pcm_FrameList *b);
 
@@ -100,12 +212,26 @@ FrameList_channel(pcm_FrameList *self, PyObject *args);
 PyObject*
 FrameList_to_bytes(pcm_FrameList *self, PyObject *args);
 
+/*returns a FrameList with the same samples stored as 16-bit ints
+  or self if that's not possible or they already are*/
+PyObject*
+FrameList_compact(pcm_FrameList *self, PyObject *args);
+
 PyObject*
 FrameList_to_float(pcm_FrameList *self, PyObject *args);
 
 PyObject*
 FrameList_frame_count(pcm_FrameList *self, PyObject *args);
 
+/*exposes "samples" to the buffer protocol as a read-only
+  2-D array of C ints, with one row per frame
+  and one column per channel*/
+int
+FrameList_getbuffer(pcm_FrameList *self, Py_buffer *view, int flags);
+
+void
+FrameList_releasebuffer(pcm_FrameList *self, Py_buffer *view);
+
 PyObject*
 FrameList_split(pcm_FrameList *self, PyObject *args);
 
@@ -146,6 +272,12 @@ typedef struct {
     unsigned samples_length;  /*the total number of samples
                                 which must be evenly distributable
                                 between channels*/
+
+    PyObject* parent;         /*if this FloatFrameList is a view of
+                                another FloatFrameList's samples,
+                                the FloatFrameList which owns them,
+                                or NULL if this FloatFrameList owns
+                                "samples" itself*/
 } pcm_FloatFrameList;
 
 static inline unsigned
@@ -173,6 +305,14 @@ FloatFrameList_blank(PyObject *dummy, PyObject *args);
 pcm_FloatFrameList*
 FloatFrameList_create(void);
 
+/*returns a new FloatFrameList of "frames" PCM frames
+  starting from PCM frame "offset" of "self"
+  which shares its samples rather than copying them*/
+pcm_FloatFrameList*
+FloatFrameList_view(pcm_FloatFrameList *self,
+                    unsigned offset,
+                    unsigned frames);
+
 PyObject*
 FloatFrameList_empty(PyObject *dummy, PyObject *args);
 
@@ -203,6 +343,17 @@ FloatFrameList_channel(pcm_FloatFrameList *self, PyObject *args);
 PyObject*
 FloatFrameList_to_int(pcm_FloatFrameList *self, PyObject *args);
 
+/*exposes "samples" to the buffer protocol as a read-only
+  2-D array of C doubles, with one row per frame
+  and one column per channel*/
+int
+FloatFrameList_getbuffer(pcm_FloatFrameList *self,
+                         Py_buffer *view,
+                         int flags);
+
+void
+FloatFrameList_releasebuffer(pcm_FloatFrameList *self, Py_buffer *view);
+
 PyObject*
 FloatFrameList_split(pcm_FloatFrameList *self, PyObject *args);
 
@@ -221,6 +372,16 @@ FloatFrameList_from_channels(PyObject *dummy, PyObject *args);
 /*for use with the PyArg_ParseTuple function*/
 int
 FloatFrameList_converter(PyObject* obj, void** floatframelist);
+
+/*returns the names of the sample conversion kernels this CPU can run,
+  from the scalar loops to the widest vector kernels*/
+PyObject*
+pcm_conversion_kernels(PyObject *dummy, PyObject *args);
+
+/*limits sample conversion to the named kernels and those before them
+  so each can be checked against the scalar loops*/
+PyObject*
+pcm_use_conversion_kernels(PyObject *dummy, PyObject *args);
 #endif
 
 #endif
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "simd.h"
+
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
  Copyright (C) 2007-2016  Brian Langenberger
@@ -43,6 +45,24 @@
                         const int int_samples[],           \
                         unsigned char pcm_samples[]);
 
+#define PCM_INT16_CONV(name)                                 \
+    static void                                              \
+    pcm_##name##_to_int16(unsigned total_samples,            \
+                          const unsigned char pcm_samples[], \
+                          int16_t int16_samples[]);          \
+                                                             \
+    static void                                              \
+    int16_to_##name##_pcm(unsigned total_samples,            \
+                          const int16_t int16_samples[],     \
+                          unsigned char pcm_samples[]);
+
+PCM_INT16_CONV(S8)
+PCM_INT16_CONV(U8)
+PCM_INT16_CONV(SB16)
+PCM_INT16_CONV(SL16)
+PCM_INT16_CONV(UB16)
+PCM_INT16_CONV(UL16)
+
 PCM_CONV(S8)
 PCM_CONV(U8)
 PCM_CONV(SB16)
@@ -79,6 +99,132 @@ PCM_INT_CONV_DEFS(8)
 PCM_INT_CONV_DEFS(16)
 PCM_INT_CONV_DEFS(24)
 
+/*each vector kernel converts as many leading samples as it can
+  a whole vector at a time and returns how many it converted,
+  leaving the rest to the scalar loop of the converter calling it
+  which they must match exactly, including clamping and wrapping
+
+  kernels are chosen at run time from the CPU's instructions
+  and convert nothing if it has none suitable*/
+
+static inline unsigned
+vec_pcm8_to_int(unsigned total_samples,
+                const unsigned char pcm_samples[],
+                int int_samples[],
+                int is_signed);
+
+static inline unsigned
+vec_int_to_pcm8(unsigned total_samples,
+                const int int_samples[],
+                unsigned char pcm_samples[],
+                int is_signed);
+
+static inline unsigned
+vec_pcm16_to_int(unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int is_big_endian,
+                 int is_signed);
+
+static inline unsigned
+vec_int_to_pcm16(unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int is_big_endian,
+                 int is_signed);
+
+static inline unsigned
+vec_pcm24_to_int(unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int is_big_endian,
+                 int is_signed);
+
+static inline unsigned
+vec_int_to_pcm24(unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int is_big_endian,
+                 int is_signed);
+
+static inline unsigned
+vec_pcm8_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[],
+                  int is_signed);
+
+static inline unsigned
+vec_int16_to_pcm8(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[],
+                  int is_signed);
+
+static inline unsigned
+vec_pcm16_to_int16(unsigned total_samples,
+                   const unsigned char pcm_samples[],
+                   int16_t int16_samples[],
+                   int is_big_endian,
+                   int is_signed);
+
+static inline unsigned
+vec_int16_to_pcm16(unsigned total_samples,
+                   const int16_t int16_samples[],
+                   unsigned char pcm_samples[],
+                   int is_big_endian,
+                   int is_signed);
+
+static inline unsigned
+vec_int_to_double(unsigned total_samples,
+                  const int int_samples[],
+                  double double_samples[],
+                  int negative_min,
+                  int positive_max);
+
+static inline unsigned
+vec_int_to_float(unsigned total_samples,
+                 const int int_samples[],
+                 float float_samples[],
+                 int negative_min,
+                 int positive_max);
+
+static inline unsigned
+vec_double_to_int(unsigned total_samples,
+                  const double double_samples[],
+                  int int_samples[],
+                  int negative_min,
+                  int positive_max);
+
+static inline unsigned
+vec_float_to_int(unsigned total_samples,
+                 const float float_samples[],
+                 int int_samples[],
+                 int negative_min,
+                 int positive_max);
+
+/*the instruction set whose kernels the converters run,
+  or -1 until the CPU is first checked*/
+static int active_isa = -1;
+
+static inline pcm_conv_isa_t
+conv_isa(void)
+{
+    if (active_isa < 0) {
+        active_isa = pcm_conv_supported_isa();
+    }
+    return (pcm_conv_isa_t)active_isa;
+}
+
+/*runs a vector kernel over the start of a converter's input
+  and advances "total_samples" and both arrays past what it converted*/
+#define CONVERT_VECTORS(KERNEL, INPUT, INPUT_SIZE, OUTPUT, OUTPUT_SIZE, ...) \
+    do {                                                                   \
+        const unsigned converted =                                         \
+            KERNEL(total_samples, INPUT, OUTPUT, __VA_ARGS__);             \
+        total_samples -= converted;                                        \
+        INPUT += converted * (INPUT_SIZE);                                 \
+        OUTPUT += converted * (OUTPUT_SIZE);                               \
+    } while (0)
+
 /***********************************
  * public function implementations *
  ***********************************/
@@ -141,6 +287,52 @@ int_to_pcm_converter(unsigned bits_per_sample,
     }
 }
 
+pcm_to_int16_f
+pcm_to_int16_converter(unsigned bits_per_sample,
+                       int is_big_endian,
+                       int is_signed)
+{
+    switch (bits_per_sample) {
+    case 8:
+        if (is_signed) {
+            return pcm_S8_to_int16;
+        } else {
+            return pcm_U8_to_int16;
+        }
+    case 16:
+        if (is_signed) {
+            return is_big_endian ? pcm_SB16_to_int16 : pcm_SL16_to_int16;
+        } else {
+            return is_big_endian ? pcm_UB16_to_int16 : pcm_UL16_to_int16;
+        }
+    default:
+        return NULL;
+    }
+}
+
+int16_to_pcm_f
+int16_to_pcm_converter(unsigned bits_per_sample,
+                       int is_big_endian,
+                       int is_signed)
+{
+    switch (bits_per_sample) {
+    case 8:
+        if (is_signed) {
+            return int16_to_S8_pcm;
+        } else {
+            return int16_to_U8_pcm;
+        }
+    case 16:
+        if (is_signed) {
+            return is_big_endian ? int16_to_SB16_pcm : int16_to_SL16_pcm;
+        } else {
+            return is_big_endian ? int16_to_UB16_pcm : int16_to_UL16_pcm;
+        }
+    default:
+        return NULL;
+    }
+}
+
 int_to_double_f
 int_to_double_converter(unsigned bits_per_sample)
 {
@@ -201,6 +393,31 @@ float_to_int_converter(unsigned bits_per_sample)
     }
 }
 
+pcm_conv_isa_t
+pcm_conv_supported_isa(void)
+{
+#if defined(SIMD_X86)
+    if (simd_supports("avx2")) {
+        return PCM_CONV_AVX2;
+    } else if (simd_supports("avx")) {
+        return PCM_CONV_AVX;
+    } else if (simd_supports("ssse3")) {
+        return PCM_CONV_SSSE3;
+    } else if (simd_supports("sse2")) {
+        return PCM_CONV_SSE2;
+    }
+#endif
+    return PCM_CONV_SCALAR;
+}
+
+pcm_conv_isa_t
+pcm_conv_limit_isa(pcm_conv_isa_t isa)
+{
+    const pcm_conv_isa_t supported = pcm_conv_supported_isa();
+    active_isa = MIN(isa, supported);
+    return (pcm_conv_isa_t)active_isa;
+}
+
 /************************************
  * private function implementations *
  ************************************/
@@ -210,6 +427,8 @@ pcm_S8_to_int(unsigned total_samples,
               const unsigned char pcm_samples[],
               int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm8_to_int, pcm_samples, 1, int_samples, 1, 1);
+
     for (; total_samples; total_samples--) {
         if (pcm_samples[0] & 0x80) {
             /*negative*/
@@ -228,6 +447,8 @@ int_to_S8_pcm(unsigned total_samples,
               const int int_samples[],
               unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm8, int_samples, 1, pcm_samples, 1, 1);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -254,6 +475,8 @@ pcm_U8_to_int(unsigned total_samples,
               const unsigned char pcm_samples[],
               int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm8_to_int, pcm_samples, 1, int_samples, 1, 0);
+
     for (; total_samples; total_samples--) {
         int_samples[0] = ((int)pcm_samples[0]) - (1 << 7);
         pcm_samples += 1;
@@ -266,6 +489,8 @@ int_to_U8_pcm(unsigned total_samples,
               const int int_samples[],
               unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm8, int_samples, 1, pcm_samples, 1, 0);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -283,6 +508,8 @@ pcm_SB16_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm16_to_int, pcm_samples, 2, int_samples, 1, 1, 1);
+
     for (; total_samples; total_samples--) {
         if (pcm_samples[0] & 0x80) {
             /*negative*/
@@ -303,6 +530,8 @@ int_to_SB16_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm16, int_samples, 1, pcm_samples, 2, 1, 1);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -328,6 +557,8 @@ pcm_SL16_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm16_to_int, pcm_samples, 2, int_samples, 1, 0, 1);
+
     for (; total_samples; total_samples--) {
         if (pcm_samples[1] & 0x80) {
             /*negative*/
@@ -348,6 +579,8 @@ int_to_SL16_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm16, int_samples, 1, pcm_samples, 2, 0, 1);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -373,6 +606,8 @@ pcm_UB16_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm16_to_int, pcm_samples, 2, int_samples, 1, 1, 0);
+
     for (; total_samples; total_samples--) {
         int_samples[0] =
             ((int)(pcm_samples[0] << 8) | pcm_samples[1]) - (1 << 15);
@@ -386,6 +621,8 @@ int_to_UB16_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm16, int_samples, 1, pcm_samples, 2, 1, 0);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -404,6 +641,8 @@ pcm_UL16_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm16_to_int, pcm_samples, 2, int_samples, 1, 0, 0);
+
     for (; total_samples; total_samples--) {
         int_samples[0] =
             ((int)(pcm_samples[1] << 8) | pcm_samples[0]) - (1 << 15);
@@ -417,6 +656,8 @@ int_to_UL16_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm16, int_samples, 1, pcm_samples, 2, 0, 0);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -435,6 +676,8 @@ pcm_SB24_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm24_to_int, pcm_samples, 3, int_samples, 1, 1, 1);
+
     for (; total_samples; total_samples--) {
         if (pcm_samples[0] & 0x80) {
             /*negative*/
@@ -460,6 +703,8 @@ int_to_SB24_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm24, int_samples, 1, pcm_samples, 3, 1, 1);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -486,6 +731,8 @@ pcm_SL24_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm24_to_int, pcm_samples, 3, int_samples, 1, 0, 1);
+
     for (; total_samples; total_samples--) {
         if (pcm_samples[2] & 0x80) {
             /*negative*/
@@ -511,6 +758,8 @@ int_to_SL24_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm24, int_samples, 1, pcm_samples, 3, 0, 1);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -538,6 +787,8 @@ pcm_UB24_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm24_to_int, pcm_samples, 3, int_samples, 1, 1, 0);
+
     for (; total_samples; total_samples--) {
         int_samples[0] =
             ((int)((pcm_samples[0] << 16) |
@@ -553,6 +804,8 @@ int_to_UB24_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm24, int_samples, 1, pcm_samples, 3, 1, 0);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -572,6 +825,8 @@ pcm_UL24_to_int(unsigned total_samples,
                 const unsigned char pcm_samples[],
                 int int_samples[])
 {
+    CONVERT_VECTORS(vec_pcm24_to_int, pcm_samples, 3, int_samples, 1, 0, 0);
+
     for (; total_samples; total_samples--) {
         int_samples[0] = ((int)((pcm_samples[2] << 16) |
                                 (pcm_samples[1] << 8) |
@@ -586,6 +841,8 @@ int_to_UL24_pcm(unsigned total_samples,
                 const int int_samples[],
                 unsigned char pcm_samples[])
 {
+    CONVERT_VECTORS(vec_int_to_pcm24, int_samples, 1, pcm_samples, 3, 0, 0);
+
     for (; total_samples; total_samples--) {
         register int i = int_samples[0];
 
@@ -600,6 +857,199 @@ int_to_UL24_pcm(unsigned total_samples,
     }
 }
 
+/*16-bit samples are small enough to convert
+  without the explicit range checks of their int counterparts*/
+
+static void
+pcm_S8_to_int16(unsigned total_samples,
+                const unsigned char pcm_samples[],
+                int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm8_to_int16, pcm_samples, 1, int16_samples, 1, 1);
+
+    for (; total_samples; total_samples--) {
+        const int v = pcm_samples[0];
+        int16_samples[0] = v - ((v & 0x80) << 1);
+        pcm_samples += 1;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_S8_pcm(unsigned total_samples,
+                const int16_t int16_samples[],
+                unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm8, int16_samples, 1, pcm_samples, 1, 1);
+
+    for (; total_samples; total_samples--) {
+        const int i = MIN(MAX(int16_samples[0], -0x80), 0x7F);
+        pcm_samples[0] = i & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 1;
+    }
+}
+
+static void
+pcm_U8_to_int16(unsigned total_samples,
+                const unsigned char pcm_samples[],
+                int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm8_to_int16, pcm_samples, 1, int16_samples, 1, 0);
+
+    for (; total_samples; total_samples--) {
+        int16_samples[0] = ((int)pcm_samples[0]) - (1 << 7);
+        pcm_samples += 1;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_U8_pcm(unsigned total_samples,
+                const int16_t int16_samples[],
+                unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm8, int16_samples, 1, pcm_samples, 1, 0);
+
+    for (; total_samples; total_samples--) {
+        pcm_samples[0] = (int16_samples[0] + (1 << 7)) & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 1;
+    }
+}
+
+static void
+pcm_SB16_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm16_to_int16,
+                    pcm_samples, 2, int16_samples, 1, 1, 1);
+
+    for (; total_samples; total_samples--) {
+        const int v = (pcm_samples[0] << 8) | pcm_samples[1];
+        int16_samples[0] = v - ((v & 0x8000) << 1);
+        pcm_samples += 2;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_SB16_pcm(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm16,
+                    int16_samples, 1, pcm_samples, 2, 1, 1);
+
+    for (; total_samples; total_samples--) {
+        const int i = int16_samples[0];
+        pcm_samples[0] = (i >> 8) & 0xFF;
+        pcm_samples[1] = i & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 2;
+    }
+}
+
+static void
+pcm_SL16_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm16_to_int16,
+                    pcm_samples, 2, int16_samples, 1, 0, 1);
+
+    for (; total_samples; total_samples--) {
+        const int v = (pcm_samples[1] << 8) | pcm_samples[0];
+        int16_samples[0] = v - ((v & 0x8000) << 1);
+        pcm_samples += 2;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_SL16_pcm(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm16,
+                    int16_samples, 1, pcm_samples, 2, 0, 1);
+
+    for (; total_samples; total_samples--) {
+        const int i = int16_samples[0];
+        pcm_samples[1] = (i >> 8) & 0xFF;
+        pcm_samples[0] = i & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 2;
+    }
+}
+
+static void
+pcm_UB16_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm16_to_int16,
+                    pcm_samples, 2, int16_samples, 1, 1, 0);
+
+    for (; total_samples; total_samples--) {
+        int16_samples[0] =
+            ((pcm_samples[0] << 8) | pcm_samples[1]) - (1 << 15);
+        pcm_samples += 2;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_UB16_pcm(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm16,
+                    int16_samples, 1, pcm_samples, 2, 1, 0);
+
+    for (; total_samples; total_samples--) {
+        const int i = int16_samples[0] + (1 << 15);
+        pcm_samples[0] = (i >> 8) & 0xFF;
+        pcm_samples[1] = i & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 2;
+    }
+}
+
+static void
+pcm_UL16_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[])
+{
+    CONVERT_VECTORS(vec_pcm16_to_int16,
+                    pcm_samples, 2, int16_samples, 1, 0, 0);
+
+    for (; total_samples; total_samples--) {
+        int16_samples[0] =
+            ((pcm_samples[1] << 8) | pcm_samples[0]) - (1 << 15);
+        pcm_samples += 2;
+        int16_samples += 1;
+    }
+}
+
+static void
+int16_to_UL16_pcm(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[])
+{
+    CONVERT_VECTORS(vec_int16_to_pcm16,
+                    int16_samples, 1, pcm_samples, 2, 0, 0);
+
+    for (; total_samples; total_samples--) {
+        const int i = int16_samples[0] + (1 << 15);
+        pcm_samples[1] = (i >> 8) & 0xFF;
+        pcm_samples[0] = i & 0xFF;
+        int16_samples += 1;
+        pcm_samples += 2;
+    }
+}
+
 #include <stdio.h>
 
 #define PCM_INT_CONV(BITS, NEGATIVE_MIN, POSITIVE_MAX)                     \
@@ -608,6 +1058,9 @@ int_to_UL24_pcm(unsigned total_samples,
                          const int int_samples[],                          \
                          double double_samples[])                          \
   {                                                                        \
+      CONVERT_VECTORS(vec_int_to_double,                                   \
+                      int_samples, 1, double_samples, 1,                   \
+                      NEGATIVE_MIN, POSITIVE_MAX);                         \
       for (; total_samples; total_samples--) {                             \
           const register int i = int_samples[0];                           \
           if (i >= 0) {                                                    \
@@ -625,6 +1078,9 @@ int_to_UL24_pcm(unsigned total_samples,
                         const int int_samples[],                           \
                         float float_samples[])                             \
   {                                                                        \
+      CONVERT_VECTORS(vec_int_to_float,                                    \
+                      int_samples, 1, float_samples, 1,                    \
+                      NEGATIVE_MIN, POSITIVE_MAX);                         \
       for (; total_samples; total_samples--) {                             \
           const register int i = int_samples[0];                           \
           if (i >= 0) {                                                    \
@@ -642,6 +1098,9 @@ int_to_UL24_pcm(unsigned total_samples,
                          const double double_samples[],                    \
                          int int_samples[])                                \
   {                                                                        \
+      CONVERT_VECTORS(vec_double_to_int,                                   \
+                      double_samples, 1, int_samples, 1,                   \
+                      NEGATIVE_MIN, POSITIVE_MAX);                         \
       for (; total_samples; total_samples--) {                             \
           const register double d = double_samples[0];                     \
           const int value =                                                \
@@ -657,6 +1116,9 @@ int_to_UL24_pcm(unsigned total_samples,
                         const float float_samples[],                       \
                         int int_samples[])                                 \
   {                                                                        \
+      CONVERT_VECTORS(vec_float_to_int,                                    \
+                      float_samples, 1, int_samples, 1,                    \
+                      NEGATIVE_MIN, POSITIVE_MAX);                         \
       for (; total_samples; total_samples--) {                             \
           const register double d = float_samples[0];                      \
           const int value =                                                \
@@ -670,3 +1132,941 @@ int_to_UL24_pcm(unsigned total_samples,
 PCM_INT_CONV(8, -128, 127)
 PCM_INT_CONV(16, -32768, 32767)
 PCM_INT_CONV(24, -8388608, 8388607)
+
+/******************
+ * vector kernels *
+ ******************/
+
+#if defined(SIMD_X86)
+/*each kernel converts whole vectors of samples starting from sample "i"
+  and returns the index of the first sample it left unconverted*/
+
+/*clamps each 32-bit lane of "v" to [low, high]*/
+SIMD_TARGET("sse2") static inline __m128i
+clamp_epi32(__m128i v, __m128i low, __m128i high)
+{
+    __m128i mask = _mm_cmplt_epi32(v, low);
+    v = _mm_or_si128(_mm_and_si128(mask, low), _mm_andnot_si128(mask, v));
+    mask = _mm_cmpgt_epi32(v, high);
+    return _mm_or_si128(_mm_and_si128(mask, high), _mm_andnot_si128(mask, v));
+}
+
+/*swaps the bytes of each 16-bit lane*/
+SIMD_TARGET("sse2") static inline __m128i
+swap16_epi16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+/*sign-extends the low or high four 16-bit lanes to 32 bits*/
+SIMD_TARGET("sse2") static inline __m128i
+extend_lo_epi16(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+SIMD_TARGET("sse2") static inline __m128i
+extend_hi_epi16(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+/*truncates each 32-bit lane of "a" and "b" to its low 16 bits
+  and packs them together without saturation*/
+SIMD_TARGET("sse2") static inline __m128i
+truncate_epi32(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                           _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+SIMD_TARGET("sse2") static unsigned
+pcm8_to_int_sse2(unsigned i,
+                 unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int is_signed)
+{
+    /*unsigned samples are offset binary, so flipping the top bit
+      turns them into the equivalent signed samples*/
+    const __m128i offset = _mm_set1_epi8(is_signed ? 0 : -0x80);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        const __m128i v = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(pcm_samples + i)), offset);
+        const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+        _mm_storeu_si128((__m128i*)(int_samples + i), extend_lo_epi16(lo));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 4),
+                         extend_hi_epi16(lo));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 8),
+                         extend_lo_epi16(hi));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 12),
+                         extend_hi_epi16(hi));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int_to_pcm8_sse2(unsigned i,
+                 unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int is_signed)
+{
+    const __m128i low_byte = _mm_set1_epi32(0xFF);
+    const __m128i offset = _mm_set1_epi8(-0x80);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(int_samples + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(int_samples + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(int_samples + i + 12));
+        __m128i v;
+
+        if (is_signed) {
+            /*saturating packs clamp to [-0x80, 0x7F]*/
+            v = _mm_packs_epi16(_mm_packs_epi32(a, b),
+                                _mm_packs_epi32(c, d));
+        } else {
+            /*unsigned samples wrap, so only their low bytes matter*/
+            a = _mm_and_si128(a, low_byte);
+            b = _mm_and_si128(b, low_byte);
+            c = _mm_and_si128(c, low_byte);
+            d = _mm_and_si128(d, low_byte);
+            v = _mm_xor_si128(_mm_packus_epi16(_mm_packs_epi32(a, b),
+                                               _mm_packs_epi32(c, d)),
+                              offset);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + i), v);
+    }
+    return i;
+}
+
+SIMD_TARGET("avx2") static unsigned
+pcm16_to_int_avx2(unsigned i,
+                  unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    const __m256i swap = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const __m256i offset = _mm256_set1_epi16(is_signed ? 0 : -0x8000);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        __m256i v =
+            _mm256_loadu_si256((const __m256i*)(pcm_samples + (i * 2)));
+        if (is_big_endian) {
+            v = _mm256_shuffle_epi8(v, swap);
+        }
+        v = _mm256_xor_si256(v, offset);
+        _mm256_storeu_si256(
+            (__m256i*)(int_samples + i),
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(
+            (__m256i*)(int_samples + i + 8),
+            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+pcm16_to_int_sse2(unsigned i,
+                  unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : -0x8000);
+
+    for (; (total_samples - i) >= 8; i += 8) {
+        __m128i v =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 2)));
+        if (is_big_endian) {
+            v = swap16_epi16(v);
+        }
+        v = _mm_xor_si128(v, offset);
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         extend_lo_epi16(v));
+        _mm_storeu_si128((__m128i*)(int_samples + i + 4),
+                         extend_hi_epi16(v));
+    }
+    return i;
+}
+
+SIMD_TARGET("avx2") static unsigned
+int_to_pcm16_avx2(unsigned i,
+                  unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    const __m256i swap = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const __m256i offset = _mm256_set1_epi16(-0x8000);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(int_samples + i));
+        __m256i b =
+            _mm256_loadu_si256((const __m256i*)(int_samples + i + 8));
+        __m256i v;
+
+        if (is_signed) {
+            /*saturating packs clamp to [-0x8000, 0x7FFF]*/
+            v = _mm256_packs_epi32(a, b);
+        } else {
+            /*unsigned samples wrap, so only their low 16 bits matter*/
+            a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+            b = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+            v = _mm256_xor_si256(_mm256_packs_epi32(a, b), offset);
+        }
+        /*packs works within each 128-bit half, so restore sample order*/
+        v = _mm256_permute4x64_epi64(v, 0xD8);
+        if (is_big_endian) {
+            v = _mm256_shuffle_epi8(v, swap);
+        }
+        _mm256_storeu_si256((__m256i*)(pcm_samples + (i * 2)), v);
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int_to_pcm16_sse2(unsigned i,
+                  unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    const __m128i offset = _mm_set1_epi16(-0x8000);
+
+    for (; (total_samples - i) >= 8; i += 8) {
+        const __m128i a =
+            _mm_loadu_si128((const __m128i*)(int_samples + i));
+        const __m128i b =
+            _mm_loadu_si128((const __m128i*)(int_samples + i + 4));
+        __m128i v;
+
+        if (is_signed) {
+            v = _mm_packs_epi32(a, b);
+        } else {
+            v = _mm_xor_si128(truncate_epi32(a, b), offset);
+        }
+        if (is_big_endian) {
+            v = swap16_epi16(v);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + (i * 2)), v);
+    }
+    return i;
+}
+
+SIMD_TARGET("ssse3") static unsigned
+pcm24_to_int_ssse3(unsigned i,
+                   unsigned total_samples,
+                   const unsigned char pcm_samples[],
+                   int int_samples[],
+                   int is_big_endian,
+                   int is_signed)
+{
+    /*moves each sample's 3 bytes to the top of a 32-bit lane
+      which an arithmetic shift then sign-extends*/
+    const __m128i unpack = is_big_endian ?
+        _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3,
+                      -1, 8, 7, 6, -1, 11, 10, 9) :
+        _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                      -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128i offset = _mm_set1_epi32(is_signed ? 0 : INT32_MIN);
+
+    /*each 16 byte load covers 4 samples plus part of the next 2*/
+    for (; (total_samples - i) >= 6; i += 4) {
+        const __m128i v = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 3))),
+            unpack);
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         _mm_srai_epi32(_mm_xor_si128(v, offset), 8));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+pcm24_to_int_sse2(unsigned i,
+                  unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int int_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    /*without byte shuffles, split the 12 bytes into two 6 byte halves
+      and shift each half's pair of samples into 32-bit lanes*/
+    const __m128i offset = _mm_set1_epi32(is_signed ? 0 : INT32_MIN);
+    const __m128i byte_0 = _mm_set1_epi32(0xFF);
+    const __m128i byte_1 = _mm_set1_epi32(0xFF00);
+
+    for (; (total_samples - i) >= 6; i += 4) {
+        const __m128i v =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 3)));
+        const __m128i halves = _mm_unpacklo_epi64(v, _mm_srli_si128(v, 6));
+        const __m128i even =
+            _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128i odd = _mm_shuffle_epi32(_mm_srli_epi64(halves, 24),
+                                              _MM_SHUFFLE(2, 0, 2, 0));
+        /*each lane's low 3 bytes now hold a sample in stream order*/
+        __m128i samples = _mm_unpacklo_epi32(even, odd);
+
+        if (is_big_endian) {
+            samples = _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(samples, 24),
+                             _mm_slli_epi32(_mm_and_si128(samples, byte_1),
+                                            8)),
+                _mm_slli_epi32(
+                    _mm_and_si128(_mm_srli_epi32(samples, 16), byte_0), 8));
+        } else {
+            samples = _mm_slli_epi32(samples, 8);
+        }
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         _mm_srai_epi32(_mm_xor_si128(samples, offset), 8));
+    }
+    return i;
+}
+
+SIMD_TARGET("ssse3") static unsigned
+int_to_pcm24_ssse3(unsigned i,
+                   unsigned total_samples,
+                   const int int_samples[],
+                   unsigned char pcm_samples[],
+                   int is_big_endian,
+                   int is_signed)
+{
+    /*gathers the low 3 bytes of each 32-bit lane into 12 bytes*/
+    const __m128i pack = is_big_endian ?
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                      8, 14, 13, 12, -1, -1, -1, -1) :
+        _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                      10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i low = _mm_set1_epi32(-0x800000);
+    const __m128i high = _mm_set1_epi32(0x7FFFFF);
+    const __m128i offset = _mm_set1_epi32(0x800000);
+
+    /*each 16 byte store writes 4 samples plus 4 bytes of padding
+      which the following store or scalar loop overwrites*/
+    for (; (total_samples - i) >= 6; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        if (is_signed) {
+            v = clamp_epi32(v, low, high);
+        } else {
+            /*unsigned samples wrap, so only their low 24 bits matter*/
+            v = _mm_xor_si128(v, offset);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + (i * 3)),
+                         _mm_shuffle_epi8(v, pack));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int_to_pcm24_sse2(unsigned i,
+                  unsigned total_samples,
+                  const int int_samples[],
+                  unsigned char pcm_samples[],
+                  int is_big_endian,
+                  int is_signed)
+{
+    /*without byte shuffles, shift pairs of samples together
+      into two 6 byte halves and then join the halves*/
+    const __m128i low = _mm_set1_epi32(-0x800000);
+    const __m128i high = _mm_set1_epi32(0x7FFFFF);
+    const __m128i offset = _mm_set1_epi32(0x800000);
+    const __m128i low_bytes = _mm_set1_epi32(0xFFFFFF);
+    const __m128i byte_0 = _mm_set1_epi32(0xFF);
+    const __m128i byte_1 = _mm_set1_epi32(0xFF00);
+    const __m128i even_lanes = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i low_6_bytes = _mm_set_epi32(0, 0, 0xFFFF, -1);
+
+    /*each 16 byte store writes 4 samples plus 4 bytes of padding
+      which the following store or scalar loop overwrites*/
+    for (; (total_samples - i) >= 6; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(int_samples + i));
+        __m128i pairs;
+
+        if (is_signed) {
+            v = clamp_epi32(v, low, high);
+        } else {
+            v = _mm_xor_si128(v, offset);
+        }
+        if (is_big_endian) {
+            v = _mm_or_si128(
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, byte_0), 16),
+                             _mm_and_si128(v, byte_1)),
+                _mm_and_si128(_mm_srli_epi32(v, 16), byte_0));
+        } else {
+            v = _mm_and_si128(v, low_bytes);
+        }
+        /*join samples 0 and 1, and 2 and 3, into 48 bits each*/
+        pairs = _mm_or_si128(
+            _mm_and_si128(v, even_lanes),
+            _mm_slli_epi64(_mm_srli_epi64(v, 32), 24));
+        _mm_storeu_si128(
+            (__m128i*)(pcm_samples + (i * 3)),
+            _mm_or_si128(_mm_and_si128(pairs, low_6_bytes),
+                         _mm_slli_si128(_mm_srli_si128(pairs, 8), 6)));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+pcm8_to_int16_sse2(unsigned i,
+                   unsigned total_samples,
+                   const unsigned char pcm_samples[],
+                   int16_t int16_samples[],
+                   int is_signed)
+{
+    const __m128i offset = _mm_set1_epi8(is_signed ? 0 : -0x80);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        const __m128i v = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(pcm_samples + i)), offset);
+        _mm_storeu_si128((__m128i*)(int16_samples + i),
+                         _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8));
+        _mm_storeu_si128((__m128i*)(int16_samples + i + 8),
+                         _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int16_to_pcm8_sse2(unsigned i,
+                   unsigned total_samples,
+                   const int16_t int16_samples[],
+                   unsigned char pcm_samples[],
+                   int is_signed)
+{
+    const __m128i low_byte = _mm_set1_epi16(0xFF);
+    const __m128i offset = _mm_set1_epi8(-0x80);
+
+    for (; (total_samples - i) >= 16; i += 16) {
+        const __m128i a =
+            _mm_loadu_si128((const __m128i*)(int16_samples + i));
+        const __m128i b =
+            _mm_loadu_si128((const __m128i*)(int16_samples + i + 8));
+        __m128i v;
+
+        if (is_signed) {
+            v = _mm_packs_epi16(a, b);
+        } else {
+            v = _mm_xor_si128(_mm_packus_epi16(_mm_and_si128(a, low_byte),
+                                               _mm_and_si128(b, low_byte)),
+                              offset);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + i), v);
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+pcm16_to_int16_sse2(unsigned i,
+                    unsigned total_samples,
+                    const unsigned char pcm_samples[],
+                    int16_t int16_samples[],
+                    int is_big_endian,
+                    int is_signed)
+{
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : -0x8000);
+
+    for (; (total_samples - i) >= 8; i += 8) {
+        __m128i v =
+            _mm_loadu_si128((const __m128i*)(pcm_samples + (i * 2)));
+        if (is_big_endian) {
+            v = swap16_epi16(v);
+        }
+        _mm_storeu_si128((__m128i*)(int16_samples + i),
+                         _mm_xor_si128(v, offset));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int16_to_pcm16_sse2(unsigned i,
+                    unsigned total_samples,
+                    const int16_t int16_samples[],
+                    unsigned char pcm_samples[],
+                    int is_big_endian,
+                    int is_signed)
+{
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : -0x8000);
+
+    for (; (total_samples - i) >= 8; i += 8) {
+        __m128i v = _mm_xor_si128(
+            _mm_loadu_si128((const __m128i*)(int16_samples + i)), offset);
+        if (is_big_endian) {
+            v = swap16_epi16(v);
+        }
+        _mm_storeu_si128((__m128i*)(pcm_samples + (i * 2)), v);
+    }
+    return i;
+}
+
+/*the floating point kernels divide and multiply exactly as
+  their scalar loops do, choosing the divisor or multiplier by sign,
+  so their results are bit-identical*/
+
+SIMD_TARGET("avx") static unsigned
+int_to_double_avx(unsigned i,
+                  unsigned total_samples,
+                  const int int_samples[],
+                  double double_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    const __m256d positive = _mm256_set1_pd(positive_max);
+    const __m256d negative = _mm256_set1_pd(-negative_min);
+    const __m256d zero = _mm256_setzero_pd();
+
+    for (; (total_samples - i) >= 4; i += 4) {
+        const __m256d v = _mm256_cvtepi32_pd(
+            _mm_loadu_si128((const __m128i*)(int_samples + i)));
+        const __m256d divisor = _mm256_blendv_pd(
+            positive, negative, _mm256_cmp_pd(v, zero, _CMP_LT_OQ));
+        _mm256_storeu_pd(double_samples + i, _mm256_div_pd(v, divisor));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int_to_double_sse2(unsigned i,
+                   unsigned total_samples,
+                   const int int_samples[],
+                   double double_samples[],
+                   int negative_min,
+                   int positive_max)
+{
+    const __m128d positive = _mm_set1_pd(positive_max);
+    const __m128d negative = _mm_set1_pd(-negative_min);
+    const __m128d zero = _mm_setzero_pd();
+
+    for (; (total_samples - i) >= 2; i += 2) {
+        const __m128d v = _mm_cvtepi32_pd(
+            _mm_loadl_epi64((const __m128i*)(int_samples + i)));
+        const __m128d mask = _mm_cmplt_pd(v, zero);
+        const __m128d divisor =
+            _mm_or_pd(_mm_and_pd(mask, negative),
+                      _mm_andnot_pd(mask, positive));
+        _mm_storeu_pd(double_samples + i, _mm_div_pd(v, divisor));
+    }
+    return i;
+}
+
+SIMD_TARGET("avx") static unsigned
+int_to_float_avx(unsigned i,
+                 unsigned total_samples,
+                 const int int_samples[],
+                 float float_samples[],
+                 int negative_min,
+                 int positive_max)
+{
+    const __m256 positive = _mm256_set1_ps((float)positive_max);
+    const __m256 negative = _mm256_set1_ps((float)-negative_min);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; (total_samples - i) >= 8; i += 8) {
+        const __m256 v = _mm256_cvtepi32_ps(
+            _mm256_loadu_si256((const __m256i*)(int_samples + i)));
+        const __m256 divisor = _mm256_blendv_ps(
+            positive, negative, _mm256_cmp_ps(v, zero, _CMP_LT_OQ));
+        _mm256_storeu_ps(float_samples + i, _mm256_div_ps(v, divisor));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+int_to_float_sse2(unsigned i,
+                  unsigned total_samples,
+                  const int int_samples[],
+                  float float_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    const __m128 positive = _mm_set1_ps((float)positive_max);
+    const __m128 negative = _mm_set1_ps((float)-negative_min);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; (total_samples - i) >= 4; i += 4) {
+        const __m128 v = _mm_cvtepi32_ps(
+            _mm_loadu_si128((const __m128i*)(int_samples + i)));
+        const __m128 mask = _mm_cmplt_ps(v, zero);
+        const __m128 divisor =
+            _mm_or_ps(_mm_and_ps(mask, negative),
+                      _mm_andnot_ps(mask, positive));
+        _mm_storeu_ps(float_samples + i, _mm_div_ps(v, divisor));
+    }
+    return i;
+}
+
+/*scales 2 doubles by their sign's multiplier,
+  truncates them to ints and clamps them, like the scalar loop
+  (negative zero and NaN scale to the same result either way)*/
+SIMD_TARGET("sse2") static inline __m128i
+scale_pd(__m128d v, __m128d positive, __m128d negative,
+         __m128i low, __m128i high)
+{
+    const __m128d mask = _mm_cmplt_pd(v, _mm_setzero_pd());
+    const __m128d multiplier = _mm_or_pd(_mm_and_pd(mask, negative),
+                                         _mm_andnot_pd(mask, positive));
+    return clamp_epi32(_mm_cvttpd_epi32(_mm_mul_pd(v, multiplier)),
+                       low,
+                       high);
+}
+
+SIMD_TARGET("avx") static unsigned
+double_to_int_avx(unsigned i,
+                  unsigned total_samples,
+                  const double double_samples[],
+                  int int_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    const __m256d positive = _mm256_set1_pd(positive_max);
+    const __m256d negative = _mm256_set1_pd(-negative_min);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m128i low = _mm_set1_epi32(negative_min);
+    const __m128i high = _mm_set1_epi32(positive_max);
+
+    for (; (total_samples - i) >= 4; i += 4) {
+        const __m256d v = _mm256_loadu_pd(double_samples + i);
+        const __m256d multiplier = _mm256_blendv_pd(
+            positive, negative, _mm256_cmp_pd(v, zero, _CMP_LT_OQ));
+        /*AVX implies SSE4.1's min and max*/
+        _mm_storeu_si128(
+            (__m128i*)(int_samples + i),
+            _mm_min_epi32(
+                _mm_max_epi32(
+                    _mm256_cvttpd_epi32(_mm256_mul_pd(v, multiplier)),
+                    low),
+                high));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+double_to_int_sse2(unsigned i,
+                   unsigned total_samples,
+                   const double double_samples[],
+                   int int_samples[],
+                   int negative_min,
+                   int positive_max)
+{
+    const __m128d positive = _mm_set1_pd(positive_max);
+    const __m128d negative = _mm_set1_pd(-negative_min);
+    const __m128i low = _mm_set1_epi32(negative_min);
+    const __m128i high = _mm_set1_epi32(positive_max);
+
+    for (; (total_samples - i) >= 2; i += 2) {
+        _mm_storel_epi64(
+            (__m128i*)(int_samples + i),
+            scale_pd(_mm_loadu_pd(double_samples + i),
+                     positive, negative, low, high));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+float_to_int_sse2(unsigned i,
+                  unsigned total_samples,
+                  const float float_samples[],
+                  int int_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    /*floats are widened to doubles before scaling, as in the scalar loop*/
+    const __m128d positive = _mm_set1_pd(positive_max);
+    const __m128d negative = _mm_set1_pd(-negative_min);
+    const __m128i low = _mm_set1_epi32(negative_min);
+    const __m128i high = _mm_set1_epi32(positive_max);
+
+    for (; (total_samples - i) >= 4; i += 4) {
+        const __m128 v = _mm_loadu_ps(float_samples + i);
+        const __m128i lo = scale_pd(_mm_cvtps_pd(v),
+                                    positive, negative, low, high);
+        const __m128i hi = scale_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)),
+                                    positive, negative, low, high);
+        _mm_storeu_si128((__m128i*)(int_samples + i),
+                         _mm_unpacklo_epi64(lo, hi));
+    }
+    return i;
+}
+#endif
+
+/*each dispatcher runs the widest kernel allowed first
+  and then narrower ones over what remains*/
+
+static inline unsigned
+vec_pcm8_to_int(unsigned total_samples,
+                const unsigned char pcm_samples[],
+                int int_samples[],
+                int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = pcm8_to_int_sse2(i, total_samples, pcm_samples, int_samples,
+                             is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int_to_pcm8(unsigned total_samples,
+                const int int_samples[],
+                unsigned char pcm_samples[],
+                int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = int_to_pcm8_sse2(i, total_samples, int_samples, pcm_samples,
+                             is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_pcm16_to_int(unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int is_big_endian,
+                 int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_AVX2) {
+        i = pcm16_to_int_avx2(i, total_samples, pcm_samples, int_samples,
+                              is_big_endian, is_signed);
+    }
+    if (isa >= PCM_CONV_SSE2) {
+        i = pcm16_to_int_sse2(i, total_samples, pcm_samples, int_samples,
+                              is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int_to_pcm16(unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int is_big_endian,
+                 int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_AVX2) {
+        i = int_to_pcm16_avx2(i, total_samples, int_samples, pcm_samples,
+                              is_big_endian, is_signed);
+    }
+    if (isa >= PCM_CONV_SSE2) {
+        i = int_to_pcm16_sse2(i, total_samples, int_samples, pcm_samples,
+                              is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_pcm24_to_int(unsigned total_samples,
+                 const unsigned char pcm_samples[],
+                 int int_samples[],
+                 int is_big_endian,
+                 int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_SSSE3) {
+        i = pcm24_to_int_ssse3(i, total_samples, pcm_samples, int_samples,
+                               is_big_endian, is_signed);
+    } else if (isa >= PCM_CONV_SSE2) {
+        i = pcm24_to_int_sse2(i, total_samples, pcm_samples, int_samples,
+                              is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int_to_pcm24(unsigned total_samples,
+                 const int int_samples[],
+                 unsigned char pcm_samples[],
+                 int is_big_endian,
+                 int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_SSSE3) {
+        i = int_to_pcm24_ssse3(i, total_samples, int_samples, pcm_samples,
+                               is_big_endian, is_signed);
+    } else if (isa >= PCM_CONV_SSE2) {
+        i = int_to_pcm24_sse2(i, total_samples, int_samples, pcm_samples,
+                              is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_pcm8_to_int16(unsigned total_samples,
+                  const unsigned char pcm_samples[],
+                  int16_t int16_samples[],
+                  int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = pcm8_to_int16_sse2(i, total_samples, pcm_samples, int16_samples,
+                               is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int16_to_pcm8(unsigned total_samples,
+                  const int16_t int16_samples[],
+                  unsigned char pcm_samples[],
+                  int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = int16_to_pcm8_sse2(i, total_samples, int16_samples, pcm_samples,
+                               is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_pcm16_to_int16(unsigned total_samples,
+                   const unsigned char pcm_samples[],
+                   int16_t int16_samples[],
+                   int is_big_endian,
+                   int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = pcm16_to_int16_sse2(i, total_samples, pcm_samples, int16_samples,
+                                is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int16_to_pcm16(unsigned total_samples,
+                   const int16_t int16_samples[],
+                   unsigned char pcm_samples[],
+                   int is_big_endian,
+                   int is_signed)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = int16_to_pcm16_sse2(i, total_samples, int16_samples, pcm_samples,
+                                is_big_endian, is_signed);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int_to_double(unsigned total_samples,
+                  const int int_samples[],
+                  double double_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_AVX) {
+        i = int_to_double_avx(i, total_samples, int_samples, double_samples,
+                              negative_min, positive_max);
+    }
+    if (isa >= PCM_CONV_SSE2) {
+        i = int_to_double_sse2(i, total_samples, int_samples, double_samples,
+                               negative_min, positive_max);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_int_to_float(unsigned total_samples,
+                 const int int_samples[],
+                 float float_samples[],
+                 int negative_min,
+                 int positive_max)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_AVX) {
+        i = int_to_float_avx(i, total_samples, int_samples, float_samples,
+                             negative_min, positive_max);
+    }
+    if (isa >= PCM_CONV_SSE2) {
+        i = int_to_float_sse2(i, total_samples, int_samples, float_samples,
+                              negative_min, positive_max);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_double_to_int(unsigned total_samples,
+                  const double double_samples[],
+                  int int_samples[],
+                  int negative_min,
+                  int positive_max)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    const pcm_conv_isa_t isa = conv_isa();
+    if (isa >= PCM_CONV_AVX) {
+        i = double_to_int_avx(i, total_samples, double_samples, int_samples,
+                              negative_min, positive_max);
+    }
+    if (isa >= PCM_CONV_SSE2) {
+        i = double_to_int_sse2(i, total_samples, double_samples, int_samples,
+                               negative_min, positive_max);
+    }
+#endif
+    return i;
+}
+
+static inline unsigned
+vec_float_to_int(unsigned total_samples,
+                 const float float_samples[],
+                 int int_samples[],
+                 int negative_min,
+                 int positive_max)
+{
+    unsigned i = 0;
+#if defined(SIMD_X86)
+    if (conv_isa() >= PCM_CONV_SSE2) {
+        i = float_to_int_sse2(i, total_samples, float_samples, int_samples,
+                              negative_min, positive_max);
+    }
+#endif
+    return i;
+}
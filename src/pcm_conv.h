@@ -20,6 +20,8 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+#include <stdint.h>
+
 /*for turning raw PCM bytes into integer values
 
   given "total_samples * (bits_per_sample / 8)" PCM samples
@@ -33,6 +35,21 @@ pcm_to_int_converter(unsigned bits_per_sample,
                      int is_big_endian,
                      int is_signed);
 
+/*for turning raw PCM bytes into 16-bit integer values
+  for PCM data of 16 bits-per-sample or less
+
+  given "total_samples * (bits_per_sample / 8)" PCM samples
+  converts to "total_samples" 16-bit integer samples*/
+typedef void (*pcm_to_int16_f)(unsigned total_samples,
+                               const unsigned char pcm_samples[],
+                               int16_t int16_samples[]);
+
+/*returns NULL if bits_per_sample is greater than 16*/
+pcm_to_int16_f
+pcm_to_int16_converter(unsigned bits_per_sample,
+                       int is_big_endian,
+                       int is_signed);
+
 /*for turning integer values into raw PCM bytes
 
   given "total_samples" integer samples
@@ -46,6 +63,21 @@ int_to_pcm_converter(unsigned bits_per_sample,
                      int is_big_endian,
                      int is_signed);
 
+/*for turning 16-bit integer values into raw PCM bytes
+  for PCM data of 16 bits-per-sample or less
+
+  given "total_samples" 16-bit integer samples
+  converts to "total_samples * (bits_per_sample / 8)" PCM samples*/
+typedef void (*int16_to_pcm_f)(unsigned total_samples,
+                               const int16_t int16_samples[],
+                               unsigned char pcm_samples[]);
+
+/*returns NULL if bits_per_sample is greater than 16*/
+int16_to_pcm_f
+int16_to_pcm_converter(unsigned bits_per_sample,
+                       int is_big_endian,
+                       int is_signed);
+
 /*for turning integer values with the given bits-per-sample
   into double values between -1.0 and 1.0
 
@@ -98,4 +130,29 @@ typedef void (*float_to_int_f)(unsigned total_samples,
 float_to_int_f
 float_to_int_converter(unsigned bits_per_sample);
 
+
+/*the instruction sets the converters have vector kernels for,
+  each of which implies those before it*/
+typedef enum {
+    PCM_CONV_SCALAR,
+    PCM_CONV_SSE2,
+    PCM_CONV_SSSE3,
+    PCM_CONV_AVX,
+    PCM_CONV_AVX2
+} pcm_conv_isa_t;
+
+/*returns the widest instruction set whose kernels this CPU can run*/
+pcm_conv_isa_t
+pcm_conv_supported_isa(void);
+
+/*limits the converters to kernels for "isa" and those before it,
+  or to those the CPU supports if fewer,
+  and returns the instruction set actually in use
+
+  this only affects the converters compiled into the calling module
+  and exists so that each set of kernels can be checked
+  against the scalar loops, which it must match exactly*/
+pcm_conv_isa_t
+pcm_conv_limit_isa(pcm_conv_isa_t isa);
+
 #endif
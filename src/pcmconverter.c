@@ -6,8 +6,12 @@
 #include "pcm_conv.h"
 #include "bitstream.h"
 #include "samplerate/samplerate.h"
+#include "polyphase.h"
+#include "dither.h"
+#include "pcmtee.h"
+#include <pthread.h>
 #include "pcmconverter.h"
-#include "dither.c"
+#include "simd.h"
 
 /********************************************************
  Audio Tools, a module and set of tools for manipulating audio data
@@ -157,9 +161,393 @@ Averager_close(pcmconverter_Averager *self, PyObject *args)
 }
 
 /*******************************************************
- Downmixer for reducing channel count from many to 2
+ Downmixer for reducing channel count from many to 2 or 1
 *******************************************************/
 
+/*returns the PCMReader's channel mask,
+  or invents one based on its channel count if undefined*/
+static unsigned
+downmix_input_mask(const struct PCMReader *pcmreader)
+{
+    if (pcmreader->channel_mask != 0) {
+        return pcmreader->channel_mask;
+    }
+
+    switch (pcmreader->channels) {
+    case 0: return 0x0;
+    case 1: /*fC*/ return 0x4;
+    case 2: /*fL, fR*/ return 0x3;
+    case 3: /*fL, fR, fC*/ return 0x7;
+    case 4: /*fL, fR, bL, bR*/ return 0x33;
+    case 5: /*fL, fR, fC, bL, bR*/ return 0x37;
+    case 6: /*fL, fR, fC, LFE, bL, bR*/ return 0x3F;
+    case 8: /*fL, fR, fC, LFE, bL, bR, sL, sR*/ return 0x63F;
+    default:
+        /*7 or more than 8 channels
+          fL, fR, fC, LFE, bL, bR, ...*/
+        return 0x3F;
+    }
+}
+
+/*each speaker's gain into the left and right of a stereo downmix
+
+  rear and side channels are summed to a back mono channel at 0.7
+  which is then added to the left and subtracted from the right at 0.6
+  while speakers not listed here are dropped*/
+static const struct {
+    unsigned speaker;
+    double left;
+    double right;
+} DOWNMIX_GAINS[] = {
+    {0x001, 1.0, 0.0},          /*fL*/
+    {0x002, 0.0, 1.0},          /*fR*/
+    {0x004, 0.7, 0.7},          /*fC*/
+    {0x008, 0.0, 0.0},          /*LFE*/
+    {0x010, 0.42, -0.42},       /*bL*/
+    {0x020, 0.42, -0.42},       /*bR*/
+    {0x200, 0.42, -0.42},       /*sL*/
+    {0x400, 0.42, -0.42}        /*sR*/
+};
+
+/*fills "matrix" with one row of "input_channels" gains
+  per channel of "output_mask", which is either
+  0x3 for stereo or 0x4 for mono (stereo's average)
+
+  input channels past the highest speaker of "input_mask" are dropped
+
+  returns 0 on success, 1 if "output_mask" is unsupported*/
+static int
+downmix_matrix(unsigned input_mask,
+               unsigned input_channels,
+               unsigned output_mask,
+               double matrix[])
+{
+    const unsigned output_channels = (output_mask == 0x3) ? 2 : 1;
+    unsigned speaker;
+    unsigned c;
+
+    if ((output_mask != 0x3) && (output_mask != 0x4)) {
+        return 1;
+    }
+
+    for (c = 0; c < output_channels * input_channels; c++) {
+        matrix[c] = 0.0;
+    }
+
+    for (c = 0, speaker = 1;
+         (c < input_channels) && (speaker <= input_mask);
+         speaker <<= 1) {
+        unsigned i;
+
+        if (!(input_mask & speaker)) {
+            continue;
+        }
+        for (i = 0; i < sizeof(DOWNMIX_GAINS) / sizeof(DOWNMIX_GAINS[0]);
+             i++) {
+            if (DOWNMIX_GAINS[i].speaker == speaker) {
+                if (output_channels == 2) {
+                    matrix[c] = DOWNMIX_GAINS[i].left;
+                    matrix[input_channels + c] = DOWNMIX_GAINS[i].right;
+                } else {
+                    matrix[c] = (DOWNMIX_GAINS[i].left +
+                                 DOWNMIX_GAINS[i].right) / 2;
+                }
+            }
+        }
+        c++;
+    }
+
+    return 0;
+}
+
+/*the widest mixing kernels new Downmixers may use*/
+static mix_isa_t mix_isa_limit = MIX_AVX;
+
+/*returns the widest instruction set whose mixing kernels
+  this CPU can run*/
+static mix_isa_t
+mix_supported_isa(void)
+{
+#if defined(SIMD_X86)
+    if (simd_supports("avx")) {
+        return MIX_AVX;
+    } else if (simd_supports("sse2")) {
+        return MIX_SSE2;
+    }
+#endif
+    return MIX_SCALAR;
+}
+
+#if defined(SIMD_X86)
+/*each vector kernel handles as many samples as fit its vectors
+  and returns that amount, leaving the remainder to the scalar loop*/
+
+SIMD_TARGET("sse2") static unsigned
+mix_accumulate_sse2(unsigned count,
+                    double gain,
+                    const double input[],
+                    double output[])
+{
+    const __m128d gains = _mm_set1_pd(gain);
+    unsigned i;
+
+    for (i = 0; (i + 2) <= count; i += 2) {
+        _mm_storeu_pd(
+            output + i,
+            _mm_add_pd(_mm_loadu_pd(output + i),
+                       _mm_mul_pd(gains, _mm_loadu_pd(input + i))));
+    }
+    return i;
+}
+
+SIMD_TARGET("avx") static unsigned
+mix_accumulate_avx(unsigned count,
+                   double gain,
+                   const double input[],
+                   double output[])
+{
+    const __m256d gains = _mm256_set1_pd(gain);
+    unsigned i;
+
+    for (i = 0; (i + 4) <= count; i += 4) {
+        _mm256_storeu_pd(
+            output + i,
+            _mm256_add_pd(_mm256_loadu_pd(output + i),
+                          _mm256_mul_pd(gains, _mm256_loadu_pd(input + i))));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2") static unsigned
+mix_round_sse2(unsigned count,
+               const double input[],
+               int minimum,
+               int maximum,
+               int output[])
+{
+    const __m128d lower = _mm_set1_pd(minimum);
+    const __m128d upper = _mm_set1_pd(maximum);
+    unsigned i;
+
+    for (i = 0; (i + 2) <= count; i += 2) {
+        const __m128d clamped =
+            _mm_min_pd(_mm_max_pd(_mm_loadu_pd(input + i), lower), upper);
+        _mm_storel_epi64((__m128i*)(output + i), _mm_cvtpd_epi32(clamped));
+    }
+    return i;
+}
+
+SIMD_TARGET("avx") static unsigned
+mix_round_avx(unsigned count,
+              const double input[],
+              int minimum,
+              int maximum,
+              int output[])
+{
+    const __m256d lower = _mm256_set1_pd(minimum);
+    const __m256d upper = _mm256_set1_pd(maximum);
+    unsigned i;
+
+    for (i = 0; (i + 4) <= count; i += 4) {
+        const __m256d clamped =
+            _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(input + i), lower),
+                          upper);
+        _mm_storeu_si128((__m128i*)(output + i),
+                         _mm256_cvtpd_epi32(clamped));
+    }
+    return i;
+}
+#endif
+
+/*output[i] += gain * input[i] for "count" samples*/
+static void
+mix_accumulate(mix_isa_t isa,
+               unsigned count,
+               double gain,
+               const double input[],
+               double output[])
+{
+    unsigned i = 0;
+
+#if defined(SIMD_X86)
+    switch (isa) {
+    case MIX_AVX:
+        i = mix_accumulate_avx(count, gain, input, output);
+        break;
+    case MIX_SSE2:
+        i = mix_accumulate_sse2(count, gain, input, output);
+        break;
+    default:
+        break;
+    }
+#endif
+
+    for (; i < count; i++) {
+        output[i] += gain * input[i];
+    }
+}
+
+/*clamps "count" mixed samples between "minimum" and "maximum"
+  and rounds them to the nearest integer, ties to even*/
+static void
+mix_round(mix_isa_t isa,
+          unsigned count,
+          const double input[],
+          int minimum,
+          int maximum,
+          int output[])
+{
+    unsigned i = 0;
+
+#if defined(SIMD_X86)
+    switch (isa) {
+    case MIX_AVX:
+        i = mix_round_avx(count, input, minimum, maximum, output);
+        break;
+    case MIX_SSE2:
+        i = mix_round_sse2(count, input, minimum, maximum, output);
+        break;
+    default:
+        break;
+    }
+#endif
+
+    for (; i < count; i++) {
+        output[i] = (int)lrint(MIN(MAX(input[i], minimum), maximum));
+    }
+}
+
+/*names of each mix_isa_t, in order*/
+static const char *mix_kernel_names[] = {"scalar", "sse2", "avx", NULL};
+
+/*returns a list of the first "supported" + 1 kernel names*/
+static PyObject*
+kernel_names(const char *names[], int supported)
+{
+    PyObject *kernels = PyList_New(0);
+    int i;
+
+    if (kernels == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i <= supported; i++) {
+#if PY_MAJOR_VERSION >= 3
+        PyObject *name = PyUnicode_FromString(names[i]);
+#else
+        PyObject *name = PyString_FromString(names[i]);
+#endif
+        if ((name == NULL) || (PyList_Append(kernels, name) == -1)) {
+            Py_XDECREF(name);
+            Py_DECREF(kernels);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+
+    return kernels;
+}
+
+/*returns the index of "name" among the first "supported" + 1 names
+  or -1 with a ValueError set if it isn't one of them*/
+static int
+kernel_index(const char *names[], int supported, const char *name)
+{
+    int i;
+
+    for (i = 0; (i <= supported) && (names[i] != NULL); i++) {
+        if (!strcmp(name, names[i])) {
+            return i;
+        }
+    }
+
+    PyErr_SetString(PyExc_ValueError, "unavailable kernels");
+    return -1;
+}
+
+static PyObject*
+pcmconverter_mixing_kernels(PyObject *dummy, PyObject *args)
+{
+    return kernel_names(mix_kernel_names, (int)mix_supported_isa());
+}
+
+static PyObject*
+pcmconverter_use_mixing_kernels(PyObject *dummy, PyObject *args)
+{
+    char *name;
+    int isa;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    } else if ((isa = kernel_index(mix_kernel_names,
+                                   (int)mix_supported_isa(),
+                                   name)) == -1) {
+        return NULL;
+    }
+
+    mix_isa_limit = (mix_isa_t)isa;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*names of each polyphase_isa_t, in order*/
+static const char *resampling_kernel_names[] =
+    {"scalar", "sse2", "avx", "avx2", NULL};
+
+static PyObject*
+pcmconverter_resampling_kernels(PyObject *dummy, PyObject *args)
+{
+    return kernel_names(resampling_kernel_names,
+                        (int)polyphase_supported_isa());
+}
+
+static PyObject*
+pcmconverter_use_resampling_kernels(PyObject *dummy, PyObject *args)
+{
+    char *name;
+    int isa;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    } else if ((isa = kernel_index(resampling_kernel_names,
+                                   (int)polyphase_supported_isa(),
+                                   name)) == -1) {
+        return NULL;
+    }
+
+    polyphase_limit_isa((polyphase_isa_t)isa);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*names of each dither_isa_t, in order*/
+static const char *dither_kernel_names[] = {"scalar", "sse2", "avx2", NULL};
+
+static PyObject*
+pcmconverter_dither_kernels(PyObject *dummy, PyObject *args)
+{
+    return kernel_names(dither_kernel_names, (int)dither_supported_isa());
+}
+
+static PyObject*
+pcmconverter_use_dither_kernels(PyObject *dummy, PyObject *args)
+{
+    char *name;
+    int isa;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    } else if ((isa = kernel_index(dither_kernel_names,
+                                   (int)dither_supported_isa(),
+                                   name)) == -1) {
+        return NULL;
+    }
+
+    dither_limit_isa((dither_isa_t)isa);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 PyObject*
 Downmixer_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
@@ -175,21 +563,144 @@ Downmixer_dealloc(pcmconverter_Downmixer *self)
 {
     if (self->pcmreader != NULL)
         self->pcmreader->del(self->pcmreader);
+    free(self->matrix);
+    free(self->input);
+    free(self->input_d);
+    free(self->mixed);
     Py_XDECREF(self->audiotools_pcm);
 
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
+/*populates the Downmixer's matrix from a sequence of rows,
+  one per output channel, each with a gain per input channel
+
+  returns 0 on success, or -1 with an exception set*/
+static int
+Downmixer_parse_matrix(pcmconverter_Downmixer *self, PyObject *rows)
+{
+    const unsigned input_channels = self->pcmreader->channels;
+    Py_ssize_t row_count;
+    Py_ssize_t o;
+
+    if ((rows = PySequence_Fast(rows, "matrix must be a sequence")) == NULL)
+        return -1;
+
+    row_count = PySequence_Fast_GET_SIZE(rows);
+    if ((row_count < 1) ||
+        ((self->channel_mask != 0) &&
+         ((unsigned)row_count != self->channels))) {
+        PyErr_SetString(PyExc_ValueError,
+                        "matrix must have a row per output channel");
+        Py_DECREF(rows);
+        return -1;
+    }
+    self->channels = (unsigned)row_count;
+    self->matrix = malloc(sizeof(double) * row_count * input_channels);
+
+    for (o = 0; o < row_count; o++) {
+        PyObject *row =
+            PySequence_Fast(PySequence_Fast_GET_ITEM(rows, o),
+                            "matrix rows must be sequences");
+        Py_ssize_t c;
+
+        if (row == NULL) {
+            Py_DECREF(rows);
+            return -1;
+        }
+        if ((unsigned)PySequence_Fast_GET_SIZE(row) != input_channels) {
+            PyErr_SetString(PyExc_ValueError,
+                            "matrix must have a gain per input channel");
+            Py_DECREF(row);
+            Py_DECREF(rows);
+            return -1;
+        }
+        for (c = 0; c < (Py_ssize_t)input_channels; c++) {
+            const double gain =
+                PyFloat_AsDouble(PySequence_Fast_GET_ITEM(row, c));
+            if ((gain == -1.0) && PyErr_Occurred()) {
+                Py_DECREF(row);
+                Py_DECREF(rows);
+                return -1;
+            }
+            self->matrix[o * input_channels + c] = gain;
+        }
+        Py_DECREF(row);
+    }
+
+    Py_DECREF(rows);
+    return 0;
+}
+
 int
 Downmixer_init(pcmconverter_Downmixer *self, PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"pcmreader", "channel_mask", "matrix", NULL};
+    int channel_mask = -1;
+    PyObject *matrix = NULL;
+    unsigned input_channels;
+
     self->pcmreader = NULL;
+    self->matrix = NULL;
+    self->input = NULL;
+    self->input_d = NULL;
+    self->mixed = NULL;
     self->audiotools_pcm = NULL;
 
-    if (!PyArg_ParseTuple(args, "O&",
-                          py_obj_to_pcmreader,
-                          &(self->pcmreader)))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|iO", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &channel_mask,
+                                     &matrix))
+        return -1;
+
+    if (channel_mask < -1) {
+        PyErr_SetString(PyExc_ValueError, "channel mask must be >= 0");
+        return -1;
+    } else if (channel_mask == -1) {
+        /*custom matrices default to an undefined mask
+          and predefined ones to stereo*/
+        channel_mask = ((matrix != NULL) && (matrix != Py_None)) ? 0 : 0x3;
+    }
+    switch (self->pcmreader->bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError,
+                        "bits per sample must be 8, 16 or 24");
         return -1;
+    }
+
+    input_channels = self->pcmreader->channels;
+    self->channel_mask = (unsigned)channel_mask;
+    self->channels = 0;
+    for (; channel_mask; channel_mask &= (channel_mask - 1)) {
+        self->channels++;
+    }
+
+    if ((matrix != NULL) && (matrix != Py_None)) {
+        /*caller supplies gains for any output channel mask*/
+        if (Downmixer_parse_matrix(self, matrix))
+            return -1;
+    } else {
+        /*use a predefined stereo or mono downmix*/
+        self->matrix = malloc(sizeof(double) * 2 * input_channels);
+        if (downmix_matrix(downmix_input_mask(self->pcmreader),
+                           input_channels,
+                           self->channel_mask,
+                           self->matrix)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "no predefined downmix for channel mask");
+            return -1;
+        }
+    }
+
+    self->input = malloc(sizeof(int) * CHUNK_SIZE * input_channels);
+    self->input_d = malloc(sizeof(double) * CHUNK_SIZE * input_channels);
+    self->mixed = malloc(sizeof(double) * CHUNK_SIZE);
+    self->isa = MIN(mix_supported_isa(), mix_isa_limit);
 
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
@@ -212,102 +723,70 @@ Downmixer_bits_per_sample(pcmconverter_Downmixer *self, void *closure)
 static PyObject*
 Downmixer_channels(pcmconverter_Downmixer *self, void *closure)
 {
-    return Py_BuildValue("I", 2);
+    return Py_BuildValue("I", self->channels);
 }
 
 static PyObject*
 Downmixer_channel_mask(pcmconverter_Downmixer *self, void *closure)
 {
-    return Py_BuildValue("I", 0x3);
+    return Py_BuildValue("I", self->channel_mask);
 }
 
 static PyObject*
 Downmixer_read(pcmconverter_Downmixer *self, PyObject *args)
 {
-    const double REAR_GAIN = 0.6;
-    const double CENTER_GAIN = 0.7;
+    const unsigned input_channels = self->pcmreader->channels;
     const int SAMPLE_MIN = -(1 << (self->pcmreader->bits_per_sample - 1));
     const int SAMPLE_MAX = (1 << (self->pcmreader->bits_per_sample - 1)) - 1;
-    unsigned mask;
-    unsigned input_mask;
-    int pcm_data[CHUNK_SIZE * self->pcmreader->channels];
     const unsigned frames_read = self->pcmreader->read(self->pcmreader,
                                                        CHUNK_SIZE,
-                                                       pcm_data);
+                                                       self->input);
     pcm_FrameList *framelist;
-    unsigned input_channel = 0;
-    unsigned output_channel = 0;
-    unsigned i;
-    static int fL[CHUNK_SIZE];
-    static int fR[CHUNK_SIZE];
-    static int fC[CHUNK_SIZE];
-    static int LFE[CHUNK_SIZE];
-    static int bL[CHUNK_SIZE];
-    static int bR[CHUNK_SIZE];
-    int *six_channels[] = {fL, fR, fC, LFE, bL, bR};
+    unsigned c;
+    unsigned o;
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
         return NULL;
     }
 
-    framelist = new_FrameList(self->audiotools_pcm,
-                              2,
-                              self->pcmreader->bits_per_sample,
-                              frames_read);
-
-    /*ensure PCMReader's channel mask is defined*/
-    if (self->pcmreader->channel_mask != 0) {
-        input_mask = self->pcmreader->channel_mask;
-    } else {
-        /*invent channel mask for input based on channel count*/
-        switch (self->pcmreader->channels) {
-        case 0: input_mask = 0x0; break;
-        case 1: /*fC*/ input_mask = 0x4; break;
-        case 2: /*fL, fR*/ input_mask = 0x3; break;
-        case 3: /*fL, fR, fC*/ input_mask = 0x7; break;
-        case 4: /*fL, fR, bL, bR*/ input_mask = 0x33; break;
-        case 5: /*fL, fR, fC, bL, bR*/ input_mask = 0x37; break;
-        case 6: /*fL, fR, fC, LFE, bL, bR*/ input_mask = 0x3F; break;
-        default:
-            /*more than 6 channels
-              fL, fR, fC, LFE, bL, bR, ...*/
-            input_mask = 0x3F;
-            break;
-        }
-    }
-
-    /*split pcm.FrameList into 6 channels*/
-    for (mask = 1; mask <= 0x20; mask <<= 1) {
-        if (mask & input_mask) {
-            /*PCMReader contains that channel*/
-            get_channel_data(pcm_data,
-                             input_channel++,
-                             self->pcmreader->channels,
-                             frames_read,
-                             six_channels[output_channel++]);
-        } else {
-            /*PCMReader object doesn't contain that channel
-              so pad with a channel of empty samples*/
-            blank_channel_data(frames_read, six_channels[output_channel++]);
+    /*split input into one row of doubles per channel
+      so each output channel is a series of whole-row kernels*/
+    for (c = 0; c < input_channels; c++) {
+        double *row = self->input_d + c * frames_read;
+        const int *input = self->input + c;
+        unsigned i;
+        for (i = 0; i < frames_read; i++) {
+            row[i] = input[i * input_channels];
         }
     }
 
-    for (i = 0; i < frames_read; i++) {
-        /*bM (back mono) = 0.7 * (bL + bR)*/
-        const double mono_rear = 0.7 * (bL[i] + bR[i]);
-
-        /*left  = fL + rear_gain * bM + center_gain * fC*/
-        const long int left_i =
-            lround(fL[i] + REAR_GAIN * mono_rear + CENTER_GAIN * fC[i]);
+    framelist = new_planar_FrameList(self->audiotools_pcm,
+                                     self->channels,
+                                     self->pcmreader->bits_per_sample,
+                                     frames_read);
 
-        /*right = fR - rear_gain * bM + center_gain * fC*/
-        const long int right_i =
-            lround(fR[i] - REAR_GAIN * mono_rear + CENTER_GAIN * fC[i]);
+    for (o = 0; o < self->channels; o++) {
+        const double *gains = self->matrix + o * input_channels;
+        unsigned i;
 
-        put_sample(framelist->samples, 0, 2, i,
-                   (int)(MAX(MIN(left_i, SAMPLE_MAX), SAMPLE_MIN)));
-        put_sample(framelist->samples, 1, 2, i,
-                   (int)(MAX(MIN(right_i, SAMPLE_MAX), SAMPLE_MIN)));
+        for (i = 0; i < frames_read; i++) {
+            self->mixed[i] = 0.0;
+        }
+        for (c = 0; c < input_channels; c++) {
+            if (gains[c] != 0.0) {
+                mix_accumulate(self->isa,
+                               frames_read,
+                               gains[c],
+                               self->input_d + c * frames_read,
+                               self->mixed);
+            }
+        }
+        mix_round(self->isa,
+                  frames_read,
+                  self->mixed,
+                  SAMPLE_MIN,
+                  SAMPLE_MAX,
+                  framelist->samples + o * frames_read);
     }
 
     return (PyObject*)framelist;
@@ -321,7 +800,6 @@ Downmixer_close(pcmconverter_Downmixer *self, PyObject *args)
     return Py_None;
 }
 
-
 /*******************************************************
  Resampler for changing a PCMReader's sample rate
 *******************************************************/
@@ -329,6 +807,109 @@ Downmixer_close(pcmconverter_Downmixer *self, PyObject *args)
 /*the amount of PCM frames to resample at once*/
 #define RESAMPLER_BLOCK_SIZE 4096
 
+/*prepares either a polyphase resampler or a libsamplerate state
+  for "channels" of samples between the two rates,
+  preferring precomputed polyphase filter banks when the
+  ratio between the rates is small enough to allow them
+
+  "src_data" receives input and output buffers which hold
+  "block_size" PCM frames of input and all the resulting output
+
+  returns 0 on success, or -1 with an exception set*/
+static int
+open_resampler(unsigned channels,
+               unsigned input_rate,
+               unsigned output_rate,
+               int quality,
+               unsigned block_size,
+               struct polyphase **polyphase,
+               SRC_STATE **src_state,
+               SRC_DATA *src_data)
+{
+    static const int SRC_CONVERTERS[] = {SRC_SINC_FASTEST,
+                                         SRC_SINC_MEDIUM_QUALITY,
+                                         SRC_SINC_BEST_QUALITY};
+    unsigned output_frames;
+
+    if ((quality < RESAMPLE_FAST) || (quality > RESAMPLE_BEST)) {
+        PyErr_SetString(PyExc_ValueError, "unknown resampling quality");
+        return -1;
+    }
+
+    if ((*polyphase = polyphase_open(channels,
+                                     input_rate,
+                                     output_rate,
+                                     (polyphase_quality_t)quality)) != NULL) {
+        output_frames = polyphase_max_output(*polyphase, block_size);
+    } else {
+        int error;
+
+        if ((*src_state = src_new(SRC_CONVERTERS[quality],
+                                  channels,
+                                  &error)) == NULL) {
+            PyErr_SetString(PyExc_ValueError, src_strerror(error));
+            return -1;
+        }
+        output_frames = block_size;
+    }
+
+    src_data->data_in = malloc(sizeof(float) * block_size * channels);
+    src_data->input_frames = 0;
+    src_data->data_out = malloc(sizeof(float) * output_frames * channels);
+    src_data->output_frames = output_frames;
+    src_data->output_frames_gen = 0;
+    src_data->src_ratio = (double)output_rate / (double)input_rate;
+    src_data->end_of_input = 0;
+
+    return 0;
+}
+
+/*resamples "input_frames" of float samples which have been placed
+  in the input buffer after any of its "input_frames" left over
+  from the previous pass, where 0 frames indicates the end of input
+
+  the resampled frames are placed in the output buffer
+  with their count in "output_frames_gen"
+
+  returns 0 on success, or -1 with an exception set*/
+static int
+run_resampler(struct polyphase *polyphase,
+              SRC_STATE *src_state,
+              SRC_DATA *src_data,
+              unsigned channels,
+              unsigned input_frames)
+{
+    int process_result;
+
+    if (polyphase != NULL) {
+        /*the polyphase resampler keeps its own history
+          so nothing is ever left over*/
+        src_data->output_frames_gen = polyphase_process(polyphase,
+                                                        input_frames,
+                                                        src_data->data_in,
+                                                        src_data->data_out);
+        return 0;
+    }
+
+    src_data->input_frames += input_frames;
+    src_data->end_of_input = (input_frames == 0);
+
+    /*run conversion on input data*/
+    if ((process_result = src_process(src_state, src_data)) != 0) {
+        PyErr_SetString(PyExc_ValueError, src_strerror(process_result));
+        return -1;
+    }
+
+    /*preserve any leftover input data*/
+    memmove(src_data->data_in,
+            src_data->data_in + (src_data->input_frames_used * channels),
+            (src_data->input_frames - src_data->input_frames_used) *
+            channels * sizeof(float));
+    src_data->input_frames -= src_data->input_frames_used;
+
+    return 0;
+}
+
 static PyObject*
 Resampler_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
@@ -342,18 +923,21 @@ Resampler_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 int
 Resampler_init(pcmconverter_Resampler *self, PyObject *args, PyObject *kwds)
 {
-    int error;
+    static char *kwlist[] = {"pcmreader", "sample_rate", "quality", NULL};
+    int quality = RESAMPLE_BEST;
 
     self->pcmreader = NULL;
+    self->polyphase = NULL;
     self->src_state = NULL;
     self->src_data.data_in = NULL;
     self->src_data.data_out = NULL;
     self->audiotools_pcm = NULL;
 
-    if (!PyArg_ParseTuple(args, "O&i",
-                          py_obj_to_pcmreader,
-                          &(self->pcmreader),
-                          &(self->sample_rate)))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i|i", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &(self->sample_rate),
+                                     &quality))
         return -1;
 
     /*basic sanity checking*/
@@ -363,26 +947,16 @@ Resampler_init(pcmconverter_Resampler *self, PyObject *args, PyObject *kwds)
         return -1;
     }
 
-    /*allocate fresh resampler state*/
-    self->src_state = src_new(SRC_SINC_BEST_QUALITY,
-                              self->pcmreader->channels,
-                              &error);
-
-    /*allocate fresh resampler I/O state*/
-    self->src_data.data_in =
-        malloc(sizeof(float) * RESAMPLER_BLOCK_SIZE * self->pcmreader->channels);
-
-    self->src_data.input_frames = 0;
-
-    self->src_data.data_out =
-        malloc(sizeof(float) * RESAMPLER_BLOCK_SIZE * self->pcmreader->channels);
-
-    self->src_data.output_frames = RESAMPLER_BLOCK_SIZE;
-
-    self->src_data.src_ratio = ((double)self->sample_rate /
-                                (double)self->pcmreader->sample_rate);
-
-    self->src_data.end_of_input = 0;
+    /*allocate fresh resampler state and I/O buffers*/
+    if (open_resampler(self->pcmreader->channels,
+                       self->pcmreader->sample_rate,
+                       (unsigned)self->sample_rate,
+                       quality,
+                       RESAMPLER_BLOCK_SIZE,
+                       &(self->polyphase),
+                       &(self->src_state),
+                       &(self->src_data)))
+        return -1;
 
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
@@ -395,6 +969,8 @@ Resampler_dealloc(pcmconverter_Resampler *self)
 {
     if (self->pcmreader)
         self->pcmreader->del(self->pcmreader);
+    if (self->polyphase)
+        polyphase_close(self->polyphase);
     if (self->src_state)
         src_delete(self->src_state);
     free(self->src_data.data_in);
@@ -415,7 +991,6 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
             self->pcmreader,
             (unsigned)(RESAMPLER_BLOCK_SIZE - self->src_data.input_frames),
             pcm_data);
-    int process_result;
     pcm_FrameList *framelist;
 
     if (!frames_read && (self->pcmreader->status != PCM_OK)) {
@@ -428,23 +1003,13 @@ Resampler_read(pcmconverter_Resampler *self, PyObject *args)
                          pcm_data,
                          self->src_data.data_in +
                          (self->src_data.input_frames * channels));
-    self->src_data.input_frames += frames_read;
-    self->src_data.end_of_input = (frames_read == 0);
 
-    /*run conversion on input data*/
-    if ((process_result =
-         src_process(self->src_state, &(self->src_data))) != 0) {
-        PyErr_SetString(PyExc_ValueError, src_strerror(process_result));
+    if (run_resampler(self->polyphase,
+                      self->src_state,
+                      &(self->src_data),
+                      channels,
+                      frames_read))
         return NULL;
-    }
-
-    /*preserve any leftover input data*/
-    memmove(self->src_data.data_in,
-            self->src_data.data_in +
-            (self->src_data.input_frames_used * channels),
-            (self->src_data.input_frames -
-             self->src_data.input_frames_used) * channels * sizeof(float));
-    self->src_data.input_frames -= self->src_data.input_frames_used;
 
     /*build FrameList from output data*/
     framelist = new_FrameList(self->audiotools_pcm,
@@ -496,17 +1061,6 @@ Resampler_channel_mask(pcmconverter_Resampler *self, void *closure)
     return Py_BuildValue("i", channel_mask);
 }
 
-static unsigned
-read_os_random(void *user_data,
-               uint8_t* buffer,
-               unsigned buffer_size);
-
-static int
-close_os_random(void *user_data);
-
-static void
-free_os_random(void *user_data);
-
 static PyObject*
 BPSConverter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
@@ -522,8 +1076,8 @@ BPSConverter_dealloc(pcmconverter_BPSConverter *self)
 {
     if (self->pcmreader != NULL)
         self->pcmreader->del(self->pcmreader);
-    if (self->white_noise != NULL)
-        self->white_noise->close(self->white_noise);
+    if (self->dither != NULL)
+        close_dither(self->dither);
     Py_XDECREF(self->audiotools_pcm);
 
     Py_TYPE(self)->tp_free((PyObject*)self);
@@ -533,14 +1087,21 @@ int
 BPSConverter_init(pcmconverter_BPSConverter *self,
                   PyObject *args, PyObject *kwds)
 {
+    static char *kwlist[] = {"pcmreader",
+                             "bits_per_sample",
+                             "noise_shaping",
+                             NULL};
+    int noise_shaping = DITHER_SHAPING_NONE;
+
     self->pcmreader = NULL;
-    self->white_noise = NULL;
+    self->dither = NULL;
     self->audiotools_pcm = NULL;
 
-    if (!PyArg_ParseTuple(args, "O&i",
-                          py_obj_to_pcmreader,
-                          &(self->pcmreader),
-                          &(self->bits_per_sample)))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i|i", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &(self->bits_per_sample),
+                                     &noise_shaping))
         return -1;
 
     /*ensure bits per sample is supported*/
@@ -555,10 +1116,17 @@ BPSConverter_init(pcmconverter_BPSConverter *self,
         return -1;
     }
 
+    if ((noise_shaping < DITHER_SHAPING_NONE) ||
+        (noise_shaping > DITHER_SHAPING_LIPSHITZ)) {
+        PyErr_SetString(PyExc_ValueError, "unknown noise shaping");
+        return -1;
+    }
+
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
         return -1;
 
-    if ((self->white_noise = open_dither()) == NULL)
+    if ((self->dither = open_dither(self->pcmreader->channels,
+                                    noise_shaping)) == NULL)
         return -1;
 
     return 0;
@@ -623,16 +1191,12 @@ BPSConverter_read(pcmconverter_BPSConverter *self, PyObject *args)
         }
     } else if (shift < 0) {
         /*going from more bits-per-sample to fewer, like 24bps to 16
-          so perform right shift on each sample and add dither*/
-        const unsigned samples_length = FrameList_samples_length(framelist);
-        BitstreamReader *white_noise = self->white_noise;
-        br_read_f read = white_noise->read;
-
-        shift = abs(shift);
-        for (i = 0; i < samples_length; i++) {
-            framelist->samples[i] >>= shift;
-            framelist->samples[i] |= read(white_noise, 1);
-        }
+          so requantize each sample with dither*/
+        dither_shift(self->dither,
+                     FrameList_samples_length(framelist),
+                     abs(shift),
+                     self->bits_per_sample,
+                     framelist->samples);
     }
 
     return (PyObject*)framelist;
@@ -1084,6 +1648,880 @@ FadeOutReader_close(pcmconverter_FadeOutReader *self, PyObject *args)
 }
 
 
+/*******************************************************
+ Converter for changing any combination of
+ channel count, sample rate and bits-per-sample at once
+*******************************************************/
+
+/*fills "matrix" with one row of "input_channels" gains
+  per output channel which mirror the Downmixer, Averager
+  and channel-duplicating stages PCMConverter would otherwise chain
+
+  returns 0 on success, 1 if the conversion is unsupported*/
+static int
+build_mix_matrix(const struct PCMReader *pcmreader,
+                 unsigned output_channels,
+                 double matrix[])
+{
+    const unsigned input_channels = pcmreader->channels;
+    unsigned o;
+
+    if (output_channels > input_channels) {
+        /*pass through existing channels and
+          duplicate the first channel into the rest*/
+        for (o = 0; o < output_channels * input_channels; o++) {
+            matrix[o] = 0.0;
+        }
+        for (o = 0; o < output_channels; o++) {
+            matrix[o * input_channels + ((o < input_channels) ? o : 0)] = 1.0;
+        }
+        return 0;
+    } else if ((output_channels == 1) && (input_channels == 2)) {
+        /*average both channels together*/
+        matrix[0] = matrix[1] = 0.5;
+        return 0;
+    } else if ((output_channels <= 2) && (input_channels > 2)) {
+        return downmix_matrix(downmix_input_mask(pcmreader),
+                              input_channels,
+                              (output_channels == 2) ? 0x3 : 0x4,
+                              matrix);
+    } else {
+        return 1;
+    }
+}
+
+static void
+mix_channels(unsigned pcm_frames,
+             unsigned input_channels,
+             const float input[],
+             unsigned output_channels,
+             const double matrix[],
+             float output[])
+{
+    for (; pcm_frames; pcm_frames--) {
+        unsigned o;
+        for (o = 0; o < output_channels; o++) {
+            const double *gains = matrix + o * input_channels;
+            double accumulator = 0.0;
+            unsigned c;
+            for (c = 0; c < input_channels; c++) {
+                accumulator += gains[c] * input[c];
+            }
+            output[o] = (float)accumulator;
+        }
+        input += input_channels;
+        output += output_channels;
+    }
+}
+
+static PyObject*
+Converter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcmconverter_Converter *self;
+
+    self = (pcmconverter_Converter *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+void
+Converter_dealloc(pcmconverter_Converter *self)
+{
+    if (self->pcmreader != NULL)
+        self->pcmreader->del(self->pcmreader);
+    if (self->polyphase != NULL)
+        polyphase_close(self->polyphase);
+    if (self->src_state != NULL)
+        src_delete(self->src_state);
+    if (self->dither != NULL)
+        close_dither(self->dither);
+    free(self->matrix);
+    free(self->src_data.data_in);
+    free(self->src_data.data_out);
+    free(self->input);
+    free(self->input_f);
+    free(self->mixed);
+    Py_XDECREF(self->audiotools_pcm);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+int
+Converter_init(pcmconverter_Converter *self,
+               PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreader",
+                             "sample_rate",
+                             "channels",
+                             "channel_mask",
+                             "bits_per_sample",
+                             "quality",
+                             "noise_shaping",
+                             NULL};
+    int quality = RESAMPLE_BEST;
+    int noise_shaping = DITHER_SHAPING_NONE;
+    unsigned input_channels;
+    unsigned output_channels;
+    unsigned resample_channels;
+    unsigned mixed_frames = CHUNK_SIZE;
+
+    self->pcmreader = NULL;
+    self->matrix = NULL;
+    self->polyphase = NULL;
+    self->src_state = NULL;
+    self->src_data.data_in = NULL;
+    self->src_data.data_out = NULL;
+    self->dither = NULL;
+    self->input = NULL;
+    self->input_f = NULL;
+    self->mixed = NULL;
+    self->audiotools_pcm = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&iiii|ii", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &(self->sample_rate),
+                                     &(self->channels),
+                                     &(self->channel_mask),
+                                     &(self->bits_per_sample),
+                                     &quality,
+                                     &noise_shaping))
+        return -1;
+
+    /*basic sanity checking*/
+    if (self->sample_rate <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "new sample rate must be positive");
+        return -1;
+    }
+    if (self->channels <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "new channel count must be positive");
+        return -1;
+    }
+    switch (self->bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError,
+                        "new bits per sample must be 8, 16 or 24");
+        return -1;
+    }
+    switch (self->pcmreader->bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError,
+                        "input bits per sample must be 8, 16 or 24");
+        return -1;
+    }
+    if ((noise_shaping < DITHER_SHAPING_NONE) ||
+        (noise_shaping > DITHER_SHAPING_LIPSHITZ)) {
+        PyErr_SetString(PyExc_ValueError, "unknown noise shaping");
+        return -1;
+    }
+
+    input_channels = self->pcmreader->channels;
+    output_channels = (unsigned)self->channels;
+
+    /*compile the channel matrix, if any*/
+    self->mix = (output_channels != input_channels);
+    if (self->mix) {
+        self->matrix = malloc(sizeof(double) *
+                              output_channels * input_channels);
+        if (build_mix_matrix(self->pcmreader,
+                             output_channels,
+                             self->matrix)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "unsupported channel conversion");
+            return -1;
+        }
+        if (output_channels < input_channels) {
+            /*downmixed channels keep their traditional mask*/
+            self->channel_mask = (output_channels == 1) ? 0x4 : 0x3;
+        }
+    } else {
+        self->channel_mask = self->pcmreader->channel_mask;
+    }
+
+    /*resample whichever side of the matrix has fewer channels*/
+    self->mix_before_resample = (output_channels < input_channels);
+    resample_channels = MIN(output_channels, input_channels);
+
+    self->resample = ((unsigned)self->sample_rate !=
+                      self->pcmreader->sample_rate);
+    if (self->resample) {
+        if (open_resampler(resample_channels,
+                           self->pcmreader->sample_rate,
+                           (unsigned)self->sample_rate,
+                           quality,
+                           CHUNK_SIZE,
+                           &(self->polyphase),
+                           &(self->src_state),
+                           &(self->src_data)))
+            return -1;
+        mixed_frames = MAX(mixed_frames,
+                           (unsigned)self->src_data.output_frames);
+    }
+
+    if (self->mix || self->resample) {
+        self->input = malloc(sizeof(int) * CHUNK_SIZE * input_channels);
+        self->input_f = malloc(sizeof(float) * CHUNK_SIZE * input_channels);
+        if (self->mix) {
+            self->mixed =
+                malloc(sizeof(float) * mixed_frames * output_channels);
+        }
+    }
+
+    /*only reductions in bits-per-sample need dither*/
+    if ((unsigned)self->bits_per_sample <
+        self->pcmreader->bits_per_sample) {
+        if ((self->dither = open_dither(output_channels,
+                                        noise_shaping)) == NULL)
+            return -1;
+    }
+
+    if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
+        return -1;
+
+    return 0;
+}
+
+static PyObject*
+Converter_sample_rate(pcmconverter_Converter *self, void *closure)
+{
+    return Py_BuildValue("i", self->sample_rate);
+}
+
+static PyObject*
+Converter_bits_per_sample(pcmconverter_Converter *self, void *closure)
+{
+    return Py_BuildValue("i", self->bits_per_sample);
+}
+
+static PyObject*
+Converter_channels(pcmconverter_Converter *self, void *closure)
+{
+    return Py_BuildValue("i", self->channels);
+}
+
+static PyObject*
+Converter_channel_mask(pcmconverter_Converter *self, void *closure)
+{
+    return Py_BuildValue("i", self->channel_mask);
+}
+
+/*with no remixing or resampling to do,
+  samples stay integers and are simply shifted
+  to the new bits-per-sample*/
+static PyObject*
+Converter_read_shifted(pcmconverter_Converter *self)
+{
+    int shift = self->bits_per_sample - self->pcmreader->bits_per_sample;
+    pcm_FrameList *framelist = new_FrameList(
+        self->audiotools_pcm,
+        self->channels,
+        self->bits_per_sample,
+        CHUNK_SIZE);
+    const unsigned frames_read =
+        self->pcmreader->read(self->pcmreader,
+                              CHUNK_SIZE,
+                              framelist->samples);
+    unsigned samples_length;
+    unsigned i;
+
+    if (!frames_read && (self->pcmreader->status != PCM_OK)) {
+        Py_DECREF((PyObject*)framelist);
+        return NULL;
+    }
+
+    framelist->frames = frames_read;
+    samples_length = FrameList_samples_length(framelist);
+
+    if (shift > 0) {
+        for (i = 0; i < samples_length; i++) {
+            framelist->samples[i] <<= shift;
+        }
+    } else if (shift < 0) {
+        dither_shift(self->dither,
+                     samples_length,
+                     abs(shift),
+                     self->bits_per_sample,
+                     framelist->samples);
+    }
+
+    return (PyObject*)framelist;
+}
+
+static PyObject*
+Converter_read(pcmconverter_Converter *self, PyObject *args)
+{
+    const unsigned input_channels = self->pcmreader->channels;
+    const unsigned output_channels = self->channels;
+    const unsigned resample_channels = MIN(input_channels, output_channels);
+    const int_to_float_f int_to_float =
+        int_to_float_converter(self->pcmreader->bits_per_sample);
+    unsigned frames_read;
+    unsigned output_frames;
+    const float *output;
+    pcm_FrameList *framelist;
+
+    if (!self->mix && !self->resample) {
+        return Converter_read_shifted(self);
+    }
+
+    /*get data from PCMReader*/
+    frames_read = self->pcmreader->read(
+        self->pcmreader,
+        self->resample ?
+        (unsigned)(CHUNK_SIZE - self->src_data.input_frames) :
+        CHUNK_SIZE,
+        self->input);
+
+    if (!frames_read && (self->pcmreader->status != PCM_OK)) {
+        return NULL;
+    }
+
+    if (self->resample) {
+        float *resample_input = self->src_data.data_in +
+            (self->src_data.input_frames * resample_channels);
+
+        /*convert to floats and remix straight into the
+          resampler's input buffer when there are fewer channels after*/
+        if (self->mix && self->mix_before_resample) {
+            int_to_float(frames_read * input_channels,
+                         self->input,
+                         self->input_f);
+            mix_channels(frames_read,
+                         input_channels,
+                         self->input_f,
+                         output_channels,
+                         self->matrix,
+                         resample_input);
+        } else {
+            int_to_float(frames_read * input_channels,
+                         self->input,
+                         resample_input);
+        }
+        if (run_resampler(self->polyphase,
+                          self->src_state,
+                          &(self->src_data),
+                          resample_channels,
+                          frames_read))
+            return NULL;
+
+        output_frames = (unsigned)(self->src_data.output_frames_gen);
+        output = self->src_data.data_out;
+
+        /*remix resampled data when there are more channels after*/
+        if (self->mix && !self->mix_before_resample) {
+            mix_channels(output_frames,
+                         input_channels,
+                         output,
+                         output_channels,
+                         self->matrix,
+                         self->mixed);
+            output = self->mixed;
+        }
+    } else {
+        int_to_float(frames_read * input_channels,
+                     self->input,
+                     self->input_f);
+        mix_channels(frames_read,
+                     input_channels,
+                     self->input_f,
+                     output_channels,
+                     self->matrix,
+                     self->mixed);
+        output_frames = frames_read;
+        output = self->mixed;
+    }
+
+    /*quantize to the new bits-per-sample in a single step*/
+    framelist = new_FrameList(self->audiotools_pcm,
+                              output_channels,
+                              self->bits_per_sample,
+                              output_frames);
+    if (self->dither != NULL) {
+        dither_float(self->dither,
+                     FrameList_samples_length(framelist),
+                     output,
+                     self->bits_per_sample,
+                     framelist->samples);
+    } else {
+        float_to_int_converter(
+            self->bits_per_sample)(FrameList_samples_length(framelist),
+                                   output,
+                                   framelist->samples);
+    }
+
+    return (PyObject*)framelist;
+}
+
+static PyObject*
+Converter_close(pcmconverter_Converter *self, PyObject *args)
+{
+    self->pcmreader->close(self->pcmreader);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+
+static PyObject*
+PCMTee_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    pcmconverter_PCMTee *self;
+
+    self = (pcmconverter_PCMTee *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+/*pthread entry point which feeds a consumer its queued FrameLists
+  until the PCMTee finishes and the queue is empty*/
+static void*
+tee_consumer_thread(void *arg)
+{
+    struct tee_consumer *consumer = arg;
+
+    for (;;) {
+        const pcm_FrameList *framelist;
+        int failed = 0;
+
+        pthread_mutex_lock(&(consumer->mutex));
+        while ((consumer->consumed == consumer->queued) &&
+               (!consumer->finished)) {
+            pthread_cond_wait(&(consumer->queued_cond), &(consumer->mutex));
+        }
+        if (consumer->consumed == consumer->queued) {
+            pthread_mutex_unlock(&(consumer->mutex));
+            return NULL;
+        }
+        framelist = (pcm_FrameList*)consumer->queue[consumer->consumed %
+                                                    consumer->queue_size];
+        pthread_mutex_unlock(&(consumer->mutex));
+
+        /*only this thread sets "failed", so it's safe to check
+          and once set, the rest of the stream is discarded*/
+        if (consumer->failed) {
+            /*do nothing*/
+        } else if (consumer->callback) {
+            failed = consumer->callback->update(consumer->callback->data,
+                                                framelist);
+        } else {
+            PyGILState_STATE state = PyGILState_Ensure();
+            PyObject *result =
+                PyObject_CallFunctionObjArgs(consumer->consumer,
+                                             (PyObject*)framelist,
+                                             NULL);
+            if (result) {
+                Py_DECREF(result);
+            } else {
+                PyErr_Fetch(&(consumer->exc_type),
+                            &(consumer->exc_value),
+                            &(consumer->exc_traceback));
+                failed = 1;
+            }
+            PyGILState_Release(state);
+        }
+
+        pthread_mutex_lock(&(consumer->mutex));
+        if (failed) {
+            consumer->failed = 1;
+        }
+        consumer->consumed++;
+        pthread_cond_signal(&(consumer->consumed_cond));
+        pthread_mutex_unlock(&(consumer->mutex));
+    }
+}
+
+/*releases the FrameLists a consumer has finished with
+
+  the GIL must be held
+  as must the consumer's mutex if its thread is running*/
+static void
+tee_release(struct tee_consumer *consumer)
+{
+    for (; consumer->released != consumer->consumed; consumer->released++) {
+        Py_DECREF(consumer->queue[consumer->released % consumer->queue_size]);
+    }
+}
+
+int
+PCMTee_init(pcmconverter_PCMTee *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"pcmreader",
+                             "consumers",
+                             "queue_size",
+                             NULL};
+    PyObject *consumers;
+    PyObject *consumers_seq;
+    int queue_size = 4;
+    Py_ssize_t count;
+    Py_ssize_t i;
+
+    self->closed = 0;
+    self->pcmreader = NULL;
+    self->consumer_count = 0;
+    self->consumers = NULL;
+    self->audiotools_pcm = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|i", kwlist,
+                                     py_obj_to_pcmreader,
+                                     &(self->pcmreader),
+                                     &consumers,
+                                     &queue_size))
+        return -1;
+
+    if (queue_size < 1) {
+        PyErr_SetString(PyExc_ValueError, "queue size must be > 0");
+        return -1;
+    }
+
+    if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
+        return -1;
+
+    if ((consumers_seq = PySequence_Fast(
+            consumers, "consumers must be a sequence")) == NULL)
+        return -1;
+
+    count = PySequence_Fast_GET_SIZE(consumers_seq);
+    self->consumers = calloc(count ? count : 1, sizeof(struct tee_consumer));
+
+    for (i = 0; i < count; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(consumers_seq, i);
+        struct tee_consumer *consumer = &(self->consumers[i]);
+
+        if (PyCapsule_IsValid(item, PCMTEE_CALLBACK)) {
+            consumer->callback = PyCapsule_GetPointer(item, PCMTEE_CALLBACK);
+        } else if (PyCallable_Check(item)) {
+            consumer->callback = NULL;
+        } else {
+            PyErr_SetString(PyExc_TypeError,
+                            "consumers must be callable");
+            Py_DECREF(consumers_seq);
+            return -1;
+        }
+
+        Py_INCREF(item);
+        consumer->consumer = item;
+        consumer->queue = malloc(sizeof(PyObject*) * queue_size);
+        consumer->queue_size = queue_size;
+        consumer->queued = consumer->consumed = consumer->released = 0;
+        consumer->finished = 0;
+        consumer->failed = 0;
+        consumer->reported = 0;
+        pthread_mutex_init(&(consumer->mutex), NULL);
+        pthread_cond_init(&(consumer->queued_cond), NULL);
+        pthread_cond_init(&(consumer->consumed_cond), NULL);
+        self->consumer_count++;
+
+        if (pthread_create(&(consumer->thread),
+                           NULL,
+                           tee_consumer_thread,
+                           consumer)) {
+            PyErr_SetString(PyExc_OSError,
+                            "unable to start consumer thread");
+            Py_DECREF(consumers_seq);
+            return -1;
+        } else {
+            consumer->started = 1;
+        }
+    }
+
+    Py_DECREF(consumers_seq);
+    return 0;
+}
+
+/*signals each consumer that nothing more will be queued,
+  waits for them to finish what has been
+  and releases those FrameLists*/
+static void
+tee_finish(pcmconverter_PCMTee *self)
+{
+    unsigned i;
+
+    for (i = 0; i < self->consumer_count; i++) {
+        struct tee_consumer *consumer = &(self->consumers[i]);
+        pthread_mutex_lock(&(consumer->mutex));
+        consumer->finished = 1;
+        pthread_cond_signal(&(consumer->queued_cond));
+        pthread_mutex_unlock(&(consumer->mutex));
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < self->consumer_count; i++) {
+        if (self->consumers[i].started) {
+            pthread_join(self->consumers[i].thread, NULL);
+            self->consumers[i].started = 0;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    for (i = 0; i < self->consumer_count; i++) {
+        tee_release(&(self->consumers[i]));
+    }
+}
+
+/*if a consumer has failed, sets its exception and returns 1
+  otherwise returns 0*/
+static int
+tee_raise_failure(pcmconverter_PCMTee *self)
+{
+    unsigned i;
+
+    for (i = 0; i < self->consumer_count; i++) {
+        struct tee_consumer *consumer = &(self->consumers[i]);
+        int failed;
+
+        pthread_mutex_lock(&(consumer->mutex));
+        failed = consumer->failed && !consumer->reported;
+        pthread_mutex_unlock(&(consumer->mutex));
+
+        if (failed) {
+            consumer->reported = 1;
+            if (consumer->exc_type) {
+                PyErr_Restore(consumer->exc_type,
+                              consumer->exc_value,
+                              consumer->exc_traceback);
+                consumer->exc_type = NULL;
+                consumer->exc_value = NULL;
+                consumer->exc_traceback = NULL;
+            } else {
+                PyErr_SetString(PyExc_ValueError, "PCMTee callback failed");
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void
+PCMTee_dealloc(pcmconverter_PCMTee *self)
+{
+    unsigned i;
+
+    if (self->consumers) {
+        tee_finish(self);
+        for (i = 0; i < self->consumer_count; i++) {
+            struct tee_consumer *consumer = &(self->consumers[i]);
+            pthread_mutex_destroy(&(consumer->mutex));
+            pthread_cond_destroy(&(consumer->queued_cond));
+            pthread_cond_destroy(&(consumer->consumed_cond));
+            free(consumer->queue);
+            Py_XDECREF(consumer->consumer);
+            Py_XDECREF(consumer->exc_type);
+            Py_XDECREF(consumer->exc_value);
+            Py_XDECREF(consumer->exc_traceback);
+        }
+        free(self->consumers);
+    }
+    if (self->pcmreader)
+        self->pcmreader->del(self->pcmreader);
+    Py_XDECREF(self->audiotools_pcm);
+
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject*
+PCMTee_sample_rate(pcmconverter_PCMTee *self, void *closure)
+{
+    return Py_BuildValue("I", self->pcmreader->sample_rate);
+}
+
+static PyObject*
+PCMTee_bits_per_sample(pcmconverter_PCMTee *self, void *closure)
+{
+    return Py_BuildValue("I", self->pcmreader->bits_per_sample);
+}
+
+static PyObject*
+PCMTee_channels(pcmconverter_PCMTee *self, void *closure)
+{
+    return Py_BuildValue("I", self->pcmreader->channels);
+}
+
+static PyObject*
+PCMTee_channel_mask(pcmconverter_PCMTee *self, void *closure)
+{
+    return Py_BuildValue("I", self->pcmreader->channel_mask);
+}
+
+/*reads a FrameList of up to "pcm_frames" from the wrapped reader
+  and queues it for every consumer,
+  or returns NULL with an exception set*/
+static pcm_FrameList*
+tee_read(pcmconverter_PCMTee *self, int pcm_frames)
+{
+    pcm_FrameList *framelist;
+    unsigned frames_read;
+    unsigned i;
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "cannot read from closed stream");
+        return NULL;
+    }
+
+    /*surface consumer errors as soon as they're noticed*/
+    if (tee_raise_failure(self)) {
+        return NULL;
+    }
+
+    framelist = new_FrameList(self->audiotools_pcm,
+                              self->pcmreader->channels,
+                              self->pcmreader->bits_per_sample,
+                              pcm_frames);
+
+    frames_read = self->pcmreader->read(self->pcmreader,
+                                        pcm_frames,
+                                        framelist->samples);
+
+    if (!frames_read && (self->pcmreader->status != PCM_OK)) {
+        Py_DECREF((PyObject*)framelist);
+        PyErr_SetString(PyExc_IOError, "I/O error reading from stream");
+        return NULL;
+    }
+
+    if (frames_read != (unsigned)pcm_frames) {
+        framelist->frames = frames_read;
+    }
+
+    if (!frames_read) {
+        return framelist;
+    }
+
+    for (i = 0; i < self->consumer_count; i++) {
+        struct tee_consumer *consumer = &(self->consumers[i]);
+
+        Py_INCREF((PyObject*)framelist);
+        pthread_mutex_lock(&(consumer->mutex));
+        tee_release(consumer);
+        if ((consumer->queued - consumer->consumed) == consumer->queue_size) {
+            /*wait for the consumer to make room
+              which it can't do while we hold the GIL
+              if it's a Python callable*/
+            Py_BEGIN_ALLOW_THREADS
+            while ((consumer->queued - consumer->consumed) ==
+                   consumer->queue_size) {
+                pthread_cond_wait(&(consumer->consumed_cond),
+                                  &(consumer->mutex));
+            }
+            Py_END_ALLOW_THREADS
+            tee_release(consumer);
+        }
+        consumer->queue[consumer->queued % consumer->queue_size] =
+            (PyObject*)framelist;
+        consumer->queued++;
+        pthread_cond_signal(&(consumer->queued_cond));
+        pthread_mutex_unlock(&(consumer->mutex));
+    }
+
+    return framelist;
+}
+
+static PyObject*
+PCMTee_read(pcmconverter_PCMTee *self, PyObject *args)
+{
+    int pcm_frames;
+
+    if (!PyArg_ParseTuple(args, "i", &pcm_frames)) {
+        return NULL;
+    } else if (pcm_frames <= 0) {
+        PyErr_SetString(PyExc_ValueError, "PCM frames must be >= 1");
+        return NULL;
+    }
+
+    return (PyObject*)tee_read(self, pcm_frames);
+}
+
+/*closes the stream and its consumers,
+  returning 0 on success or 1 with a consumer's exception set*/
+static int
+tee_close(pcmconverter_PCMTee *self)
+{
+    if (!self->closed) {
+        self->closed = 1;
+        tee_finish(self);
+        self->pcmreader->close(self->pcmreader);
+    }
+    return tee_raise_failure(self);
+}
+
+static PyObject*
+PCMTee_run(pcmconverter_PCMTee *self, PyObject *args)
+{
+    int pcm_frames = 4096;
+
+    if (!PyArg_ParseTuple(args, "|i", &pcm_frames)) {
+        return NULL;
+    } else if (pcm_frames <= 0) {
+        PyErr_SetString(PyExc_ValueError, "PCM frames must be >= 1");
+        return NULL;
+    }
+
+    /*feed the whole stream to the consumers*/
+    for (;;) {
+        pcm_FrameList *framelist = tee_read(self, pcm_frames);
+        unsigned frames;
+
+        if (!framelist) {
+            /*close the stream but raise the original error*/
+            PyObject *type;
+            PyObject *value;
+            PyObject *traceback;
+
+            PyErr_Fetch(&type, &value, &traceback);
+            if (tee_close(self)) {
+                PyErr_Clear();
+            }
+            PyErr_Restore(type, value, traceback);
+            return NULL;
+        }
+        frames = framelist->frames;
+        Py_DECREF((PyObject*)framelist);
+        if (!frames) {
+            break;
+        }
+    }
+
+    /*then wait for them to finish*/
+    if (tee_close(self)) {
+        return NULL;
+    } else {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+}
+
+static PyObject*
+PCMTee_close(pcmconverter_PCMTee *self, PyObject *args)
+{
+    if (tee_close(self)) {
+        return NULL;
+    } else {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+}
+
+static PyObject*
+PCMTee_enter(pcmconverter_PCMTee *self, PyObject *args)
+{
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject*
+PCMTee_exit(pcmconverter_PCMTee *self, PyObject *args)
+{
+    return PCMTee_close(self, NULL);
+}
+
+
 MOD_INIT(pcmconverter)
 {
     PyObject* m;
@@ -1091,6 +2529,11 @@ MOD_INIT(pcmconverter)
     MOD_DEF(m, "pcmconverter", "a PCM stream conversion module",
             module_methods)
 
+#if PY_VERSION_HEX < 0x03070000
+    /*PCMTee's consumer threads call back into Python*/
+    PyEval_InitThreads();
+#endif
+
     pcmconverter_AveragerType.tp_new = PyType_GenericNew;
     if (PyType_Ready(&pcmconverter_AveragerType) < 0)
         return MOD_ERROR_VAL;
@@ -1119,6 +2562,14 @@ MOD_INIT(pcmconverter)
     if (PyType_Ready(&pcmconverter_FadeOutReaderType) < 0)
         return MOD_ERROR_VAL;
 
+    pcmconverter_ConverterType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_ConverterType) < 0)
+        return MOD_ERROR_VAL;
+
+    pcmconverter_PCMTeeType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&pcmconverter_PCMTeeType) < 0)
+        return MOD_ERROR_VAL;
+
     Py_INCREF(&pcmconverter_AveragerType);
     PyModule_AddObject(m, "Averager",
                        (PyObject *)&pcmconverter_AveragerType);
@@ -1147,5 +2598,25 @@ MOD_INIT(pcmconverter)
     PyModule_AddObject(m, "FadeOutReader",
                        (PyObject *)&pcmconverter_FadeOutReaderType);
 
+    Py_INCREF(&pcmconverter_ConverterType);
+    PyModule_AddObject(m, "Converter",
+                       (PyObject *)&pcmconverter_ConverterType);
+
+    Py_INCREF(&pcmconverter_PCMTeeType);
+    PyModule_AddObject(m, "PCMTee",
+                       (PyObject *)&pcmconverter_PCMTeeType);
+
+    PyModule_AddIntConstant(m, "RESAMPLE_FAST", RESAMPLE_FAST);
+    PyModule_AddIntConstant(m, "RESAMPLE_MEDIUM", RESAMPLE_MEDIUM);
+    PyModule_AddIntConstant(m, "RESAMPLE_BEST", RESAMPLE_BEST);
+    PyModule_AddIntConstant(m, "NOISE_SHAPING_NONE",
+                            DITHER_SHAPING_NONE);
+    PyModule_AddIntConstant(m, "NOISE_SHAPING_FIRST_ORDER",
+                            DITHER_SHAPING_FIRST_ORDER);
+    PyModule_AddIntConstant(m, "NOISE_SHAPING_SECOND_ORDER",
+                            DITHER_SHAPING_SECOND_ORDER);
+    PyModule_AddIntConstant(m, "NOISE_SHAPING_LIPSHITZ",
+                            DITHER_SHAPING_LIPSHITZ);
+
     return MOD_SUCCESS_VAL(m);
 }
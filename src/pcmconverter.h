@@ -17,10 +17,55 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+static PyObject*
+pcmconverter_mixing_kernels(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_use_mixing_kernels(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_resampling_kernels(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_use_resampling_kernels(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_dither_kernels(PyObject *dummy, PyObject *args);
+
+static PyObject*
+pcmconverter_use_dither_kernels(PyObject *dummy, PyObject *args);
+
 PyMethodDef module_methods[] = {
+    {"mixing_kernels", (PyCFunction)pcmconverter_mixing_kernels,
+     METH_NOARGS,
+     "mixing_kernels() -> [kernel name, ...] this CPU can run"},
+    {"use_mixing_kernels", (PyCFunction)pcmconverter_use_mixing_kernels,
+     METH_VARARGS,
+     "use_mixing_kernels(name) -- limits new Downmixers "
+     "to the named kernels and those before them"},
+    {"resampling_kernels", (PyCFunction)pcmconverter_resampling_kernels,
+     METH_NOARGS,
+     "resampling_kernels() -> [kernel name, ...] this CPU can run"},
+    {"use_resampling_kernels",
+     (PyCFunction)pcmconverter_use_resampling_kernels,
+     METH_VARARGS,
+     "use_resampling_kernels(name) -- limits new Resamplers "
+     "to the named kernels and those before them"},
+    {"dither_kernels", (PyCFunction)pcmconverter_dither_kernels,
+     METH_NOARGS,
+     "dither_kernels() -> [kernel name, ...] this CPU can run"},
+    {"use_dither_kernels", (PyCFunction)pcmconverter_use_dither_kernels,
+     METH_VARARGS,
+     "use_dither_kernels(name) -- limits new dithering converters "
+     "to the named kernels and those before them"},
     {NULL}
 };
 
+/*resampling quality levels, matching polyphase_quality_t*/
+#define RESAMPLE_FAST 0
+#define RESAMPLE_MEDIUM 1
+#define RESAMPLE_BEST 2
+
 typedef struct {
     PyObject_HEAD
 
@@ -111,10 +156,28 @@ PyTypeObject pcmconverter_AveragerType = {
 };
 
 
+/*the instruction sets the Downmixer has mixing kernels for,
+  each of which implies those before it*/
+typedef enum {
+    MIX_SCALAR,
+    MIX_SSE2,
+    MIX_AVX
+} mix_isa_t;
+
 typedef struct {
     PyObject_HEAD
 
     struct PCMReader *pcmreader;
+    unsigned channels;               /*the output channel count*/
+    unsigned channel_mask;           /*the output channel mask*/
+    double *matrix;                  /*channels rows of input channel gains*/
+    mix_isa_t isa;                   /*mixing kernels chosen when created*/
+
+    /*working buffers, one set per Downmixer*/
+    int *input;                      /*interleaved input samples*/
+    double *input_d;                 /*one row of samples per input channel*/
+    double *mixed;                   /*one output channel of mixed samples*/
+
     PyObject* audiotools_pcm;
 } pcmconverter_Downmixer;
 
@@ -204,6 +267,7 @@ typedef struct {
     PyObject_HEAD
 
     struct PCMReader *pcmreader;
+    struct polyphase *polyphase;     /*fixed-ratio resampler, if possible*/
     SRC_STATE *src_state;            /*libsamplerate's internal state*/
     SRC_DATA src_data;               /*libsamplerate's processing state*/
     int sample_rate;                 /*the output sample rate*/
@@ -297,7 +361,7 @@ typedef struct {
 
     struct PCMReader *pcmreader;
     int bits_per_sample;
-    BitstreamReader *white_noise;
+    struct dither *dither;
     PyObject *audiotools_pcm;
 } pcmconverter_BPSConverter;
 
@@ -705,3 +769,266 @@ PyTypeObject pcmconverter_FadeOutReaderType = {
     0,                         /* tp_alloc */
     FadeOutReader_new,         /* tp_new */
 };
+
+
+typedef struct {
+    PyObject_HEAD
+
+    struct PCMReader *pcmreader;
+    int sample_rate;                 /*the output sample rate*/
+    int channels;                    /*the output channel count*/
+    int channel_mask;                /*the output channel mask*/
+    int bits_per_sample;             /*the output bits-per-sample*/
+
+    /*the conversion plan, compiled once at init-time*/
+    int mix;                         /*whether channels are remixed*/
+    int mix_before_resample;         /*whether to mix ahead of resampling*/
+    double *matrix;                  /*channels rows of input channel gains*/
+    int resample;                    /*whether the sample rate changes*/
+    struct polyphase *polyphase;     /*fixed-ratio resampler, if possible*/
+    SRC_STATE *src_state;            /*libsamplerate's internal state*/
+    SRC_DATA src_data;               /*libsamplerate's processing state*/
+    struct dither *dither;           /*dither source when reducing bps*/
+
+    /*working buffers, reused by every read*/
+    int *input;                      /*samples from the wrapped reader*/
+    float *input_f;                  /*input samples as floats*/
+    float *mixed;                    /*remixed samples as floats*/
+
+    PyObject *audiotools_pcm;
+} pcmconverter_Converter;
+
+static PyObject*
+Converter_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+Converter_init(pcmconverter_Converter *self,
+               PyObject *args, PyObject *kwds);
+
+void
+Converter_dealloc(pcmconverter_Converter *self);
+
+static PyObject*
+Converter_sample_rate(pcmconverter_Converter *self, void *closure);
+
+static PyObject*
+Converter_bits_per_sample(pcmconverter_Converter *self, void *closure);
+
+static PyObject*
+Converter_channels(pcmconverter_Converter *self, void *closure);
+
+static PyObject*
+Converter_channel_mask(pcmconverter_Converter *self, void *closure);
+
+static PyObject*
+Converter_read(pcmconverter_Converter *self, PyObject *args);
+
+static PyObject*
+Converter_close(pcmconverter_Converter *self, PyObject *args);
+
+PyGetSetDef Converter_getseters[] = {
+    {"sample_rate", (getter)Converter_sample_rate,
+     NULL, "sample rate", NULL},
+    {"bits_per_sample", (getter)Converter_bits_per_sample,
+     NULL, "bits per sample", NULL},
+    {"channels", (getter)Converter_channels,
+     NULL, "channels", NULL},
+    {"channel_mask", (getter)Converter_channel_mask,
+     NULL, "channel_mask", NULL},
+    {NULL}
+};
+
+PyMethodDef Converter_methods[] = {
+    {"read", (PyCFunction)Converter_read, METH_VARARGS, ""},
+    {"close", (PyCFunction)Converter_close, METH_NOARGS, ""},
+    {NULL}
+};
+
+PyTypeObject pcmconverter_ConverterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pcmconverter.Converter",  /*tp_name*/
+    sizeof(pcmconverter_Converter), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)Converter_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "Converter objects",       /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    Converter_methods,         /* tp_methods */
+    0,                         /* tp_members */
+    Converter_getseters,       /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Converter_init,  /* tp_init */
+    0,                         /* tp_alloc */
+    Converter_new,             /* tp_new */
+};
+
+
+/*a consumer of a PCMTee's FrameLists,
+  fed from a bounded queue by its own thread*/
+struct tee_consumer {
+    PyObject *consumer;   /*a callable or PCMTEE_CALLBACK capsule*/
+    const struct pcmtee_callback *callback;  /*or NULL if callable*/
+
+    pthread_t thread;
+    int started;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t queued_cond;
+    pthread_cond_t consumed_cond;
+
+    /*a ring of FrameLists which the PCMTee has queued,
+      the consumer has finished with,
+      and the PCMTee has released, in that order
+
+      only the PCMTee touches references so consumers needn't take the GIL*/
+    PyObject **queue;
+    unsigned queue_size;
+    unsigned queued;
+    unsigned consumed;
+    unsigned released;
+    int finished;         /*set when no more FrameLists will be queued*/
+
+    /*set once the consumer fails,
+      along with the exception the PCMTee should raise*/
+    int failed;
+    int reported;
+    PyObject *exc_type;
+    PyObject *exc_value;
+    PyObject *exc_traceback;
+};
+
+typedef struct {
+    PyObject_HEAD
+
+    int closed;
+    struct PCMReader *pcmreader;
+
+    unsigned consumer_count;
+    struct tee_consumer *consumers;
+
+    PyObject *audiotools_pcm;
+} pcmconverter_PCMTee;
+
+static PyObject*
+PCMTee_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+PCMTee_init(pcmconverter_PCMTee *self, PyObject *args, PyObject *kwds);
+
+void
+PCMTee_dealloc(pcmconverter_PCMTee *self);
+
+static PyObject*
+PCMTee_sample_rate(pcmconverter_PCMTee *self, void *closure);
+
+static PyObject*
+PCMTee_bits_per_sample(pcmconverter_PCMTee *self, void *closure);
+
+static PyObject*
+PCMTee_channels(pcmconverter_PCMTee *self, void *closure);
+
+static PyObject*
+PCMTee_channel_mask(pcmconverter_PCMTee *self, void *closure);
+
+static PyObject*
+PCMTee_read(pcmconverter_PCMTee *self, PyObject *args);
+
+static PyObject*
+PCMTee_run(pcmconverter_PCMTee *self, PyObject *args);
+
+static PyObject*
+PCMTee_close(pcmconverter_PCMTee *self, PyObject *args);
+
+static PyObject*
+PCMTee_enter(pcmconverter_PCMTee *self, PyObject *args);
+
+static PyObject*
+PCMTee_exit(pcmconverter_PCMTee *self, PyObject *args);
+
+PyGetSetDef PCMTee_getseters[] = {
+    {"sample_rate", (getter)PCMTee_sample_rate,
+     NULL, "sample rate", NULL},
+    {"bits_per_sample", (getter)PCMTee_bits_per_sample,
+     NULL, "bits per sample", NULL},
+    {"channels", (getter)PCMTee_channels,
+     NULL, "channels", NULL},
+    {"channel_mask", (getter)PCMTee_channel_mask,
+     NULL, "channel_mask", NULL},
+    {NULL}
+};
+
+PyMethodDef PCMTee_methods[] = {
+    {"read", (PyCFunction)PCMTee_read, METH_VARARGS, ""},
+    {"run", (PyCFunction)PCMTee_run,
+     METH_VARARGS, "run(pcm_frames) -> None"},
+    {"close", (PyCFunction)PCMTee_close, METH_NOARGS, ""},
+    {"__enter__", (PyCFunction)PCMTee_enter,
+     METH_NOARGS, "enter() -> self"},
+    {"__exit__", (PyCFunction)PCMTee_exit,
+     METH_VARARGS, "exit(exc_type, exc_value, traceback) -> None"},
+    {NULL}
+};
+
+PyTypeObject pcmconverter_PCMTeeType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "pcmconverter.PCMTee",     /*tp_name*/
+    sizeof(pcmconverter_PCMTee), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)PCMTee_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "PCMTee objects",          /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    PCMTee_methods,            /* tp_methods */
+    0,                         /* tp_members */
+    PCMTee_getseters,          /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)PCMTee_init,     /* tp_init */
+    0,                         /* tp_alloc */
+    PCMTee_new,                /* tp_new */
+};
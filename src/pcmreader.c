@@ -39,8 +39,20 @@ pcmreader_##name##_del(struct PCMReader *self);
 #ifdef STANDALONE
 READER_DEFS(raw)
 READER_DEFS(error)
+
+/*implements read_planar for readers with no planar data of their own
+  by reading interleaved data and splitting it into channels*/
+static unsigned
+pcmreader_deinterleave_read_planar(struct PCMReader *self,
+                                   unsigned pcm_frames,
+                                   int *channel_data[]);
 #else
 READER_DEFS(python)
+
+static unsigned
+pcmreader_python_read_planar(struct PCMReader *self,
+                             unsigned pcm_frames,
+                             int *channel_data[]);
 #endif
 
 
@@ -78,6 +90,7 @@ pcmreader_open_raw(FILE *file,
     reader->status = PCM_OK;
 
     reader->read = pcmreader_raw_read;
+    reader->read_planar = pcmreader_deinterleave_read_planar;
     reader->close = pcmreader_raw_close;
     reader->del = pcmreader_raw_del;
     return reader;
@@ -108,6 +121,7 @@ pcmreader_open_error(FILE *file,
     reader->status = PCM_OK;
 
     reader->read = pcmreader_error_read;
+    reader->read_planar = pcmreader_deinterleave_read_planar;
     reader->close = pcmreader_error_close;
     reader->del = pcmreader_error_del;
     return reader;
@@ -179,6 +193,7 @@ pcmreader_open_python(PyObject *obj)
     reader->status = PCM_OK;
 
     reader->read = pcmreader_python_read;
+    reader->read_planar = pcmreader_python_read_planar;
     reader->close = pcmreader_python_close;
     reader->del = pcmreader_python_del;
     return reader;
@@ -319,6 +334,26 @@ pcmreader_error_read(struct PCMReader *self,
     }
 }
 
+static unsigned
+pcmreader_deinterleave_read_planar(struct PCMReader *self,
+                                   unsigned pcm_frames,
+                                   int *channel_data[])
+{
+    int pcm_data[pcm_frames * self->channels];
+    const unsigned pcm_frames_read = self->read(self, pcm_frames, pcm_data);
+    unsigned c;
+
+    for (c = 0; c < self->channels; c++) {
+        get_channel_data(pcm_data,
+                         c,
+                         self->channels,
+                         pcm_frames_read,
+                         channel_data[c]);
+    }
+
+    return pcm_frames_read;
+}
+
 static void
 pcmreader_error_close(struct PCMReader *self)
 {
@@ -333,6 +368,67 @@ pcmreader_error_del(struct PCMReader *self)
 
 #else
 
+/*returns the FrameList currently being read from,
+  reading a new one from the wrapped PCMReader if necessary
+  and setting "stream_finished" if it's empty
+
+  returns NULL and sets the reader's status if an error occurs*/
+static pcm_FrameList*
+pcmreader_python_framelist(struct PCMReader *self,
+                           unsigned pcm_frames,
+                           int *stream_finished)
+{
+    PyObject *framelist_obj;
+    pcm_FrameList *framelist;
+
+    if (self->input.python.framelist) {
+        return self->input.python.framelist;
+    }
+
+    /*need to read a new framelist from wrapped PCMReader*/
+    if ((framelist_obj =
+         PyObject_CallMethod(self->input.python.obj,
+                             "read", "i", pcm_frames)) == NULL) {
+        /*ensure result isn't an exception*/
+        self->status = PCM_READ_ERROR;
+        return NULL;
+    }
+
+    /*ensure result is a pcm.FrameList object*/
+    if (Py_TYPE(framelist_obj) ==
+        (PyTypeObject*)self->input.python.framelist_type) {
+        framelist = (pcm_FrameList*)framelist_obj;
+    } else {
+        self->status = PCM_NON_FRAMELIST;
+        Py_DECREF(framelist_obj);
+        return NULL;
+    }
+
+    /*ensure FrameList object matches stream's parameters*/
+    if ((framelist->channels != self->channels) ||
+        (framelist->bits_per_sample != self->bits_per_sample)) {
+        self->status = PCM_INVALID_FRAMELIST;
+        Py_DECREF(framelist_obj);
+        return NULL;
+    }
+
+    *stream_finished = (framelist->frames == 0);
+    self->input.python.framelist = framelist;
+    self->input.python.frames_remaining = framelist->frames;
+    return framelist;
+}
+
+/*removes the FrameList currently being read from
+  if "to_transfer" frames exhausts it*/
+static void
+pcmreader_python_advance(struct PCMReader *self, unsigned to_transfer)
+{
+    if ((self->input.python.frames_remaining -= to_transfer) == 0) {
+        Py_DECREF((PyObject*)self->input.python.framelist);
+        self->input.python.framelist = NULL;
+    }
+}
+
 static unsigned
 pcmreader_python_read(struct PCMReader *self,
                       unsigned pcm_frames,
@@ -343,67 +439,90 @@ pcmreader_python_read(struct PCMReader *self,
 
     while (pcm_frames && !stream_finished) {
         unsigned to_transfer;
-        pcm_FrameList *framelist;
-
-        if (self->input.python.framelist) {
-            framelist = self->input.python.framelist;
-        } else {
-            PyObject *framelist_obj;
-
-            /*need to read a new framelist from wrapped PCMReader*/
-            if ((framelist_obj =
-                 PyObject_CallMethod(self->input.python.obj,
-                                     "read", "i", pcm_frames)) == NULL) {
-                /*ensure result isn't an exception*/
-                self->status = PCM_READ_ERROR;
-                return 0;
-            }
-
-            /*ensure result is a pcm.FrameList object*/
-            if (Py_TYPE(framelist_obj) ==
-                (PyTypeObject*)self->input.python.framelist_type) {
-                framelist = (pcm_FrameList*)framelist_obj;
-            } else {
-                self->status = PCM_NON_FRAMELIST;
-                Py_DECREF(framelist_obj);
-                return 0;
-            }
-
-            /*ensure FrameList object matches stream's parameters*/
-            if ((framelist->channels != self->channels) ||
-                (framelist->bits_per_sample != self->bits_per_sample)) {
-                self->status = PCM_INVALID_FRAMELIST;
-                Py_DECREF(framelist_obj);
-                return 0;
-            }
+        pcm_FrameList *framelist =
+            pcmreader_python_framelist(self, pcm_frames, &stream_finished);
 
-            stream_finished = (framelist->frames == 0);
-            self->input.python.framelist = framelist;
-            self->input.python.frames_remaining = framelist->frames;
+        if (!framelist) {
+            return 0;
         }
 
         /*transfer data from FrameList to buffer*/
         to_transfer = MIN(self->input.python.frames_remaining, pcm_frames);
 
-        memcpy(pcm_data,
-               framelist->samples +
-               (framelist->channels *
-                (framelist->frames - self->input.python.frames_remaining)),
-               sizeof(int) * framelist->channels * to_transfer);
+        FrameList_get_samples(
+            framelist,
+            framelist->channels *
+            (framelist->frames - self->input.python.frames_remaining),
+            framelist->channels * to_transfer,
+            pcm_data);
 
         /*advance buffers*/
         pcm_frames -= to_transfer;
         pcm_data += (to_transfer * framelist->channels);
-        if ((self->input.python.frames_remaining -= to_transfer) == 0) {
-            /*and remove FrameList if we've exhausted it*/
-            Py_DECREF((PyObject*)self->input.python.framelist);
-            self->input.python.framelist = NULL;
-        }
+        pcmreader_python_advance(self, to_transfer);
     }
 
     return initial_frames - pcm_frames;
 }
 
+static unsigned
+pcmreader_python_read_planar(struct PCMReader *self,
+                             unsigned pcm_frames,
+                             int *channel_data[])
+{
+    unsigned frames_read = 0;
+    int stream_finished = 0;
+
+    while ((frames_read < pcm_frames) && !stream_finished) {
+        unsigned to_transfer;
+        unsigned start;
+        unsigned c;
+        pcm_FrameList *framelist =
+            pcmreader_python_framelist(self,
+                                       pcm_frames - frames_read,
+                                       &stream_finished);
+
+        if (!framelist) {
+            return 0;
+        }
+
+        /*transfer data from FrameList to channel buffers*/
+        to_transfer = MIN(self->input.python.frames_remaining,
+                          pcm_frames - frames_read);
+        start = framelist->frames - self->input.python.frames_remaining;
+
+        for (c = 0; c < framelist->channels; c++) {
+            int *output = channel_data[c] + frames_read;
+
+            if (framelist->planar) {
+                memcpy(output,
+                       framelist->samples + (c * framelist->frames) + start,
+                       sizeof(int) * to_transfer);
+            } else if (framelist->storage_bits == 16) {
+                const int16_t *samples16 = framelist->samples16 +
+                    (start * framelist->channels) + c;
+                unsigned i;
+                for (i = 0; i < to_transfer; i++) {
+                    output[i] = samples16[i * framelist->channels];
+                }
+            } else {
+                get_channel_data(framelist->samples +
+                                 (start * framelist->channels),
+                                 c,
+                                 framelist->channels,
+                                 to_transfer,
+                                 output);
+            }
+        }
+
+        /*advance buffers*/
+        frames_read += to_transfer;
+        pcmreader_python_advance(self, to_transfer);
+    }
+
+    return frames_read;
+}
+
 static void
 pcmreader_python_close(struct PCMReader *self)
 {
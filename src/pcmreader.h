@@ -84,6 +84,19 @@ struct PCMReader {
                      unsigned pcm_frames,
                      int *pcm_data);
 
+    /*works like read, but reads up to the given number of PCM frames
+      to one array per channel, each of which must be at least:
+
+      pcm_frames
+
+      long in order to hold the returned data
+
+      this avoids de-interleaving the data with get_channel_data
+      and copies planar FrameLists from decoders straight through*/
+    unsigned (*read_planar)(struct PCMReader *self,
+                            unsigned pcm_frames,
+                            int *channel_data[]);
+
     /*forwards a call to "close" to the wrapped PCMReader object*/
     void (*close)(struct PCMReader *self);
 
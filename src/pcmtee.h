@@ -0,0 +1,47 @@
+#ifndef PCMTEE_H
+#define PCMTEE_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#include "pcm.h"
+
+/*besides Python callables, a pcmconverter.PCMTee accepts
+  C consumers wrapped in a PyCapsule of this name
+  whose pointer is a struct pcmtee_callback
+
+  these run entirely without the GIL,
+  so analyzers can work in parallel with the decoder and each other
+
+  the struct must remain valid as long as the capsule does*/
+#define PCMTEE_CALLBACK "audiotools.pcmconverter.PCMTee.callback"
+
+struct pcmtee_callback {
+    /*called from the PCMTee's worker thread without the GIL
+      for each FrameList read from the stream, in order
+
+      returns 0 on success or nonzero on error,
+      after which the callback is no longer called
+      and the PCMTee raises ValueError*/
+    int (*update)(void *data, const pcm_FrameList *framelist);
+
+    void *data;
+};
+
+#endif
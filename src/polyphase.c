@@ -0,0 +1,646 @@
+#include "polyphase.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "simd.h"
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef MIN
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#endif
+#ifndef MAX
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#endif
+
+/*the largest reduced interpolation factor we'll build banks for*/
+#define MAX_INTERPOLATION 1024
+
+/*the largest filter bank we'll build, in floats*/
+#define MAX_BANK_SIZE (1 << 20)
+
+/*taps per phase are padded to a multiple of this
+  so the vector kernels need no tail handling*/
+#define TAP_ALIGNMENT 8
+
+/*filters one output PCM frame for every channel
+  with the same row of "taps" filter coefficients,
+  starting each channel's window at "start"*/
+typedef void (*filter_frame_f)(unsigned taps,
+                               const float row[],
+                               unsigned channels,
+                               float *const history[],
+                               unsigned start,
+                               float output[]);
+
+struct polyphase {
+    filter_frame_f filter_frame;    /*kernel chosen when opened*/
+    unsigned channels;
+    unsigned interpolation;     /*L, output rate / gcd*/
+    unsigned decimation;        /*M, input rate / gcd*/
+    unsigned taps;              /*taps per phase*/
+    float *bank;                /*"interpolation" rows of "taps"*/
+
+    /*one row of input history per channel, where the first
+      "taps - 1" frames are those preceding the current window*/
+    float **history;
+    unsigned capacity;          /*frames allocated per history row*/
+    unsigned filled;            /*frames present in each history row*/
+
+    /*the next output frame's newest input frame in the history
+      and its filter phase*/
+    unsigned position;
+    unsigned phase;
+
+    uint64_t total_input;
+    uint64_t total_output;
+    int finished;
+};
+
+/*******************************
+ * private function signatures *
+ *******************************/
+
+static unsigned
+gcd(unsigned a, unsigned b);
+
+/*the zeroth-order modified Bessel function of the first kind*/
+static double
+bessel_i0(double x);
+
+static void
+build_bank(struct polyphase *resampler,
+           double attenuation,
+           double rolloff);
+
+/*ensures each history row has room for "frames" more PCM frames*/
+static void
+reserve_history(struct polyphase *resampler, unsigned frames);
+
+/*appends "input_frames" interleaved frames to the history rows,
+  or silence if "input" is NULL*/
+static void
+append_history(struct polyphase *resampler,
+               unsigned input_frames,
+               const float input[]);
+
+/*generates up to "limit" output frames from the history
+  and returns the amount generated*/
+static unsigned
+generate_output(struct polyphase *resampler,
+                uint64_t limit,
+                float output[]);
+
+static void
+filter_frame_scalar(unsigned taps,
+                    const float row[],
+                    unsigned channels,
+                    float *const history[],
+                    unsigned start,
+                    float output[]);
+
+#if defined(SIMD_X86)
+SIMD_TARGET("sse2") static void
+filter_frame_sse2(unsigned taps,
+                  const float row[],
+                  unsigned channels,
+                  float *const history[],
+                  unsigned start,
+                  float output[]);
+
+SIMD_TARGET("avx") static void
+filter_frame_avx(unsigned taps,
+                 const float row[],
+                 unsigned channels,
+                 float *const history[],
+                 unsigned start,
+                 float output[]);
+
+/*works like filter_frame_avx, but with fused multiply-adds*/
+SIMD_TARGET("avx2,fma") static void
+filter_frame_avx2(unsigned taps,
+                  const float row[],
+                  unsigned channels,
+                  float *const history[],
+                  unsigned start,
+                  float output[]);
+#endif
+
+/*the widest kernels new resamplers may use*/
+static polyphase_isa_t isa_limit = POLYPHASE_AVX2;
+
+/***********************************
+ * public function implementations *
+ ***********************************/
+
+struct polyphase*
+polyphase_open(unsigned channels,
+               unsigned input_rate,
+               unsigned output_rate,
+               polyphase_quality_t quality)
+{
+    const unsigned divisor = gcd(input_rate, output_rate);
+    unsigned interpolation;
+    unsigned decimation;
+    double attenuation;
+    double rolloff;
+    double taps;
+    struct polyphase *resampler;
+    unsigned c;
+
+    if ((channels == 0) || (divisor == 0)) {
+        return NULL;
+    }
+
+    interpolation = output_rate / divisor;
+    decimation = input_rate / divisor;
+
+    switch (quality) {
+    case POLYPHASE_FAST:
+        attenuation = 60.0;
+        rolloff = 0.80;
+        break;
+    case POLYPHASE_MEDIUM:
+        attenuation = 90.0;
+        rolloff = 0.90;
+        break;
+    case POLYPHASE_BEST:
+    default:
+        attenuation = 110.0;
+        rolloff = 0.95;
+        break;
+    }
+
+    /*Kaiser's estimate of the filter length needed for the
+      transition band between the passband and the lower Nyquist,
+      in input samples per output sample*/
+    taps = ((attenuation - 7.95) / (2.285 * M_PI * (1.0 - rolloff)));
+    if (decimation > interpolation) {
+        taps = taps * decimation / interpolation;
+    }
+    taps = ceil(taps / TAP_ALIGNMENT) * TAP_ALIGNMENT;
+
+    if ((interpolation > MAX_INTERPOLATION) ||
+        ((interpolation * taps) > MAX_BANK_SIZE)) {
+        return NULL;
+    }
+
+    resampler = malloc(sizeof(struct polyphase));
+    switch (MIN(polyphase_supported_isa(), isa_limit)) {
+#if defined(SIMD_X86)
+    case POLYPHASE_AVX2:
+        resampler->filter_frame = filter_frame_avx2;
+        break;
+    case POLYPHASE_AVX:
+        resampler->filter_frame = filter_frame_avx;
+        break;
+    case POLYPHASE_SSE2:
+        resampler->filter_frame = filter_frame_sse2;
+        break;
+#endif
+    default:
+        resampler->filter_frame = filter_frame_scalar;
+        break;
+    }
+    resampler->channels = channels;
+    resampler->interpolation = interpolation;
+    resampler->decimation = decimation;
+    resampler->taps = (unsigned)taps;
+    resampler->bank = malloc(sizeof(float) * interpolation * resampler->taps);
+    build_bank(resampler, attenuation, rolloff);
+
+    /*history starts with enough silence that the first output frame
+      is centered on the first input frame*/
+    resampler->capacity = 0;
+    resampler->filled = 0;
+    resampler->history = malloc(sizeof(float*) * channels);
+    for (c = 0; c < channels; c++) {
+        resampler->history[c] = NULL;
+    }
+    append_history(resampler, resampler->taps - 1, NULL);
+    resampler->position = resampler->taps / 2 + resampler->taps - 1;
+    resampler->phase = 0;
+
+    resampler->total_input = 0;
+    resampler->total_output = 0;
+    resampler->finished = 0;
+
+    return resampler;
+}
+
+void
+polyphase_close(struct polyphase *resampler)
+{
+    unsigned c;
+
+    for (c = 0; c < resampler->channels; c++) {
+        free(resampler->history[c]);
+    }
+    free(resampler->history);
+    free(resampler->bank);
+    free(resampler);
+}
+
+polyphase_isa_t
+polyphase_supported_isa(void)
+{
+#if defined(SIMD_X86)
+    if (simd_supports("avx2") && simd_supports("fma")) {
+        return POLYPHASE_AVX2;
+    } else if (simd_supports("avx")) {
+        return POLYPHASE_AVX;
+    } else if (simd_supports("sse2")) {
+        return POLYPHASE_SSE2;
+    }
+#endif
+    return POLYPHASE_SCALAR;
+}
+
+polyphase_isa_t
+polyphase_limit_isa(polyphase_isa_t isa)
+{
+    isa_limit = isa;
+    return MIN(polyphase_supported_isa(), isa_limit);
+}
+
+unsigned
+polyphase_max_output(const struct polyphase *resampler,
+                     unsigned input_frames)
+{
+    return (unsigned)(((uint64_t)input_frames + resampler->taps) *
+                      resampler->interpolation /
+                      resampler->decimation) + 2;
+}
+
+unsigned
+polyphase_process(struct polyphase *resampler,
+                  unsigned input_frames,
+                  const float input[],
+                  float output[])
+{
+    if (resampler->finished) {
+        return 0;
+    } else if (input_frames) {
+        append_history(resampler, input_frames, input);
+        resampler->total_input += input_frames;
+        return generate_output(resampler, UINT64_MAX, output);
+    } else {
+        /*pad the stream with enough silence to center
+          the filter on the final input frame
+          and stop once the stream's full length is generated*/
+        const uint64_t total_length =
+            (resampler->total_input * resampler->interpolation +
+             resampler->decimation - 1) / resampler->decimation;
+
+        append_history(resampler, resampler->taps / 2 + 1, NULL);
+        resampler->finished = 1;
+        return generate_output(
+            resampler,
+            total_length - MIN(total_length, resampler->total_output),
+            output);
+    }
+}
+
+/************************************
+ * private function implementations *
+ ************************************/
+
+static unsigned
+gcd(unsigned a, unsigned b)
+{
+    while (b) {
+        const unsigned r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static double
+bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    unsigned k;
+
+    for (k = 1; k < 64; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < (sum * 1e-21))
+            break;
+    }
+    return sum;
+}
+
+static void
+build_bank(struct polyphase *resampler,
+           double attenuation,
+           double rolloff)
+{
+    const unsigned L = resampler->interpolation;
+    const unsigned taps = resampler->taps;
+    const double length = (double)L * taps;
+    const double center = length / 2;
+    /*cutoff in cycles per upsampled sample*/
+    const double cutoff =
+        rolloff / (2.0 * MAX(resampler->interpolation,
+                             resampler->decimation));
+    const double beta = (attenuation > 50.0) ?
+        0.1102 * (attenuation - 8.7) :
+        0.5842 * pow(attenuation - 21.0, 0.4) +
+        0.07886 * (attenuation - 21.0);
+    const double window_scale = 1.0 / bessel_i0(beta);
+    unsigned phase;
+
+    /*each phase's row holds its coefficients in reverse
+      so filtering is a dot product against the history
+      in its natural order*/
+    for (phase = 0; phase < L; phase++) {
+        float *row = resampler->bank + phase * taps;
+        unsigned i;
+
+        for (i = 0; i < taps; i++) {
+            const double offset = (phase + (double)L * (taps - 1 - i)) -
+                                  center;
+            const double ratio = offset / center;
+            const double x = 2.0 * cutoff * offset;
+            const double sinc = (x == 0.0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            const double window = (fabs(ratio) < 1.0) ?
+                bessel_i0(beta * sqrt(1.0 - ratio * ratio)) * window_scale :
+                0.0;
+
+            /*the interpolation factor restores the gain
+              lost to zero-stuffing the input*/
+            row[i] = (float)(L * 2.0 * cutoff * sinc * window);
+        }
+    }
+}
+
+static void
+reserve_history(struct polyphase *resampler, unsigned frames)
+{
+    if ((resampler->filled + frames) > resampler->capacity) {
+        unsigned c;
+
+        resampler->capacity = resampler->filled + frames;
+        for (c = 0; c < resampler->channels; c++) {
+            resampler->history[c] =
+                realloc(resampler->history[c],
+                        sizeof(float) * resampler->capacity);
+        }
+    }
+}
+
+static void
+append_history(struct polyphase *resampler,
+               unsigned input_frames,
+               const float input[])
+{
+    const unsigned channels = resampler->channels;
+    unsigned c;
+
+    reserve_history(resampler, input_frames);
+
+    for (c = 0; c < channels; c++) {
+        float *row = resampler->history[c] + resampler->filled;
+        unsigned i;
+
+        if (input) {
+            for (i = 0; i < input_frames; i++) {
+                row[i] = input[i * channels + c];
+            }
+        } else {
+            for (i = 0; i < input_frames; i++) {
+                row[i] = 0.0;
+            }
+        }
+    }
+
+    resampler->filled += input_frames;
+}
+
+static unsigned
+generate_output(struct polyphase *resampler,
+                uint64_t limit,
+                float output[])
+{
+    const unsigned channels = resampler->channels;
+    const unsigned taps = resampler->taps;
+    const unsigned L = resampler->interpolation;
+    const unsigned M = resampler->decimation;
+    unsigned position = resampler->position;
+    unsigned phase = resampler->phase;
+    unsigned generated = 0;
+    unsigned discard;
+    unsigned c;
+
+    while ((position < resampler->filled) && (generated < limit)) {
+        resampler->filter_frame(taps,
+                                resampler->bank + phase * taps,
+                                channels,
+                                resampler->history,
+                                position - (taps - 1),
+                                output);
+        output += channels;
+        generated++;
+
+        phase += M;
+        position += phase / L;
+        phase %= L;
+    }
+
+    /*keep only the history the next output frame needs*/
+    discard = MIN(position - (taps - 1), resampler->filled);
+    for (c = 0; c < channels; c++) {
+        memmove(resampler->history[c],
+                resampler->history[c] + discard,
+                sizeof(float) * (resampler->filled - discard));
+    }
+    resampler->filled -= discard;
+    resampler->position = position - discard;
+    resampler->phase = phase;
+    resampler->total_output += generated;
+
+    return generated;
+}
+
+static void
+filter_frame_scalar(unsigned taps,
+                    const float row[],
+                    unsigned channels,
+                    float *const history[],
+                    unsigned start,
+                    float output[])
+{
+    unsigned c;
+
+    for (c = 0; c < channels; c++) {
+        const float *x = history[c] + start;
+        float sum = 0.0;
+        unsigned i;
+
+        for (i = 0; i < taps; i++) {
+            sum += row[i] * x[i];
+        }
+        output[c] = sum;
+    }
+}
+
+#if defined(SIMD_X86)
+SIMD_TARGET("sse2") static inline float
+sum128(__m128 s)
+{
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+SIMD_TARGET("avx") static inline float
+sum256(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v),
+                          _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+SIMD_TARGET("sse2") static void
+filter_frame_sse2(unsigned taps,
+                  const float row[],
+                  unsigned channels,
+                  float *const history[],
+                  unsigned start,
+                  float output[])
+{
+    unsigned c = 0;
+
+    /*channels are filtered in pairs so each
+      load of coefficients is shared by both*/
+    for (; (c + 2) <= channels; c += 2) {
+        const float *x0 = history[c] + start;
+        const float *x1 = history[c + 1] + start;
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 4) {
+            const __m128 h = _mm_loadu_ps(row + i);
+            sum0 = _mm_add_ps(_mm_mul_ps(h, _mm_loadu_ps(x0 + i)), sum0);
+            sum1 = _mm_add_ps(_mm_mul_ps(h, _mm_loadu_ps(x1 + i)), sum1);
+        }
+        output[c] = sum128(sum0);
+        output[c + 1] = sum128(sum1);
+    }
+    for (; c < channels; c++) {
+        const float *x = history[c] + start;
+        __m128 sum = _mm_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 4) {
+            sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row + i),
+                                        _mm_loadu_ps(x + i)),
+                             sum);
+        }
+        output[c] = sum128(sum);
+    }
+}
+
+SIMD_TARGET("avx") static void
+filter_frame_avx(unsigned taps,
+                 const float row[],
+                 unsigned channels,
+                 float *const history[],
+                 unsigned start,
+                 float output[])
+{
+    unsigned c = 0;
+
+    for (; (c + 2) <= channels; c += 2) {
+        const float *x0 = history[c] + start;
+        const float *x1 = history[c + 1] + start;
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 8) {
+            const __m256 h = _mm256_loadu_ps(row + i);
+            sum0 = _mm256_add_ps(_mm256_mul_ps(h, _mm256_loadu_ps(x0 + i)),
+                                 sum0);
+            sum1 = _mm256_add_ps(_mm256_mul_ps(h, _mm256_loadu_ps(x1 + i)),
+                                 sum1);
+        }
+        output[c] = sum256(sum0);
+        output[c + 1] = sum256(sum1);
+    }
+    for (; c < channels; c++) {
+        const float *x = history[c] + start;
+        __m256 sum = _mm256_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 8) {
+            sum = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row + i),
+                                              _mm256_loadu_ps(x + i)),
+                                sum);
+        }
+        output[c] = sum256(sum);
+    }
+}
+
+SIMD_TARGET("avx2,fma") static void
+filter_frame_avx2(unsigned taps,
+                  const float row[],
+                  unsigned channels,
+                  float *const history[],
+                  unsigned start,
+                  float output[])
+{
+    unsigned c = 0;
+
+    for (; (c + 2) <= channels; c += 2) {
+        const float *x0 = history[c] + start;
+        const float *x1 = history[c + 1] + start;
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 8) {
+            const __m256 h = _mm256_loadu_ps(row + i);
+            sum0 = _mm256_fmadd_ps(h, _mm256_loadu_ps(x0 + i), sum0);
+            sum1 = _mm256_fmadd_ps(h, _mm256_loadu_ps(x1 + i), sum1);
+        }
+        output[c] = sum256(sum0);
+        output[c + 1] = sum256(sum1);
+    }
+    for (; c < channels; c++) {
+        const float *x = history[c] + start;
+        __m256 sum = _mm256_setzero_ps();
+        unsigned i;
+
+        for (i = 0; i < taps; i += 8) {
+            sum = _mm256_fmadd_ps(_mm256_loadu_ps(row + i),
+                                  _mm256_loadu_ps(x + i),
+                                  sum);
+        }
+        output[c] = sum256(sum);
+    }
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef POLYPHASE_H
+#define POLYPHASE_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*a fixed-ratio polyphase FIR resampler
+
+  the ratio between the two sample rates is reduced to
+  "interpolation / decimation" and a Kaiser-windowed sinc filter
+  is precomputed as one bank of taps per interpolation phase
+  so that each output sample is a single dot product
+
+  this is much faster than libsamplerate's general sinc converter
+  for the handful of rate pairs which reduce to small ratios,
+  such as 44100 <-> 48000, 88200 -> 44100 or 192000 -> 48000*/
+
+typedef enum {
+    POLYPHASE_FAST,      /*60dB stopband, 80% passband*/
+    POLYPHASE_MEDIUM,    /*90dB stopband, 90% passband*/
+    POLYPHASE_BEST       /*110dB stopband, 95% passband*/
+} polyphase_quality_t;
+
+struct polyphase;
+
+/*the instruction sets the resampler has filter kernels for,
+  each of which implies those before it*/
+typedef enum {
+    POLYPHASE_SCALAR,
+    POLYPHASE_SSE2,
+    POLYPHASE_AVX,
+    POLYPHASE_AVX2       /*AVX2 with fused multiply-adds*/
+} polyphase_isa_t;
+
+/*returns the widest instruction set whose kernels this CPU can run*/
+polyphase_isa_t
+polyphase_supported_isa(void);
+
+/*limits resamplers opened from now on to kernels for "isa"
+  and those before it, or to those the CPU supports if fewer,
+  and returns the instruction set they will use
+
+  this exists so that each set of kernels can be checked
+  against the scalar one, which differs only in
+  the order its products are summed*/
+polyphase_isa_t
+polyphase_limit_isa(polyphase_isa_t isa);
+
+/*returns a resampler of interleaved float samples
+  with the given number of channels between the two rates
+
+  returns NULL if the rates don't reduce to a ratio
+  whose filter banks are small enough to precompute,
+  in which case the caller should fall back to libsamplerate*/
+struct polyphase*
+polyphase_open(unsigned channels,
+               unsigned input_rate,
+               unsigned output_rate,
+               polyphase_quality_t quality);
+
+void
+polyphase_close(struct polyphase *resampler);
+
+/*returns the most PCM frames a single call to polyphase_process
+  may generate from the given number of input PCM frames*/
+unsigned
+polyphase_max_output(const struct polyphase *resampler,
+                     unsigned input_frames);
+
+/*resamples "input_frames" of interleaved samples from "input"
+  to "output" and returns the number of PCM frames generated
+
+  output is aligned with the input such that
+  the whole stream resamples to ceil(input * output_rate / input_rate)
+  PCM frames, without any leading filter delay
+
+  an "input_frames" of 0 indicates the end of the stream
+  and flushes the filter's remaining output,
+  after which no further frames are generated*/
+unsigned
+polyphase_process(struct polyphase *resampler,
+                  unsigned input_frames,
+                  const float input[],
+                  float output[]);
+
+#endif
@@ -4,8 +4,10 @@
 #include "framelist.h"
 #include "pcmreader.h"
 #include "bitstream.h"
-#include "dither.c"
+#include "dither.h"
+#include "pcmtee.h"
 #include "replaygain.h"
+#include "simd.h"
 
 /*
  *  ReplayGainAnalysis - analyzes input samples and give the recommended dB change
@@ -43,12 +45,21 @@
 #endif
 
 PyMethodDef module_methods[] = {
+    {"filter_kernels", (PyCFunction)replaygain_filter_kernels,
+     METH_NOARGS,
+     "filter_kernels() -> [kernel name, ...] this CPU can run"},
+    {"use_filter_kernels", (PyCFunction)replaygain_use_filter_kernels,
+     METH_VARARGS,
+     "use_filter_kernels(name) -- limits new analyzers "
+     "to the named kernels and those before them"},
     {NULL}
 };
 
 PyGetSetDef ReplayGain_getseters[] = {
     {"sample_rate",
      (getter)ReplayGain_sample_rate, NULL, "sample rate", NULL},
+    {"callback",
+     (getter)ReplayGain_callback, NULL, "PCMTee callback capsule", NULL},
     {NULL}
 };
 
@@ -65,6 +76,10 @@ PyMethodDef ReplayGain_methods[] = {
      METH_NOARGS, "album_peak() -> album peak float"},
     {"next_title", (PyCFunction)ReplayGain_next_title,
      METH_NOARGS, "call after each title is completed"},
+    {"album_histogram", (PyCFunction)ReplayGain_album_histogram,
+     METH_NOARGS, "album_histogram() -> album loudness histogram bytes"},
+    {"merge", (PyCFunction)ReplayGain_merge,
+     METH_VARARGS, "merge(album_histogram, album_peak) -> None"},
     {NULL}
 };
 
@@ -109,6 +124,112 @@ PyTypeObject replaygain_ReplayGainType = {
     ReplayGain_new,            /* tp_new */
 };
 
+static int
+replaygain_update(void *data, const pcm_FrameList *framelist);
+
+static int
+r128_update(void *data, const pcm_FrameList *framelist);
+
+static int
+levels_update(void *data, const pcm_FrameList *framelist);
+
+static void
+callback_capsule_destructor(PyObject *capsule)
+{
+    Py_XDECREF((PyObject*)PyCapsule_GetContext(capsule));
+}
+
+/*returns a PCMTEE_CALLBACK capsule of one of this module's analyzers
+  which keeps the analyzer alive as long as a PCMTee might call it*/
+static PyObject*
+callback_capsule(PyObject *analyzer, struct pcmtee_callback *callback)
+{
+    PyObject *capsule = PyCapsule_New(callback,
+                                      PCMTEE_CALLBACK,
+                                      callback_capsule_destructor);
+    if (capsule) {
+        Py_INCREF(analyzer);
+        PyCapsule_SetContext(capsule, analyzer);
+    }
+    return capsule;
+}
+
+/*the widest filter kernels new analyzers may use*/
+static replaygain_isa_t isa_limit = REPLAYGAIN_SSE2;
+
+/*names of each replaygain_isa_t, in order*/
+static const char *filter_kernel_names[] = {"scalar", "sse2", NULL};
+
+/*returns the widest instruction set whose filter kernels
+  this CPU can run*/
+static replaygain_isa_t
+replaygain_supported_isa(void)
+{
+#if defined(SIMD_X86)
+    if (simd_supports("sse2")) {
+        return REPLAYGAIN_SSE2;
+    }
+#endif
+    return REPLAYGAIN_SCALAR;
+}
+
+/*returns the kernels a new analyzer should use*/
+static replaygain_isa_t
+replaygain_usable_isa(void)
+{
+    const replaygain_isa_t supported = replaygain_supported_isa();
+    return MIN(supported, isa_limit);
+}
+
+PyObject*
+replaygain_filter_kernels(PyObject *dummy, PyObject *args)
+{
+    PyObject *kernels = PyList_New(0);
+    int i;
+
+    if (kernels == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i <= (int)replaygain_supported_isa(); i++) {
+#if PY_MAJOR_VERSION >= 3
+        PyObject *name = PyUnicode_FromString(filter_kernel_names[i]);
+#else
+        PyObject *name = PyString_FromString(filter_kernel_names[i]);
+#endif
+        if ((name == NULL) || (PyList_Append(kernels, name) == -1)) {
+            Py_XDECREF(name);
+            Py_DECREF(kernels);
+            return NULL;
+        }
+        Py_DECREF(name);
+    }
+
+    return kernels;
+}
+
+PyObject*
+replaygain_use_filter_kernels(PyObject *dummy, PyObject *args)
+{
+    char *name;
+    int i;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    }
+
+    for (i = 0; i <= (int)replaygain_supported_isa(); i++) {
+        if (!strcmp(name, filter_kernel_names[i])) {
+            isa_limit = (replaygain_isa_t)i;
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+    }
+
+    PyErr_SetString(PyExc_ValueError, "unavailable kernels");
+    return NULL;
+}
+
 void
 ReplayGain_dealloc(replaygain_ReplayGain* self)
 {
@@ -153,13 +274,10 @@ ReplayGain_init(replaygain_ReplayGain *self, PyObject *args, PyObject *kwds)
     self->sample_rate = (unsigned)sample_rate;
 
     /* zero out initial values*/
-    for (i = 0; i < MAX_ORDER; i++ )
-        self->linprebuf[i] =
-            self->lstepbuf[i] =
-            self->loutbuf[i] =
-            self->rinprebuf[i] =
-            self->rstepbuf[i] =
-            self->routbuf[i] = 0.;
+    for (i = 0; i < MAX_ORDER * 2; i++ )
+        self->inprebuf[i] =
+            self->stepbuf[i] =
+            self->outbuf[i] = 0.;
 
     switch (sample_rate) {
     case 48000: self->freqindex = 0; break;
@@ -188,6 +306,7 @@ ReplayGain_init(replaygain_ReplayGain *self, PyObject *args, PyObject *kwds)
     }
 
     self->sampleWindow = (int)ceil(sample_rate * RMS_WINDOW_TIME);
+    self->isa = replaygain_usable_isa();
 
     self->lsum         = 0.;
     self->rsum         = 0.;
@@ -195,15 +314,14 @@ ReplayGain_init(replaygain_ReplayGain *self, PyObject *args, PyObject *kwds)
 
     memset (self->A, 0, sizeof(self->A));
 
-    self->linpre       = self->linprebuf + MAX_ORDER;
-    self->rinpre       = self->rinprebuf + MAX_ORDER;
-    self->lstep        = self->lstepbuf  + MAX_ORDER;
-    self->rstep        = self->rstepbuf  + MAX_ORDER;
-    self->lout         = self->loutbuf   + MAX_ORDER;
-    self->rout         = self->routbuf   + MAX_ORDER;
+    self->inpre        = self->inprebuf + MAX_ORDER * 2;
+    self->step         = self->stepbuf  + MAX_ORDER * 2;
+    self->out          = self->outbuf   + MAX_ORDER * 2;
 
     memset (self->B, 0, sizeof(self->B));
 
+    self->callback.update = replaygain_update;
+    self->callback.data = self;
 
     return 0;
 }
@@ -214,6 +332,12 @@ ReplayGain_sample_rate(replaygain_ReplayGain *self, void *closure)
     return Py_BuildValue("I", self->sample_rate);
 }
 
+static PyObject*
+ReplayGain_callback(replaygain_ReplayGain *self, void *closure)
+{
+    return callback_capsule((PyObject*)self, &(self->callback));
+}
+
 PyObject*
 ReplayGain_next_title(replaygain_ReplayGain *self)
 {
@@ -225,13 +349,10 @@ ReplayGain_next_title(replaygain_ReplayGain *self)
         self->A[i]  = 0;
     }
 
-    for ( i = 0; i < MAX_ORDER; i++ )
-        self->linprebuf[i] =
-            self->lstepbuf[i] =
-            self->loutbuf[i] =
-            self->rinprebuf[i] =
-            self->rstepbuf[i] =
-            self->routbuf[i] = 0.f;
+    for ( i = 0; i < MAX_ORDER * 2; i++ )
+        self->inprebuf[i] =
+            self->stepbuf[i] =
+            self->outbuf[i] = 0.f;
 
     self->totsamp = 0;
     self->lsum    = self->rsum = 0.;
@@ -242,95 +363,128 @@ ReplayGain_next_title(replaygain_ReplayGain *self)
     return Py_None;
 }
 
-#define CHUNK_SIZE 4096
-
-PyObject*
-ReplayGain_update(replaygain_ReplayGain *self, PyObject *args)
+/*analyzes a FrameList of 8, 16 or 24 bits-per-sample
+  without touching any Python state,
+  returning 0 on success or 1 on error*/
+static int
+replaygain_update(void *data, const pcm_FrameList *framelist)
 {
-    pcm_FrameList* framelist;
+    replaygain_ReplayGain *self = data;
     unsigned total_frames;
-    const int *samples;
-    int32_t peak_shift;
-    static int left_i[CHUNK_SIZE];
-    static int right_i[CHUNK_SIZE];
-    static double left_f[CHUNK_SIZE];
-    static double right_f[CHUNK_SIZE];
-
-    if (!PyArg_ParseTuple(args, "O!", self->framelist_type, &framelist))
-        return NULL;
+    unsigned frame = 0;
+    unsigned right;
+    int peak_shift;
+    int shift;
+
+    /*analysis runs on 16-bit samples*/
+    switch (framelist->bits_per_sample) {
+    case 8:
+        shift = -8;
+        break;
+    case 16:
+        shift = 0;
+        break;
+    case 24:
+        shift = 8;
+        break;
+    default:
+        return 1;
+    }
 
     peak_shift = 1 << (framelist->bits_per_sample - 1);
     total_frames = framelist->frames;
-    samples = framelist->samples;
+
+    /*analyze a maximum of 2 channels
+      and if 1 channel, duplicate to right channel*/
+    right = framelist->channels > 1 ? 1 : 0;
 
     /*FrameList could be very large, so process it in chunks
       rather than all at once*/
     while (total_frames) {
-        const unsigned to_process = MIN(total_frames, CHUNK_SIZE);
+        const unsigned to_process = MIN(total_frames, REPLAYGAIN_CHUNK_SIZE);
+        const unsigned channels = framelist->channels;
+        double *samples = self->samples;
+        int peak = 0;
         unsigned i;
 
-        /*split FrameList's packed ints into a set of channels
-          to a maximum of 2 channels*/
-        get_channel_data(samples,
-                         0,
-                         framelist->channels,
-                         to_process,
-                         left_i);
-
-        /*if 1 channel, duplicate to right channel*/
-        get_channel_data(samples,
-                         framelist->channels > 1 ? 1 : 0,
-                         framelist->channels,
-                         to_process,
-                         right_i);
-
-
-        /*calculate peak values*/
-        for (i = 0; i < to_process; i++) {
-            const double peak_l = ((double)(abs(left_i[i]))) / peak_shift;
-            const double peak_r = ((double)(abs(right_i[i]))) / peak_shift;
-            const double peak = MAX(peak_l, peak_r);
-            self->title_peak = MAX(self->title_peak, peak);
-            self->album_peak = MAX(self->album_peak, peak);
+        /*interleave channels as doubles at 16 bits-per-sample
+          while finding the largest magnitude among them*/
+#define INTERLEAVE(LEFT, RIGHT)                                 \
+        for (i = 0; i < to_process; i++) {                      \
+            const int l = (LEFT);                               \
+            const int r = (RIGHT);                              \
+            peak = MAX(peak, MAX(abs(l), abs(r)));              \
+            samples[i * 2] =                                    \
+                shift >= 0 ? (double)(l >> shift) :             \
+                             (double)(l << -shift);             \
+            samples[i * 2 + 1] =                                \
+                shift >= 0 ? (double)(r >> shift) :             \
+                             (double)(r << -shift);             \
         }
 
-        /*convert channels to 16-bit doubles*/
-        switch (framelist->bits_per_sample) {
-        case 8:
-            for (i = 0; i < to_process; i++) {
-                left_f[i] = (double)(left_i[i] << 8);
-                right_f[i] = (double)(right_i[i] << 8);
-            }
-            break;
-        case 16:
-            for (i = 0; i < to_process; i++) {
-                left_f[i] = (double)(left_i[i]);
-                right_f[i] = (double)(right_i[i]);
-            }
-            break;
-        case 24:
-            for (i = 0; i < to_process; i++) {
-                left_f[i] = (double)(left_i[i] >> 8);
-                right_f[i] = (double)(right_i[i] >> 8);
-            }
-            break;
-        default:
-            PyErr_SetString(PyExc_ValueError, "unsupported bits per sample");
-            return NULL;
+        if (framelist->storage_bits == 16) {
+            const int16_t *samples16 =
+                framelist->samples16 + frame * channels;
+            INTERLEAVE(samples16[i * channels],
+                       samples16[i * channels + right])
+        } else if (framelist->planar) {
+            const int *left_samples = framelist->samples + frame;
+            const int *right_samples =
+                framelist->samples + right * framelist->frames + frame;
+            INTERLEAVE(left_samples[i], right_samples[i])
+        } else {
+            const int *samples32 = framelist->samples + frame * channels;
+            INTERLEAVE(samples32[i * channels],
+                       samples32[i * channels + right])
         }
+#undef INTERLEAVE
+
+        /*calculate peak values*/
+        self->title_peak = MAX(self->title_peak, (double)peak / peak_shift);
+        self->album_peak = MAX(self->album_peak, (double)peak / peak_shift);
 
         /*perform gain analysis on channels*/
         if (ReplayGain_analyze_samples(self,
-                                       left_f,
-                                       right_f,
-                                       to_process,
-                                       2) == GAIN_ANALYSIS_ERROR) {
-            PyErr_SetString(PyExc_ValueError, "ReplayGain calculation error");
-            return NULL;
+                                       samples,
+                                       to_process) == GAIN_ANALYSIS_ERROR) {
+            return 1;
         }
 
         total_frames -= to_process;
-        samples += (to_process * framelist->channels);
+        frame += to_process;
+    }
+
+    return 0;
+}
+
+PyObject*
+ReplayGain_update(replaygain_ReplayGain *self, PyObject *args)
+{
+    pcm_FrameList* framelist;
+    int error;
+
+    if (!PyArg_ParseTuple(args, "O!", self->framelist_type, &framelist))
+        return NULL;
+
+    switch (framelist->bits_per_sample) {
+    case 8:
+    case 16:
+    case 24:
+        break;
+    default:
+        PyErr_SetString(PyExc_ValueError, "unsupported bits per sample");
+        return NULL;
+    }
+
+    /*neither the FrameList nor the analyzer is shared,
+      so analysis runs without holding the GIL*/
+    Py_BEGIN_ALLOW_THREADS
+    error = replaygain_update(self, framelist);
+    Py_END_ALLOW_THREADS
+
+    if (error) {
+        PyErr_SetString(PyExc_ValueError, "ReplayGain calculation error");
+        return NULL;
     }
 
     Py_INCREF(Py_None);
@@ -375,6 +529,46 @@ ReplayGain_album_peak(replaygain_ReplayGain *self)
     return Py_BuildValue("d", self->album_peak);
 }
 
+PyObject*
+ReplayGain_album_histogram(replaygain_ReplayGain *self)
+{
+    return PyBytes_FromStringAndSize((const char*)self->B, sizeof(self->B));
+}
+
+PyObject*
+ReplayGain_merge(replaygain_ReplayGain *self, PyObject *args)
+{
+    const char *histogram;
+    Py_ssize_t histogram_size;
+    double peak;
+    unsigned i;
+#if PY_MAJOR_VERSION >= 3
+    char format[] = "y#d";
+#else
+    char format[] = "s#d";
+#endif
+
+    if (!PyArg_ParseTuple(args, format, &histogram, &histogram_size, &peak))
+        return NULL;
+
+    if (histogram_size != sizeof(self->B)) {
+        PyErr_SetString(PyExc_ValueError, "invalid histogram size");
+        return NULL;
+    }
+
+    /*album gain is taken from the sum of every title's
+      loudness histogram, so albums can be analyzed in pieces*/
+    for (i = 0; i < STEPS_per_dB_times_MAX_dB; i++) {
+        uint32_t count;
+        memcpy(&count, histogram + i * sizeof(uint32_t), sizeof(uint32_t));
+        self->B[i] += count;
+    }
+    self->album_peak = MAX(self->album_peak, peak);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 PyGetSetDef ReplayGainReader_getseters[] = {
     {"sample_rate",
      (getter)ReplayGainReader_sample_rate, NULL, "sample rate", NULL},
@@ -437,6 +631,132 @@ PyTypeObject replaygain_ReplayGainReaderType = {
     ReplayGainReader_new,      /* tp_new */
 };
 
+/*EBU R128 loudness metering, as described in ITU-R BS.1770-4
+  and EBU Tech 3341 and 3342*/
+
+PyGetSetDef R128_getseters[] = {
+    {"sample_rate",
+     (getter)R128_sample_rate, NULL, "sample rate", NULL},
+    {"channels",
+     (getter)R128_channels, NULL, "channels", NULL},
+    {"callback",
+     (getter)R128_callback, NULL, "PCMTee callback capsule", NULL},
+    {NULL}
+};
+
+PyMethodDef R128_methods[] = {
+    {"update", (PyCFunction)R128_update,
+     METH_VARARGS, "update(FrameList) -> None"},
+    {"integrated_loudness", (PyCFunction)R128_integrated_loudness,
+     METH_NOARGS, "integrated_loudness() -> integrated loudness in LUFS"},
+    {"loudness_range", (PyCFunction)R128_loudness_range,
+     METH_NOARGS, "loudness_range() -> loudness range in LU"},
+    {"true_peak", (PyCFunction)R128_true_peak,
+     METH_NOARGS, "true_peak() -> linear true peak float"},
+    {NULL}
+};
+
+PyTypeObject replaygain_R128Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "replaygain.R128",         /*tp_name*/
+    sizeof(replaygain_R128),   /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)R128_dealloc,  /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "R128 objects",            /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    R128_methods,              /* tp_methods */
+    0,                         /* tp_members */
+    R128_getseters,            /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)R128_init,       /* tp_init */
+    0,                         /* tp_alloc */
+    R128_new,                  /* tp_new */
+};
+
+
+PyGetSetDef Levels_getseters[] = {
+    {"channels",
+     (getter)Levels_channels, NULL, "channels", NULL},
+    {"callback",
+     (getter)Levels_callback, NULL, "PCMTee callback capsule", NULL},
+    {NULL}
+};
+
+PyMethodDef Levels_methods[] = {
+    {"update", (PyCFunction)Levels_update,
+     METH_VARARGS, "update(FrameList) -> None"},
+    {"peaks", (PyCFunction)Levels_peaks,
+     METH_NOARGS, "peaks() -> [peak float per channel]"},
+    {"dc_offsets", (PyCFunction)Levels_dc_offsets,
+     METH_NOARGS, "dc_offsets() -> [DC offset float per channel]"},
+    {NULL}
+};
+
+PyTypeObject replaygain_LevelsType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "replaygain.Levels",       /*tp_name*/
+    sizeof(replaygain_Levels), /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    (destructor)Levels_dealloc, /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    0,                         /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "Levels objects",          /* tp_doc */
+    0,                         /* tp_traverse */
+    0,                         /* tp_clear */
+    0,                         /* tp_richcompare */
+    0,                         /* tp_weaklistoffset */
+    0,                         /* tp_iter */
+    0,                         /* tp_iternext */
+    Levels_methods,            /* tp_methods */
+    0,                         /* tp_members */
+    Levels_getseters,          /* tp_getset */
+    0,                         /* tp_base */
+    0,                         /* tp_dict */
+    0,                         /* tp_descr_get */
+    0,                         /* tp_descr_set */
+    0,                         /* tp_dictoffset */
+    (initproc)Levels_init,     /* tp_init */
+    0,                         /* tp_alloc */
+    Levels_new,                /* tp_new */
+};
+
 
 
 MOD_INIT(replaygain)
@@ -455,6 +775,14 @@ MOD_INIT(replaygain)
     if (PyType_Ready(&replaygain_ReplayGainReaderType) < 0)
         return MOD_ERROR_VAL;
 
+    replaygain_R128Type.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&replaygain_R128Type) < 0)
+        return MOD_ERROR_VAL;
+
+    replaygain_LevelsType.tp_new = PyType_GenericNew;
+    if (PyType_Ready(&replaygain_LevelsType) < 0)
+        return MOD_ERROR_VAL;
+
     Py_INCREF(&replaygain_ReplayGainType);
     PyModule_AddObject(m, "ReplayGain",
                        (PyObject *)&replaygain_ReplayGainType);
@@ -463,6 +791,14 @@ MOD_INIT(replaygain)
     PyModule_AddObject(m, "ReplayGainReader",
                        (PyObject *)&replaygain_ReplayGainReaderType);
 
+    Py_INCREF(&replaygain_R128Type);
+    PyModule_AddObject(m, "R128",
+                       (PyObject *)&replaygain_R128Type);
+
+    Py_INCREF(&replaygain_LevelsType);
+    PyModule_AddObject(m, "Levels",
+                       (PyObject *)&replaygain_LevelsType);
+
     return MOD_SUCCESS_VAL(m);
 }
 
@@ -600,76 +936,175 @@ static const double ABButter[20][2*BUTTER_ORDER + 1] = {
 
 /* When calling these filter procedures, make sure that ip[-order] and op[-order] point to real data! */
 
-/* If your compiler complains that "'operation on 'output' may be undefined", you can */
-/* either ignore the warnings or uncomment the three "y" lines (and comment out the indicated line) */
+/* samples are interleaved pairs, so each filter runs both channels
+   at once in the two lanes of an SSE2 register when available;
+   every tap is accumulated in the same order in either case */
 
 static void
-filterYule (const double* input, double* output, size_t nSamples,
-            const double* kernel)
+filterYule_scalar (const double* input, double* output, size_t nSamples,
+                   const double* kernel)
 {
     while (nSamples--) {
-        *output =  1e-10  /* 1e-10 is a hack to avoid slowdown because of denormals */
-            + input [0]  * kernel[0]
-            - output[-1] * kernel[1]
-            + input [-1] * kernel[2]
-            - output[-2] * kernel[3]
-            + input [-2] * kernel[4]
-            - output[-3] * kernel[5]
-            + input [-3] * kernel[6]
-            - output[-4] * kernel[7]
-            + input [-4] * kernel[8]
-            - output[-5] * kernel[9]
-            + input [-5] * kernel[10]
-            - output[-6] * kernel[11]
-            + input [-6] * kernel[12]
-            - output[-7] * kernel[13]
-            + input [-7] * kernel[14]
-            - output[-8] * kernel[15]
-            + input [-8] * kernel[16]
-            - output[-9] * kernel[17]
-            + input [-9] * kernel[18]
-            - output[-10]* kernel[19]
-            + input [-10]* kernel[20];
-        ++output;
-        ++input;
+        int c;
+        for (c = 0; c < 2; c++) {
+            double y = 1e-10 + input[c] * kernel[0]; /* 1e-10 is a hack to avoid slowdown because of denormals */
+            int i;
+            for (i = 1; i <= YULE_ORDER; i++) {
+                y -= output[c - 2 * i] * kernel[2 * i - 1];
+                y += input[c - 2 * i] * kernel[2 * i];
+            }
+            output[c] = y;
+        }
+        output += 2;
+        input += 2;
+    }
+}
+
+static void
+filterButter_scalar (const double* input, double* output, size_t nSamples, const double* kernel)
+{
+    while (nSamples--) {
+        int c;
+        for (c = 0; c < 2; c++) {
+            output[c] =
+                input [c]      * kernel[0]
+                - output[c - 2] * kernel[1]
+                + input [c - 2] * kernel[2]
+                - output[c - 4] * kernel[3]
+                + input [c - 4] * kernel[4];
+        }
+        output += 2;
+        input += 2;
     }
 }
 
 static void
-filterButter (const double* input, double* output, size_t nSamples, const double* kernel)
+sumSquares_scalar (const double* samples, size_t nSamples, double* lsum, double* rsum)
+{
+    double l = *lsum;
+    double r = *rsum;
+
+    while (nSamples--) {
+        l += samples[0] * samples[0];
+        r += samples[1] * samples[1];
+        samples += 2;
+    }
+    *lsum = l;
+    *rsum = r;
+}
+
+#if defined(SIMD_X86)
+SIMD_TARGET("sse2") static void
+filterYule_sse2 (const double* input, double* output, size_t nSamples,
+                 const double* kernel)
+{
+    __m128d k[2 * YULE_ORDER + 1];
+    const __m128d bias = _mm_set1_pd(1e-10);
+    unsigned i;
+
+    for (i = 0; i < 2 * YULE_ORDER + 1; i++)
+        k[i] = _mm_set1_pd(kernel[i]);
+
+    while (nSamples--) {
+        __m128d y = _mm_add_pd(bias, _mm_mul_pd(_mm_loadu_pd(input), k[0]));
+        for (i = 1; i <= YULE_ORDER; i++) {
+            y = _mm_sub_pd(y, _mm_mul_pd(_mm_loadu_pd(output - 2 * i),
+                                         k[2 * i - 1]));
+            y = _mm_add_pd(y, _mm_mul_pd(_mm_loadu_pd(input - 2 * i),
+                                         k[2 * i]));
+        }
+        _mm_storeu_pd(output, y);
+        output += 2;
+        input += 2;
+    }
+}
+
+SIMD_TARGET("sse2") static void
+filterButter_sse2 (const double* input, double* output, size_t nSamples, const double* kernel)
+{
+    const __m128d k0 = _mm_set1_pd(kernel[0]);
+    const __m128d k1 = _mm_set1_pd(kernel[1]);
+    const __m128d k2 = _mm_set1_pd(kernel[2]);
+    const __m128d k3 = _mm_set1_pd(kernel[3]);
+    const __m128d k4 = _mm_set1_pd(kernel[4]);
+
+    while (nSamples--) {
+        __m128d y = _mm_mul_pd(_mm_loadu_pd(input), k0);
+        y = _mm_sub_pd(y, _mm_mul_pd(_mm_loadu_pd(output - 2), k1));
+        y = _mm_add_pd(y, _mm_mul_pd(_mm_loadu_pd(input - 2), k2));
+        y = _mm_sub_pd(y, _mm_mul_pd(_mm_loadu_pd(output - 4), k3));
+        y = _mm_add_pd(y, _mm_mul_pd(_mm_loadu_pd(input - 4), k4));
+        _mm_storeu_pd(output, y);
+        output += 2;
+        input += 2;
+    }
+}
+
+SIMD_TARGET("sse2") static void
+sumSquares_sse2 (const double* samples, size_t nSamples, double* lsum, double* rsum)
 {
+    __m128d sum = _mm_set_pd(*rsum, *lsum);
+
     while (nSamples--) {
-        *output =
-            input [0]  * kernel[0]
-            - output[-1] * kernel[1]
-            + input [-1] * kernel[2]
-            - output[-2] * kernel[3]
-            + input [-2] * kernel[4];
-        ++output;
-        ++input;
+        const __m128d s = _mm_loadu_pd(samples);
+        sum = _mm_add_pd(sum, _mm_mul_pd(s, s));
+        samples += 2;
+    }
+    _mm_storel_pd(lsum, sum);
+    _mm_storeh_pd(rsum, sum);
+}
+#endif
+
+static void
+filterYule (replaygain_isa_t isa, const double* input, double* output,
+            size_t nSamples, const double* kernel)
+{
+#if defined(SIMD_X86)
+    if (isa >= REPLAYGAIN_SSE2) {
+        filterYule_sse2(input, output, nSamples, kernel);
+        return;
+    }
+#endif
+    filterYule_scalar(input, output, nSamples, kernel);
+}
+
+static void
+filterButter (replaygain_isa_t isa, const double* input, double* output,
+              size_t nSamples, const double* kernel)
+{
+#if defined(SIMD_X86)
+    if (isa >= REPLAYGAIN_SSE2) {
+        filterButter_sse2(input, output, nSamples, kernel);
+        return;
     }
+#endif
+    filterButter_scalar(input, output, nSamples, kernel);
 }
 
-static inline double
-fsqr(const double d)
+/* adds the squares of each channel's filtered samples to its sum */
+static void
+sumSquares (replaygain_isa_t isa, const double* samples, size_t nSamples,
+            double* lsum, double* rsum)
 {
-    return d * d;
+#if defined(SIMD_X86)
+    if (isa >= REPLAYGAIN_SSE2) {
+        sumSquares_sse2(samples, nSamples, lsum, rsum);
+        return;
+    }
+#endif
+    sumSquares_scalar(samples, nSamples, lsum, rsum);
 }
 
 /* returns GAIN_ANALYSIS_OK if successful, GAIN_ANALYSIS_ERROR if not */
 gain_calc_status
 ReplayGain_analyze_samples(replaygain_ReplayGain* self,
-                           const double* left_samples,
-                           const double* right_samples,
-                           size_t num_samples,
-                           int num_channels)
+                           const double* samples,
+                           size_t num_samples)
 {
-    const double*  curleft;
-    const double*  curright;
+    const double*  cursamples_in;
     long            batchsamples;
     long            cursamples;
     long            cursamplepos;
-    long            i;
 
     if ( num_samples == 0 )
         return GAIN_ANALYSIS_OK;
@@ -677,85 +1112,30 @@ ReplayGain_analyze_samples(replaygain_ReplayGain* self,
     cursamplepos = 0;
     batchsamples = num_samples;
 
-    switch ( num_channels) {
-    case  1: right_samples = left_samples;
-    case  2: break;
-    default: return GAIN_ANALYSIS_ERROR;
-    }
-
     if ( num_samples < MAX_ORDER ) {
-        memcpy (self->linprebuf + MAX_ORDER, left_samples , num_samples * sizeof(double) );
-        memcpy ( self->rinprebuf + MAX_ORDER, right_samples, num_samples * sizeof(double) );
+        memcpy ( self->inprebuf + MAX_ORDER * 2, samples, num_samples * 2 * sizeof(double) );
     }
     else {
-        memcpy ( self->linprebuf + MAX_ORDER, left_samples,  MAX_ORDER   * sizeof(double) );
-        memcpy ( self->rinprebuf + MAX_ORDER, right_samples, MAX_ORDER   * sizeof(double) );
+        memcpy ( self->inprebuf + MAX_ORDER * 2, samples, MAX_ORDER * 2 * sizeof(double) );
     }
 
     while ( batchsamples > 0 ) {
         cursamples = batchsamples > self->sampleWindow - self->totsamp  ?  self->sampleWindow - self->totsamp  :  batchsamples;
         if ( cursamplepos < MAX_ORDER ) {
-            curleft  = self->linpre + cursamplepos;
-            curright = self->rinpre + cursamplepos;
+            cursamples_in = self->inpre + cursamplepos * 2;
             if (cursamples > MAX_ORDER - cursamplepos )
                 cursamples = MAX_ORDER - cursamplepos;
         }
         else {
-            curleft  = left_samples  + cursamplepos;
-            curright = right_samples + cursamplepos;
+            cursamples_in = samples + cursamplepos * 2;
         }
 
-        YULE_FILTER ( curleft , self->lstep + self->totsamp, cursamples, ABYule[self->freqindex]);
-        YULE_FILTER ( curright, self->rstep + self->totsamp, cursamples, ABYule[self->freqindex]);
+        YULE_FILTER ( self->isa, cursamples_in, self->step + self->totsamp * 2, cursamples, ABYule[self->freqindex]);
 
-        BUTTER_FILTER ( self->lstep + self->totsamp, self->lout + self->totsamp, cursamples, ABButter[self->freqindex]);
-        BUTTER_FILTER ( self->rstep + self->totsamp, self->rout + self->totsamp, cursamples, ABButter[self->freqindex]);
+        BUTTER_FILTER ( self->isa, self->step + self->totsamp * 2, self->out + self->totsamp * 2, cursamples, ABButter[self->freqindex]);
 
-        curleft = self->lout + self->totsamp; /* Get the squared values */
-        curright = self->rout + self->totsamp;
-
-        i = cursamples % 16;
-        while (i--)
-            {   self->lsum += fsqr(*curleft++);
-                self->rsum += fsqr(*curright++);
-            }
-        i = cursamples / 16;
-        while (i--)
-            {   self->lsum += fsqr(curleft[0])
-                    + fsqr(curleft[1])
-                    + fsqr(curleft[2])
-                    + fsqr(curleft[3])
-                    + fsqr(curleft[4])
-                    + fsqr(curleft[5])
-                    + fsqr(curleft[6])
-                    + fsqr(curleft[7])
-                    + fsqr(curleft[8])
-                    + fsqr(curleft[9])
-                    + fsqr(curleft[10])
-                    + fsqr(curleft[11])
-                    + fsqr(curleft[12])
-                    + fsqr(curleft[13])
-                    + fsqr(curleft[14])
-                    + fsqr(curleft[15]);
-                curleft += 16;
-                self->rsum += fsqr(curright[0])
-                    + fsqr(curright[1])
-                    + fsqr(curright[2])
-                    + fsqr(curright[3])
-                    + fsqr(curright[4])
-                    + fsqr(curright[5])
-                    + fsqr(curright[6])
-                    + fsqr(curright[7])
-                    + fsqr(curright[8])
-                    + fsqr(curright[9])
-                    + fsqr(curright[10])
-                    + fsqr(curright[11])
-                    + fsqr(curright[12])
-                    + fsqr(curright[13])
-                    + fsqr(curright[14])
-                    + fsqr(curright[15]);
-                curright += 16;
-            }
+        /* Get the squared values */
+        sumSquares ( self->isa, self->out + self->totsamp * 2, cursamples, &(self->lsum), &(self->rsum) );
 
         batchsamples -= cursamples;
         cursamplepos += cursamples;
@@ -767,24 +1147,19 @@ ReplayGain_analyze_samples(replaygain_ReplayGain* self,
             if ( ival >= (int)(sizeof(self->A)/sizeof(*(self->A))) ) ival = sizeof(self->A)/sizeof(*(self->A)) - 1;
             self->A [ival]++;
             self->lsum = self->rsum = 0.;
-            memmove ( self->loutbuf , self->loutbuf  + self->totsamp, MAX_ORDER * sizeof(double) );
-            memmove ( self->routbuf , self->routbuf  + self->totsamp, MAX_ORDER * sizeof(double) );
-            memmove ( self->lstepbuf, self->lstepbuf + self->totsamp, MAX_ORDER * sizeof(double) );
-            memmove ( self->rstepbuf, self->rstepbuf + self->totsamp, MAX_ORDER * sizeof(double) );
+            memmove ( self->outbuf , self->outbuf  + self->totsamp * 2, MAX_ORDER * 2 * sizeof(double) );
+            memmove ( self->stepbuf, self->stepbuf + self->totsamp * 2, MAX_ORDER * 2 * sizeof(double) );
             self->totsamp = 0;
         }
         if ( self->totsamp > self->sampleWindow )   /* somehow I really screwed up: Error in programming! Contact author about self->totsamp > self->sampleWindow */
             return GAIN_ANALYSIS_ERROR;
     }
     if ( num_samples < MAX_ORDER ) {
-        memmove ( self->linprebuf,                           self->linprebuf + num_samples, (MAX_ORDER-num_samples) * sizeof(double) );
-        memmove ( self->rinprebuf,                           self->rinprebuf + num_samples, (MAX_ORDER-num_samples) * sizeof(double) );
-        memcpy  ( self->linprebuf + MAX_ORDER - num_samples, left_samples,          num_samples             * sizeof(double) );
-        memcpy  ( self->rinprebuf + MAX_ORDER - num_samples, right_samples,         num_samples             * sizeof(double) );
+        memmove ( self->inprebuf,                                 self->inprebuf + num_samples * 2, (MAX_ORDER-num_samples) * 2 * sizeof(double) );
+        memcpy  ( self->inprebuf + (MAX_ORDER - num_samples) * 2, samples,                          num_samples * 2                 * sizeof(double) );
     }
     else {
-        memcpy  ( self->linprebuf, left_samples  + num_samples - MAX_ORDER, MAX_ORDER * sizeof(double) );
-        memcpy  ( self->rinprebuf, right_samples + num_samples - MAX_ORDER, MAX_ORDER * sizeof(double) );
+        memcpy  ( self->inprebuf, samples + (num_samples - MAX_ORDER) * 2, MAX_ORDER * 2 * sizeof(double) );
     }
 
     return GAIN_ANALYSIS_OK;
@@ -845,7 +1220,7 @@ ReplayGainReader_init(replaygain_ReplayGainReader *self,
 
     self->stream_closed = 0;
     self->pcmreader = NULL;
-    self->white_noise = NULL;
+    self->dither = NULL;
     self->audiotools_pcm = NULL;
 
 
@@ -855,7 +1230,8 @@ ReplayGainReader_init(replaygain_ReplayGainReader *self,
                           &(peak)))
         return -1;
 
-    if ((self->white_noise = open_dither()) == NULL)
+    if ((self->dither = open_dither(self->pcmreader->channels,
+                                    DITHER_SHAPING_NONE)) == NULL)
         return -1;
 
     if ((self->audiotools_pcm = open_audiotools_pcm()) == NULL)
@@ -872,8 +1248,8 @@ void
 ReplayGainReader_dealloc(replaygain_ReplayGainReader* self) {
     if (self->pcmreader != NULL)
         self->pcmreader->del(self->pcmreader);
-    if (self->white_noise != NULL)
-        self->white_noise->close(self->white_noise);
+    if (self->dither != NULL)
+        close_dither(self->dither);
     Py_XDECREF(self->audiotools_pcm);
 
     Py_TYPE(self)->tp_free((PyObject*)self);
@@ -919,10 +1295,6 @@ ReplayGainReader_read(replaygain_ReplayGainReader* self, PyObject *args) {
         PyErr_SetString(PyExc_ValueError, "pcm_frames must be positive");
         return NULL;
     } else {
-        const int max_value = (1 << (self->pcmreader->bits_per_sample - 1)) - 1;
-        const int min_value = -(1 << (self->pcmreader->bits_per_sample - 1));
-        const double multiplier = self->multiplier;
-
         pcm_FrameList *framelist = new_FrameList(
             self->audiotools_pcm,
             self->pcmreader->channels,
@@ -933,9 +1305,6 @@ ReplayGainReader_read(replaygain_ReplayGainReader* self, PyObject *args) {
             self->pcmreader->read(self->pcmreader,
                                   pcm_frames,
                                   framelist->samples);
-        const unsigned total_samples =
-            frames_read * self->pcmreader->channels;
-        unsigned i;
 
         if (!frames_read && (self->pcmreader->status != PCM_OK)) {
             Py_DECREF((PyObject*)framelist);
@@ -946,13 +1315,11 @@ ReplayGainReader_read(replaygain_ReplayGainReader* self, PyObject *args) {
 
         /*apply our multiplier to framelist's integer samples
           and apply dithering*/
-        for (i = 0; i < total_samples; i++) {
-            framelist->samples[i] =
-                (int)lround(framelist->samples[i] * multiplier);
-            framelist->samples[i] =
-                (MIN(MAX(framelist->samples[i], min_value), max_value) ^
-                 self->white_noise->read(self->white_noise, 1));
-        }
+        dither_scale(self->dither,
+                     frames_read * self->pcmreader->channels,
+                     self->multiplier,
+                     self->pcmreader->bits_per_sample,
+                     framelist->samples);
 
         /*return integer samples as a new FrameList object*/
         return (PyObject*)framelist;
@@ -966,3 +1333,838 @@ ReplayGainReader_close(replaygain_ReplayGainReader* self, PyObject *args) {
     Py_INCREF(Py_None);
     return Py_None;
 }
+
+
+/*gating thresholds and the offset from mean square to LUFS*/
+#define R128_OFFSET -0.691
+#define R128_ABSOLUTE_GATE -70.0
+#define R128_INTEGRATED_GATE -10.0
+#define R128_RANGE_GATE -20.0
+
+void
+R128_dealloc(replaygain_R128* self)
+{
+    Py_XDECREF(self->framelist_type);
+    free(self->samples);
+    free(self->momentary.energy);
+    free(self->short_term.energy);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+PyObject*
+R128_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    replaygain_R128 *self;
+
+    self = (replaygain_R128 *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+/*the K-weighting pre-filter's high shelf, modeling the head*/
+static void
+r128_shelf(double sample_rate, struct r128_biquad *shelf)
+{
+    const double f0 = 1681.974450955533;
+    const double G = 3.999843853973347;
+    const double Q = 0.7071752369554196;
+    const double K = tan(M_PI * f0 / sample_rate);
+    const double Vh = pow(10.0, G / 20.0);
+    const double Vb = pow(Vh, 0.4996667741545416);
+    const double a0 = 1.0 + K / Q + K * K;
+
+    shelf->b0 = (Vh + Vb * K / Q + K * K) / a0;
+    shelf->b1 = 2.0 * (K * K - Vh) / a0;
+    shelf->b2 = (Vh - Vb * K / Q + K * K) / a0;
+    shelf->a1 = 2.0 * (K * K - 1.0) / a0;
+    shelf->a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+/*the K-weighting RLB high-pass filter*/
+static void
+r128_highpass(double sample_rate, struct r128_biquad *highpass)
+{
+    const double f0 = 38.13547087602444;
+    const double Q = 0.5003270373238773;
+    const double K = tan(M_PI * f0 / sample_rate);
+    const double a0 = 1.0 + K / Q + K * K;
+
+    highpass->b0 = 1.0;
+    highpass->b1 = -2.0;
+    highpass->b2 = 1.0;
+    highpass->a1 = 2.0 * (K * K - 1.0) / a0;
+    highpass->a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+/*returns the weight of the given speaker's channel*/
+static double
+r128_weight(unsigned speaker)
+{
+    switch (speaker) {
+    case 0x008:     /*LFE is excluded*/
+        return 0.0;
+    case 0x010:     /*bL*/
+    case 0x020:     /*bR*/
+    case 0x200:     /*sL*/
+    case 0x400:     /*sR*/
+        return 1.41;
+    default:
+        return 1.0;
+    }
+}
+
+int
+R128_init(replaygain_R128 *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"sample_rate",
+                             "channels",
+                             "channel_mask",
+                             NULL};
+    int sample_rate;
+    int channels;
+    int channel_mask = 0;
+    PyObject *audiotools_pcm;
+    unsigned speaker;
+    unsigned c;
+    unsigned p;
+
+    self->framelist_type = NULL;
+    self->samples = NULL;
+    self->momentary.energy = NULL;
+    self->short_term.energy = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|i", kwlist,
+                                     &sample_rate,
+                                     &channels,
+                                     &channel_mask))
+        return -1;
+
+    if (sample_rate < 8000) {
+        PyErr_SetString(PyExc_ValueError,
+                        "sample rate must be at least 8000Hz");
+        return -1;
+    }
+    if ((channels < 1) || (channels > R128_MAX_CHANNELS)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "channels must be between 1 and 8");
+        return -1;
+    }
+
+    /*store FrameList type for later comparison*/
+    if ((audiotools_pcm = PyImport_ImportModule("audiotools.pcm")) != NULL) {
+        self->framelist_type = PyObject_GetAttrString(audiotools_pcm,
+                                                      "FrameList");
+        Py_DECREF(audiotools_pcm);
+    } else {
+        return -1;
+    }
+
+    self->sample_rate = (unsigned)sample_rate;
+    self->channels = (unsigned)channels;
+    self->lanes = (self->channels + 1) & ~1u;
+    self->isa = replaygain_usable_isa();
+
+    r128_shelf(sample_rate, &(self->shelf));
+    r128_highpass(sample_rate, &(self->highpass));
+    memset(self->state, 0, sizeof(self->state));
+
+    /*weigh channels by the speakers in their mask,
+      assuming the usual layouts for unassigned channels*/
+    if (!channel_mask) {
+        switch (channels) {
+        case 1: channel_mask = 0x4; break;
+        case 2: channel_mask = 0x3; break;
+        case 3: channel_mask = 0x7; break;
+        case 4: channel_mask = 0x33; break;
+        case 5: channel_mask = 0x37; break;
+        case 6: channel_mask = 0x3F; break;
+        case 8: channel_mask = 0x63F; break;
+        default: channel_mask = 0x3F; break;
+        }
+    }
+    for (c = 0; c < R128_MAX_CHANNELS; c++) {
+        self->weights[c] = c < self->channels ? 1.0 : 0.0;
+    }
+    for (c = 0, speaker = 1; (c < self->channels) && speaker; speaker <<= 1) {
+        if (channel_mask & speaker) {
+            self->weights[c++] = r128_weight(speaker);
+        }
+    }
+
+    /*true peak interpolates 3 points between each pair of samples
+      with a Hann-windowed sinc, each phase normalized to unity gain*/
+    for (p = 0; p < R128_TP_PHASES - 1; p++) {
+        double total = 0.0;
+        unsigned k;
+
+        for (k = 0; k < R128_TP_TAPS; k++) {
+            const double t = (double)(p + 1) / R128_TP_PHASES +
+                             (R128_TP_TAPS / 2 - 1) - (double)k;
+            const double window =
+                0.5 + 0.5 * cos(M_PI * t / (R128_TP_TAPS / 2));
+            self->interpolator[p][k] =
+                window * sin(M_PI * t) / (M_PI * t);
+            total += self->interpolator[p][k];
+        }
+        for (k = 0; k < R128_TP_TAPS; k++) {
+            self->interpolator[p][k] /= total;
+        }
+    }
+    self->true_peak = 0.0;
+
+    self->samples = calloc((R128_TP_TAPS - 1 + R128_CHUNK_SIZE) * self->lanes,
+                           sizeof(double));
+
+    self->segment_frames = (self->sample_rate + 5) / 10;
+    self->segment_used = 0;
+    memset(self->segment_sum, 0, sizeof(self->segment_sum));
+    self->segments_total = 0;
+
+    self->momentary.size = self->momentary.total = 0;
+    self->short_term.size = self->short_term.total = 0;
+
+    self->callback.update = r128_update;
+    self->callback.data = self;
+
+    return 0;
+}
+
+static PyObject*
+R128_sample_rate(replaygain_R128 *self, void *closure)
+{
+    return Py_BuildValue("I", self->sample_rate);
+}
+
+static PyObject*
+R128_channels(replaygain_R128 *self, void *closure)
+{
+    return Py_BuildValue("I", self->channels);
+}
+
+static PyObject*
+R128_callback(replaygain_R128 *self, void *closure)
+{
+    return callback_capsule((PyObject*)self, &(self->callback));
+}
+
+static void
+r128_add_block(struct r128_blocks *blocks, double energy)
+{
+    if (blocks->total == blocks->size) {
+        blocks->size = blocks->size ? blocks->size * 2 : 1024;
+        blocks->energy = realloc(blocks->energy,
+                                 sizeof(double) * blocks->size);
+    }
+    blocks->energy[blocks->total++] = energy;
+}
+
+/*returns the mean of the most recent "count" segments*/
+static double
+r128_recent_segments(const replaygain_R128 *self, unsigned count)
+{
+    double total = 0.0;
+    unsigned i;
+
+    for (i = 1; i <= count; i++) {
+        total += self->segments[(self->segments_total - i) %
+                                R128_SHORT_TERM];
+    }
+    return total / count;
+}
+
+/*finishes the current 100ms segment,
+  which completes a 400ms gating block overlapping the previous by 75%
+  and a 3s short-term block for the loudness range*/
+static void
+r128_finish_segment(replaygain_R128 *self)
+{
+    double energy = 0.0;
+    unsigned c;
+
+    for (c = 0; c < self->channels; c++) {
+        energy += self->weights[c] * self->segment_sum[c];
+        self->segment_sum[c] = 0.0;
+    }
+    self->segments[self->segments_total % R128_SHORT_TERM] =
+        energy / self->segment_frames;
+    self->segments_total++;
+    self->segment_used = 0;
+
+    if (self->segments_total >= R128_MOMENTARY) {
+        r128_add_block(&(self->momentary),
+                       r128_recent_segments(self, R128_MOMENTARY));
+    }
+    if (self->segments_total >= R128_SHORT_TERM) {
+        r128_add_block(&(self->short_term),
+                       r128_recent_segments(self, R128_SHORT_TERM));
+    }
+}
+
+/*K-weights "frames" of interleaved samples,
+  adding the squares of each channel's output to its segment sum
+
+  channels are filtered in pairs, one per SIMD lane
+  with the vector kernels*/
+static void
+r128_filter_scalar(replaygain_R128 *self,
+                   const double samples[],
+                   unsigned frames)
+{
+    const struct r128_biquad *s = &(self->shelf);
+    const struct r128_biquad *h = &(self->highpass);
+    const unsigned lanes = self->lanes;
+    unsigned lane;
+
+    for (lane = 0; lane < lanes; lane++) {
+        double z1 = self->state[0][lane];
+        double z2 = self->state[1][lane];
+        double z3 = self->state[2][lane];
+        double z4 = self->state[3][lane];
+        double sum = self->segment_sum[lane];
+        unsigned i;
+
+        for (i = 0; i < frames; i++) {
+            const double in = samples[i * lanes + lane];
+            const double shelved = s->b0 * in + z1;
+            double out;
+            z1 = s->b1 * in - s->a1 * shelved + z2;
+            z2 = s->b2 * in - s->a2 * shelved;
+
+            /*the high-pass numerator is 1, -2, 1*/
+            out = shelved + z3;
+            z3 = z4 - shelved - (shelved + h->a1 * out);
+            z4 = shelved - h->a2 * out;
+
+            sum += out * out;
+        }
+
+        self->state[0][lane] = z1;
+        self->state[1][lane] = z2;
+        self->state[2][lane] = z3;
+        self->state[3][lane] = z4;
+        self->segment_sum[lane] = sum;
+    }
+}
+
+/*updates the true peak from "frames" of interleaved samples
+  which follow R128_TP_TAPS - 1 frames of earlier samples,
+  interpolating between every pair centered in the buffer*/
+static void
+r128_update_true_peak_scalar(replaygain_R128 *self, unsigned frames)
+{
+    const unsigned lanes = self->lanes;
+    const double *samples = self->samples;
+    unsigned lane;
+
+    for (lane = 0; lane < lanes; lane++) {
+        double peak = 0.0;
+        unsigned i;
+
+        for (i = 0; i < frames; i++) {
+            const double *x = samples + i * lanes + lane;
+            unsigned p;
+
+            /*the newest sample itself*/
+            peak = MAX(peak, fabs(x[(R128_TP_TAPS - 1) * lanes]));
+
+            for (p = 0; p < R128_TP_PHASES - 1; p++) {
+                const double *taps = self->interpolator[p];
+                double total = 0.0;
+                unsigned k;
+                for (k = 0; k < R128_TP_TAPS; k++) {
+                    total += taps[k] * x[k * lanes];
+                }
+                peak = MAX(peak, fabs(total));
+            }
+        }
+
+        self->true_peak = MAX(self->true_peak, peak);
+    }
+}
+
+#if defined(SIMD_X86)
+SIMD_TARGET("sse2") static void
+r128_filter_sse2(replaygain_R128 *self,
+                 const double samples[],
+                 unsigned frames)
+{
+    const struct r128_biquad *s = &(self->shelf);
+    const struct r128_biquad *h = &(self->highpass);
+    const unsigned lanes = self->lanes;
+    const __m128d sb0 = _mm_set1_pd(s->b0);
+    const __m128d sb1 = _mm_set1_pd(s->b1);
+    const __m128d sb2 = _mm_set1_pd(s->b2);
+    const __m128d sa1 = _mm_set1_pd(s->a1);
+    const __m128d sa2 = _mm_set1_pd(s->a2);
+    const __m128d ha1 = _mm_set1_pd(h->a1);
+    const __m128d ha2 = _mm_set1_pd(h->a2);
+    unsigned c;
+
+    for (c = 0; c < lanes; c += 2) {
+        const double *x = samples + c;
+        __m128d z1 = _mm_loadu_pd(self->state[0] + c);
+        __m128d z2 = _mm_loadu_pd(self->state[1] + c);
+        __m128d z3 = _mm_loadu_pd(self->state[2] + c);
+        __m128d z4 = _mm_loadu_pd(self->state[3] + c);
+        __m128d sum = _mm_loadu_pd(self->segment_sum + c);
+        unsigned i;
+
+        for (i = 0; i < frames; i++) {
+            const __m128d in = _mm_loadu_pd(x);
+            const __m128d shelved = _mm_add_pd(_mm_mul_pd(sb0, in), z1);
+            __m128d out;
+            z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, in),
+                                       _mm_mul_pd(sa1, shelved)),
+                            z2);
+            z2 = _mm_sub_pd(_mm_mul_pd(sb2, in),
+                            _mm_mul_pd(sa2, shelved));
+
+            out = _mm_add_pd(shelved, z3);
+            z3 = _mm_sub_pd(_mm_sub_pd(z4, shelved),
+                            _mm_add_pd(shelved, _mm_mul_pd(ha1, out)));
+            z4 = _mm_sub_pd(shelved, _mm_mul_pd(ha2, out));
+
+            sum = _mm_add_pd(sum, _mm_mul_pd(out, out));
+            x += lanes;
+        }
+
+        _mm_storeu_pd(self->state[0] + c, z1);
+        _mm_storeu_pd(self->state[1] + c, z2);
+        _mm_storeu_pd(self->state[2] + c, z3);
+        _mm_storeu_pd(self->state[3] + c, z4);
+        _mm_storeu_pd(self->segment_sum + c, sum);
+    }
+}
+
+SIMD_TARGET("sse2") static void
+r128_update_true_peak_sse2(replaygain_R128 *self, unsigned frames)
+{
+    const unsigned lanes = self->lanes;
+    const double *samples = self->samples;
+    const __m128d magnitude =
+        _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    unsigned c;
+
+    for (c = 0; c < lanes; c += 2) {
+        __m128d peak = _mm_setzero_pd();
+        double peaks[2];
+        unsigned i;
+
+        for (i = 0; i < frames; i++) {
+            const double *x = samples + i * lanes + c;
+            unsigned p;
+
+            peak = _mm_max_pd(
+                peak,
+                _mm_and_pd(_mm_loadu_pd(x + (R128_TP_TAPS - 1) * lanes),
+                           magnitude));
+
+            for (p = 0; p < R128_TP_PHASES - 1; p++) {
+                const double *taps = self->interpolator[p];
+                __m128d total = _mm_setzero_pd();
+                unsigned k;
+                for (k = 0; k < R128_TP_TAPS; k++) {
+                    total = _mm_add_pd(total,
+                                       _mm_mul_pd(_mm_set1_pd(taps[k]),
+                                                  _mm_loadu_pd(x + k * lanes)));
+                }
+                peak = _mm_max_pd(peak, _mm_and_pd(total, magnitude));
+            }
+        }
+
+        _mm_storeu_pd(peaks, peak);
+        self->true_peak = MAX(self->true_peak, MAX(peaks[0], peaks[1]));
+    }
+}
+#endif
+
+static void
+r128_filter(replaygain_R128 *self, const double samples[], unsigned frames)
+{
+#if defined(SIMD_X86)
+    if (self->isa >= REPLAYGAIN_SSE2) {
+        r128_filter_sse2(self, samples, frames);
+        return;
+    }
+#endif
+    r128_filter_scalar(self, samples, frames);
+}
+
+static void
+r128_update_true_peak(replaygain_R128 *self, unsigned frames)
+{
+#if defined(SIMD_X86)
+    if (self->isa >= REPLAYGAIN_SSE2) {
+        r128_update_true_peak_sse2(self, frames);
+        return;
+    }
+#endif
+    r128_update_true_peak_scalar(self, frames);
+}
+
+/*meters a FrameList without touching any Python state,
+  returning 0 on success or 1 if its format doesn't match*/
+static int
+r128_update(void *data, const pcm_FrameList *framelist)
+{
+    replaygain_R128 *self = data;
+    const unsigned lanes = self->lanes;
+    double *chunk = self->samples + (R128_TP_TAPS - 1) * lanes;
+    unsigned total_frames = framelist->frames;
+    unsigned frame = 0;
+    double scale;
+
+    if ((framelist->channels != self->channels) ||
+        (framelist->bits_per_sample < 1) ||
+        (framelist->bits_per_sample > 32)) {
+        return 1;
+    }
+
+    scale = ldexp(1.0, -(int)(framelist->bits_per_sample - 1));
+
+    while (total_frames) {
+        const unsigned to_process = MIN(total_frames, R128_CHUNK_SIZE);
+        unsigned i;
+
+        for (i = 0; i < to_process; i++) {
+            unsigned c;
+            for (c = 0; c < self->channels; c++) {
+                chunk[i * lanes + c] =
+                    FrameList_sample(framelist,
+                                     (frame + i) * self->channels + c) *
+                    scale;
+            }
+        }
+
+        r128_update_true_peak(self, to_process);
+
+        /*keep the end of this chunk for interpolating the next*/
+        memmove(self->samples,
+                self->samples + to_process * lanes,
+                sizeof(double) * (R128_TP_TAPS - 1) * lanes);
+
+        /*K-weight segment by segment*/
+        for (i = 0; i < to_process;) {
+            const unsigned segment =
+                MIN(to_process - i,
+                    self->segment_frames - self->segment_used);
+            r128_filter(self, chunk + i * lanes, segment);
+            self->segment_used += segment;
+            i += segment;
+            if (self->segment_used == self->segment_frames) {
+                r128_finish_segment(self);
+            }
+        }
+
+        total_frames -= to_process;
+        frame += to_process;
+    }
+
+    return 0;
+}
+
+static PyObject*
+R128_update(replaygain_R128 *self, PyObject *args)
+{
+    pcm_FrameList* framelist;
+
+    if (!PyArg_ParseTuple(args, "O!", self->framelist_type, &framelist))
+        return NULL;
+
+    if (framelist->channels != self->channels) {
+        PyErr_SetString(PyExc_ValueError,
+                        "FrameList channel count mismatch");
+        return NULL;
+    }
+    if ((framelist->bits_per_sample < 1) ||
+        (framelist->bits_per_sample > 32)) {
+        PyErr_SetString(PyExc_ValueError, "unsupported bits per sample");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    r128_update(self, framelist);
+    Py_END_ALLOW_THREADS
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*returns the mean energy of blocks louder than the absolute gate
+  and louder than the mean of those by the relative gate in LU,
+  or 0.0 if there are none*/
+static double
+r128_gated_mean(const struct r128_blocks *blocks, double relative_gate)
+{
+    const double absolute = pow(10.0, (R128_ABSOLUTE_GATE - R128_OFFSET) /
+                                      10.0);
+    double relative;
+    double total = 0.0;
+    unsigned count = 0;
+    unsigned i;
+
+    for (i = 0; i < blocks->total; i++) {
+        if (blocks->energy[i] > absolute) {
+            total += blocks->energy[i];
+            count++;
+        }
+    }
+    if (!count) {
+        return 0.0;
+    }
+
+    relative = MAX(total / count * pow(10.0, relative_gate / 10.0),
+                   absolute);
+    total = 0.0;
+    count = 0;
+    for (i = 0; i < blocks->total; i++) {
+        if (blocks->energy[i] > relative) {
+            total += blocks->energy[i];
+            count++;
+        }
+    }
+    return count ? total / count : 0.0;
+}
+
+static PyObject*
+R128_integrated_loudness(replaygain_R128 *self, PyObject *args)
+{
+    const double energy = r128_gated_mean(&(self->momentary),
+                                          R128_INTEGRATED_GATE);
+
+    if (energy > 0.0) {
+        return Py_BuildValue("d", R128_OFFSET + 10.0 * log10(energy));
+    } else {
+        PyErr_SetString(PyExc_ValueError,
+                        "Not enough samples to perform calculation");
+        return NULL;
+    }
+}
+
+static int
+r128_cmp_energy(const void *a, const void *b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static PyObject*
+R128_loudness_range(replaygain_R128 *self, PyObject *args)
+{
+    const double absolute = pow(10.0, (R128_ABSOLUTE_GATE - R128_OFFSET) /
+                                      10.0);
+    const double mean = r128_gated_mean(&(self->short_term), 0.0);
+    double relative;
+    double *gated;
+    unsigned count = 0;
+    unsigned i;
+    double low;
+    double high;
+
+    if (mean <= 0.0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Not enough samples to perform calculation");
+        return NULL;
+    }
+
+    /*the range runs from the 10th to the 95th percentile of
+      short-term loudness not under the gates*/
+    relative = 0.0;
+    for (i = 0; i < self->short_term.total; i++) {
+        if (self->short_term.energy[i] > absolute) {
+            relative += self->short_term.energy[i];
+            count++;
+        }
+    }
+    relative = MAX(relative / count * pow(10.0, R128_RANGE_GATE / 10.0),
+                   absolute);
+
+    gated = malloc(sizeof(double) * self->short_term.total);
+    count = 0;
+    for (i = 0; i < self->short_term.total; i++) {
+        if (self->short_term.energy[i] > relative) {
+            gated[count++] = self->short_term.energy[i];
+        }
+    }
+    qsort(gated, count, sizeof(double), r128_cmp_energy);
+    low = gated[(unsigned)((count - 1) * 0.10 + 0.5)];
+    high = gated[(unsigned)((count - 1) * 0.95 + 0.5)];
+    free(gated);
+
+    return Py_BuildValue("d", 10.0 * log10(high / low));
+}
+
+static PyObject*
+R128_true_peak(replaygain_R128 *self, PyObject *args)
+{
+    return Py_BuildValue("d", self->true_peak);
+}
+
+
+void
+Levels_dealloc(replaygain_Levels* self)
+{
+    Py_XDECREF(self->framelist_type);
+    free(self->peaks);
+    free(self->sums);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+PyObject*
+Levels_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    replaygain_Levels *self;
+
+    self = (replaygain_Levels *)type->tp_alloc(type, 0);
+
+    return (PyObject *)self;
+}
+
+int
+Levels_init(replaygain_Levels *self, PyObject *args, PyObject *kwds)
+{
+    int channels;
+    PyObject *audiotools_pcm;
+
+    self->framelist_type = NULL;
+    self->peaks = NULL;
+    self->sums = NULL;
+
+    if (!PyArg_ParseTuple(args, "i", &channels))
+        return -1;
+
+    if (channels < 1) {
+        PyErr_SetString(PyExc_ValueError, "channels must be > 0");
+        return -1;
+    }
+
+    /*store FrameList type for later comparison*/
+    if ((audiotools_pcm = PyImport_ImportModule("audiotools.pcm")) != NULL) {
+        self->framelist_type = PyObject_GetAttrString(audiotools_pcm,
+                                                      "FrameList");
+        Py_DECREF(audiotools_pcm);
+    } else {
+        return -1;
+    }
+
+    self->channels = (unsigned)channels;
+    self->frames = 0;
+    self->peaks = calloc(channels, sizeof(double));
+    self->sums = calloc(channels, sizeof(double));
+    self->callback.update = levels_update;
+    self->callback.data = self;
+
+    return 0;
+}
+
+static PyObject*
+Levels_channels(replaygain_Levels *self, void *closure)
+{
+    return Py_BuildValue("I", self->channels);
+}
+
+static PyObject*
+Levels_callback(replaygain_Levels *self, void *closure)
+{
+    return callback_capsule((PyObject*)self, &(self->callback));
+}
+
+/*updates the meter from a FrameList,
+  returning 0 on success or 1 if its channel count doesn't match*/
+static int
+levels_update(void *data, const pcm_FrameList *framelist)
+{
+    replaygain_Levels *self = data;
+    const unsigned channels = framelist->channels;
+    const double scale = ldexp(1.0, -(int)(framelist->bits_per_sample - 1));
+    const unsigned chunk_frames = 4096 / MAX(channels, 1);
+    int samples[4096];
+    unsigned frame;
+
+    if ((channels != self->channels) || (chunk_frames == 0)) {
+        return 1;
+    }
+
+    for (frame = 0; frame < framelist->frames; frame += chunk_frames) {
+        const unsigned to_process = MIN(framelist->frames - frame,
+                                        chunk_frames);
+        unsigned c;
+
+        FrameList_get_samples(framelist,
+                              frame * channels,
+                              to_process * channels,
+                              samples);
+
+        for (c = 0; c < channels; c++) {
+            int64_t sum = 0;
+            int peak = 0;
+            unsigned i;
+
+            for (i = 0; i < to_process; i++) {
+                const int sample = samples[i * channels + c];
+                sum += sample;
+                peak = MAX(peak, abs(sample));
+            }
+            self->sums[c] += sum * scale;
+            self->peaks[c] = MAX(self->peaks[c], peak * scale);
+        }
+    }
+    self->frames += framelist->frames;
+
+    return 0;
+}
+
+static PyObject*
+Levels_update(replaygain_Levels *self, PyObject *args)
+{
+    pcm_FrameList* framelist;
+    int error;
+
+    if (!PyArg_ParseTuple(args, "O!", self->framelist_type, &framelist))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    error = levels_update(self, framelist);
+    Py_END_ALLOW_THREADS
+
+    if (error) {
+        PyErr_SetString(PyExc_ValueError,
+                        "FrameList channel count mismatch");
+        return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject*
+Levels_peaks(replaygain_Levels *self, PyObject *args)
+{
+    PyObject *peaks = PyList_New(self->channels);
+    unsigned c;
+
+    if (peaks) {
+        for (c = 0; c < self->channels; c++) {
+            PyList_SET_ITEM(peaks, c, PyFloat_FromDouble(self->peaks[c]));
+        }
+    }
+    return peaks;
+}
+
+static PyObject*
+Levels_dc_offsets(replaygain_Levels *self, PyObject *args)
+{
+    PyObject *offsets = PyList_New(self->channels);
+    unsigned c;
+
+    if (offsets) {
+        for (c = 0; c < self->channels; c++) {
+            PyList_SET_ITEM(offsets, c,
+                            PyFloat_FromDouble(self->frames ?
+                                               self->sums[c] / self->frames :
+                                               0.0));
+        }
+    }
+    return offsets;
+}
@@ -46,29 +46,45 @@
 #define MAX_SAMPLES_PER_WINDOW 9600  /* MAX_SAMP_FREQ * RMS_WINDOW_TIME */
 #define PINK_REF                64.82 /* calibration value */
 
+#define REPLAYGAIN_CHUNK_SIZE 4096
+
 typedef enum {GAIN_ANALYSIS_ERROR, GAIN_ANALYSIS_OK} gain_calc_status;
 
+/*the instruction sets the filters have kernels for,
+  each of which implies those before it*/
+typedef enum {
+    REPLAYGAIN_SCALAR,
+    REPLAYGAIN_SSE2
+} replaygain_isa_t;
+
+/*returns the filter kernels this CPU can run, by name*/
+PyObject*
+replaygain_filter_kernels(PyObject *dummy, PyObject *args);
+
+/*limits analyzers created from now on to the named kernels
+  and those before them, so each can be checked against
+  the scalar filters, which they must match exactly*/
+PyObject*
+replaygain_use_filter_kernels(PyObject *dummy, PyObject *args);
+
 typedef struct {
     PyObject_HEAD;
 
-    double          linprebuf [MAX_ORDER * 2];
-    double*         linpre;  /* left input samples, with pre-buffer */
-    double          lstepbuf  [MAX_SAMPLES_PER_WINDOW + MAX_ORDER];
-    double*         lstep;   /* left "first step" (i.e. post first filter) samples */
-    double          loutbuf   [MAX_SAMPLES_PER_WINDOW + MAX_ORDER];
-    double*         lout;    /* left "out" (i.e. post second filter) samples */
-    double          rinprebuf [MAX_ORDER * 2];
-    double*         rinpre;  /* right input samples ... */
-    double          rstepbuf  [MAX_SAMPLES_PER_WINDOW + MAX_ORDER];
-    double*         rstep;
-    double          routbuf   [MAX_SAMPLES_PER_WINDOW + MAX_ORDER];
-    double*         rout;
+    /*both channels' samples are interleaved in every buffer
+      so the filters can run on a pair of SIMD lanes*/
+    double          inprebuf [MAX_ORDER * 2 * 2];
+    double*         inpre;   /* input samples, with pre-buffer */
+    double          stepbuf  [(MAX_SAMPLES_PER_WINDOW + MAX_ORDER) * 2];
+    double*         step;    /* "first step" (i.e. post first filter) samples */
+    double          outbuf   [(MAX_SAMPLES_PER_WINDOW + MAX_ORDER) * 2];
+    double*         out;     /* "out" (i.e. post second filter) samples */
     long            sampleWindow; /* number of samples required to reach number of milliseconds required for RMS window */
     long            totsamp;
     double          lsum;
     double          rsum;
     int             freqindex;
     int             first;
+    replaygain_isa_t isa;    /* filter kernels chosen when created */
     uint32_t  A [STEPS_per_dB_times_MAX_dB];
     uint32_t  B [STEPS_per_dB_times_MAX_dB];
 
@@ -76,6 +92,12 @@ typedef struct {
     unsigned sample_rate;
     double title_peak;
     double album_peak;
+
+    /*interleaved stereo samples being analyzed*/
+    double samples[REPLAYGAIN_CHUNK_SIZE * 2];
+
+    /*for feeding the analyzer directly from a PCMTee*/
+    struct pcmtee_callback callback;
 } replaygain_ReplayGain;
 
 void
@@ -90,6 +112,9 @@ ReplayGain_init(replaygain_ReplayGain *self, PyObject *args, PyObject *kwds);
 PyObject*
 ReplayGain_sample_rate(replaygain_ReplayGain *self, void *closure);
 
+static PyObject*
+ReplayGain_callback(replaygain_ReplayGain *self, void *closure);
+
 PyObject*
 ReplayGain_next_title(replaygain_ReplayGain *self);
 
@@ -108,12 +133,20 @@ ReplayGain_album_gain(replaygain_ReplayGain *self);
 PyObject*
 ReplayGain_album_peak(replaygain_ReplayGain *self);
 
+/*returns the album's loudness histogram as a string of
+  native-endian 32-bit counts, suitable for merge()*/
+PyObject*
+ReplayGain_album_histogram(replaygain_ReplayGain *self);
+
+/*adds another analyzer's album histogram and peak to this one*/
+PyObject*
+ReplayGain_merge(replaygain_ReplayGain *self, PyObject *args);
+
+/*analyzes "num_samples" PCM frames of interleaved stereo samples*/
 gain_calc_status
 ReplayGain_analyze_samples(replaygain_ReplayGain* self,
-                           const double* left_samples,
-                           const double* right_samples,
-                           size_t num_samples,
-                           int num_channels);
+                           const double* samples,
+                           size_t num_samples);
 
 double
 ReplayGain_get_title_gain(replaygain_ReplayGain *self);
@@ -127,7 +160,7 @@ typedef struct {
 
     int stream_closed;
     struct PCMReader *pcmreader;
-    BitstreamReader *white_noise;
+    struct dither *dither;
     PyObject *audiotools_pcm;
     double multiplier;
 } replaygain_ReplayGainReader;
@@ -164,4 +197,132 @@ ReplayGainReader_read(replaygain_ReplayGainReader* self, PyObject *args);
 static PyObject*
 ReplayGainReader_close(replaygain_ReplayGainReader* self, PyObject *args);
 
+
+/*an EBU R128 / ITU-R BS.1770 loudness meter*/
+
+#define R128_MAX_CHANNELS 8
+#define R128_CHUNK_SIZE 4096
+#define R128_TP_TAPS 12          /*taps per true peak interpolation phase*/
+#define R128_TP_PHASES 4         /*true peak oversampling factor*/
+#define R128_SHORT_TERM 30       /*100ms segments per short-term block*/
+#define R128_MOMENTARY 4         /*100ms segments per gating block*/
+
+struct r128_biquad {
+    double b0, b1, b2, a1, a2;
+};
+
+struct r128_blocks {
+    unsigned size;
+    unsigned total;
+    double *energy;              /*mean square of each block*/
+};
+
+typedef struct {
+    PyObject_HEAD;
+
+    PyObject *framelist_type;
+    unsigned sample_rate;
+    unsigned channels;
+    unsigned lanes;              /*channels rounded up to a pair*/
+    replaygain_isa_t isa;        /*filter kernels chosen when created*/
+
+    /*K-weighting is a high shelf followed by a high-pass,
+      each with its own z^-1 and z^-2 state for every channel*/
+    struct r128_biquad shelf;
+    struct r128_biquad highpass;
+    double state[4][R128_MAX_CHANNELS];
+    double weights[R128_MAX_CHANNELS];
+
+    /*the interleaved samples being measured, scaled to -1.0 to 1.0,
+      following the previous R128_TP_TAPS - 1 PCM frames*/
+    double *samples;
+    double interpolator[R128_TP_PHASES - 1][R128_TP_TAPS];
+    double true_peak;
+
+    /*each channel's sum of squares in the current 100ms segment*/
+    unsigned segment_frames;
+    unsigned segment_used;
+    double segment_sum[R128_MAX_CHANNELS];
+
+    /*the most recent segments' weighted mean squares*/
+    double segments[R128_SHORT_TERM];
+    unsigned segments_total;
+
+    struct r128_blocks momentary;    /*400ms gating blocks*/
+    struct r128_blocks short_term;   /*3s blocks for loudness range*/
+
+    /*for feeding the meter directly from a PCMTee*/
+    struct pcmtee_callback callback;
+} replaygain_R128;
+
+void
+R128_dealloc(replaygain_R128* self);
+
+PyObject*
+R128_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+R128_init(replaygain_R128 *self, PyObject *args, PyObject *kwds);
+
+static PyObject*
+R128_sample_rate(replaygain_R128 *self, void *closure);
+
+static PyObject*
+R128_channels(replaygain_R128 *self, void *closure);
+
+static PyObject*
+R128_callback(replaygain_R128 *self, void *closure);
+
+static PyObject*
+R128_update(replaygain_R128 *self, PyObject *args);
+
+static PyObject*
+R128_integrated_loudness(replaygain_R128 *self, PyObject *args);
+
+static PyObject*
+R128_loudness_range(replaygain_R128 *self, PyObject *args);
+
+static PyObject*
+R128_true_peak(replaygain_R128 *self, PyObject *args);
+
+
+/*a per-channel peak and DC offset meter*/
+
+typedef struct {
+    PyObject_HEAD
+
+    PyObject* framelist_type;
+    unsigned channels;
+    uint64_t frames;
+    double *peaks;       /*largest magnitude, relative to full scale*/
+    double *sums;        /*sum of samples, relative to full scale*/
+
+    /*for feeding the meter directly from a PCMTee*/
+    struct pcmtee_callback callback;
+} replaygain_Levels;
+
+void
+Levels_dealloc(replaygain_Levels* self);
+
+PyObject*
+Levels_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+int
+Levels_init(replaygain_Levels *self, PyObject *args, PyObject *kwds);
+
+static PyObject*
+Levels_channels(replaygain_Levels *self, void *closure);
+
+static PyObject*
+Levels_callback(replaygain_Levels *self, void *closure);
+
+static PyObject*
+Levels_update(replaygain_Levels *self, PyObject *args);
+
+static PyObject*
+Levels_peaks(replaygain_Levels *self, PyObject *args);
+
+static PyObject*
+Levels_dc_offsets(replaygain_Levels *self, PyObject *args);
+
 #endif
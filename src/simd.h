@@ -0,0 +1,38 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/********************************************************
+ Audio Tools, a module and set of tools for manipulating audio data
+ Copyright (C) 2007-2016  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+/*run-time selection of vector kernels
+
+  where SIMD_X86 is defined, kernels for instruction sets
+  beyond the compiler's baseline are compiled with SIMD_TARGET("isa")
+  and must only be called once simd_supports("isa") is true
+  for the CPU actually running them*/
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define SIMD_X86
+#include <immintrin.h>
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#define simd_supports(isa) __builtin_cpu_supports(isa)
+#endif
+
+#endif
@@ -292,6 +292,92 @@ class BufferedPCMReader(unittest.TestCase):
                           4096)
 
 
+class PCMTee(unittest.TestCase):
+    @LIB_PCM
+    def test_pcm(self):
+        from hashlib import md5
+        from audiotools.pcmconverter import PCMTee
+        from audiotools.replaygain import ReplayGain, R128, Levels
+        from audiotools.accuraterip import Checksum
+
+        def stream():
+            return test_streams.Sine16_Stereo(441000, 44100,
+                                              441.0, 0.50,
+                                              882.0, 0.25, 1.0)
+
+        def analyzers():
+            return [ReplayGain(44100),
+                    R128(44100, 2),
+                    Levels(2),
+                    Checksum(total_pcm_frames=441000)]
+
+        def results(analyzers, digest):
+            (replaygain, r128, levels, checksum) = analyzers
+            return (replaygain.title_gain(),
+                    replaygain.title_peak(),
+                    r128.integrated_loudness(),
+                    r128.true_peak(),
+                    levels.peaks(),
+                    levels.dc_offsets(),
+                    checksum.checksums_v1(),
+                    checksum.checksum_v2(),
+                    digest.digest())
+
+        def update_md5(digest):
+            return lambda f: digest.update(f.to_bytes(False, True))
+
+        # analyzing the stream one after another
+        serial = analyzers()
+        serial_md5 = md5()
+        for analyzer in serial:
+            audiotools.transfer_data(stream().read, analyzer.update)
+        audiotools.transfer_data(stream().read, update_md5(serial_md5))
+
+        # matches analyzing it once through callables
+        # or through callbacks
+        for queue_size in [1, 4]:
+            for callbacks in [False, True]:
+                tee = analyzers()
+                tee_md5 = md5()
+                PCMTee(stream(),
+                       [a.callback if callbacks else a.update for a in tee] +
+                       [update_md5(tee_md5)],
+                       queue_size=queue_size).run()
+                self.assertEqual(results(tee, tee_md5),
+                                 results(serial, serial_md5))
+
+        # the stream reads through unchanged
+        reader = PCMTee(stream(), [Levels(2).callback])
+        self.assertEqual(reader.sample_rate, 44100)
+        self.assertEqual(reader.channels, 2)
+        self.assertEqual(reader.channel_mask, 0x3)
+        self.assertEqual(reader.bits_per_sample, 16)
+        digest = md5()
+        audiotools.transfer_data(reader.read, update_md5(digest))
+        reader.close()
+        self.assertEqual(digest.digest(), serial_md5.digest())
+        self.assertRaises(ValueError, reader.read, 4096)
+
+        # consumer errors are raised by the PCMTee
+        def consumer_error(framelist):
+            raise KeyError(framelist.frames)
+
+        self.assertRaises(KeyError,
+                          PCMTee(stream(), [consumer_error]).run)
+        self.assertRaises(ValueError,
+                          PCMTee(stream(), [Levels(1).callback]).run)
+        with PCMTee(stream(), [Levels(1).callback]) as reader:
+            reader.read(4096)
+            self.assertRaises(ValueError,
+                              audiotools.transfer_data,
+                              reader.read,
+                              lambda f: None)
+
+        self.assertRaises(TypeError, PCMTee, stream(), [None])
+        self.assertRaises(TypeError, PCMTee, stream(), None)
+        self.assertRaises(ValueError, PCMTee, stream(), [], 0)
+
+
 class LimitedPCMReader(unittest.TestCase):
     @LIB_PCM
     def test_pcm(self):
@@ -560,6 +646,72 @@ class CDDA(unittest.TestCase):
 
         self.assertRaises(ValueError, cdda.seek, 10)
 
+    @LIB_CDIO
+    def test_rip_cddareader(self):
+        from audiotools.cdio import CDDAReader
+        from audiotools.accuraterip import Checksum
+
+        cdda = CDDAReader(self.cue)
+        numbers = sorted(cdda.track_offsets.keys())
+
+        # every other track leaves gaps for the reader to seek past
+        for (read_offset, selected) in [(667, numbers),
+                                        (-1164, numbers),
+                                        (667, numbers[::2])]:
+            output_dir = tempfile.mkdtemp()
+            try:
+                tracks = [(number,
+                           audiotools.WaveAudio,
+                           audiotools.Filename(
+                               os.path.join(output_dir,
+                                            "track{:02d}.wav".format(number))),
+                           None) for number in selected]
+                ripped = audiotools.rip_cddareader(cdda,
+                                                   cdda.track_offsets,
+                                                   cdda.track_lengths,
+                                                   tracks,
+                                                   read_offset=read_offset,
+                                                   jobs=2)
+                self.assertEqual(len(ripped), len(tracks))
+
+                for (number,
+                     (track, log, checksums_v1, checksum_v2,
+                      replay_gain)) in zip(selected, ripped):
+                    offset = cdda.track_offsets[number] + read_offset
+                    length = cdda.track_lengths[number]
+
+                    # each track matches its part of the disc
+                    self.assertEqual(track.total_frames(), length)
+                    self.reader.reset()
+                    self.assertTrue(audiotools.pcm_cmp(
+                        track.to_pcm(),
+                        audiotools.PCMReaderWindow(self.reader,
+                                                   offset,
+                                                   length)))
+
+                    # and its checksums match its own AccurateRip window
+                    checksum = Checksum(total_pcm_frames=length,
+                                        is_first=(number == numbers[0]),
+                                        is_last=(number == numbers[-1]),
+                                        pcm_frame_range=5881,
+                                        accurateripv2_offset=2940)
+                    self.reader.reset()
+                    audiotools.transfer_data(
+                        audiotools.PCMReaderWindow(self.reader,
+                                                   offset - 2940,
+                                                   length + 5880).read,
+                        checksum.update)
+                    self.assertEqual(checksums_v1, checksum.checksums_v1())
+                    self.assertEqual(checksum_v2, checksum.checksum_v2())
+                    self.assertTrue(
+                        isinstance(replay_gain, audiotools.ReplayGain))
+            finally:
+                for f in os.listdir(output_dir):
+                    os.unlink(os.path.join(output_dir, f))
+                os.rmdir(output_dir)
+
+        cdda.close()
+
 
 class ChannelMask(unittest.TestCase):
     @LIB_CORE
@@ -861,6 +1013,559 @@ class PCMConverter(unittest.TestCase):
                 # when converter is closed
                 self.assertRaises(ValueError, main_reader.read, 4096)
 
+    @LIB_PCM
+    def test_fused(self):
+        from audiotools.pcmconverter import (Converter,
+                                             Averager,
+                                             Downmixer,
+                                             Resampler,
+                                             BPSConverter)
+
+        def sine(sample_rate, channel_mask, bits_per_sample):
+            channels = len(audiotools.ChannelMask(channel_mask))
+            peak = (1 << (bits_per_sample - 1)) // (channels * 2)
+            return test_streams.Simple_Sine(
+                sample_rate // 2,
+                sample_rate,
+                channel_mask,
+                bits_per_sample,
+                *[(peak, 40 + c * 7) for c in range(channels)])
+
+        def samples(reader):
+            samples = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                samples.extend(f)
+                f = reader.read(4096)
+            reader.close()
+            return samples
+
+        def assertClose(fused, chained, tolerance):
+            self.assertEqual(len(fused), len(chained))
+            self.assertLessEqual(
+                max([abs(f - c) for (f, c) in zip(fused, chained)] + [0]),
+                tolerance)
+
+        # resampling alone matches the Resampler exactly
+        assertClose(samples(Converter(sine(48000, 0x3, 16),
+                                      44100, 2, 0x3, 16)),
+                    samples(Resampler(sine(48000, 0x3, 16), 44100)),
+                    0)
+
+        # increasing bits-per-sample alone matches the BPSConverter exactly
+        assertClose(samples(Converter(sine(44100, 0x3, 16),
+                                      44100, 2, 0x3, 24)),
+                    samples(BPSConverter(sine(44100, 0x3, 16), 24)),
+                    0)
+
+        # reducing bits-per-sample differs only in dither
+        assertClose(samples(Converter(sine(44100, 0x3, 24),
+                                      44100, 2, 0x3, 16)),
+                    samples(BPSConverter(sine(44100, 0x3, 24), 16)),
+                    2)
+
+        # channel matrices round once instead of per-stage
+        assertClose(samples(Converter(sine(44100, 0x3F, 16),
+                                      44100, 2, 0x3, 16)),
+                    samples(Downmixer(sine(44100, 0x3F, 16))),
+                    1)
+        assertClose(samples(Converter(sine(44100, 0x37, 24),
+                                      44100, 1, 0x4, 24)),
+                    samples(Averager(Downmixer(sine(44100, 0x37, 24)))),
+                    2)
+        assertClose(samples(Converter(sine(44100, 0x3, 16),
+                                      44100, 1, 0x4, 16)),
+                    samples(Averager(sine(44100, 0x3, 16))),
+                    1)
+
+        # duplicating channels resamples before remixing
+        mono = samples(Resampler(sine(44100, 0x4, 16), 48000))
+        stereo = samples(Converter(sine(44100, 0x4, 16),
+                                   48000, 2, 0x3, 16))
+        self.assertEqual(stereo[0::2], mono)
+        self.assertEqual(stereo[1::2], mono)
+
+        # the whole 24/96 5.1 to 16/44.1 stereo chain in one pass
+        fused = Converter(sine(96000, 0x3F, 24), 44100, 2, 0, 16)
+        self.assertEqual(fused.sample_rate, 44100)
+        self.assertEqual(fused.channels, 2)
+        self.assertEqual(fused.channel_mask, 0x3)
+        self.assertEqual(fused.bits_per_sample, 16)
+        assertClose(samples(fused),
+                    samples(BPSConverter(
+                        Resampler(Downmixer(sine(96000, 0x3F, 24)), 44100),
+                        16)),
+                    2)
+
+        # unsupported plans are rejected up front
+        self.assertRaises(ValueError, Converter,
+                          sine(44100, 0x3F, 16), 44100, 4, 0x33, 16)
+        self.assertRaises(ValueError, Converter,
+                          sine(44100, 0x3, 16), 0, 2, 0x3, 16)
+        self.assertRaises(ValueError, Converter,
+                          sine(44100, 0x3, 16), 44100, 2, 0x3, 12)
+
+    @LIB_PCM
+    def test_dither(self):
+        from audiotools.pcmconverter import (BPSConverter,
+                                             Converter,
+                                             NOISE_SHAPING_NONE,
+                                             NOISE_SHAPING_FIRST_ORDER,
+                                             NOISE_SHAPING_SECOND_ORDER,
+                                             NOISE_SHAPING_LIPSHITZ)
+        from math import sin
+
+        PCM_FRAMES = 100000
+
+        class ListReader:
+            def __init__(self, samples):
+                self.sample_rate = 44100
+                self.channels = 1
+                self.channel_mask = 0x4
+                self.bits_per_sample = 24
+                self.framelist = audiotools.pcm.from_list(samples,
+                                                          1, 24, True)
+
+            def read(self, pcm_frames):
+                (head, self.framelist) = self.framelist.split(pcm_frames)
+                return head
+
+            def close(self):
+                pass
+
+        def samples(reader):
+            samples = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                samples.extend(f)
+                f = reader.read(4096)
+            reader.close()
+            return samples
+
+        def error_stats(original, reduced):
+            errors = [r - o / 256.0 for (o, r) in zip(original, reduced)]
+            mean = sum(errors) / len(errors)
+            variance = sum((e - mean) ** 2 for e in errors) / len(errors)
+            lag1 = (sum((errors[i] - mean) * (errors[i + 1] - mean)
+                        for i in range(len(errors) - 1)) /
+                    (len(errors) - 1))
+            return (errors, mean, lag1 / variance)
+
+        # TPDF dither keeps sub-LSB levels on average
+        half_lsb = samples(BPSConverter(ListReader([128] * PCM_FRAMES), 16))
+        self.assertEqual(len(half_lsb), PCM_FRAMES)
+        self.assertLess(abs(sum(half_lsb) / float(PCM_FRAMES) - 0.5), 0.02)
+
+        original = [int(round(1000000 * sin(i / 100.0)))
+                    for i in range(PCM_FRAMES)]
+
+        # unshaped error stays within 1.5 LSB and is white
+        (errors, mean, correlation) = error_stats(
+            original,
+            samples(BPSConverter(ListReader(original), 16,
+                                 NOISE_SHAPING_NONE)))
+        self.assertLessEqual(max(map(abs, errors)), 1.5)
+        self.assertLess(abs(mean), 0.02)
+        self.assertLess(abs(correlation), 0.02)
+
+        # shaped error moves toward high frequencies
+        for (shaping, expected) in [(NOISE_SHAPING_FIRST_ORDER, -0.5),
+                                    (NOISE_SHAPING_SECOND_ORDER, -2 / 3.0)]:
+            (errors, mean, correlation) = error_stats(
+                original,
+                samples(BPSConverter(ListReader(original), 16,
+                                     noise_shaping=shaping)))
+            self.assertLess(abs(mean), 0.02)
+            self.assertLess(abs(correlation - expected), 0.02)
+
+        (errors, mean, correlation) = error_stats(
+            original,
+            samples(Converter(ListReader(original), 44100, 1, 0x4, 16,
+                              noise_shaping=NOISE_SHAPING_LIPSHITZ)))
+        self.assertLess(abs(mean), 0.05)
+        self.assertLess(correlation, -0.5)
+
+        self.assertRaises(ValueError, BPSConverter,
+                          ListReader(original), 16, 4)
+        self.assertRaises(ValueError, Converter,
+                          ListReader(original), 44100, 1, 0x4, 16, 0, -1)
+
+    @LIB_PCM
+    def test_dither_kernels(self):
+        import os
+        import audiotools.pcmconverter
+        from audiotools.pcmconverter import (BPSConverter,
+                                             Converter,
+                                             NOISE_SHAPING_NONE,
+                                             NOISE_SHAPING_FIRST_ORDER,
+                                             NOISE_SHAPING_LIPSHITZ)
+        from math import sin
+
+        original = [int(round(8388607 * sin(i / 10.0)))
+                    for i in range(10001)]
+
+        class ListReader:
+            def __init__(self):
+                self.sample_rate = 44100
+                self.channels = 1
+                self.channel_mask = 0x4
+                self.bits_per_sample = 24
+                self.framelist = audiotools.pcm.from_list(original,
+                                                          1, 24, True)
+
+            def read(self, pcm_frames):
+                (head, self.framelist) = self.framelist.split(
+                    min(pcm_frames, 1001))
+                return head
+
+            def close(self):
+                pass
+
+        def samples(reader):
+            samples = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                samples.extend(f)
+                f = reader.read(4096)
+            reader.close()
+            return samples
+
+        def dither_all():
+            # every dither source is seeded alike
+            # so each set of kernels must generate the same noise
+            urandom = os.urandom
+            os.urandom = lambda size: bytes(bytearray(range(1, size + 1)))
+            try:
+                return ([samples(BPSConverter(ListReader(), 16, shaping))
+                         for shaping in [NOISE_SHAPING_NONE,
+                                         NOISE_SHAPING_FIRST_ORDER,
+                                         NOISE_SHAPING_LIPSHITZ]] +
+                        [samples(Converter(ListReader(), 48000, 1, 0x4, 8))])
+            finally:
+                os.urandom = urandom
+
+        kernels = audiotools.pcmconverter.dither_kernels()
+        self.assertEqual(kernels[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.pcmconverter.use_dither_kernels,
+                          "none")
+
+        try:
+            audiotools.pcmconverter.use_dither_kernels("scalar")
+            scalar = dither_all()
+            for kernel in kernels[1:]:
+                audiotools.pcmconverter.use_dither_kernels(kernel)
+                self.assertEqual(dither_all(), scalar,
+                                 "%s kernels differ from scalar" % (kernel))
+        finally:
+            audiotools.pcmconverter.use_dither_kernels(kernels[-1])
+
+    @LIB_PCM
+    def test_downmixer(self):
+        from audiotools.pcmconverter import Downmixer
+
+        def sine(channel_mask, bits_per_sample):
+            channels = len(audiotools.ChannelMask(channel_mask))
+            peak = (1 << (bits_per_sample - 1)) // channels
+            return test_streams.Simple_Sine(
+                10000,
+                44100,
+                channel_mask,
+                bits_per_sample,
+                *[(peak, 30 + c * 11) for c in range(channels)])
+
+        def frames(reader):
+            frames = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                frames.extend([f.frame(i) for i in range(f.frames)])
+                f = reader.read(4096)
+            reader.close()
+            return frames
+
+        def mixed(channel_mask, bits_per_sample, matrix):
+            # mixes the sine wave's frames in Python
+            maximum = (1 << (bits_per_sample - 1)) - 1
+            minimum = -(1 << (bits_per_sample - 1))
+            return [[min(max(int(round(sum([g * s for (g, s) in
+                                             zip(gains, list(frame))]))),
+                             minimum), maximum)
+                     for gains in matrix]
+                    for frame in frames(sine(channel_mask,
+                                             bits_per_sample))]
+
+        def assertMix(downmixer, channel_mask, bits_per_sample, matrix):
+            for (frame, expected) in zip(frames(downmixer),
+                                         mixed(channel_mask,
+                                               bits_per_sample,
+                                               matrix)):
+                for (s, e) in zip(list(frame), expected):
+                    self.assertLessEqual(abs(s - e), 1)
+
+        rear = 0.7 * 0.6
+        stereo_5_1 = [[1, 0, 0.7, 0, rear, rear],
+                      [0, 1, 0.7, 0, -rear, -rear]]
+        stereo_7_1 = [[1, 0, 0.7, 0, rear, rear, rear, rear],
+                      [0, 1, 0.7, 0, -rear, -rear, -rear, -rear]]
+
+        # predefined stereo and mono matrices
+        for (input_mask, matrix) in [(0x3F, stereo_5_1),
+                                     (0x63F, stereo_7_1)]:
+            for bits_per_sample in [8, 16, 24]:
+                downmixer = Downmixer(sine(input_mask, bits_per_sample))
+                self.assertEqual(downmixer.channels, 2)
+                self.assertEqual(downmixer.channel_mask, 0x3)
+                assertMix(downmixer, input_mask, bits_per_sample, matrix)
+
+                downmixer = Downmixer(sine(input_mask, bits_per_sample),
+                                      channel_mask=0x4)
+                self.assertEqual(downmixer.channels, 1)
+                self.assertEqual(downmixer.channel_mask, 0x4)
+                assertMix(downmixer, input_mask, bits_per_sample,
+                          [[(l + r) / 2 for (l, r) in zip(*matrix)]])
+
+        # caller-supplied matrices, with or without a channel mask
+        matrix = [[0.5, 0.5, 0, 0, 0, 0],
+                  [0, 0, 1, 0, 0, 0],
+                  [0, 0, 0, 0, 0.25, 0.75]]
+        downmixer = Downmixer(sine(0x3F, 16), matrix=matrix)
+        self.assertEqual(downmixer.channels, 3)
+        self.assertEqual(downmixer.channel_mask, 0)
+        assertMix(downmixer, 0x3F, 16, matrix)
+
+        downmixer = Downmixer(sine(0x3F, 16), 0x7, matrix)
+        self.assertEqual(downmixer.channels, 3)
+        self.assertEqual(downmixer.channel_mask, 0x7)
+        assertMix(downmixer, 0x3F, 16, matrix)
+
+        # each Downmixer has its own buffers
+        # so interleaving reads doesn't change their output
+        readers = [Downmixer(sine(0x3F, 16)),
+                   Downmixer(sine(0x63F, 24), channel_mask=0x4)]
+        outputs = [[], []]
+        while True:
+            chunks = [r.read(4096) for r in readers]
+            if max([len(c) for c in chunks]) == 0:
+                break
+            for (output, chunk) in zip(outputs, chunks):
+                output.extend([chunk.frame(i) for i in range(chunk.frames)])
+        for r in readers:
+            r.close()
+        self.assertEqual(outputs[0], frames(Downmixer(sine(0x3F, 16))))
+        self.assertEqual(outputs[1],
+                         frames(Downmixer(sine(0x63F, 24), channel_mask=0x4)))
+
+        # unsupported masks and malformed matrices are rejected
+        self.assertRaises(ValueError, Downmixer, sine(0x3F, 16), 0x33)
+        self.assertRaises(ValueError, Downmixer, sine(0x3F, 16),
+                          matrix=[[1, 0, 0, 0, 0]])
+        self.assertRaises(ValueError, Downmixer, sine(0x3F, 16), 0x3,
+                          [[1, 0, 0, 0, 0, 0]])
+        self.assertRaises(ValueError, Downmixer, sine(0x3F, 16),
+                          matrix=[])
+        self.assertRaises(TypeError, Downmixer, sine(0x3F, 16),
+                          matrix=[[1, 0, 0, 0, 0, "x"]])
+
+    @LIB_PCM
+    def test_downmixer_kernels(self):
+        import audiotools.pcmconverter
+        from audiotools.pcmconverter import Downmixer
+
+        def mix(input_mask, bits_per_sample, channel_mask, matrix):
+            # full-scale sines so mixes clip and round at the extremes
+            channels = len(audiotools.ChannelMask(input_mask))
+            peak = (1 << (bits_per_sample - 1)) - 1
+            reader = Downmixer(
+                test_streams.Simple_Sine(4103,
+                                         44100,
+                                         input_mask,
+                                         bits_per_sample,
+                                         *[(peak, 30 + c * 11)
+                                           for c in range(channels)]),
+                channel_mask,
+                matrix)
+            frames = []
+            f = reader.read(1000)
+            while len(f) > 0:
+                frames.extend(list(f))
+                f = reader.read(1000)
+            reader.close()
+            return frames
+
+        def mix_all():
+            return [mix(input_mask, bits_per_sample, channel_mask, matrix)
+                    for bits_per_sample in [8, 16, 24]
+                    for (input_mask, channel_mask, matrix) in
+                    [(0x3F, 0x3, None),
+                     (0x63F, 0x3, None),
+                     (0x63F, 0x4, None),
+                     (0x3, 0x7, [[1.5, 0.5], [0.5, -0.5], [-2, 0.25]])]]
+
+        kernels = audiotools.pcmconverter.mixing_kernels()
+        self.assertEqual(kernels[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.pcmconverter.use_mixing_kernels,
+                          "none")
+
+        try:
+            audiotools.pcmconverter.use_mixing_kernels("scalar")
+            scalar = mix_all()
+            for kernel in kernels[1:]:
+                audiotools.pcmconverter.use_mixing_kernels(kernel)
+                self.assertEqual(mix_all(), scalar,
+                                 "%s kernels differ from scalar" % (kernel))
+        finally:
+            audiotools.pcmconverter.use_mixing_kernels(kernels[-1])
+
+    @LIB_PCM
+    def test_polyphase(self):
+        from audiotools.pcmconverter import (Resampler,
+                                             RESAMPLE_FAST,
+                                             RESAMPLE_MEDIUM,
+                                             RESAMPLE_BEST)
+        from math import sin, pi, ceil
+
+        AMPLITUDE = 16384
+        FREQUENCY = 1000.0
+
+        class SineReader:
+            def __init__(self, sample_rate, pcm_frames, chunk_size):
+                self.sample_rate = sample_rate
+                self.channels = 2
+                self.channel_mask = 0x3
+                self.bits_per_sample = 16
+                self.chunk_size = chunk_size
+                self.framelist = audiotools.pcm.from_channels(
+                    [audiotools.pcm.from_list(
+                        [int(round(AMPLITUDE *
+                                   sin(2 * pi * FREQUENCY * i / sample_rate +
+                                       phase)))
+                         for i in range(pcm_frames)], 1, 16, True)
+                     for phase in [0, pi / 2]])
+
+            def read(self, pcm_frames):
+                (head, self.framelist) = self.framelist.split(
+                    min(pcm_frames, self.chunk_size))
+                return head
+
+            def close(self):
+                pass
+
+        def resample(input_rate, output_rate, quality, chunk_size=4096):
+            reader = Resampler(SineReader(input_rate, input_rate // 4,
+                                          chunk_size),
+                               output_rate,
+                               quality)
+            samples = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                samples.extend(f)
+                f = reader.read(4096)
+            reader.close()
+            return samples
+
+        def error(samples, output_rate):
+            # compare against the ideal sine away from the stream's edges
+            pcm_frames = len(samples) // 2
+            return max([abs(samples[i * 2 + c] -
+                            AMPLITUDE * sin(2 * pi * FREQUENCY * i /
+                                            output_rate + phase))
+                        for i in range(pcm_frames // 5, pcm_frames * 4 // 5)
+                        for (c, phase) in enumerate([0, pi / 2])])
+
+        for (input_rate, output_rate) in [(44100, 48000),
+                                          (48000, 44100),
+                                          (88200, 44100),
+                                          (96000, 48000),
+                                          (192000, 48000),
+                                          (192000, 44100),
+                                          (44100, 96000)]:
+            for (quality, tolerance) in [(RESAMPLE_FAST, 8),
+                                         (RESAMPLE_MEDIUM, 2),
+                                         (RESAMPLE_BEST, 2)]:
+                samples = resample(input_rate, output_rate, quality)
+
+                # the whole stream is resampled without filter delay
+                self.assertEqual(
+                    len(samples) // 2,
+                    int(ceil((input_rate // 4) * output_rate /
+                             float(input_rate))))
+                self.assertLessEqual(error(samples, output_rate), tolerance)
+
+            # output doesn't depend on how the input is chunked
+            self.assertEqual(resample(input_rate, output_rate,
+                                      RESAMPLE_BEST, 1001),
+                             samples)
+
+        # ratios without small filter banks fall back to libsamplerate
+        samples = resample(44100, 44099, RESAMPLE_BEST)
+        self.assertLessEqual(abs(len(samples) // 2 - 44099 // 4), 1)
+        self.assertLessEqual(error(samples, 44099), 2)
+
+        self.assertRaises(ValueError, Resampler,
+                          SineReader(44100, 10, 10), 48000, 3)
+
+    @LIB_PCM
+    def test_polyphase_kernels(self):
+        import audiotools.pcmconverter
+        from audiotools.pcmconverter import Resampler, RESAMPLE_BEST
+
+        def resample(input_rate, output_rate, channel_mask, bits_per_sample):
+            channels = len(audiotools.ChannelMask(channel_mask))
+            peak = (1 << (bits_per_sample - 1)) // channels
+            reader = Resampler(
+                test_streams.Simple_Sine(input_rate // 10,
+                                         input_rate,
+                                         channel_mask,
+                                         bits_per_sample,
+                                         *[(peak, 30 + c * 11)
+                                           for c in range(channels)]),
+                output_rate,
+                RESAMPLE_BEST)
+            samples = []
+            f = reader.read(4096)
+            while len(f) > 0:
+                samples.extend(f)
+                f = reader.read(4096)
+            reader.close()
+            return samples
+
+        def resample_all():
+            # odd channel counts exercise both
+            # the paired and single channel loops
+            return [(bits_per_sample,
+                     resample(input_rate, output_rate,
+                              channel_mask, bits_per_sample))
+                    for (input_rate, output_rate) in [(44100, 48000),
+                                                      (96000, 44100)]
+                    for channel_mask in [0x4, 0x3, 0x7, 0x3F]
+                    for bits_per_sample in [16, 24]]
+
+        kernels = audiotools.pcmconverter.resampling_kernels()
+        self.assertEqual(kernels[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.pcmconverter.use_resampling_kernels,
+                          "none")
+
+        try:
+            audiotools.pcmconverter.use_resampling_kernels("scalar")
+            scalar = resample_all()
+            for kernel in kernels[1:]:
+                audiotools.pcmconverter.use_resampling_kernels(kernel)
+                # kernels only sum their products in a different order
+                # so they may differ from scalar by float rounding,
+                # which is a few LSBs once samples have 24 bits
+                for ((bits_per_sample, expected),
+                     (_, samples)) in zip(scalar, resample_all()):
+                    self.assertEqual(len(samples), len(expected))
+                    self.assertLessEqual(
+                        max([abs(s - e) for (s, e) in zip(samples,
+                                                          expected)]),
+                        {16: 1, 24: 8}[bits_per_sample],
+                        "%s kernels differ from scalar" % (kernel))
+        finally:
+            audiotools.pcmconverter.use_resampling_kernels(kernels[-1])
+
 
 class Test_ReplayGain(unittest.TestCase):
     @LIB_CORE
@@ -1841,6 +2546,359 @@ class TestFrameList(unittest.TestCase):
                           audiotools.pcm.FloatFrameList,
                           [0.0] * 4, -1)
 
+    @LIB_CORE
+    def test_vector_conversions(self):
+        import audiotools.pcm
+        from random import Random
+
+        # converters handle whole vectors of samples at a time
+        # and the rest one at a time, so every length up to a few vectors
+        # must match a sample-at-a-time reference exactly
+        # with each set of vector kernels the CPU can run
+
+        def from_bytes(data, bits_per_sample, is_big_endian, is_signed):
+            size = bits_per_sample // 8
+            values = [int.from_bytes(data[i:i + size],
+                                     "big" if is_big_endian else "little",
+                                     signed=is_signed)
+                      for i in range(0, len(data), size)]
+            if is_signed:
+                return values
+            else:
+                return [v - (1 << (bits_per_sample - 1)) for v in values]
+
+        def to_bytes(values, bits_per_sample, is_big_endian, is_signed):
+            # signed samples clamp, unsigned samples wrap
+            size = bits_per_sample // 8
+            high = (1 << (bits_per_sample - 1)) - 1
+            low = -(1 << (bits_per_sample - 1))
+            data = b""
+            for v in values:
+                if is_signed:
+                    v = min(max(v, low), high) % (1 << bits_per_sample)
+                else:
+                    v = (v - low) % (1 << bits_per_sample)
+                data += v.to_bytes(size, "big" if is_big_endian else "little")
+            return data
+
+        def convert():
+            # runs every conversion on the same pseudo-random input
+            # and returns all of the results
+            r = Random(36)
+            results = []
+            for bits_per_sample in [8, 16, 24]:
+                high = (1 << (bits_per_sample - 1)) - 1
+                low = -(1 << (bits_per_sample - 1))
+                for length in range(0, 41):
+                    for is_big_endian in [False, True]:
+                        for is_signed in [False, True]:
+                            data = bytes(r.randrange(256) for i in
+                                         range(length * bits_per_sample // 8))
+                            f = audiotools.pcm.FrameList(data,
+                                                         1,
+                                                         bits_per_sample,
+                                                         is_big_endian,
+                                                         is_signed)
+                            values = from_bytes(data,
+                                                bits_per_sample,
+                                                is_big_endian,
+                                                is_signed)
+                            self.assertEqual(list(f), values)
+                            self.assertEqual(
+                                f.to_bytes(is_big_endian, is_signed), data)
+                            results.append(list(f))
+
+                            values = [r.choice([r.randint(low, high),
+                                                r.randint(low * 4, high * 4),
+                                                low, high])
+                                      for i in range(length)]
+                            f = audiotools.pcm.from_list(values,
+                                                         1,
+                                                         bits_per_sample,
+                                                         True)
+                            data = f.to_bytes(is_big_endian, is_signed)
+                            self.assertEqual(data,
+                                             to_bytes(values,
+                                                      bits_per_sample,
+                                                      is_big_endian,
+                                                      is_signed))
+                            results.append(data)
+
+                    values = [r.randint(low, high) for i in range(length)]
+                    f = audiotools.pcm.from_list(values,
+                                                 1,
+                                                 bits_per_sample,
+                                                 True)
+                    floats = list(f.to_float())
+                    self.assertEqual(floats,
+                                     [v / (high if v >= 0 else -low)
+                                      for v in values])
+                    results.append(floats)
+
+                    floats = [r.choice([r.uniform(-1.0, 1.0),
+                                        r.uniform(-2.0, 2.0),
+                                        -1.0, 1.0, -0.0])
+                              for i in range(length)]
+                    f = audiotools.pcm.FloatFrameList(floats, 1)
+                    values = list(f.to_int(bits_per_sample))
+                    self.assertEqual(
+                        values,
+                        [min(max(int(v * (-low if v < 0 else high)), low),
+                             high)
+                         for v in floats])
+                    results.append(values)
+            return results
+
+        kernels = audiotools.pcm.conversion_kernels()
+        self.assertEqual(kernels[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.pcm.use_conversion_kernels,
+                          "none")
+
+        try:
+            audiotools.pcm.use_conversion_kernels("scalar")
+            scalar = convert()
+            for kernel in kernels[1:]:
+                audiotools.pcm.use_conversion_kernels(kernel)
+                self.assertEqual(convert(), scalar,
+                                 "%s kernels differ from scalar" % (kernel))
+        finally:
+            audiotools.pcm.use_conversion_kernels(kernels[-1])
+
+    @LIB_CORE
+    def test_compact(self):
+        import audiotools.pcm
+        import struct
+        from io import BytesIO
+
+        samples = [-32768, -1000, -1, 0, 1, 1000, 32767, 5]
+
+        # FrameLists of 16 bits-per-sample or less from bytes
+        # are stored as 16-bit integers
+        for (bits_per_sample, values) in [(16, samples),
+                                          (8, [-128, -5, 0, 5, 127, 1])]:
+            i = audiotools.pcm.from_list(values, 2, bits_per_sample, True)
+            self.assertEqual(memoryview(i).format, "i")
+            self.assertEqual(i.storage_bits, 32)
+            for is_big_endian in [False, True]:
+                for is_signed in [False, True]:
+                    data = i.to_bytes(is_big_endian, is_signed)
+                    f = audiotools.pcm.FrameList(data,
+                                                 2,
+                                                 bits_per_sample,
+                                                 is_big_endian,
+                                                 is_signed)
+                    self.assertEqual(memoryview(f).format, "h")
+                    self.assertEqual(memoryview(f).itemsize, 2)
+                    self.assertEqual(f.storage_bits, 16)
+                    self.assertEqual(list(f), values)
+                    self.assertEqual(f, i)
+                    self.assertEqual(i, f)
+                    self.assertEqual(f.to_bytes(is_big_endian, is_signed),
+                                     data)
+
+        i = audiotools.pcm.from_list(samples, 2, 16, True)
+        f = i.compact()
+        self.assertEqual(memoryview(f).format, "h")
+        self.assertEqual(memoryview(f).tolist(),
+                         [samples[j:j + 2] for j in range(0, 8, 2)])
+        self.assertEqual(f, i)
+        self.assertIs(f.compact(), f)
+
+        # compact FrameLists work like any other
+        self.assertEqual(f.frames, 4)
+        self.assertEqual(f.channels, 2)
+        self.assertEqual(f.bits_per_sample, 16)
+        self.assertEqual([f[j] for j in range(8)], samples)
+        self.assertEqual(list(f.frame(1)), samples[2:4])
+        self.assertEqual(list(f.channel(1)), samples[1::2])
+        self.assertEqual(memoryview(f.channel(1)).format, "h")
+        self.assertEqual(f.to_float(), i.to_float())
+        (head, tail) = f.split(1)
+        self.assertEqual(list(head), samples[0:2])
+        self.assertEqual(list(tail), samples[2:])
+        self.assertEqual(list(head + tail), samples)
+        self.assertEqual(list(tail + head), samples[2:] + samples[0:2])
+        self.assertEqual(list(f + i), samples + samples)
+        self.assertEqual(list(i + f), samples + samples)
+        self.assertEqual(memoryview(f + f).format, "h")
+        self.assertEqual(list(f * 2), samples + samples)
+        self.assertEqual(
+            list(audiotools.pcm.from_frames([f.frame(j) for j in range(4)])),
+            samples)
+        self.assertEqual(
+            list(audiotools.pcm.from_channels([f.channel(0),
+                                               f.channel(1)])),
+            samples)
+
+        # FrameLists that can't be stored in 16 bits aren't
+        f = audiotools.pcm.from_list([0, 1, 2, 3], 2, 24, True)
+        self.assertIs(f.compact(), f)
+        f = audiotools.pcm.from_list([0, 40000, 2, 3], 2, 16, True)
+        self.assertIs(f.compact(), f)
+        data = audiotools.pcm.from_list(
+            [0, 1, 2, 3], 2, 24, True).to_bytes(False, True)
+        f = audiotools.pcm.FrameList(data, 2, 24, False, True)
+        self.assertEqual(memoryview(f).format, "i")
+        self.assertEqual(f.storage_bits, 32)
+
+        # C readers of compact FrameLists see the same samples
+        data = struct.pack("<" + "h" * 2000,
+                           *[(j * 37) % 65536 - 32768 for j in range(2000)])
+        reader = audiotools.BufferedPCMReader(
+            audiotools.PCMFileReader(BytesIO(data), 44100, 2, 0x3, 16))
+        self.assertEqual(reader.read(1000).to_bytes(False, True), data)
+        reader.close()
+
+    @LIB_CORE
+    def test_empty_framelist(self):
+        import audiotools.pcm
+
+        f = audiotools.pcm.empty_framelist(2, 16)
+        self.assertEqual(f.frames, 0)
+        self.assertEqual(f.channels, 2)
+        self.assertEqual(f.bits_per_sample, 16)
+
+        f = audiotools.pcm.empty_framelist(3, 24, 5)
+        self.assertEqual(f.frames, 5)
+        self.assertEqual(f.channels, 3)
+        self.assertEqual(f.bits_per_sample, 24)
+        self.assertEqual(list(f), [0] * 15)
+
+        f = audiotools.pcm.empty_framelist(2, 16, 5, True)
+        self.assertEqual(f.frames, 5)
+        self.assertEqual(memoryview(f).format, "h")
+        self.assertEqual(list(f), [0] * 10)
+
+        f = audiotools.pcm.empty_framelist(2, 24, 5, True)
+        self.assertEqual(memoryview(f).format, "i")
+        self.assertEqual(list(f), [0] * 10)
+
+        self.assertRaises(ValueError,
+                          audiotools.pcm.empty_framelist, 2, 16, -1)
+
+    @LIB_CORE
+    def test_split_views(self):
+        import audiotools.pcm
+
+        samples = list(range(-50, 50))
+        f = audiotools.pcm.from_list(samples, 4, 16, True)
+
+        # halves outlive the FrameList they were split from
+        (head, tail) = f.split(10)
+        del(f)
+        self.assertEqual(list(head), samples[0:40])
+        self.assertEqual(list(tail), samples[40:])
+        self.assertEqual(memoryview(tail).tolist()[0], samples[40:44])
+
+        # splitting a split works from the same samples
+        (head2, tail2) = tail.split(5)
+        del(tail)
+        self.assertEqual(list(head2), samples[40:60])
+        self.assertEqual(list(tail2), samples[60:])
+        self.assertEqual(head2.frames, 5)
+        self.assertEqual(tail2.frames, 10)
+        self.assertEqual(head2.bits_per_sample, 16)
+
+        # rejoining split halves restores the original
+        whole = head + head2 + tail2
+        self.assertEqual(list(whole), samples)
+        self.assertEqual(whole.frames, 25)
+        self.assertEqual(list(tail2 + head2), samples[60:] + samples[40:60])
+
+        # concatenating with other FrameLists still copies
+        other = audiotools.pcm.from_list([1, 2, 3, 4], 4, 16, True)
+        self.assertEqual(list(head2 + other), samples[40:60] + [1, 2, 3, 4])
+        self.assertEqual(list(other + head), [1, 2, 3, 4] + samples[0:40])
+
+        # split points at either end
+        (empty, full) = head.split(0)
+        self.assertEqual(empty.frames, 0)
+        self.assertEqual(empty.channels, 4)
+        self.assertEqual(list(full), samples[0:40])
+        (full, empty) = head.split(10)
+        self.assertEqual(empty.frames, 0)
+        self.assertEqual(list(full), samples[0:40])
+        self.assertEqual(list(empty + full), samples[0:40])
+
+        # frames and conversions of views
+        self.assertEqual(list(head2.frame(1)), samples[44:48])
+        self.assertEqual(list(head2.channel(0)), samples[40:60:4])
+        self.assertEqual(head2.to_float().to_int(16), head2)
+        self.assertEqual(head2.to_bytes(False, True),
+                         audiotools.pcm.from_list(samples[40:60], 4, 16,
+                                                  True).to_bytes(False, True))
+
+    @LIB_CORE
+    def test_recycling(self):
+        import audiotools.pcm
+
+        # sample arrays and FrameLists are reused once deallocated
+        # so ensure recycled ones never leak old samples
+        for frames in [0, 1, 192, 4096, 65536, 70000]:
+            for channels in [1, 2, 8]:
+                for value in [1, -1]:
+                    f = audiotools.pcm.from_list([value] *
+                                                 (frames * channels),
+                                                 channels, 16, True)
+                    del(f)
+                f = audiotools.pcm.empty_framelist(channels, 16, frames)
+                self.assertEqual(f.frames, frames)
+                self.assertEqual(f.channels, channels)
+                self.assertEqual(set(f), set([0]) if frames else set([]))
+                (head, tail) = f.split(frames // 2)
+                self.assertEqual(head + tail, f)
+                self.assertEqual(f.to_float().to_int(16), f)
+                del(head)
+                del(tail)
+                del(f)
+
+        # many live FrameLists at once are all distinct
+        framelists = [audiotools.pcm.from_list([i] * 8, 2, 16, True)
+                      for i in range(1000)]
+        for (i, f) in enumerate(framelists):
+            self.assertEqual(list(f), [i] * 8)
+        del(framelists)
+
+    @LIB_CORE
+    def test_buffer(self):
+        import audiotools.pcm
+        import struct
+
+        f = audiotools.pcm.from_list(list(range(-6, 6)), 3, 16, True)
+        view = memoryview(f)
+        self.assertEqual(view.format, "i")
+        self.assertEqual(view.itemsize, struct.calcsize("i"))
+        self.assertEqual(view.ndim, 2)
+        self.assertEqual(view.shape, (4, 3))
+        self.assertEqual(view.strides, (3 * view.itemsize, view.itemsize))
+        self.assertTrue(view.readonly)
+        self.assertTrue(view.c_contiguous)
+        self.assertEqual(view.tolist(),
+                         [[-6, -5, -4], [-3, -2, -1], [0, 1, 2], [3, 4, 5]])
+        self.assertEqual(view[2, 1], 1)
+        self.assertEqual(
+            view.tobytes(),
+            struct.pack("=" + "i" * 12, *range(-6, 6)))
+
+        # the view keeps its FrameList alive
+        del(f)
+        self.assertEqual(view[3, 2], 5)
+        view.release()
+
+        # views may not be written to
+        f = audiotools.pcm.from_list([1, 2], 2, 16, True)
+        view = memoryview(f)
+        def assign(view):
+            view[0, 0] = 3
+        self.assertRaises(TypeError, assign, view)
+        self.assertEqual(list(f), [1, 2])
+
+        # empty FrameLists have an empty view
+        f = audiotools.pcm.empty_framelist(2, 16)
+        view = memoryview(f)
+        self.assertEqual(view.shape, (0, 2))
+        self.assertEqual(view.tobytes(), b"")
 
 class TestFloatFrameList(unittest.TestCase):
     @LIB_CORE
@@ -1980,6 +3038,50 @@ class TestFloatFrameList(unittest.TestCase):
                               audiotools.pcm.FrameList,
                               b"\x00" * 4, 2, bps, 1, 1)
 
+    @LIB_CORE
+    def test_split_views(self):
+        import audiotools.pcm
+
+        samples = [i / 100.0 for i in range(-50, 50)]
+        f = audiotools.pcm.FloatFrameList(samples, 2)
+
+        (head, tail) = f.split(20)
+        del(f)
+        self.assertEqual(list(head), samples[0:40])
+        self.assertEqual(list(tail), samples[40:])
+
+        (head2, tail2) = tail.split(5)
+        del(tail)
+        self.assertEqual(list(head2), samples[40:50])
+        self.assertEqual(list(tail2), samples[50:])
+
+        self.assertEqual(list(head + head2 + tail2), samples)
+        self.assertEqual(list(tail2 + head), samples[50:] + samples[0:40])
+        self.assertEqual(list(head2.to_int(16)),
+                         list(audiotools.pcm.FloatFrameList(
+                             samples[40:50], 2).to_int(16)))
+
+    @LIB_CORE
+    def test_buffer(self):
+        import audiotools.pcm
+        import struct
+
+        f = audiotools.pcm.FloatFrameList([0.0, 0.25, -0.5, 1.0, -1.0, 0.5],
+                                          2)
+        view = memoryview(f)
+        self.assertEqual(view.format, "d")
+        self.assertEqual(view.itemsize, struct.calcsize("d"))
+        self.assertEqual(view.shape, (3, 2))
+        self.assertEqual(view.strides, (2 * view.itemsize, view.itemsize))
+        self.assertTrue(view.readonly)
+        self.assertEqual(view.tolist(),
+                         [[0.0, 0.25], [-0.5, 1.0], [-1.0, 0.5]])
+        self.assertEqual(view[1, 0], -0.5)
+
+        f = audiotools.pcm.empty_float_framelist(2)
+        view = memoryview(f)
+        self.assertEqual(view.shape, (0, 2))
+        self.assertEqual(view.tobytes(), b"")
 
 class __SimpleChunkReader__:
     def __init__(self, chunks):
@@ -4462,6 +5564,29 @@ class TestReplayGain(unittest.TestCase):
             self.assertEqual(title_gain, album_gain)
             self.assertEqual(title_peak, album_peak)
 
+    @LIB_REPLAYGAIN
+    def test_compact(self):
+        import audiotools.replaygain
+
+        # FrameLists stored as 16-bit integers have the same gain
+        # as their 32-bit equivalents
+        framelists = []
+        audiotools.transfer_data(
+            test_streams.Sine16_Stereo(44100, 44100,
+                                       441.0, 0.50,
+                                       4410.0, 0.49, 1.0).read,
+            framelists.append)
+
+        gain = audiotools.replaygain.ReplayGain(44100)
+        for framelist in framelists:
+            gain.update(framelist)
+        gain2 = audiotools.replaygain.ReplayGain(44100)
+        for framelist in framelists:
+            gain2.update(framelist.compact())
+
+        self.assertEqual(gain.title_gain(), gain2.title_gain())
+        self.assertEqual(gain.title_peak(), gain2.title_peak())
+
     @LIB_REPLAYGAIN
     def test_pcm(self):
         import audiotools.replaygain
@@ -4503,6 +5628,255 @@ class TestReplayGain(unittest.TestCase):
         # ensure wrapped reader is also closed
         self.assertRaises(ValueError, main_reader.read, 4096)
 
+    @LIB_REPLAYGAIN
+    def test_merge(self):
+        import audiotools.replaygain
+
+        def sine(frequency, amplitude):
+            return test_streams.Sine16_Stereo(44100, 44100,
+                                              frequency, amplitude,
+                                              frequency * 2, amplitude,
+                                              1.0)
+
+        # a single analyzer running through each title in turn
+        serial = audiotools.replaygain.ReplayGain(44100)
+        for (frequency, amplitude) in [(441.0, 0.50), (882.0, 0.10)]:
+            audiotools.transfer_data(sine(frequency, amplitude).read,
+                                     serial.update)
+            serial.next_title()
+
+        # matches separate analyzers whose histograms are merged
+        merged = audiotools.replaygain.ReplayGain(44100)
+        for (frequency, amplitude) in [(441.0, 0.50), (882.0, 0.10)]:
+            title = audiotools.replaygain.ReplayGain(44100)
+            audiotools.transfer_data(sine(frequency, amplitude).read,
+                                     title.update)
+            title.next_title()
+            merged.merge(title.album_histogram(), title.album_peak())
+
+        self.assertEqual(merged.album_histogram(), serial.album_histogram())
+        self.assertEqual(merged.album_gain(), serial.album_gain())
+        self.assertEqual(merged.album_peak(), serial.album_peak())
+
+        self.assertRaises(ValueError, merged.merge, b"\x00" * 4, 0.0)
+
+        # calculate_replay_gain's jobs yield the same results
+        temp_files = [
+            tempfile.NamedTemporaryFile(suffix=".wav") for i in range(3)]
+        try:
+            tracks = [audiotools.WaveAudio.from_pcm(f.name,
+                                                    sine(441.0 * (i + 1),
+                                                         0.5 / (i + 1)))
+                      for (i, f) in enumerate(temp_files)]
+            progress = []
+            serial = list(audiotools.calculate_replay_gain(tracks, jobs=1))
+            parallel = list(audiotools.calculate_replay_gain(
+                tracks,
+                lambda fraction: progress.append(fraction),
+                jobs=2))
+            self.assertEqual(serial, parallel)
+            self.assertEqual(progress[-1], 1)
+            self.assertEqual(len(set([r[3] for r in parallel])), 1)
+
+            # and add_replay_gain passes its jobs along
+            class ReplayGainTrack(object):
+                def __init__(self, track, applied):
+                    self.track = track
+                    self.applied = applied
+
+                def __getattr__(self, attr):
+                    return getattr(self.track, attr)
+
+                def set_replay_gain(self, replay_gain):
+                    self.applied.append(replay_gain)
+
+            expected = [audiotools.ReplayGain(track_gain=r[1],
+                                              track_peak=r[2],
+                                              album_gain=r[3],
+                                              album_peak=r[4])
+                        for r in serial]
+            for jobs in [1, 2]:
+                applied = []
+                audiotools.add_replay_gain(
+                    [ReplayGainTrack(t, applied) for t in tracks],
+                    jobs=jobs)
+                self.assertEqual(applied, expected)
+        finally:
+            for f in temp_files:
+                f.close()
+
+    @LIB_REPLAYGAIN
+    def test_mixed_rates(self):
+        import audiotools.replaygain
+
+        # each track of a mixed-rate album is analyzed at its own rate
+        temp_files = [
+            tempfile.NamedTemporaryFile(suffix=".wav") for i in range(3)]
+        try:
+            tracks = [audiotools.WaveAudio.from_pcm(
+                f.name,
+                test_streams.Sine16_Stereo(rate, rate,
+                                           441.0, 0.50,
+                                           882.0, 0.25, 1.0))
+                for (f, rate) in zip(temp_files, [44100, 44100, 48000])]
+
+            for (track,
+                 track_gain,
+                 track_peak,
+                 album_gain,
+                 album_peak) in audiotools.calculate_replay_gain(tracks,
+                                                                 jobs=1):
+                gain = audiotools.replaygain.ReplayGain(track.sample_rate())
+                with track.to_pcm() as pcm:
+                    audiotools.transfer_data(pcm.read, gain.update)
+                self.assertEqual(track_gain, gain.title_gain())
+                self.assertEqual(track_peak, gain.title_peak())
+        finally:
+            for f in temp_files:
+                f.close()
+
+    @LIB_REPLAYGAIN
+    def test_filter_kernels(self):
+        import audiotools.replaygain
+
+        def analyze(sample_rate):
+            gain = audiotools.replaygain.ReplayGain(sample_rate)
+            for (frequency, amplitude) in [(441.0, 0.50), (1234.5, 0.90)]:
+                audiotools.transfer_data(
+                    test_streams.Sine16_Stereo(sample_rate * 2,
+                                               sample_rate,
+                                               frequency, amplitude,
+                                               frequency * 3, amplitude / 2,
+                                               1.0).read,
+                    gain.update)
+                yield (gain.title_gain(), gain.title_peak())
+                gain.next_title()
+            yield (gain.album_gain(),
+                   gain.album_peak(),
+                   gain.album_histogram())
+
+        # every filter kernel matches the scalar filters exactly
+        kernels = audiotools.replaygain.filter_kernels()
+        self.assertEqual(kernels[0], "scalar")
+        self.assertRaises(ValueError,
+                          audiotools.replaygain.use_filter_kernels,
+                          "unknown")
+        try:
+            for sample_rate in [8000, 22050, 44100, 96000]:
+                audiotools.replaygain.use_filter_kernels("scalar")
+                expected = list(analyze(sample_rate))
+                for kernel in kernels[1:]:
+                    audiotools.replaygain.use_filter_kernels(kernel)
+                    self.assertEqual(list(analyze(sample_rate)), expected)
+        finally:
+            audiotools.replaygain.use_filter_kernels(kernels[-1])
+
+    @LIB_REPLAYGAIN
+    def test_r128(self):
+        import audiotools.replaygain
+        from math import sin, pi
+
+        self.assertRaises(ValueError, audiotools.replaygain.R128, 0, 2)
+        self.assertRaises(ValueError, audiotools.replaygain.R128, 44100, 0)
+        self.assertRaises(ValueError, audiotools.replaygain.R128, 44100, 9)
+
+        # a 1kHz tone peaking at -20dBFS in both channels
+        # meters at -20 LUFS with no loudness range
+        for sample_rate in [44100, 48000]:
+            meter = audiotools.replaygain.R128(sample_rate, 2)
+            self.assertEqual(meter.sample_rate, sample_rate)
+            self.assertEqual(meter.channels, 2)
+            self.assertRaises(ValueError, meter.integrated_loudness)
+            audiotools.transfer_data(
+                test_streams.Sine16_Stereo(sample_rate * 10, sample_rate,
+                                           1000.0, 0.05,
+                                           1000.0, 0.05, 1.0).read,
+                meter.update)
+            self.assertAlmostEqual(meter.integrated_loudness(), -20.0,
+                                   places=1)
+            self.assertAlmostEqual(meter.loudness_range(), 0.0, places=1)
+            self.assertGreaterEqual(meter.true_peak(), 0.1)
+            self.assertLess(meter.true_peak(), 0.11)
+
+        self.assertRaises(ValueError,
+                          meter.update,
+                          audiotools.pcm.from_list([0], 1, 16, True))
+
+        # a tone at a quarter of the sample rate
+        # peaks between its samples
+        meter = audiotools.replaygain.R128(48000, 1)
+        meter.update(audiotools.pcm.from_list(
+            [int(round(32767 * sin(pi / 2 * i + pi / 4)))
+             for i in range(48000)], 1, 16, True))
+        self.assertGreater(meter.true_peak(), 0.99)
+        self.assertLess(meter.true_peak(), 1.05)
+
+        # the LFE channel isn't metered
+        meter = audiotools.replaygain.R128(44100, 2, 0x8 | 0x4)
+        meter.update(audiotools.pcm.from_list([0, 16384] * 44100,
+                                              2, 16, True))
+        self.assertRaises(ValueError, meter.integrated_loudness)
+
+        # calculate_replay_gain meters loudness in the same pass
+        temp_file = tempfile.NamedTemporaryFile(suffix=".wav")
+        try:
+            track = audiotools.WaveAudio.from_pcm(
+                temp_file.name,
+                test_streams.Sine16_Stereo(441000, 44100,
+                                           1000.0, 0.05,
+                                           1000.0, 0.05, 1.0))
+            [(result_track,
+              track_gain,
+              track_peak,
+              album_gain,
+              album_peak,
+              (integrated_loudness,
+               loudness_range,
+               true_peak))] = list(audiotools.calculate_replay_gain(
+                   [track], loudness=True))
+            self.assertAlmostEqual(integrated_loudness, -20.0, places=1)
+            self.assertAlmostEqual(loudness_range, 0.0, places=1)
+            self.assertGreaterEqual(true_peak, 0.1)
+        finally:
+            temp_file.close()
+
+    @LIB_REPLAYGAIN
+    def test_r128_kernels(self):
+        import audiotools.replaygain
+        from math import sin
+
+        def analyze(sample_rate, channels):
+            # a tone whose level swells and fades every few seconds
+            # so the meter has a loudness range to measure
+            meter = audiotools.replaygain.R128(sample_rate, channels)
+            for second in range(8):
+                meter.update(audiotools.pcm.from_list(
+                    [int(round(32767 * sin(i / sample_rate * 3.0) *
+                               sin(i * (c + 1) * 0.07)))
+                     for i in range(second * sample_rate,
+                                    (second + 1) * sample_rate)
+                     for c in range(channels)],
+                    channels, 16, True))
+            return (meter.integrated_loudness(),
+                    meter.loudness_range(),
+                    meter.true_peak())
+
+        # every filter kernel matches the scalar filters exactly,
+        # including the unused lane of an odd channel count
+        kernels = audiotools.replaygain.filter_kernels()
+        try:
+            for (sample_rate, channels) in [(44100, 1),
+                                            (48000, 2),
+                                            (44100, 3)]:
+                audiotools.replaygain.use_filter_kernels("scalar")
+                expected = analyze(sample_rate, channels)
+                for kernel in kernels[1:]:
+                    audiotools.replaygain.use_filter_kernels(kernel)
+                    self.assertEqual(analyze(sample_rate, channels),
+                                     expected)
+        finally:
+            audiotools.replaygain.use_filter_kernels(kernels[-1])
+
     @LIB_REPLAYGAIN
     def test_reader(self):
         import audiotools.replaygain
@@ -6345,6 +7719,15 @@ class Test_Accuraterip(Test_FreeDB):
                           is_last=False,
                           accurateripv2_offset=-1)
 
+        self.assertRaises(ValueError,
+                          Checksum,
+                          total_pcm_frames=10,
+                          sample_rate=44100,
+                          is_first=False,
+                          is_last=False,
+                          pcm_frame_range=3,
+                          accurateripv2_offset=3)
+
         checksum = Checksum(total_pcm_frames=200000,
                             sample_rate=44100,
                             is_first=False,
@@ -6541,6 +7924,43 @@ class Test_Accuraterip(Test_FreeDB):
         #                                              0x197662C7,
         #                                              0x3009367D])
 
+        # ensure a wide range of offsets matches
+        # each offset's window checksummed on its own
+        for (is_first, is_last) in [(False, False),
+                                    (True, False),
+                                    (False, True),
+                                    (True, True)]:
+            wide_track = Checksum(total_pcm_frames=track.total_frames(),
+                                  sample_rate=track.sample_rate(),
+                                  is_first=is_first,
+                                  is_last=is_last,
+                                  pcm_frame_range=2941,
+                                  accurateripv2_offset=1470)
+            with audiotools.PCMReaderWindow(track.to_pcm(),
+                                            -1470,
+                                            track.total_frames() +
+                                            2940) as pcmreader:
+                audiotools.transfer_data(pcmreader.read, wide_track.update)
+            checksums = wide_track.checksums_v1()
+            self.assertEqual(len(checksums), 2941)
+            for offset in [0, 1, 587, 1469, 1470, 1471, 2000, 2940]:
+                window_track = Checksum(
+                    total_pcm_frames=track.total_frames(),
+                    sample_rate=track.sample_rate(),
+                    is_first=is_first,
+                    is_last=is_last)
+                with audiotools.PCMReaderWindow(
+                        track.to_pcm(),
+                        offset - 1470,
+                        track.total_frames()) as pcmreader:
+                    audiotools.transfer_data(pcmreader.read,
+                                             window_track.update)
+                self.assertEqual(checksums[offset],
+                                 window_track.checksums_v1()[0])
+                if offset == 1470:
+                    self.assertEqual(wide_track.checksum_v2(),
+                                     window_track.checksum_v2())
+
         # ensure feeding checksum with not enough samples
         # raises ValueError at checksums()-time
         insufficient_samples = Checksum(
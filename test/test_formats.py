@@ -964,11 +964,18 @@ class AudioFileTest(unittest.TestCase):
                 # get a PCMReader of our format
                 with temp_track.to_pcm() as pcmreader:
                     # hash its data when read to end
+                    # and count the PCM frames actually decoded
+                    # since lossy formats may not preserve the length
                     raw_data = md5()
+                    decoded_pcm_frames = 0
                     frame = pcmreader.read(4096)
                     while len(frame) > 0:
                         raw_data.update(frame.to_bytes(False, True))
+                        decoded_pcm_frames += frame.frames
                         frame = pcmreader.read(4096)
+                    if temp_track.lossless():
+                        self.assertEqual(decoded_pcm_frames,
+                                         total_pcm_frames)
 
                     # seeking to negative values should raise ValueError
                     self.assertRaises(ValueError,
@@ -998,7 +1005,7 @@ class AudioFileTest(unittest.TestCase):
                         # if lossless, ensure seeking works as advertised
                         # by comparing stream to file window
                         actual_remaining_frames = 0
-                        desired_remaining_frames = (total_pcm_frames -
+                        desired_remaining_frames = (decoded_pcm_frames -
                                                     actual_position)
                         frame = pcmreader.read(4096)
                         while len(frame) > 0:
@@ -3645,6 +3652,71 @@ class FlacFileTest(TestForeignAiffChunks,
             self.assertEqual(md5sum.digest(), g.digest())
             g.close()
 
+    @FORMAT_FLAC
+    def test_planar(self):
+        import audiotools.pcm
+        from random import Random
+
+        # the encoder reads channels planar
+        # and the decoder returns planar FrameLists
+        # which must behave just like interleaved ones
+        r = Random(35)
+        for (channels, mask, bps) in [(1, 0x4, 8),
+                                      (2, 0x3, 16),
+                                      (6, 0x3F, 16),
+                                      (8, 0x63F, 24)]:
+            noise = [r.randint(-(1 << (bps - 1)), (1 << (bps - 1)) - 1)
+                     for i in range(channels * 3000)]
+            for options in [{"block_size": 1152, "mid_side": True},
+                            {"block_size": 4096}]:
+                temp_file = tempfile.NamedTemporaryFile(suffix=".flac")
+                self.encode(filename=temp_file.name,
+                            pcmreader=test_streams.FrameListReader(noise,
+                                                                   44100,
+                                                                   channels,
+                                                                   bps,
+                                                                   mask),
+                            version="Python Audio Tools " + audiotools.VERSION,
+                            **options)
+
+                decoded = []
+                d = self.decoder(open(temp_file.name, "rb"))
+                f = d.read(4096)
+                while len(f) > 0:
+                    start = len(decoded)
+                    expected = audiotools.pcm.from_list(
+                        noise[start:start + len(f)], channels, bps, True)
+                    self.assertEqual(f.frame(1), expected.frame(1))
+                    self.assertEqual(f[channels + 1], expected[channels + 1])
+                    for c in range(channels):
+                        self.assertEqual(f.channel(c), expected.channel(c))
+                    decoded.extend(f)
+                    (head, tail) = f.split(10)
+                    self.assertEqual(head + tail, expected)
+                    self.assertEqual(f.to_bytes(False, True),
+                                     expected.to_bytes(False, True))
+                    self.assertEqual(memoryview(f).tolist(),
+                                     memoryview(expected).tolist())
+                    f = d.read(4096)
+                d.close()
+                self.assertEqual(decoded, noise)
+
+                # re-encoding planar FrameLists straight from the decoder
+                temp_file2 = tempfile.NamedTemporaryFile(suffix=".flac")
+                pcmreader = audiotools.open(temp_file.name).to_pcm()
+                self.encode(filename=temp_file2.name,
+                            pcmreader=pcmreader,
+                            version="Python Audio Tools " + audiotools.VERSION,
+                            **options)
+                pcmreader.close()
+                self.assertEqual(
+                    audiotools.pcm_cmp(
+                        audiotools.open(temp_file.name).to_pcm(),
+                        audiotools.open(temp_file2.name).to_pcm()),
+                    True)
+                temp_file.close()
+                temp_file2.close()
+
     def __test_reader__(self, pcmreader, **encode_options):
         if not audiotools.BIN.can_execute(audiotools.BIN["flac"]):
             self.assertTrue(
@@ -4627,6 +4699,41 @@ class VorbisFileTest(OggVerify, LossyFileTest):
             self.assertEqual(original_pcm_sum.hexdigest(),
                              new_pcm_sum.hexdigest())
 
+    @FORMAT_VORBIS
+    def test_exact_seek(self):
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            track = self.audio_class.from_pcm(
+                temp.name,
+                test_streams.Sine16_Stereo(441000, 44100,
+                                           441.0, 0.50,
+                                           4410.0, 0.49, 1.0))
+
+            with track.to_pcm() as pcmreader:
+                full = []
+                frame = pcmreader.read(4096)
+                while len(frame) > 0:
+                    full.extend(list(frame))
+                    frame = pcmreader.read(4096)
+            total_pcm_frames = len(full) // 2
+
+            # seeking lands on the requested PCM frame
+            # and decodes exactly what a linear decode does from there
+            for offset in [0, 1, 1023, 100000, 300001,
+                           total_pcm_frames - 1]:
+                with track.to_pcm() as pcmreader:
+                    self.assertEqual(pcmreader.seek(offset), offset)
+                    remaining = []
+                    frame = pcmreader.read(4096)
+                    while len(frame) > 0:
+                        remaining.extend(list(frame))
+                        frame = pcmreader.read(4096)
+                    self.assertEqual(remaining, full[offset * 2:])
+
+            # seeking past the end lands at the end
+            with track.to_pcm() as pcmreader:
+                self.assertEqual(pcmreader.seek(2 ** 34), total_pcm_frames)
+                self.assertEqual(pcmreader.read(4096).frames, 0)
+
 
 class OpusFileTest(OggVerify, LossyFileTest):
     def setUp(self):
@@ -4663,6 +4770,41 @@ class OpusFileTest(OggVerify, LossyFileTest):
             self.assertEqual(original_pcm_sum.hexdigest(),
                              new_pcm_sum.hexdigest())
 
+    @FORMAT_OPUS
+    def test_exact_seek(self):
+        with tempfile.NamedTemporaryFile(suffix=self.suffix) as temp:
+            track = self.audio_class.from_pcm(
+                temp.name,
+                test_streams.Sine16_Stereo(441000, 44100,
+                                           441.0, 0.50,
+                                           4410.0, 0.49, 1.0))
+
+            with track.to_pcm() as pcmreader:
+                total_pcm_frames = 0
+                frame = pcmreader.read(4096)
+                while len(frame) > 0:
+                    total_pcm_frames += frame.frames
+                    frame = pcmreader.read(4096)
+
+            # Opus decoders pre-roll to converge after a seek
+            # so samples may differ slightly from a linear decode,
+            # but the position must still be exact
+            for offset in [0, 1, 1023, 100000, 300001,
+                           total_pcm_frames - 1]:
+                with track.to_pcm() as pcmreader:
+                    self.assertEqual(pcmreader.seek(offset), offset)
+                    remaining = 0
+                    frame = pcmreader.read(4096)
+                    while len(frame) > 0:
+                        remaining += frame.frames
+                        frame = pcmreader.read(4096)
+                    self.assertEqual(remaining, total_pcm_frames - offset)
+
+            # seeking past the end lands at the end
+            with track.to_pcm() as pcmreader:
+                self.assertEqual(pcmreader.seek(2 ** 34), total_pcm_frames)
+                self.assertEqual(pcmreader.read(4096).frames, 0)
+
 
 class SpeexFileTest(LossyFileTest):
     def setUp(self):
@@ -5723,6 +5865,146 @@ class TTAFileTest(LosslessFileTest):
                             bits_per_sample=bps)),
                     65536)
 
+    @FORMAT_TTA
+    def test_threads(self):
+        from audiotools.encoders import encode_tta
+
+        def sine():
+            return test_streams.Sine16_Stereo(200000, 44100,
+                                              441.0, 0.50,
+                                              4410.0, 0.49, 1.0)
+
+        reference = BytesIO()
+        encode_tta(file=reference,
+                   pcmreader=sine(),
+                   total_pcm_frames=200000)
+
+        for threads in [2, 3, 8]:
+            # threaded encoding should be identical to single-threaded
+            for total_pcm_frames in [200000, 0]:
+                encoded = BytesIO()
+                encode_tta(file=encoded,
+                           pcmreader=sine(),
+                           total_pcm_frames=total_pcm_frames,
+                           threads=threads)
+                self.assertEqual(encoded.getvalue(), reference.getvalue())
+
+            # threaded decoding should return the same PCM frames
+            decoder = self.decoder(BytesIO(reference.getvalue()),
+                                   threads=threads)
+            self.assertTrue(audiotools.pcm_cmp(decoder, sine()))
+            decoder.close()
+
+            # and seeking should discard any frames decoded in advance
+            decoder = self.decoder(BytesIO(reference.getvalue()),
+                                   threads=threads)
+            decoder.read(4096)
+            offset = decoder.seek(100000)
+            self.assertEqual(offset, 100000)
+            self.assertTrue(
+                audiotools.pcm_cmp(decoder,
+                                   audiotools.PCMReaderDeHead(sine(),
+                                                              offset)))
+            decoder.close()
+
+        self.assertRaises(ValueError,
+                          self.decoder,
+                          BytesIO(reference.getvalue()),
+                          threads=0)
+
+    @FORMAT_TTA
+    def test_filter_kernels(self):
+        from audiotools.decoders import tta_filter
+        from audiotools.decoders import tta_filter_kernels
+
+        kernels = tta_filter_kernels()
+        self.assertIn("scalar", kernels)
+        self.assertRaises(ValueError, tta_filter, "none", 0, 16, 1, [])
+
+        r = random.Random(27)
+
+        def random_taps():
+            return ([r.randint(-(1 << 16), 1 << 16)] +
+                    [r.randint(-(1 << 10), 1 << 10) for i in range(8)] +
+                    [r.choice([-4, -2, -1, 0, 1, 2, 4]) for i in range(8)] +
+                    [r.randint(-(1 << 17), 1 << 17) for i in range(8)])
+
+        def edge_taps(shift, k, d):
+            # a first sum landing just around a multiple of 1 << shift,
+            # where the filter's rounding and shifting must agree
+            round_ = 1 << (shift - 1)
+            return ([0] +
+                    [k * (1 << shift) - round_ + d] + [0] * 7 +
+                    [0] * 8 +
+                    [1] + [0] * 7)
+
+        for (bps, shift) in [(8, 10), (16, 9), (24, 10)]:
+            lowest = -(1 << (bps - 1))
+            highest = (1 << (bps - 1)) - 1
+            for channels in range(1, 9):
+                for pcm_frames in [0, 1, 7, 64]:
+                    samples = [r.choice([lowest, highest, 0, -1, 1,
+                                         r.randint(lowest, highest)])
+                               for i in range(pcm_frames * channels)]
+                    tap_sets = [None,
+                                [random_taps() for c in range(channels)]]
+                    for k in [-3, -1, 0, 1, 3]:
+                        for d in [-1, 0, 1]:
+                            tap_sets.append([edge_taps(shift, k, d)
+                                             for c in range(channels)])
+
+                    for decode in [0, 1]:
+                        for taps in tap_sets:
+                            if taps is None:
+                                args = (decode, bps, channels, samples)
+                            else:
+                                args = (decode, bps, channels, samples, taps)
+                            scalar = tta_filter("scalar", *args)
+                            for kernel in kernels:
+                                self.assertEqual(
+                                    tta_filter(kernel, *args), scalar,
+                                    "%s kernel mismatch at %d bps, "
+                                    "%d channels, %d frames" %
+                                    (kernel, bps, channels, pcm_frames))
+
+    @FORMAT_TTA
+    def test_exact_seek(self):
+        from audiotools.encoders import encode_tta
+
+        def sine():
+            return test_streams.Sine16_Stereo(200000, 44100,
+                                              441.0, 0.50,
+                                              4410.0, 0.49, 1.0)
+
+        encoded = BytesIO()
+        encode_tta(file=encoded,
+                   pcmreader=sine(),
+                   total_pcm_frames=200000)
+
+        for threads in [1, 2]:
+            # seeking should land on the requested PCM frame
+            # whether it's at the start, middle or end of a TTA frame
+            block_size = (44100 * 256) // 245
+            for offset in [0, 1, block_size - 1, block_size,
+                           block_size + 1, 100000, 199999]:
+                decoder = self.decoder(BytesIO(encoded.getvalue()),
+                                       threads=threads)
+                decoder.read(4096)
+                self.assertEqual(decoder.seek(offset), offset)
+                self.assertTrue(
+                    audiotools.pcm_cmp(decoder,
+                                       audiotools.PCMReaderDeHead(sine(),
+                                                                  offset)))
+
+            # seeking past the end lands at the end of the stream
+            decoder = self.decoder(BytesIO(encoded.getvalue()),
+                                   threads=threads)
+            self.assertEqual(decoder.seek(200000), 200000)
+            self.assertEqual(decoder.read(4096).frames, 0)
+            self.assertEqual(decoder.seek(2 ** 34), 200000)
+            self.assertEqual(decoder.read(4096).frames, 0)
+            decoder.close()
+
     @FORMAT_TTA
     def test_sines(self):
         for g in self.__stream_variations__():